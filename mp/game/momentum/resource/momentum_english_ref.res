@@ -54,9 +54,12 @@
         "MOM_Saveloc_Frame_Toggle" "Toggle All"
         "MOM_Saveloc_Frame_Obtaining" "Obtaining saveloc count..."
         "MOM_Saveloc_Frame_Downloading" "Downloading savelocs..."
+        "MOM_Saveloc_Frame_Progress" "Downloading savelocs... (%s1/%s2)"
         "MOM_Saveloc_Frame_Downloaded" "Savelocs downloaded."
         "MOM_Saveloc_Frame_Select" "Select savelocs to request."
         "MOM_Saveloc_Frame_Requester_Left" "The requester has left the lobby."
+        "MOM_Saveloc_Frame_Failed" "The savelocs could not be downloaded."
+        "MOM_Saveloc_Frame_Outdated" "This player's game is too old to send savelocs."
 
 
     //In-game leaderboards
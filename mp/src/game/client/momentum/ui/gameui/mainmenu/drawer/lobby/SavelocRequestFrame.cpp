@@ -4,6 +4,7 @@
 #include "vgui_controls/CheckButtonList.h"
 #include "vgui_controls/Label.h"
 #include "vgui_controls/Button.h"
+#include "vgui/ILocalize.h"
 #include "tier1/fmtstr.h"
 #include "mom_modulecomms.h"
 #include "mom_ghostdefs.h"
@@ -74,6 +75,11 @@ void SavelocReqFrame::FireEvent(KeyValues* pKv)
     {
         SetSavelocCount(pKv->GetInt("count"));
     }
+    else if (stage == SAVELOC_REQ_STAGE_PROGRESS)
+    {
+        m_pStatusLabel->SetText(CConstructLocalizedString(g_pVGuiLocalize->FindSafe("#MOM_Saveloc_Frame_Progress"),
+                                                          pKv->GetInt("received"), pKv->GetInt("total")));
+    }
     else if (stage == SAVELOC_REQ_STAGE_DONE)
     {
         m_pStatusLabel->SetText("#MOM_Saveloc_Frame_Downloaded");
@@ -83,9 +89,14 @@ void SavelocReqFrame::FireEvent(KeyValues* pKv)
         m_pRequestButton->SetEnabled(false);
         m_pToggleAllButton->SetEnabled(false);
     }
-    else if (stage == SAVELOC_REQ_STAGE_REQUESTER_LEFT)
+    else if (stage == SAVELOC_REQ_STAGE_REQUESTER_LEFT || stage == SAVELOC_REQ_STAGE_FAILED || stage == SAVELOC_REQ_STAGE_OUTDATED)
     {
-        m_pStatusLabel->SetText("#MOM_Saveloc_Frame_Requester_Left");
+        if (stage == SAVELOC_REQ_STAGE_FAILED)
+            m_pStatusLabel->SetText("#MOM_Saveloc_Frame_Failed");
+        else if (stage == SAVELOC_REQ_STAGE_OUTDATED)
+            m_pStatusLabel->SetText("#MOM_Saveloc_Frame_Outdated");
+        else
+            m_pStatusLabel->SetText("#MOM_Saveloc_Frame_Requester_Left");
         m_pRequestButton->SetEnabled(false);
         m_pSavelocSelect->SetEnabled(false);
         m_pToggleAllButton->SetEnabled(false);
@@ -21,6 +21,7 @@
 #include "mom_map_cache.h"
 #include "mom_api_requests.h"
 #include "run/mom_replay_factory.h"
+#include "run/mom_replay_index.h"
 #include "filesystem.h"
 #include "fmtstr.h"
 #include "mom_system_gamemode.h"
@@ -199,14 +200,15 @@ void CLeaderboardsTimes::OnRunPosted(bool bPosted)
 
 void CLeaderboardsTimes::OnRunSaved(const char *pFilePath)
 {
-    MomReplayAsyncHandle handle;
-    CUtlStringList tempName;
-    tempName.CopyAndAddToTail(pFilePath);
-
-    auto status = g_ReplayFactory.AsyncLoadReplaysByFilename(tempName, "MOD", UtlMakeDelegate(this, &CLeaderboardsTimes::LocalTimesCallback), handle);
+    const auto pReplay = g_ReplayFactory.LoadReplayFile(pFilePath, false);
+    if (pReplay)
+    {
+        // The server only indexes it in its own memory, the client's index is the one that gets saved
+        g_ReplayIndex.AddReplay(pReplay, pFilePath);
 
-    if (status == ASYNC_REPLAYS_INPROGRESS)
-        m_llReplayLocalRequests.AddToTail(handle);
+        m_vLocalTimes.Insert(pReplay);
+        FillLeaderboards(false);
+    }
 }
 
 void CLeaderboardsTimes::OnPanelShow(bool bShow)
@@ -361,23 +363,19 @@ void CLeaderboardsTimes::SetPlaceColors(SectionedListPanel* panel, TimeType_t ty
 
 void CLeaderboardsTimes::LoadLocalTimes()
 {
-    MomReplayAsyncHandle handle;
+    // Everything shown here lives in the replay index, no need to open the replay files themselves
+    CUtlVector<const ReplayIndexEntry_t *> vecRuns;
+    g_ReplayIndex.GetRunsForMap(g_pGameRules->MapName(), vecRuns);
 
-    auto status = g_ReplayFactory.AsyncLoadReplaysForMap(g_pGameRules->MapName(), UtlMakeDelegate(this, &CLeaderboardsTimes::LocalTimesCallback), handle);
-
-    if (status == ASYNC_REPLAYS_INPROGRESS)
-        m_llReplayLocalRequests.AddToTail(handle);
-
-}
+    FOR_EACH_VEC(vecRuns, i)
+    {
+        const auto pReplay = g_ReplayIndex.CreateReplayFromEntry(*vecRuns[i]);
+        if (pReplay)
+            m_vLocalTimes.Insert(pReplay);
+    }
 
-void CLeaderboardsTimes::LocalTimesCallback(MomReplayAsyncHandle handle)
-{
-    int idx = m_llReplayLocalRequests.Find(handle);
-    if (idx == -1)
-        return;
-    auto data = new KeyValues("LocalTimesReady");
-    data->SetInt("nRequestIndex", idx);
-    PostMessage(GetVPanel(), data);
+    if (!vecRuns.IsEmpty())
+        FillLeaderboards(false);
 }
 
 void CLeaderboardsTimes::LoadOnlineTimes(TimeType_t type)
@@ -946,6 +944,8 @@ void CLeaderboardsTimes::OnConfirmDeleteReplay(KeyValues *pData)
     m_pLocalLeaderboards->RemoveItem(pData->GetInt("itemID"));
     m_vLocalTimes.FindAndRemove(replay);
     g_pFullFileSystem->RemoveFile(replay->GetFilePath(), "MOD");
+    g_ReplayIndex.RemoveReplay(replay->GetFilePath());
+    delete replay;
 
 
     // MOM_TODO this is still synchoronous so it will lag
@@ -1111,34 +1111,9 @@ void CLeaderboardsTimes::OnItemContextMenu(KeyValues* pData)
 
 void CLeaderboardsTimes::LevelShutdown()
 {
-    FOR_EACH_LL(m_llReplayLocalRequests, i)
-    {
-        g_ReplayFactory.AsyncCleanup(m_llReplayLocalRequests[i]);
-    }
     m_vLocalTimes.PurgeAndDeleteElements();
 }
 
-void CLeaderboardsTimes::OnLocalTimesReady(int nRequestIndex)
-{
-    // This is not exactly optimal but requiring the return value of the replay
-    // factory to be sorted doesn't make sense either
-    CUtlVector<CMomReplayBase*> temp_vLocalTimes;
-
-    if (g_ReplayFactory.AsyncGetReplays(m_llReplayLocalRequests[nRequestIndex], temp_vLocalTimes) != ASYNC_REPLAYS_READY)
-        return;
-
-    // This should not cause multithreading headaches because testing showed VGUI will process messages sequentially
-    m_llReplayLocalRequests.Remove(nRequestIndex);
-
-    FOR_EACH_VEC(temp_vLocalTimes, i)
-    {
-        m_vLocalTimes.InsertNoSort(temp_vLocalTimes[i]);
-    }
-    m_vLocalTimes.RedoSort();
-
-    FillLeaderboards(false);
-}
-
 void CLeaderboardsTimes::SwitchPanel(Panel *pToPanel)
 {
     // To avoid inconsistent state, we start from scratch
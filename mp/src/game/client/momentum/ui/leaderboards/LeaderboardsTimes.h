@@ -60,7 +60,6 @@ class CLeaderboardsTimes : public vgui::EditablePanel
     void OnPanelShow(bool bShow);
 
     CUtlMap<HTTPRequestHandle, uint64> m_mapReplayDownloads;
-    CUtlLinkedList<MomReplayAsyncHandle> m_llReplayLocalRequests;
 
     // Sets up the icons used in the leaderboard
     void SetupDefaultIcons();
@@ -120,9 +119,6 @@ protected:
     MESSAGE_FUNC_UINT64(OnContextVisitProfile, "ContextVisitProfile", profile);
 
     void LoadLocalTimes();
-    // We take this detour so only the VGUI thread modifies our local times vector
-    MESSAGE_FUNC_INT(OnLocalTimesReady, "LocalTimesReady", nRequestIndex);
-    void LocalTimesCallback(MomReplayAsyncHandle handle);
 
     void ConvertLocalTimes(KeyValues *pKv);
 
@@ -180,6 +180,13 @@ void C_MOMReplayUI::OnNewProgress(float scale)
     int tickToGo = static_cast<int>(scale * m_iTotalDuration);
     if (tickToGo > -1 && tickToGo <= m_iTotalDuration)
     {
+        const auto pPlayer = C_MomentumPlayer::GetLocalMomPlayer();
+        const auto pEnt = pPlayer ? pPlayer->GetCurrentUIEntity() : nullptr;
+        if (pEnt && pEnt->GetEntType() == RUN_ENT_REPLAY && static_cast<C_MomentumReplayGhostEntity *>(pEnt)->m_iCurrentTick == tickToGo)
+            return;
+
+        // Seeking is random access on the server, so follow the cursor right away instead of waiting for the ghost
+        m_pProgress->SetProgress(clamp<float>(scale, 0.0f, 1.0f));
         engine->ServerCmd(VarArgs("mom_replay_goto %i", tickToGo));
     }
 }
@@ -262,7 +269,8 @@ void C_MOMReplayUI::OnCommand(const char *command)
         // Teleport at the position we want with timer included
         char tick[32];
         m_pGotoTick->GetText(tick, sizeof(tick));
-        engine->ServerCmd(CFmtStr("mom_replay_goto %s", tick));
+        if (tick[0])
+            engine->ServerCmd(CFmtStr("mom_replay_goto %s", tick));
         m_pGotoTick->SetText("");
     }
     else if (FStrEq("close", command))
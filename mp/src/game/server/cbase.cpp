@@ -84,6 +84,8 @@ OUTPUTS:
 #include "tier1/strtools.h"
 #include "datacache/imdlcache.h"
 #include "env_debughistory.h"
+#include "tier1/generichash.h"
+#include "tier1/fmtstr.h"
 
 #include "tier0/vprof.h"
 
@@ -646,6 +648,12 @@ CEventQueue::CEventQueue()
 {
 	m_Events.m_iFireTick = INT_MIN;
 	m_Events.m_pNext = nullptr;
+	m_iNextSerial = 0;
+	m_iQueryMark = 0;
+
+	SetDefLessFunc( m_TickTails );
+	SetDefLessFunc( m_EntityIndex );
+	SetDefLessFunc( m_NameIndex );
 
 	Init();
 }
@@ -769,6 +777,11 @@ void CEventQueue::Clear( void )
 	}
 
 	m_Events.m_pNext = NULL;
+
+	m_TickTails.RemoveAll();
+	m_EntityIndex.PurgeAndDeleteElements();
+	m_NameIndex.PurgeAndDeleteElements();
+	m_PatternEvents.RemoveAll();
 }
 
 void CEventQueue::Dump( void )
@@ -861,14 +874,22 @@ void CEventQueue::AddEvent( CBaseEntity *target, const char *action, float fireD
 //-----------------------------------------------------------------------------
 void CEventQueue::AddEvent( EventQueuePrioritizedEvent_t *newEvent )
 {
-	// loop through the actions looking for a place to insert
+	newEvent->m_iSerial = m_iNextSerial++;
+	newEvent->m_iQueryMark = m_iQueryMark;
+
+	// goes right after the last event firing on or before the same tick, so same-tick events keep the order they were added in
 	EventQueuePrioritizedEvent_t *pe;
-	for ( pe = &m_Events; pe->m_pNext != NULL; pe = pe->m_pNext )
+	int iTail = m_TickTails.Find( newEvent->m_iFireTick );
+	if ( m_TickTails.IsValidIndex( iTail ) )
 	{
-		if ( pe->m_pNext->m_iFireTick > newEvent->m_iFireTick )
-		{
-			break;
-		}
+		pe = m_TickTails[iTail];
+		m_TickTails[iTail] = newEvent;
+	}
+	else
+	{
+		iTail = m_TickTails.Insert( newEvent->m_iFireTick, newEvent );
+		const int iPrev = m_TickTails.PrevInorder( iTail );
+		pe = m_TickTails.IsValidIndex( iPrev ) ? m_TickTails[iPrev] : &m_Events;
 	}
 
 	Assert( pe );
@@ -881,18 +902,200 @@ void CEventQueue::AddEvent( EventQueuePrioritizedEvent_t *newEvent )
 	{
 		newEvent->m_pNext->m_pPrev = newEvent;
 	}
+
+	UpdateIndexes( newEvent, true );
 }
 
 void CEventQueue::RemoveEvent( EventQueuePrioritizedEvent_t *pe )
 {
 	Assert( pe->m_pPrev );
+
+	const int iTail = m_TickTails.Find( pe->m_iFireTick );
+	if ( m_TickTails.IsValidIndex( iTail ) && m_TickTails[iTail] == pe )
+	{
+		if ( pe->m_pPrev != &m_Events && pe->m_pPrev->m_iFireTick == pe->m_iFireTick )
+			m_TickTails[iTail] = pe->m_pPrev;
+		else
+			m_TickTails.RemoveAt( iTail );
+	}
+
 	pe->m_pPrev->m_pNext = pe->m_pNext;
 	if ( pe->m_pNext )
 	{
 		pe->m_pNext->m_pPrev = pe->m_pPrev;
 	}
+
+	UpdateIndexes( pe, false );
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Target names that can only be resolved against the entity list, rather than compared
+//			against one entity's name: procedural (!player), wildcards and regex
+//-----------------------------------------------------------------------------
+static bool IsPatternTargetName( const char *pszName )
+{
+	return pszName[0] == '!' || pszName[0] == '@' || strpbrk( pszName, "*?" ) != NULL;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Procedural names that resolve to the event's own activator or caller. The event is
+//			already filed under those handles, so the target name doesn't need an index of its own.
+//-----------------------------------------------------------------------------
+static bool IsActivatorOrCallerTargetName( const char *pszName )
+{
+	return FStrEq( pszName, "!activator" ) || FStrEq( pszName, "!caller" ) || FStrEq( pszName, "!self" );
+}
+
+void CEventQueue::UpdateIndexes( EventQueuePrioritizedEvent_t *pe, bool bAdd )
+{
+	if ( !bAdd )
+	{
+		for ( int i = 0; i < EVENTQUEUE_SLOT_COUNT; i++ )
+		{
+			EventQueueIndexEntry_t &entry = pe->m_IndexEntries[i];
+			if ( entry.m_iPos < 0 )
+				continue;
+
+			if ( i != EVENTQUEUE_SLOT_TARGETNAME )
+				RemoveFromIndex( m_EntityIndex, entry );
+			else if ( entry.m_iBucket == EventIndex_t::InvalidIndex() )
+				RemoveFromBucket( m_PatternEvents, entry );
+			else
+				RemoveFromIndex( m_NameIndex, entry );
+		}
+		return;
+	}
+
+	for ( int i = 0; i < EVENTQUEUE_SLOT_COUNT; i++ )
+	{
+		pe->m_IndexEntries[i].m_pEvent = pe;
+		pe->m_IndexEntries[i].m_iBucket = EventIndex_t::InvalidIndex();
+		pe->m_IndexEntries[i].m_iPos = -1;
+	}
+
+	// each entity only gets the event once, even if it's more than one of these
+	CBaseHandle handles[3] = { pe->m_pActivator, pe->m_pCaller, pe->m_pEntTarget };
+	for ( int i = 0; i < 3; i++ )
+	{
+		if ( !handles[i].IsValid() || ( i > 0 && handles[i] == handles[0] ) || ( i > 1 && handles[i] == handles[1] ) )
+			continue;
+
+		AddToIndex( m_EntityIndex, handles[i].ToInt(), pe->m_IndexEntries[i] );
+	}
+
+	// an empty name never finds anything
+	const char *pszTarget = STRING( pe->m_iTarget );
+	if ( pe->m_iTarget == NULL_STRING || !pszTarget[0] || IsActivatorOrCallerTargetName( pszTarget ) )
+		return;
+
+	if ( IsPatternTargetName( pszTarget ) )
+	{
+		AddToBucket( m_PatternEvents, pe->m_IndexEntries[EVENTQUEUE_SLOT_TARGETNAME] );
+	}
+	else
+	{
+		AddToIndex( m_NameIndex, HashStringCaseless( pszTarget ), pe->m_IndexEntries[EVENTQUEUE_SLOT_TARGETNAME] );
+	}
+}
+
+void CEventQueue::AddToIndex( EventIndex_t &index, unsigned int key, EventQueueIndexEntry_t &entry )
+{
+	int i = index.Find( key );
+	if ( !index.IsValidIndex( i ) )
+	{
+		i = index.Insert( key, new EventBucket_t );
+	}
+
+	entry.m_iBucket = i;
+	AddToBucket( *index[i], entry );
+}
+
+void CEventQueue::AddToBucket( EventBucket_t &bucket, EventQueueIndexEntry_t &entry )
+{
+	entry.m_iPos = bucket.AddToTail( &entry );
+}
+
+void CEventQueue::RemoveFromIndex( EventIndex_t &index, EventQueueIndexEntry_t &entry )
+{
+	const int i = entry.m_iBucket;
+	if ( !index.IsValidIndex( i ) )
+	{
+		Assert( 0 );
+		return;
+	}
+
+	EventBucket_t *pBucket = index[i];
+	RemoveFromBucket( *pBucket, entry );
+	if ( pBucket->IsEmpty() )
+	{
+		delete pBucket;
+		index.RemoveAt( i );
+	}
 }
 
+// moves the last entry into the hole, rather than searching the bucket or shifting it down
+void CEventQueue::RemoveFromBucket( EventBucket_t &bucket, EventQueueIndexEntry_t &entry )
+{
+	const int iPos = entry.m_iPos;
+	Assert( bucket.IsValidIndex( iPos ) && bucket[iPos] == &entry );
+
+	EventQueueIndexEntry_t *pLast = bucket.Tail();
+	bucket[iPos] = pLast;
+	pLast->m_iPos = iPos;
+	bucket.RemoveMultipleFromTail( 1 );
+
+	entry.m_iPos = -1;
+}
+
+void CEventQueue::GatherBucket( const EventBucket_t &bucket, CUtlVector<EventQueuePrioritizedEvent_t *> &vecOut )
+{
+	FOR_EACH_VEC( bucket, j )
+	{
+		EventQueuePrioritizedEvent_t *pe = bucket[j]->m_pEvent;
+		if ( pe->m_iQueryMark != m_iQueryMark )
+		{
+			pe->m_iQueryMark = m_iQueryMark;
+			vecOut.AddToTail( pe );
+		}
+	}
+}
+
+void CEventQueue::GatherBucket( const EventIndex_t &index, unsigned int key, CUtlVector<EventQueuePrioritizedEvent_t *> &vecOut )
+{
+	const int i = index.Find( key );
+	if ( index.IsValidIndex( i ) )
+	{
+		GatherBucket( *index[i], vecOut );
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Every event that could affect the entity, in no particular order. This is a superset,
+//			EventAffectsEntity still has the final say.
+//-----------------------------------------------------------------------------
+void CEventQueue::GatherEventsAffecting( CBaseEntity *pTarget, CUtlVector<EventQueuePrioritizedEvent_t *> &vecOut )
+{
+	m_iQueryMark++;
+
+	// also covers events targeting !activator or !caller when that's this entity
+	GatherBucket( m_EntityIndex, pTarget->GetRefEHandle().ToInt(), vecOut );
+
+	const char *pszName = STRING( pTarget->GetEntityName() );
+	if ( pTarget->GetEntityName() != NULL_STRING && pszName[0] )
+	{
+		GatherBucket( m_NameIndex, HashStringCaseless( pszName ), vecOut );
+	}
+
+	GatherBucket( m_PatternEvents, vecOut );
+}
+
+static int CompareEventOrder( EventQueuePrioritizedEvent_t * const *a, EventQueuePrioritizedEvent_t * const *b )
+{
+	if ( (*a)->m_iFireTick != (*b)->m_iFireTick )
+		return (*a)->m_iFireTick < (*b)->m_iFireTick ? -1 : 1;
+
+	return (*a)->m_iSerial < (*b)->m_iSerial ? -1 : ( (*a)->m_iSerial > (*b)->m_iSerial );
+}
 
 //-----------------------------------------------------------------------------
 // Purpose: fires off any events in the queue who's fire time is (or before) the present time
@@ -904,13 +1107,14 @@ void CEventQueue::ServiceEvents( void )
 		return;
 	}
 
+	ServiceEventsUntil( gpGlobals->tickcount );
+}
+
+void CEventQueue::ServiceEventsUntil( int iTick )
+{
 	EventQueuePrioritizedEvent_t *pe = m_Events.m_pNext;
 
-#ifdef TF_DLL
-	while ( pe != NULL && pe->m_flFireTime <= engine->GetServerTime() )
-#else
-	while ( pe != NULL && pe->m_iFireTick <= gpGlobals->tickcount )
-#endif
+	while ( pe != NULL && pe->m_iFireTick <= iTick )
 	{
 		MDLCACHE_CRITICAL_SECTION();
 
@@ -1009,6 +1213,152 @@ void CC_DumpEventQueue()
 }
 static ConCommand dumpeventqueue( "dumpeventqueue", CC_DumpEventQueue, "Dump the contents of the Entity I/O event queue to the console." );
 
+#define EVENTQUEUE_BENCHMARK_TARGETS	32
+#define EVENTQUEUE_BENCHMARK_TICKS		512
+
+//-----------------------------------------------------------------------------
+// Purpose: Times adding, looking up, cancelling, saving, restoring and servicing events on a scratch
+//			queue, spread over a set of throwaway entities the way map I/O is.
+//-----------------------------------------------------------------------------
+void CEventQueue::RunBenchmark( int iEvents, int iPasses )
+{
+	iEvents = Max( iEvents, EVENTQUEUE_BENCHMARK_TARGETS );
+	iPasses = Max( iPasses, 1 );
+
+	CBaseEntity *pTargets[EVENTQUEUE_BENCHMARK_TARGETS];
+	int iTargets;
+	for ( iTargets = 0; iTargets < EVENTQUEUE_BENCHMARK_TARGETS; iTargets++ )
+	{
+		CBaseEntity *pTarget = CreateEntityByName( "info_target" );
+		if ( !pTarget )
+			break;
+
+		pTarget->SetName( AllocPooledString( CFmtStr( "eventqueue_benchmark_%i", iTargets ) ) );
+		DispatchSpawn( pTarget );
+		pTargets[iTargets] = pTarget;
+	}
+
+	if ( iTargets < EVENTQUEUE_BENCHMARK_TARGETS )
+	{
+		Warning( "Couldn't create the entities for the event queue benchmark!\n" );
+		for ( int i = 0; i < iTargets; i++ )
+		{
+			UTIL_RemoveImmediate( pTargets[i] );
+		}
+		return;
+	}
+
+	variant_t value;
+	value.Set( FIELD_VOID, NULL );
+
+	CEventQueue queue;
+	CEventQueueState state, check, targetState;
+	enum { INSERT = 0, SAVE, RESTORE, TARGET, CANCEL, SERVICE, TIMING_COUNT };
+	double flElapsed[TIMING_COUNT] = { 0.0 };
+	int iMismatches = 0, iPending = 0;
+
+	for ( int iPass = 0; iPass < iPasses; iPass++ )
+	{
+		double flStart = Plat_FloatTime();
+		for ( int i = 0; i < iEvents; i++ )
+		{
+			CBaseEntity *pTarget = pTargets[i % EVENTQUEUE_BENCHMARK_TARGETS];
+			CBaseEntity *pCaller = pTargets[( i * 7 + 3 ) % EVENTQUEUE_BENCHMARK_TARGETS];
+			const float flDelay = ( ( i * 37 ) % EVENTQUEUE_BENCHMARK_TICKS ) * gpGlobals->interval_per_tick;
+
+			// a few by name, most outputs end up with a direct pointer
+			if ( i % 8 == 0 )
+				queue.AddEvent( STRING( pTarget->GetEntityName() ), "BenchmarkInput", value, flDelay, pCaller, pCaller, i );
+			else
+				queue.AddEvent( pTarget, "BenchmarkInput", value, flDelay, pCaller, pCaller, i );
+		}
+		flElapsed[INSERT] += Plat_FloatTime() - flStart;
+
+		flStart = Plat_FloatTime();
+		queue.SaveAll( state );
+		flElapsed[SAVE] += Plat_FloatTime() - flStart;
+
+		flStart = Plat_FloatTime();
+		queue.RestoreAll( state );
+		flElapsed[RESTORE] += Plat_FloatTime() - flStart;
+
+		// the restored queue has to fire in exactly the same order
+		queue.SaveAll( check );
+		if ( check.m_vecEvents.Count() != state.m_vecEvents.Count() )
+		{
+			iMismatches++;
+		}
+		else
+		{
+			FOR_EACH_VEC( state.m_vecEvents, i )
+			{
+				if ( check.m_vecEvents[i].m_iFireDelayTicks != state.m_vecEvents[i].m_iFireDelayTicks ||
+					 check.m_vecEvents[i].m_iOutputID != state.m_vecEvents[i].m_iOutputID )
+				{
+					iMismatches++;
+					break;
+				}
+			}
+		}
+
+		// what savelocs do for the player
+		flStart = Plat_FloatTime();
+		for ( int i = 0; i < EVENTQUEUE_BENCHMARK_TARGETS; i++ )
+		{
+			queue.SaveForTarget( pTargets[i], targetState );
+			queue.RestoreForTarget( pTargets[i], targetState );
+		}
+		flElapsed[TARGET] += Plat_FloatTime() - flStart;
+
+		flStart = Plat_FloatTime();
+		for ( int i = 0; i < EVENTQUEUE_BENCHMARK_TARGETS; i++ )
+		{
+			if ( queue.HasEventPending( pTargets[i], "BenchmarkInput" ) )
+				iPending++;
+
+			if ( i % 2 == 0 )
+				queue.CancelEventOn( pTargets[i], "BenchmarkInput" );
+		}
+		flElapsed[CANCEL] += Plat_FloatTime() - flStart;
+
+		flStart = Plat_FloatTime();
+		queue.ServiceEventsUntil( gpGlobals->tickcount + EVENTQUEUE_BENCHMARK_TICKS );
+		flElapsed[SERVICE] += Plat_FloatTime() - flStart;
+
+		if ( queue.m_Events.m_pNext )
+		{
+			iMismatches++;
+			queue.Clear();
+		}
+	}
+
+	for ( int i = 0; i < EVENTQUEUE_BENCHMARK_TARGETS; i++ )
+	{
+		UTIL_RemoveImmediate( pTargets[i] );
+	}
+
+	const char *pszNames[TIMING_COUNT] = { "Insert", "SaveAll", "RestoreAll", "Save/RestoreForTarget", "HasEventPending/CancelEventOn", "Service" };
+	Msg( "Event queue benchmark: %i events over %i entities, %i passes\n", iEvents, EVENTQUEUE_BENCHMARK_TARGETS, iPasses );
+	for ( int i = 0; i < TIMING_COUNT; i++ )
+	{
+		Msg( "  %-30s %.3f ms per pass\n", pszNames[i], flElapsed[i] * 1000.0 / iPasses );
+	}
+
+	if ( iPending != EVENTQUEUE_BENCHMARK_TARGETS * iPasses || iMismatches )
+		Warning( "The event queue lost or reordered events during the benchmark!\n" );
+}
+
+void CC_BenchmarkEventQueue( const CCommand &args )
+{
+	if ( !UTIL_IsCommandIssuedByServerAdmin() )
+		return;
+
+	const int iEvents = args.ArgC() > 1 ? atoi( args[1] ) : 4096;
+	const int iPasses = args.ArgC() > 2 ? atoi( args[2] ) : 10;
+	CEventQueue::RunBenchmark( iEvents, iPasses );
+}
+static ConCommand benchmarkeventqueue( "benchmarkeventqueue", CC_BenchmarkEventQueue, "Time the Entity I/O event queue's operations on a scratch queue. Usage: benchmarkeventqueue [events] [passes]", FCVAR_CHEAT );
+
 //-----------------------------------------------------------------------------
 // Purpose: Removes all pending events from the I/O queue that were added by the
 //			given caller.
@@ -1021,11 +1371,13 @@ void CEventQueue::CancelEvents( CBaseEntity *pCaller )
 	if (!pCaller)
 		return;
 
-	EventQueuePrioritizedEvent_t *pCur = m_Events.m_pNext;
+	CUtlVector<EventQueuePrioritizedEvent_t *> vecEvents;
+	m_iQueryMark++;
+	GatherBucket( m_EntityIndex, pCaller->GetRefEHandle().ToInt(), vecEvents );
 
-	while (pCur != NULL)
+	FOR_EACH_VEC( vecEvents, i )
 	{
-		bool bDelete = false;
+		EventQueuePrioritizedEvent_t *pCur = vecEvents[i];
 		if (pCur->m_pCaller == pCaller)
 		{
 			// Pointers match; make sure everything else matches.
@@ -1033,18 +1385,10 @@ void CEventQueue::CancelEvents( CBaseEntity *pCaller )
 				!stricmp(pCur->m_pCaller->GetClassname(), pCaller->GetClassname()))
 			{
 				// Found a matching event; delete it from the queue.
-				bDelete = true;
+				RemoveEvent( pCur );
+				delete pCur;
 			}
 		}
-
-		EventQueuePrioritizedEvent_t *pCurSave = pCur;
-		pCur = pCur->m_pNext;
-
-		if (bDelete)
-		{
-			RemoveEvent( pCurSave );
-			delete pCurSave;
-		}
 	}
 }
 
@@ -1074,28 +1418,22 @@ void CEventQueue::CancelEventOn( CBaseEntity *pTarget, const char *sInputName )
 	if (!pTarget)
 		return;
 
-	EventQueuePrioritizedEvent_t *pCur = m_Events.m_pNext;
+	CUtlVector<EventQueuePrioritizedEvent_t *> vecEvents;
+	GatherEventsAffecting( pTarget, vecEvents );
+
 	const size_t inputNameSize = sInputName ? strlen(sInputName) : 0;
-	while (pCur != nullptr)
+	FOR_EACH_VEC( vecEvents, i )
 	{
-		bool bDelete = false;
+		EventQueuePrioritizedEvent_t *pCur = vecEvents[i];
 		if (EventAffectsEntity(pCur, pTarget))
 		{
 			if (!sInputName || !Q_strncmp(STRING(pCur->m_iTargetInput), sInputName, inputNameSize))
 			{
 				// Found a matching event; delete it from the queue.
-				bDelete = true;
+				RemoveEvent( pCur );
+				delete pCur;
 			}
 		}
-
-		EventQueuePrioritizedEvent_t *pCurSave = pCur;
-		pCur = pCur->m_pNext;
-
-		if (bDelete)
-		{
-			RemoveEvent( pCurSave );
-			delete pCurSave;
-		}
 	}
 }
 
@@ -1109,17 +1447,18 @@ bool CEventQueue::HasEventPending( CBaseEntity *pTarget, const char *sInputName
 	if (!pTarget)
 		return false;
 
-	EventQueuePrioritizedEvent_t *pCur = m_Events.m_pNext;
+	CUtlVector<EventQueuePrioritizedEvent_t *> vecEvents;
+	GatherEventsAffecting( pTarget, vecEvents );
+
 	const size_t inputNameSize = sInputName ? strlen(sInputName) : 0;
-	while (pCur != nullptr)
+	FOR_EACH_VEC( vecEvents, i )
 	{
+		EventQueuePrioritizedEvent_t *pCur = vecEvents[i];
 		if (EventAffectsEntity(pCur, pTarget))
 		{
 			if (!sInputName || !Q_strncmp(STRING(pCur->m_iTargetInput), sInputName, inputNameSize))
 				return true;
 		}
-
-		pCur = pCur->m_pNext;
 	}
 
 	return false;
@@ -1264,15 +1603,22 @@ void CEventQueue::RestoreAll( const CEventQueueState &state )
 void CEventQueue::SaveForTarget( CBaseEntity *pTarget, CEventQueueState &state )
 {
 	state.m_vecEvents.RemoveAll();
-	for ( EventQueuePrioritizedEvent_t *pe = m_Events.m_pNext; pe != nullptr; pe = pe->m_pNext )
+
+	CUtlVector<EventQueuePrioritizedEvent_t *> vecEvents;
+	GatherEventsAffecting( pTarget, vecEvents );
+
+	// keep them in firing order
+	vecEvents.Sort( CompareEventOrder );
+
+	FOR_EACH_VEC( vecEvents, i )
 	{
 		// Only add the event if it affects the entity of interest
-		if (EventAffectsEntity(pe, pTarget))
+		if (EventAffectsEntity(vecEvents[i], pTarget))
 		{
 			state.m_vecEvents.AddToTail();
 
 			CEventQueueEvent &e = state.m_vecEvents.Tail();
-			e.FromPrioritizedEvent( pe, pTarget );
+			e.FromPrioritizedEvent( vecEvents[i], pTarget );
 		}
 	}
 }
@@ -1445,6 +1791,91 @@ void CEventQueueState::SaveToKeyValues( KeyValues *kv ) const
 	kv->AddSubKey( events );
 }
 
+// Empty strings come back as NULL_STRING, rather than pointing into whatever buffer they were read from
+static string_t ReadPooledString( CUtlBuffer &buf )
+{
+	char szString[1024];
+	buf.GetString( szString );
+	return szString[0] ? AllocPooledString( szString ) : NULL_STRING;
+}
+
+bool CEventQueueEvent::CanWrite() const
+{
+	return m_VariantValue.FieldType() != FIELD_CLASSPTR;
+}
+
+void CEventQueueEvent::WriteToBuffer( CUtlBuffer &buf ) const
+{
+	buf.PutInt( m_iFireDelayTicks );
+	buf.PutString( STRING( m_iTarget ) );
+	buf.PutString( STRING( m_iTargetInput ) );
+	buf.PutString( STRING( m_szActivator ) );
+	buf.PutInt( m_iCaller );
+	buf.PutInt( m_iOutputID );
+	buf.PutString( STRING( m_szEntTarget ) );
+	buf.PutUnsignedChar( m_VariantValue.FieldType() );
+	buf.PutString( m_VariantValue.String() );
+	buf.PutUnsignedChar( ( m_bAbstractTarget ? 1 : 0 ) | ( m_bAbstractActivator ? 2 : 0 ) | ( m_bAbstractCaller ? 4 : 0 ) );
+}
+
+bool CEventQueueEvent::ReadFromBuffer( CUtlBuffer &buf )
+{
+	m_iFireDelayTicks = buf.GetInt();
+	m_iTarget = ReadPooledString( buf );
+	m_iTargetInput = ReadPooledString( buf );
+	m_szActivator = ReadPooledString( buf );
+	m_iCaller = buf.GetInt();
+	m_iOutputID = buf.GetInt();
+	m_szEntTarget = ReadPooledString( buf );
+
+	const fieldtype_t fieldtype = (fieldtype_t)buf.GetUnsignedChar();
+	m_VariantValue.SetString( ReadPooledString( buf ) );
+	m_VariantValue.Convert( fieldtype );
+
+	const unsigned char abstractFlags = buf.GetUnsignedChar();
+	m_bAbstractTarget = ( abstractFlags & 1 ) != 0;
+	m_bAbstractActivator = ( abstractFlags & 2 ) != 0;
+	m_bAbstractCaller = ( abstractFlags & 4 ) != 0;
+
+	return buf.IsValid();
+}
+
+void CEventQueueState::WriteToBuffer( CUtlBuffer &buf ) const
+{
+	int count = 0;
+	FOR_EACH_VEC( m_vecEvents, i )
+	{
+		if ( m_vecEvents[i].CanWrite() )
+			count++;
+	}
+
+	buf.PutInt( count );
+	FOR_EACH_VEC( m_vecEvents, i )
+	{
+		if ( m_vecEvents[i].CanWrite() )
+			m_vecEvents[i].WriteToBuffer( buf );
+	}
+}
+
+bool CEventQueueState::ReadFromBuffer( CUtlBuffer &buf )
+{
+	m_vecEvents.RemoveAll();
+
+	const int count = buf.GetInt();
+	if ( !buf.IsValid() || count < 0 || count > buf.GetBytesRemaining() )
+		return false;
+
+	m_vecEvents.EnsureCapacity( count );
+	for ( int i = 0; i < count; i++ )
+	{
+		m_vecEvents.AddToTail();
+		if ( !m_vecEvents.Tail().ReadFromBuffer( buf ) )
+			return false;
+	}
+
+	return true;
+}
+
 ////////////////////////// variant_t implementation //////////////////////////
 
 // BUGBUG: Add support for function pointer save/restore to variants
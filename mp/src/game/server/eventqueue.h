@@ -15,6 +15,29 @@
 #endif
 
 #include "mempool.h"
+#include "utlmap.h"
+
+class CUtlBuffer;
+struct EventQueuePrioritizedEvent_t;
+
+// The indexes an event can be filed under
+enum EventQueueIndexSlot_t
+{
+	EVENTQUEUE_SLOT_ACTIVATOR = 0,
+	EVENTQUEUE_SLOT_CALLER,
+	EVENTQUEUE_SLOT_ENTTARGET,
+	EVENTQUEUE_SLOT_TARGETNAME,		// the name index, or the pattern list
+
+	EVENTQUEUE_SLOT_COUNT
+};
+
+// Where an event sits in one index bucket, so it can be taken out without searching the bucket
+struct EventQueueIndexEntry_t
+{
+	EventQueuePrioritizedEvent_t *m_pEvent;
+	int m_iBucket;	// element of the index map, or the map's invalid index for the pattern list
+	int m_iPos;		// position in the bucket, -1 if the event isn't filed here
+};
 
 struct EventQueuePrioritizedEvent_t
 {
@@ -31,6 +54,11 @@ struct EventQueuePrioritizedEvent_t
 	EventQueuePrioritizedEvent_t *m_pNext;
 	EventQueuePrioritizedEvent_t *m_pPrev;
 
+	// Not saved, only used by the queue's indexes
+	unsigned int m_iSerial;		// insertion order, events with the same fire tick fire in this order
+	unsigned int m_iQueryMark;	// last lookup that visited this event, so it isn't visited twice
+	EventQueueIndexEntry_t m_IndexEntries[EVENTQUEUE_SLOT_COUNT];
+
 	DECLARE_SIMPLE_DATADESC();
 
 	DECLARE_FIXEDSIZE_ALLOCATOR( PrioritizedEvent_t );
@@ -43,6 +71,9 @@ public:
 	void ToPrioritizedEvent( EventQueuePrioritizedEvent_t *pe, CBaseEntity *pAbstractedEntity ) const;
 	void LoadFromKeyValues( KeyValues* kv );
 	void SaveToKeyValues( KeyValues* kv ) const;
+	bool CanWrite() const;
+	void WriteToBuffer( CUtlBuffer &buf ) const;
+	bool ReadFromBuffer( CUtlBuffer &buf );
 public:
 	int m_iFireDelayTicks;
 	string_t m_iTarget;
@@ -67,6 +98,8 @@ class CEventQueueState
 public:
 	void LoadFromKeyValues( KeyValues* kv );
 	void SaveToKeyValues( KeyValues* kv ) const;
+	void WriteToBuffer( CUtlBuffer &buf ) const;
+	bool ReadFromBuffer( CUtlBuffer &buf );
 public:
 	CUtlVector<CEventQueueEvent> m_vecEvents;
 };
@@ -90,6 +123,9 @@ public:
 	// debugging
 	void ValidateQueue( void );
 
+	// times the queue operations on a scratch queue
+	static void RunBenchmark( int iEvents, int iPasses );
+
 	// serialization
 	int Save( ISave &save );
 	int Restore( IRestore &restore );
@@ -108,13 +144,33 @@ public:
 	void Dump( void );
 
 private:
+	typedef CUtlVector<EventQueueIndexEntry_t *> EventBucket_t;
+	typedef CUtlMap<unsigned int, EventBucket_t *, int> EventIndex_t;
 
 	void AddEvent( EventQueuePrioritizedEvent_t *event );
 	void RemoveEvent( EventQueuePrioritizedEvent_t *pe );
+	void ServiceEventsUntil( int iTick );
+
+	void UpdateIndexes( EventQueuePrioritizedEvent_t *pe, bool bAdd );
+	void AddToIndex( EventIndex_t &index, unsigned int key, EventQueueIndexEntry_t &entry );
+	void AddToBucket( EventBucket_t &bucket, EventQueueIndexEntry_t &entry );
+	void RemoveFromIndex( EventIndex_t &index, EventQueueIndexEntry_t &entry );
+	void RemoveFromBucket( EventBucket_t &bucket, EventQueueIndexEntry_t &entry );
+	void GatherEventsAffecting( CBaseEntity *pTarget, CUtlVector<EventQueuePrioritizedEvent_t *> &vecOut );
+	void GatherBucket( const EventBucket_t &bucket, CUtlVector<EventQueuePrioritizedEvent_t *> &vecOut );
+	void GatherBucket( const EventIndex_t &index, unsigned int key, CUtlVector<EventQueuePrioritizedEvent_t *> &vecOut );
 
 	DECLARE_SIMPLE_DATADESC();
 	EventQueuePrioritizedEvent_t m_Events;
 	int m_iListCount;
+
+	// The list above stays the firing order. These index into it so nothing has to walk it:
+	CUtlMap<int, EventQueuePrioritizedEvent_t *, int> m_TickTails;	// fire tick -> the last event firing on that tick
+	EventIndex_t m_EntityIndex;				// activator/caller/target ehandle -> events referencing it
+	EventIndex_t m_NameIndex;				// caseless hash of a plain target name -> events targeting it
+	EventBucket_t m_PatternEvents;			// targets with wildcards or procedural names that aren't the activator or caller, these can match anything
+	unsigned int m_iNextSerial;
+	unsigned int m_iQueryMark;
 };
 
 extern CEventQueue g_EventQueue;
@@ -121,6 +121,12 @@ bool CMomentumGhostClient::SendSavelocReqPacket(CSteamID& target, SavelocReqPack
     return g_pMomentumLobbySystem->SendSavelocReqPacket(target, packet);
 }
 
+bool CMomentumGhostClient::CanPeerTransferSavelocs(const CSteamID &target)
+{
+    // MOM_TODO: g_pMomentumServerSystem->CanPeerTransferSavelocs(target);
+    return g_pMomentumLobbySystem->CanPeerTransferSavelocs(target.ConvertToUint64());
+}
+
 bool CMomentumGhostClient::IsInOnlineSession()
 {
     return g_pMomentumLobbySystem->LobbyValid(); /*MOM_TODO: || g_pMomentumServerSystem->ServerValid();*/
@@ -163,6 +169,7 @@ bool CMomentumGhostClient::CreateNewNetFrame(PositionPacket &into)
             vel,
             pPlayer->GetViewOffset().z,
             pPlayer->m_nButtons);
+        into.SendTime = gpGlobals->curtime;
 
         return true;
     }
@@ -29,6 +29,7 @@ public:
     void SetSpectatorTarget(CSteamID target, bool bStartedSpectating, bool bLeft = false);
     void SendDecalPacket(DecalPacket *packet);
     bool SendSavelocReqPacket(CSteamID &target, SavelocReqPacket *packet);
+    bool CanPeerTransferSavelocs(const CSteamID &target);
 
     bool IsInOnlineSession();
 
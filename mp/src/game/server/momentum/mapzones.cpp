@@ -96,12 +96,14 @@ CMapZoneSystem::CMapZoneSystem() : CAutoGameSystemPerFrame("CMapZoneSystem"), m_
 void CMapZoneSystem::LevelInitPreEntity()
 {
     ClearMapZones();
+    m_ZoneBVH.Clear();
 }
 
 void CMapZoneSystem::LevelInitPostEntity()
 {
     m_Editor.LevelInit();
     CalculateZoneCounts();
+    m_ZoneBVH.MarkDirty();
 }
 
 void CMapZoneSystem::LevelShutdownPreEntity()
@@ -119,6 +121,7 @@ void CMapZoneSystem::LevelShutdownPreEntity()
 void CMapZoneSystem::LevelShutdownPostEntity()
 {
     m_Editor.LevelShutdown();
+    m_ZoneBVH.Clear();
 }
 
 void CMapZoneSystem::FrameUpdatePostEntityThink()
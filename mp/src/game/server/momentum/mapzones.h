@@ -1,5 +1,6 @@
 #pragma once
 
+#include "mapzones_bvh.h"
 #include "mapzones_edit.h"
 #include "mom_shareddefs.h"
 
@@ -29,6 +30,8 @@ public:
     void SaveZonesToFile();
 
     CMapZoneEdit *GetZoneEditor() { return &m_Editor; }
+    // Spatial index of the zone and trigger hulls, mark it dirty whenever one is created or changed
+    CMapZoneBVH *GetZoneBVH() { return &m_ZoneBVH; }
 
     // Calculates the stage count
     void CalculateZoneCounts();
@@ -43,6 +46,7 @@ private:
 
     bool m_bLoadedFromSite;
     CMapZoneEdit m_Editor;
+    CMapZoneBVH m_ZoneBVH;
     CUtlVector<CMapZone*> m_Zones;
 
     // The number of zones for a given track
@@ -1,6 +1,7 @@
 #include "cbase.h"
 
 #include "mom_triggers.h"
+#include "mapzones.h"
 #include "mapzones_build.h"
 #include "fmtstr.h"
 
@@ -310,6 +311,8 @@ void CMomPointZoneBuilder::FinishZone(CBaseMomZoneTrigger *pEnt)
     pEnt->m_vecZonePoints.CopyArray(m_vPoints.Base(), m_vPoints.Count());
     pEnt->NetworkStateChanged(&pEnt->m_vecZonePoints);
     pEnt->m_flZoneHeight = GetHeight();
+
+    g_MapZoneSystem.GetZoneBVH()->MarkDirty();
 }
 
 void CMomPointZoneBuilder::Add(CBasePlayer *pPlayer, const Vector &vecAim)
@@ -1008,6 +1011,8 @@ void CMomBoxZoneBuilder::FinishZone(CBaseMomZoneTrigger *pEnt)
     pEnt->m_vecZonePoints.AddToTail(Vector(m_vecEnd.x, m_vecEnd.y, m_vecStart.z)); // bottom right
     pEnt->m_vecZonePoints.AddToTail(Vector(m_vecStart.x, m_vecEnd.y, m_vecStart.z)); // bottom left 
     pEnt->NetworkStateChanged(&pEnt->m_vecZonePoints);
+
+    g_MapZoneSystem.GetZoneBVH()->MarkDirty();
 }
 
 void CMomBoxZoneBuilder::SetBounds(const Vector &wmins, const Vector &wmaxs)
@@ -0,0 +1,275 @@
+#include "cbase.h"
+
+#include "mapzones_bvh.h"
+
+#include "collisionutils.h"
+#include "mom_triggers.h"
+
+#include "tier0/memdbgon.h"
+
+// Most entries in a leaf node
+#define ZONE_BVH_LEAF_SIZE 4
+// Deepest the tree can get, also bounds the traversal stack
+#define ZONE_BVH_MAX_DEPTH 32
+
+CMapZoneBVH::CMapZoneBVH() : m_bDirty(true)
+{
+}
+
+void CMapZoneBVH::Clear()
+{
+    m_vecEntries.Purge();
+    m_vecNodes.Purge();
+    m_vecDynamicEntries.Purge();
+    m_bDirty = true;
+}
+
+void CMapZoneBVH::Rebuild()
+{
+    m_vecEntries.RemoveAll();
+    m_vecNodes.RemoveAll();
+    m_vecDynamicEntries.RemoveAll();
+    m_bDirty = false;
+
+    // Class names are only compared here, never per query
+    for (auto pEnt = gEntList.FirstEnt(); pEnt; pEnt = gEntList.NextEnt(pEnt))
+    {
+        int iFlags;
+        if (FClassnameIs(pEnt, "trigger_teleport") || FClassnameIs(pEnt, "trigger_momentum_teleport"))
+        {
+            iFlags = ZONE_QUERY_TELEPORT;
+        }
+        else
+        {
+            const auto pZone = dynamic_cast<CBaseMomZoneTrigger *>(pEnt);
+            if (pZone)
+                iFlags = ZoneTypeToQueryFlag(pZone->GetZoneType());
+            else if (dynamic_cast<CBaseMomentumTrigger *>(pEnt))
+                iFlags = ZONE_QUERY_OTHER;
+            else
+                continue;
+        }
+
+        Entry_t entry;
+        entry.m_hEntity = pEnt;
+        entry.m_iFlags = iFlags;
+        pEnt->CollisionProp()->WorldSpaceSurroundingBounds(&entry.m_vecMins, &entry.m_vecMaxs);
+
+        if (pEnt->GetMoveParent() || pEnt->GetMoveType() != MOVETYPE_NONE)
+            m_vecDynamicEntries.AddToTail(entry);
+        else
+            m_vecEntries.AddToTail(entry);
+    }
+
+    if (!m_vecEntries.IsEmpty())
+    {
+        m_vecNodes.EnsureCapacity(2 * m_vecEntries.Count());
+        m_vecNodes.AddToTail();
+        BuildNode(0, 0, m_vecEntries.Count(), 0);
+    }
+
+    DevLog("Built the zone BVH with %i static and %i dynamic triggers (%i nodes)\n", m_vecEntries.Count(),
+           m_vecDynamicEntries.Count(), m_vecNodes.Count());
+}
+
+void CMapZoneBVH::BuildNode(int iNode, int iFirst, int iCount, int iDepth)
+{
+    Vector vecMins(FLT_MAX, FLT_MAX, FLT_MAX), vecMaxs(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+    Vector vecCenterMins = vecMins, vecCenterMaxs = vecMaxs;
+    int iFlags = 0;
+
+    for (int i = iFirst; i < iFirst + iCount; i++)
+    {
+        const auto &entry = m_vecEntries[i];
+        VectorMin(vecMins, entry.m_vecMins, vecMins);
+        VectorMax(vecMaxs, entry.m_vecMaxs, vecMaxs);
+
+        const Vector vecCenter = (entry.m_vecMins + entry.m_vecMaxs) * 0.5f;
+        VectorMin(vecCenterMins, vecCenter, vecCenterMins);
+        VectorMax(vecCenterMaxs, vecCenter, vecCenterMaxs);
+
+        iFlags |= entry.m_iFlags;
+    }
+
+    m_vecNodes[iNode].m_vecMins = vecMins;
+    m_vecNodes[iNode].m_vecMaxs = vecMaxs;
+    m_vecNodes[iNode].m_iFlags = iFlags;
+    m_vecNodes[iNode].m_iChild = -1;
+    m_vecNodes[iNode].m_iFirstEntry = iFirst;
+    m_vecNodes[iNode].m_iEntryCount = iCount;
+
+    if (iCount <= ZONE_BVH_LEAF_SIZE || iDepth >= ZONE_BVH_MAX_DEPTH - 1)
+        return;
+
+    // Split at the middle of the centers along their longest axis
+    const Vector vecCenterSize = vecCenterMaxs - vecCenterMins;
+    int iAxis = 0;
+    if (vecCenterSize.y > vecCenterSize[iAxis])
+        iAxis = 1;
+    if (vecCenterSize.z > vecCenterSize[iAxis])
+        iAxis = 2;
+
+    const float flSplit = (vecCenterMins[iAxis] + vecCenterMaxs[iAxis]) * 0.5f;
+
+    int iLeft = iFirst, iRight = iFirst + iCount - 1;
+    while (iLeft <= iRight)
+    {
+        const auto &entry = m_vecEntries[iLeft];
+        if ((entry.m_vecMins[iAxis] + entry.m_vecMaxs[iAxis]) * 0.5f < flSplit)
+        {
+            iLeft++;
+        }
+        else
+        {
+            V_swap(m_vecEntries[iLeft], m_vecEntries[iRight]);
+            iRight--;
+        }
+    }
+
+    // Every center in the same spot, just halve them
+    int iLeftCount = iLeft - iFirst;
+    if (iLeftCount == 0 || iLeftCount == iCount)
+        iLeftCount = iCount / 2;
+
+    const int iChild = m_vecNodes.AddMultipleToTail(2);
+    m_vecNodes[iNode].m_iChild = iChild;
+    m_vecNodes[iNode].m_iEntryCount = 0;
+
+    BuildNode(iChild, iFirst, iLeftCount, iDepth + 1);
+    BuildNode(iChild + 1, iFirst + iLeftCount, iCount - iLeftCount, iDepth + 1);
+}
+
+bool CMapZoneBVH::ClipToEntry(const Ray_t &ray, const Entry_t &entry, int iQueryFlags, trace_t &best, CBaseEntity *&pBest)
+{
+    if (!(entry.m_iFlags & iQueryFlags))
+        return false;
+
+    const auto pEnt = entry.m_hEntity.Get();
+    if (!pEnt || !pEnt->IsSolidFlagSet(FSOLID_TRIGGER))
+        return false;
+
+    if (!IsBoxIntersectingRay(entry.m_vecMins - ray.m_Extents, entry.m_vecMaxs + ray.m_Extents, ray.m_Start, ray.m_Delta))
+        return false;
+
+    // The bounds are only conservative, point zones need their own hull checked
+    trace_t tr;
+    enginetrace->ClipRayToEntity(ray, MASK_ALL, pEnt, &tr);
+
+    if (!(tr.fraction < 1.0f || tr.startsolid))
+        return false;
+
+    if (pBest && tr.fraction >= best.fraction)
+        return false;
+
+    best = tr;
+    pBest = pEnt;
+    return true;
+}
+
+CBaseEntity *CMapZoneBVH::TraceRay(const Ray_t &ray, int iQueryFlags, trace_t *pTrace)
+{
+    if (m_bDirty)
+        Rebuild();
+
+    trace_t best;
+    CBaseEntity *pBest = nullptr;
+
+    if (!m_vecNodes.IsEmpty())
+    {
+        int stack[ZONE_BVH_MAX_DEPTH * 2];
+        int iStackSize = 0;
+        stack[iStackSize++] = 0;
+
+        while (iStackSize > 0)
+        {
+            const auto &node = m_vecNodes[stack[--iStackSize]];
+
+            if (!(node.m_iFlags & iQueryFlags))
+                continue;
+
+            if (!IsBoxIntersectingRay(node.m_vecMins - ray.m_Extents, node.m_vecMaxs + ray.m_Extents, ray.m_Start, ray.m_Delta))
+                continue;
+
+            if (node.m_iEntryCount > 0)
+            {
+                for (int i = node.m_iFirstEntry; i < node.m_iFirstEntry + node.m_iEntryCount; i++)
+                {
+                    ClipToEntry(ray, m_vecEntries[i], iQueryFlags, best, pBest);
+                }
+            }
+            else
+            {
+                stack[iStackSize++] = node.m_iChild;
+                stack[iStackSize++] = node.m_iChild + 1;
+            }
+        }
+    }
+
+    FOR_EACH_VEC(m_vecDynamicEntries, i)
+    {
+        auto &entry = m_vecDynamicEntries[i];
+        const auto pEnt = entry.m_hEntity.Get();
+        if (!pEnt)
+            continue;
+
+        pEnt->CollisionProp()->WorldSpaceSurroundingBounds(&entry.m_vecMins, &entry.m_vecMaxs);
+        ClipToEntry(ray, entry, iQueryFlags, best, pBest);
+    }
+
+    if (pBest && pTrace)
+        *pTrace = best;
+
+    return pBest;
+}
+
+void CMapZoneBVH::FindTriggersInBox(const Vector &vecMins, const Vector &vecMaxs, int iQueryFlags, CUtlVector<CBaseEntity *> &vecOut)
+{
+    if (m_bDirty)
+        Rebuild();
+
+    if (!m_vecNodes.IsEmpty())
+    {
+        int stack[ZONE_BVH_MAX_DEPTH * 2];
+        int iStackSize = 0;
+        stack[iStackSize++] = 0;
+
+        while (iStackSize > 0)
+        {
+            const auto &node = m_vecNodes[stack[--iStackSize]];
+
+            if (!(node.m_iFlags & iQueryFlags) || !IsBoxIntersectingBox(vecMins, vecMaxs, node.m_vecMins, node.m_vecMaxs))
+                continue;
+
+            if (node.m_iEntryCount > 0)
+            {
+                for (int i = node.m_iFirstEntry; i < node.m_iFirstEntry + node.m_iEntryCount; i++)
+                {
+                    const auto &entry = m_vecEntries[i];
+                    if (!(entry.m_iFlags & iQueryFlags) || !IsBoxIntersectingBox(vecMins, vecMaxs, entry.m_vecMins, entry.m_vecMaxs))
+                        continue;
+
+                    const auto pEnt = entry.m_hEntity.Get();
+                    if (pEnt && pEnt->IsSolidFlagSet(FSOLID_TRIGGER))
+                        vecOut.AddToTail(pEnt);
+                }
+            }
+            else
+            {
+                stack[iStackSize++] = node.m_iChild;
+                stack[iStackSize++] = node.m_iChild + 1;
+            }
+        }
+    }
+
+    FOR_EACH_VEC(m_vecDynamicEntries, i)
+    {
+        auto &entry = m_vecDynamicEntries[i];
+        const auto pEnt = entry.m_hEntity.Get();
+        if (!pEnt || !(entry.m_iFlags & iQueryFlags) || !pEnt->IsSolidFlagSet(FSOLID_TRIGGER))
+            continue;
+
+        pEnt->CollisionProp()->WorldSpaceSurroundingBounds(&entry.m_vecMins, &entry.m_vecMaxs);
+        if (IsBoxIntersectingBox(vecMins, vecMaxs, entry.m_vecMins, entry.m_vecMaxs))
+            vecOut.AddToTail(pEnt);
+    }
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "mom_shareddefs.h"
+
+// Kinds of trigger a zone BVH query looks at, the zone ones line up with MomZoneType_t
+enum ZoneQueryFlags_t
+{
+    ZONE_QUERY_STOP = 1 << ZONE_TYPE_STOP,
+    ZONE_QUERY_START = 1 << ZONE_TYPE_START,
+    ZONE_QUERY_STAGE = 1 << ZONE_TYPE_STAGE,
+    ZONE_QUERY_CHECKPOINT = 1 << ZONE_TYPE_CHECKPOINT,
+    ZONE_QUERY_TRICK = 1 << ZONE_TYPE_TRICK,
+    ZONE_QUERY_TELEPORT = 1 << ZONE_TYPE_COUNT, // trigger_teleport and trigger_momentum_teleport
+    ZONE_QUERY_OTHER = 1 << (ZONE_TYPE_COUNT + 1), // Every other momentum trigger
+
+    ZONE_QUERY_ZONES = ZONE_QUERY_STOP | ZONE_QUERY_START | ZONE_QUERY_STAGE | ZONE_QUERY_CHECKPOINT | ZONE_QUERY_TRICK,
+    ZONE_QUERY_ALL = ZONE_QUERY_ZONES | ZONE_QUERY_TELEPORT | ZONE_QUERY_OTHER,
+};
+
+inline int ZoneTypeToQueryFlag(int zoneType)
+{
+    return zoneType > ZONE_TYPE_INVALID && zoneType < ZONE_TYPE_COUNT ? 1 << zoneType : ZONE_QUERY_OTHER;
+}
+
+// Bounding volume hierarchy over the map's zone and trigger hulls, so zone lookups
+// don't need to go through the engine's entity enumeration and compare class names.
+// It's rebuilt lazily on the next query after being marked dirty.
+class CMapZoneBVH
+{
+public:
+    CMapZoneBVH();
+
+    void MarkDirty() { m_bDirty = true; }
+    void Clear();
+
+    // The closest trigger of the given kinds the ray hits. The trace against its actual hull goes into pTrace.
+    CBaseEntity *TraceRay(const Ray_t &ray, int iQueryFlags, trace_t *pTrace = nullptr);
+    // Every trigger of the given kinds whose bounds overlap the box, the hulls themselves aren't tested
+    void FindTriggersInBox(const Vector &vecMins, const Vector &vecMaxs, int iQueryFlags, CUtlVector<CBaseEntity *> &vecOut);
+
+private:
+    struct Entry_t
+    {
+        EHANDLE m_hEntity;
+        Vector m_vecMins;
+        Vector m_vecMaxs;
+        int m_iFlags;
+    };
+
+    struct Node_t
+    {
+        Vector m_vecMins;
+        Vector m_vecMaxs;
+        int m_iFlags; // All of the flags below this node, for pruning typed queries
+        int m_iChild; // Internal nodes: the left child, the right one comes right after it
+        int m_iFirstEntry; // Leaves: the entries in m_vecEntries
+        int m_iEntryCount; // 0 for internal nodes
+    };
+
+    void Rebuild();
+    void BuildNode(int iNode, int iFirst, int iCount, int iDepth);
+
+    bool ClipToEntry(const Ray_t &ray, const Entry_t &entry, int iQueryFlags, trace_t &best, CBaseEntity *&pBest);
+
+    bool m_bDirty;
+    CUtlVector<Entry_t> m_vecEntries;
+    CUtlVector<Node_t> m_vecNodes;
+    // Parented or moving triggers, their bounds are re-read on every query
+    CUtlVector<Entry_t> m_vecDynamicEntries;
+};
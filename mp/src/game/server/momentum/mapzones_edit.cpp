@@ -7,7 +7,6 @@
 #include "mom_timer.h"
 #include "mom_triggers.h"
 #include "movevars_shared.h"
-#include "trigger_trace_enums.h"
 
 #include "tier0/memdbgon.h"
 
@@ -213,10 +212,8 @@ CON_COMMAND_F(mom_zone_info,
     Ray_t ray;
     ray.Init(start, end, pPlayer->CollisionProp()->OBBMins(), pPlayer->CollisionProp()->OBBMaxs());
 
-    // Only EnumerateEntities can hit triggers, normal TraceRay can't
-    CZoneTriggerTraceEnum zoneTriggerTraceEnum;
-    enginetrace->EnumerateEntities(ray, true, &zoneTriggerTraceEnum);
-    CBaseMomentumTrigger *pZone = zoneTriggerTraceEnum.GetZone();
+    // Normal TraceRay can't hit triggers
+    const auto pZone = g_MapZoneSystem.GetZoneBVH()->TraceRay(ray, ZONE_QUERY_ZONES);
     int zoneidx = pZone ? pZone->entindex() : -1;
     int zonetype = pZone ? g_MapZoneSystem.GetZoneEditor()->GetEntityZoneType(pZone) : -1;
 
@@ -0,0 +1,305 @@
+#include "cbase.h"
+
+#include "mapzones_sweep.h"
+
+#include "mapzones.h"
+#include "mom_triggers.h"
+
+#include "tier0/memdbgon.h"
+
+// How far off a hull edge a zone point can be before the zone counts as concave
+#define ZONE_SWEEP_CONVEX_EPSILON 0.1f
+
+static float Cross2D(const Vector2D &o, const Vector2D &a, const Vector2D &b)
+{
+    return (a.x - o.x) * (b.y - o.y) - (a.y - o.y) * (b.x - o.x);
+}
+
+static int ComparePoints2D(const Vector2D *a, const Vector2D *b)
+{
+    if (a->x != b->x)
+        return a->x < b->x ? -1 : 1;
+    if (a->y != b->y)
+        return a->y < b->y ? -1 : 1;
+    return 0;
+}
+
+void CZoneSweepHull::AddPlane(const Vector &vecNormal, float flDist)
+{
+    // Push the plane out to where the center of the hull is when the hull touches it
+    const auto iPlane = m_vecPlanes.AddToTail();
+    m_vecPlanes[iPlane].m_vecNormal = vecNormal;
+    m_vecPlanes[iPlane].m_flDist = flDist + fabsf(vecNormal.x) * m_vecExtents.x + fabsf(vecNormal.y) * m_vecExtents.y +
+                                   fabsf(vecNormal.z) * m_vecExtents.z;
+}
+
+bool CZoneSweepHull::InitFromPoints(CBaseMomZoneTrigger *pZone)
+{
+    const auto &vecPoints = pZone->m_vecZonePoints;
+    if (vecPoints.Count() < 3)
+        return false;
+
+    CUtlVector<Vector2D> vecSorted;
+    vecSorted.EnsureCapacity(vecPoints.Count());
+    float flBottom = FLT_MAX;
+    FOR_EACH_VEC(vecPoints, i)
+    {
+        vecSorted.AddToTail(vecPoints[i].AsVector2D());
+        flBottom = Min(flBottom, vecPoints[i].z);
+    }
+    vecSorted.Sort(ComparePoints2D);
+
+    // Monotone chain, counter-clockwise with collinear points dropped
+    const int iCount = vecSorted.Count();
+    CUtlVector<Vector2D> vecHull;
+    vecHull.SetCount(2 * iCount);
+    int k = 0;
+    for (int i = 0; i < iCount; i++)
+    {
+        while (k >= 2 && Cross2D(vecHull[k - 2], vecHull[k - 1], vecSorted[i]) <= 0.0f)
+            k--;
+        vecHull[k++] = vecSorted[i];
+    }
+    for (int i = iCount - 2, t = k + 1; i >= 0; i--)
+    {
+        while (k >= t && Cross2D(vecHull[k - 2], vecHull[k - 1], vecSorted[i]) <= 0.0f)
+            k--;
+        vecHull[k++] = vecSorted[i];
+    }
+    k--; // The last point is the first one again
+
+    if (k < 3)
+        return false;
+
+    // Every point has to lie on the hull's outline, otherwise the zone is concave and the hull would be too big
+    FOR_EACH_VEC(vecSorted, i)
+    {
+        bool bOnEdge = false;
+        for (int j = 0; j < k && !bOnEdge; j++)
+        {
+            const auto &a = vecHull[j];
+            const auto &b = vecHull[(j + 1) % k];
+            const float flLength = a.DistTo(b);
+            bOnEdge = flLength > 0.0f && fabsf(Cross2D(a, b, vecSorted[i])) / flLength < ZONE_SWEEP_CONVEX_EPSILON;
+        }
+
+        if (!bOnEdge)
+            return false;
+    }
+
+    Vector2D vecMins(FLT_MAX, FLT_MAX), vecMaxs(-FLT_MAX, -FLT_MAX);
+    for (int j = 0; j < k; j++)
+    {
+        const auto &a = vecHull[j];
+        const auto &b = vecHull[(j + 1) % k];
+
+        Vector vecNormal(b.y - a.y, a.x - b.x, 0.0f);
+        VectorNormalize(vecNormal);
+        AddPlane(vecNormal, vecNormal.x * a.x + vecNormal.y * a.y);
+
+        Vector2DMin(vecMins, a, vecMins);
+        Vector2DMax(vecMaxs, a, vecMaxs);
+    }
+
+    // The box's own faces, the sum of the box and the polygon needs these at the corners
+    AddPlane(Vector(1, 0, 0), vecMaxs.x);
+    AddPlane(Vector(-1, 0, 0), -vecMins.x);
+    AddPlane(Vector(0, 1, 0), vecMaxs.y);
+    AddPlane(Vector(0, -1, 0), -vecMins.y);
+
+    const float flHeight = pZone->m_flZoneHeight;
+    const float flTop = flBottom + Max(flHeight, 0.0f);
+    flBottom += Min(flHeight, 0.0f);
+    AddPlane(Vector(0, 0, 1), flTop);
+    AddPlane(Vector(0, 0, -1), -flBottom);
+
+    return true;
+}
+
+void CZoneSweepHull::Init(CBaseEntity *pZone, const Vector &vecExtents)
+{
+    m_vecPlanes.RemoveAll();
+    m_pClipZone = nullptr;
+    m_vecExtents = vecExtents;
+
+    // Points are stored in world space, so they're only valid as long as the zone doesn't move
+    const auto pMomZone = dynamic_cast<CBaseMomZoneTrigger *>(pZone);
+    if (pMomZone && !pZone->GetMoveParent() && InitFromPoints(pMomZone))
+        return;
+
+    m_vecPlanes.RemoveAll();
+
+    if (pZone->GetSolid() == SOLID_BBOX)
+    {
+        Vector vecMins, vecMaxs;
+        pZone->CollisionProp()->WorldSpaceAABB(&vecMins, &vecMaxs);
+        AddPlane(Vector(1, 0, 0), vecMaxs.x);
+        AddPlane(Vector(-1, 0, 0), -vecMins.x);
+        AddPlane(Vector(0, 1, 0), vecMaxs.y);
+        AddPlane(Vector(0, -1, 0), -vecMins.y);
+        AddPlane(Vector(0, 0, 1), vecMaxs.z);
+        AddPlane(Vector(0, 0, -1), -vecMins.z);
+        return;
+    }
+
+    m_pClipZone = pZone;
+}
+
+float CZoneSweepHull::SignedDistance(const Vector &vecPos) const
+{
+    if (m_pClipZone)
+    {
+        Ray_t ray;
+        ray.Init(vecPos, vecPos, -m_vecExtents, m_vecExtents);
+
+        trace_t tr;
+        enginetrace->ClipRayToEntity(ray, MASK_ALL, m_pClipZone, &tr);
+        return tr.startsolid ? -1.0f : 1.0f;
+    }
+
+    float flDist = -FLT_MAX;
+    FOR_EACH_VEC(m_vecPlanes, i)
+    {
+        flDist = Max(flDist, DotProduct(m_vecPlanes[i].m_vecNormal, vecPos) - m_vecPlanes[i].m_flDist);
+    }
+
+    return flDist;
+}
+
+fltx4 CZoneSweepHull::SignedDistance4(const fltx4 &x, const fltx4 &y, const fltx4 &z) const
+{
+    if (m_pClipZone)
+    {
+        fltx4 result;
+        for (int i = 0; i < 4; i++)
+        {
+            SubFloat(result, i) = SignedDistance(Vector(SubFloat(x, i), SubFloat(y, i), SubFloat(z, i)));
+        }
+        return result;
+    }
+
+    fltx4 result = ReplicateX4(-FLT_MAX);
+    FOR_EACH_VEC(m_vecPlanes, i)
+    {
+        const auto &plane = m_vecPlanes[i];
+        const fltx4 dist = MaddSIMD(x, ReplicateX4(plane.m_vecNormal.x),
+                                    MaddSIMD(y, ReplicateX4(plane.m_vecNormal.y),
+                                             MaddSIMD(z, ReplicateX4(plane.m_vecNormal.z), ReplicateX4(-plane.m_flDist))));
+        result = MaxSIMD(result, dist);
+    }
+
+    return result;
+}
+
+CZoneSweep::CZoneSweep(const Vector &vecStart, const Vector &vecStartVel, const Vector &vecEnd,
+                       const Vector &vecEndVel, float flDuration, const Vector &vecHullMins, const Vector &vecHullMaxs)
+{
+    m_vecExtents = (vecHullMaxs - vecHullMins) * 0.5f;
+    m_vecOffset = (vecHullMins + vecHullMaxs) * 0.5f;
+
+    const Vector vecStartTangent = vecStartVel * flDuration;
+    const Vector vecEndTangent = vecEndVel * flDuration;
+    const Vector vecDelta = vecEnd - vecStart;
+
+    m_vecStart = vecStart + m_vecOffset;
+    m_vecTangent = vecStartTangent;
+    m_vecAccel = vecDelta * 3.0f - vecStartTangent * 2.0f - vecEndTangent;
+    m_vecJerk = vecDelta * -2.0f + vecStartTangent + vecEndTangent;
+
+    // The curve stays inside the bounds of its Bezier control points
+    const Vector vecControl1 = vecStart + vecStartTangent / 3.0f;
+    const Vector vecControl2 = vecEnd - vecEndTangent / 3.0f;
+    VectorMin(vecStart, vecEnd, m_vecSweepMins);
+    VectorMax(vecStart, vecEnd, m_vecSweepMaxs);
+    VectorMin(m_vecSweepMins, vecControl1, m_vecSweepMins);
+    VectorMax(m_vecSweepMaxs, vecControl1, m_vecSweepMaxs);
+    VectorMin(m_vecSweepMins, vecControl2, m_vecSweepMins);
+    VectorMax(m_vecSweepMaxs, vecControl2, m_vecSweepMaxs);
+    m_vecSweepMins += vecHullMins;
+    m_vecSweepMaxs += vecHullMaxs;
+
+    for (int i = 0; i < ZONE_SWEEP_SAMPLES; i++)
+    {
+        const auto vecPos = GetPosition(static_cast<float>(i) / (ZONE_SWEEP_SAMPLES - 1));
+        SubFloat(m_SampleX[i / 4], i % 4) = vecPos.x;
+        SubFloat(m_SampleY[i / 4], i % 4) = vecPos.y;
+        SubFloat(m_SampleZ[i / 4], i % 4) = vecPos.z;
+    }
+}
+
+Vector CZoneSweep::GetPosition(float flFraction) const
+{
+    return m_vecStart + (m_vecTangent + (m_vecAccel + m_vecJerk * flFraction) * flFraction) * flFraction;
+}
+
+float CZoneSweep::RefineCrossing(const CZoneSweepHull &hull, float flOutside, float flInside) const
+{
+    for (int i = 0; i < ZONE_SWEEP_REFINE_STEPS; i++)
+    {
+        const float flMid = (flOutside + flInside) * 0.5f;
+        if (hull.SignedDistance(GetPosition(flMid)) <= 0.0f)
+            flInside = flMid;
+        else
+            flOutside = flMid;
+    }
+
+    return flInside;
+}
+
+bool CZoneSweep::Solve(CBaseEntity *pZone, ZoneSweepResult_t &result) const
+{
+    if (!pZone)
+        return false;
+
+    CZoneSweepHull hull;
+    hull.Init(pZone, m_vecExtents);
+
+    float flDist[ZONE_SWEEP_SAMPLES];
+    for (int i = 0; i < ZONE_SWEEP_SAMPLE_GROUPS; i++)
+    {
+        const fltx4 dist = hull.SignedDistance4(m_SampleX[i], m_SampleY[i], m_SampleZ[i]);
+        for (int j = 0; j < 4; j++)
+        {
+            flDist[i * 4 + j] = SubFloat(dist, j);
+        }
+    }
+
+    result.m_pZone = pZone;
+    result.m_bStartedInside = flDist[0] <= 0.0f;
+    result.m_bEndedInside = flDist[ZONE_SWEEP_SAMPLES - 1] <= 0.0f;
+    result.m_flEnter = result.m_bStartedInside ? 0.0f : -1.0f;
+    result.m_flExit = result.m_bEndedInside ? 1.0f : -1.0f;
+
+    const float flStep = 1.0f / (ZONE_SWEEP_SAMPLES - 1);
+    for (int i = 0; i < ZONE_SWEEP_SAMPLES - 1; i++)
+    {
+        const bool bInside = flDist[i] <= 0.0f;
+        const bool bNextInside = flDist[i + 1] <= 0.0f;
+
+        if (!bInside && bNextInside && result.m_flEnter < 0.0f)
+            result.m_flEnter = RefineCrossing(hull, i * flStep, (i + 1) * flStep);
+        else if (bInside && !bNextInside && !result.m_bEndedInside)
+            result.m_flExit = RefineCrossing(hull, (i + 1) * flStep, i * flStep);
+    }
+
+    return result.m_flEnter >= 0.0f;
+}
+
+int CZoneSweep::SolveZones(int iQueryFlags, CUtlVector<ZoneSweepResult_t> &vecResults) const
+{
+    CUtlVector<CBaseEntity *> vecCandidates;
+    g_MapZoneSystem.GetZoneBVH()->FindTriggersInBox(m_vecSweepMins, m_vecSweepMaxs, iQueryFlags, vecCandidates);
+
+    int iFound = 0;
+    FOR_EACH_VEC(vecCandidates, i)
+    {
+        ZoneSweepResult_t result;
+        if (Solve(vecCandidates[i], result))
+        {
+            vecResults.AddToTail(result);
+            iFound++;
+        }
+    }
+
+    return iFound;
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include "mathlib/ssemath.h"
+
+class CBaseMomZoneTrigger;
+
+#define ZONE_SWEEP_SAMPLE_GROUPS 4 // Samples along the path are taken 4 at a time
+#define ZONE_SWEEP_SAMPLES (ZONE_SWEEP_SAMPLE_GROUPS * 4) // A zone only touched between two samples is missed
+#define ZONE_SWEEP_REFINE_STEPS 24 // Bisection steps for each crossing found between two samples
+
+// A zone's volume as a set of planes, pushed outwards by the player's half extents so that
+// testing the center of the player's hull against it is the same as testing the whole hull.
+// Convex point zones use their points, box triggers their bounds. Concave zones and brush triggers
+// can't be described this way, so they fall back to clipping the hull against the entity.
+class CZoneSweepHull
+{
+public:
+    CZoneSweepHull() : m_pClipZone(nullptr) {}
+
+    void Init(CBaseEntity *pZone, const Vector &vecExtents);
+
+    // > 0 outside, <= 0 inside. Not a true distance at the corners, but the sign is right.
+    float SignedDistance(const Vector &vecPos) const;
+    // Same as above, for four points at once
+    fltx4 SignedDistance4(const fltx4 &x, const fltx4 &y, const fltx4 &z) const;
+
+private:
+    struct Plane_t
+    {
+        Vector m_vecNormal;
+        float m_flDist;
+    };
+
+    void AddPlane(const Vector &vecNormal, float flDist);
+    bool InitFromPoints(CBaseMomZoneTrigger *pZone);
+
+    CUtlVector<Plane_t> m_vecPlanes;
+    CBaseEntity *m_pClipZone; // Set when the planes can't be used
+    Vector m_vecExtents;
+};
+
+struct ZoneSweepResult_t
+{
+    CBaseEntity *m_pZone;
+    float m_flEnter; // Fraction of the sweep the hull first touched the zone, 0 if it started inside
+    float m_flExit; // Fraction of the sweep the hull last left the zone, 1 if it ended inside
+    bool m_bStartedInside;
+    bool m_bEndedInside;
+};
+
+// Sweeps the player's hull over one movement step against the zones, finding the fractions the hull
+// enters and leaves them. The hull's center follows a cubic Hermite curve through both origins and
+// velocities, so acceleration and gravity during the step are accounted for.
+// This is sampled, not exact: the curve is tested at ZONE_SWEEP_SAMPLES evenly spaced points, and only
+// crossings between two samples that disagree get refined by bisection. A zone the hull clips between
+// two samples isn't found, and the curve is itself only an estimate of the movement in between.
+class CZoneSweep
+{
+public:
+    CZoneSweep(const Vector &vecStart, const Vector &vecStartVel, const Vector &vecEnd, const Vector &vecEndVel,
+               float flDuration, const Vector &vecHullMins, const Vector &vecHullMaxs);
+
+    // Where the center of the hull is at the given fraction of the sweep
+    Vector GetPosition(float flFraction) const;
+
+    // Returns false if the hull never touches the zone
+    bool Solve(CBaseEntity *pZone, ZoneSweepResult_t &result) const;
+    // Solves every trigger of the given kinds (ZoneQueryFlags_t) the sweep touches, from the zone BVH
+    int SolveZones(int iQueryFlags, CUtlVector<ZoneSweepResult_t> &vecResults) const;
+
+private:
+    float RefineCrossing(const CZoneSweepHull &hull, float flOutside, float flInside) const;
+
+    // Hermite control values, the hull center is at m_vecStart + f * (m_vecTangent + f * (m_vecAccel + f * m_vecJerk))
+    Vector m_vecStart, m_vecTangent, m_vecAccel, m_vecJerk;
+    Vector m_vecExtents, m_vecOffset; // Half size of the hull, and how far its center is from the origin
+    Vector m_vecSweepMins, m_vecSweepMaxs;
+
+    fltx4 m_SampleX[ZONE_SWEEP_SAMPLE_GROUPS];
+    fltx4 m_SampleY[ZONE_SWEEP_SAMPLE_GROUPS];
+    fltx4 m_SampleZ[ZONE_SWEEP_SAMPLE_GROUPS];
+};
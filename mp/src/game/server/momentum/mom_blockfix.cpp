@@ -4,7 +4,7 @@
 #include "buttons.h"
 #include "mom_player.h"
 #include "mom_system_gamemode.h"
-#include "trigger_trace_enums.h"
+#include "mapzones.h"
 
 #include "tier0/memdbgon.h"
 
@@ -149,10 +149,7 @@ void CMOMBhopBlockFixSystem::FindTeleport(CBaseEntity *pBlockEnt, bool isDoor)
     // Do the TraceLine, and write our results to our trace_t class, tr.
     Ray_t ray;
     ray.Init(vecAbsStart, vecAbsEnd);
-    CTeleportTriggerTraceEnum triggerTraceEnum(&ray);
-    enginetrace->EnumerateEntities(ray, true, &triggerTraceEnum);
-
-    CBaseEntity *pTeleportEntity = triggerTraceEnum.GetTeleportEntity();
+    CBaseEntity *pTeleportEntity = g_MapZoneSystem.GetZoneBVH()->TraceRay(ray, ZONE_QUERY_TELEPORT);
     if (pTeleportEntity != nullptr)
     {
         AddBhopBlock(pBlockEnt, pTeleportEntity, isDoor);
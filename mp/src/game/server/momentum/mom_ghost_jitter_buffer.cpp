@@ -0,0 +1,189 @@
+#include "cbase.h"
+#include "mom_ghost_jitter_buffer.h"
+
+#include "tier0/memdbgon.h"
+
+// Gain of the jitter estimate, same as RFC 3550's interarrival jitter
+#define JITTER_SMOOTHING (1.0f / 16.0f)
+// How fast the clock offset creeps back up after a quick packet, so clock drift doesn't build up
+#define CLOCK_OFFSET_RELAX 0.002f
+// If the transit time suddenly differs this much the sender's clock was restarted (map change, pause...)
+#define CLOCK_RESYNC_THRESHOLD 2.0f
+// Gain of the send interval estimate
+#define INTERVAL_SMOOTHING (1.0f / 16.0f)
+// The adaptive delay is this many measured send intervals plus a multiple of the jitter
+#define MIN_DELAY_INTERVALS 2.0f
+#define JITTER_DELAY_SCALE 3.0f
+// The delay may only change by this fraction of real time, so playback speeds up/slows down instead of skipping
+#define DELAY_SLEW_RATE 0.1f
+// Extra distance allowed between two packets before it's treated as a teleport
+#define TELEPORT_SLACK 64.0f
+
+CGhostJitterBuffer::CGhostJitterBuffer()
+{
+    Reset();
+}
+
+void CGhostJitterBuffer::Reset()
+{
+    m_iHead = m_iCount = 0;
+    m_bSynced = m_bPlaying = false;
+    m_flClockOffset = m_flLastTransit = m_flJitter = m_flDelay = 0.0f;
+    m_flLastSendTime = m_flInterval = 0.0f;
+    m_flLastSampleTime = m_flPlayedTime = 0.0f;
+}
+
+void CGhostJitterBuffer::RemoveHead()
+{
+    m_iHead = (m_iHead + 1) & (MOM_GHOST_JITTER_BUFFER_SIZE - 1);
+    m_iCount--;
+}
+
+void CGhostJitterBuffer::AddPacket(float flSendTime, float flRecvTime, const PositionPacket &packet)
+{
+    const float flTransit = flRecvTime - flSendTime;
+
+    if (m_bSynced && fabsf(flTransit - m_flClockOffset) > CLOCK_RESYNC_THRESHOLD)
+        Reset();
+
+    if (!m_bSynced)
+    {
+        m_flClockOffset = m_flLastTransit = flTransit;
+        m_flLastSendTime = flSendTime;
+        m_bSynced = true;
+    }
+    else
+    {
+        m_flJitter += (fabsf(flTransit - m_flLastTransit) - m_flJitter) * JITTER_SMOOTHING;
+        m_flLastTransit = flTransit;
+
+        // The fastest packets tell us the real clock offset, the rest were held up along the way
+        if (flTransit < m_flClockOffset)
+            m_flClockOffset = flTransit;
+        else
+            m_flClockOffset += (flTransit - m_flClockOffset) * CLOCK_OFFSET_RELAX;
+
+        // Only in-order packets tell us how often the sender sends, they pick their rate per peer
+        if (flSendTime > m_flLastSendTime)
+        {
+            const float flInterval = flSendTime - m_flLastSendTime;
+            m_flInterval = m_flInterval > 0.0f ? m_flInterval + (flInterval - m_flInterval) * INTERVAL_SMOOTHING : flInterval;
+            m_flLastSendTime = flSendTime;
+        }
+    }
+
+    // Too late to be shown
+    if (m_bPlaying && flSendTime <= m_flPlayedTime)
+        return;
+
+    // Packets nearly always come in order, so look for the spot from the back
+    int iPos = m_iCount;
+    while (iPos > 0 && At(iPos - 1).m_flSendTime > flSendTime)
+        iPos--;
+
+    // Duplicate
+    if (iPos > 0 && At(iPos - 1).m_flSendTime == flSendTime)
+        return;
+
+    if (m_iCount == MOM_GHOST_JITTER_BUFFER_SIZE)
+    {
+        if (iPos == 0)
+            return;
+
+        RemoveHead();
+        iPos--;
+    }
+
+    for (int i = m_iCount; i > iPos; i--)
+        At(i) = At(i - 1);
+
+    Snapshot_t &snapshot = At(iPos);
+    snapshot.m_flSendTime = flSendTime;
+    snapshot.m_Packet = packet;
+    m_iCount++;
+}
+
+bool CGhostJitterBuffer::Sample(float flTime, float flMaxDelay, bool bAdaptive, float flMaxExtrapolate, PositionPacket &out)
+{
+    if (!m_iCount)
+        return false;
+
+    // Until the send interval is known, play it safe with the largest delay
+    float flTargetDelay = flMaxDelay;
+    if (bAdaptive && m_flInterval > 0.0f)
+        flTargetDelay = Min(MIN_DELAY_INTERVALS * m_flInterval + JITTER_DELAY_SCALE * m_flJitter, flMaxDelay);
+
+    if (m_bPlaying)
+    {
+        const float flMaxStep = DELAY_SLEW_RATE * (flTime - m_flLastSampleTime);
+        m_flDelay += clamp(flTargetDelay - m_flDelay, -flMaxStep, flMaxStep);
+    }
+    else
+    {
+        m_flDelay = flTargetDelay;
+    }
+    m_flLastSampleTime = flTime;
+
+    float flSendTime = flTime - m_flClockOffset - m_flDelay;
+
+    // Drop everything behind the playhead, except the one right before it that we interpolate from
+    while (m_iCount > 1 && At(1).m_flSendTime <= flSendTime)
+        RemoveHead();
+
+    const Snapshot_t &from = At(0);
+    if (flSendTime < from.m_flSendTime)
+    {
+        // The first packet isn't due yet
+        if (!m_bPlaying)
+            return false;
+
+        // The delay grew since we dropped older packets, hold here until it catches up
+        flSendTime = from.m_flSendTime;
+    }
+
+    m_bPlaying = true;
+    m_flPlayedTime = flSendTime;
+
+    if (m_iCount > 1)
+    {
+        Interpolate(from, At(1), flSendTime, out);
+    }
+    else
+    {
+        // Ran dry, keep going along the last velocity for a little while
+        out = from.m_Packet;
+        out.Position += from.m_Packet.Velocity * clamp(flSendTime - from.m_flSendTime, 0.0f, flMaxExtrapolate);
+    }
+
+    return true;
+}
+
+void CGhostJitterBuffer::Interpolate(const Snapshot_t &from, const Snapshot_t &to, float flSendTime, PositionPacket &out) const
+{
+    const PositionPacket &a = from.m_Packet, &b = to.m_Packet;
+    const float flSpan = to.m_flSendTime - from.m_flSendTime;
+    const float t = clamp((flSendTime - from.m_flSendTime) / flSpan, 0.0f, 1.0f);
+
+    out = a;
+
+    // Teleports can't be interpolated, stay put until the new position is due
+    const float flMaxTravel = Max(a.Velocity.Length(), b.Velocity.Length()) * flSpan * 2.0f + TELEPORT_SLACK;
+    if ((b.Position - a.Position).LengthSqr() > flMaxTravel * flMaxTravel)
+        return;
+
+    // Cubic Hermite, using the velocities as tangents keeps the path through curves and jumps
+    const float t2 = t * t, t3 = t2 * t;
+    const float h00 = 2.0f * t3 - 3.0f * t2 + 1.0f;
+    const float h10 = t3 - 2.0f * t2 + t;
+    const float h01 = -2.0f * t3 + 3.0f * t2;
+    const float h11 = t3 - t2;
+
+    out.Position = a.Position * h00 + a.Velocity * (h10 * flSpan) + b.Position * h01 + b.Velocity * (h11 * flSpan);
+    VectorLerp(a.Velocity, b.Velocity, t, out.Velocity);
+
+    for (int i = 0; i < 3; i++)
+        out.EyeAngle[i] = AngleNormalize(a.EyeAngle[i] + AngleDiff(b.EyeAngle[i], a.EyeAngle[i]) * t);
+
+    out.ViewOffset = Lerp(t, a.ViewOffset, b.ViewOffset);
+    out.SendTime = flSendTime;
+}
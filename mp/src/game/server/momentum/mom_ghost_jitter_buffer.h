@@ -0,0 +1,59 @@
+#pragma once
+
+#include "mom_ghostdefs.h"
+
+// Must be a power of two. At MOM_ONLINE_GHOST_UPDATERATE this holds a bit over 3 seconds of packets,
+// more than the largest render delay allowed.
+#define MOM_GHOST_JITTER_BUFFER_SIZE 128
+
+// Holds the position packets of a single online ghost ordered by the sender's timestamps, and plays
+// them back a small, adaptive delay in the past so late or reordered packets can still be used.
+// The delay is based on the measured time between the sender's packets, as they may send slower than
+// MOM_ONLINE_GHOST_UPDATERATE.
+// Playback interpolates between packets (cubic Hermite on position using the sent velocities) and
+// extrapolates a little when the buffer runs dry. The storage is a fixed ring, nothing is allocated per packet.
+class CGhostJitterBuffer
+{
+  public:
+    CGhostJitterBuffer();
+
+    void Reset();
+
+    // Adds a packet that was sent at flSendTime (sender's clock) and received at flRecvTime (our clock)
+    void AddPacket(float flSendTime, float flRecvTime, const PositionPacket &packet);
+
+    // Samples the ghost at local time flTime into out. Returns false if there is nothing to show yet.
+    // When bAdaptive, the render delay follows the measured send interval and jitter, capped at flMaxDelay;
+    // otherwise it is flMaxDelay.
+    bool Sample(float flTime, float flMaxDelay, bool bAdaptive, float flMaxExtrapolate, PositionPacket &out);
+
+    // The current render delay, in seconds
+    float GetDelay() const { return m_flDelay; }
+    int Count() const { return m_iCount; }
+
+  private:
+    struct Snapshot_t
+    {
+        float m_flSendTime;
+        PositionPacket m_Packet;
+    };
+
+    Snapshot_t &At(int i) { return m_Snapshots[(m_iHead + i) & (MOM_GHOST_JITTER_BUFFER_SIZE - 1)]; }
+    void RemoveHead();
+
+    void Interpolate(const Snapshot_t &from, const Snapshot_t &to, float flSendTime, PositionPacket &out) const;
+
+    Snapshot_t m_Snapshots[MOM_GHOST_JITTER_BUFFER_SIZE];
+    int m_iHead, m_iCount;
+
+    bool m_bSynced;         // Have we got a clock offset yet?
+    bool m_bPlaying;        // Has playback started?
+    float m_flClockOffset;  // Our clock minus the sender's, taken from the fastest packets
+    float m_flLastTransit;  // Transit time (recv - send) of the last packet
+    float m_flJitter;       // Smoothed variation of the transit time
+    float m_flLastSendTime; // Sender time of the newest packet
+    float m_flInterval;     // Smoothed time between the sender's packets, 0 until two have arrived
+    float m_flDelay;        // How far in the past we're rendering
+    float m_flLastSampleTime;
+    float m_flPlayedTime;   // Sender time that was last played back
+};
@@ -2,6 +2,7 @@
 
 #include "mom_lobby_system.h"
 
+#include "bspfile.h"
 #include "filesystem.h"
 #include "fmtstr.h"
 #include "ghost_client.h"
@@ -66,6 +67,11 @@ static void LobbyTypeChanged(IConVar *pVar, const char *pVal, float oldVal)
 static MAKE_CONVAR_C(mom_lobby_max_players, "16", FCVAR_REPLICATED | FCVAR_ARCHIVE, "Sets the maximum number of players allowed in lobbies you create.\n", 2, 250, LobbyMaxPlayersChanged);
 static MAKE_CONVAR_C(mom_lobby_type, "1", FCVAR_REPLICATED | FCVAR_ARCHIVE, "Sets the type of the lobby. 0 = Invite only, 1 = Friends Only, 2 = Public\n", 0, 2, LobbyTypeChanged);
 static MAKE_TOGGLE_CONVAR(mom_lobby_debug, "0", FCVAR_REPLICATED | FCVAR_ARCHIVE, "Toggles printing debug info about the lobby. 0 = OFF, 1 = ON\n");
+static MAKE_TOGGLE_CONVAR(mom_lobby_interest_enable, "1", FCVAR_ARCHIVE, "Toggles lowering the rate of position updates sent to lobby members that are far away or can't see you. 0 = OFF, 1 = ON\n");
+static MAKE_CONVAR(mom_lobby_interest_near_dist, "1024", FCVAR_ARCHIVE, "Lobby members closer than this get every position update.\n", 0, 32768);
+static MAKE_CONVAR(mom_lobby_interest_far_dist, "8192", FCVAR_ARCHIVE, "Lobby members at least this far away get position updates at mom_lobby_interest_min_rate.\n", 0, 32768);
+static MAKE_CONVAR(mom_lobby_interest_min_rate, "4", FCVAR_ARCHIVE, "Position updates per second sent to far away lobby members.\n", 2, 40);
+static MAKE_CONVAR(mom_lobby_interest_hidden_rate, "10", FCVAR_ARCHIVE, "Most position updates per second sent to lobby members whose view can't see you.\n", 2, 40);
 
 void CMomentumLobbySystem::HandleNewP2PRequest(SteamNetworkingMessagesSessionRequest_t *pParam)
 {
@@ -184,9 +190,11 @@ void CMomentumLobbySystem::HandleLobbyJoin(GameLobbyJoinRequested_t* pJoin)
     TryJoinLobby(pJoin->m_steamIDLobby);
 }
 
-CMomentumLobbySystem::CMomentumLobbySystem() : m_bHostingLobby(false)
+CMomentumLobbySystem::CMomentumLobbySystem() : m_bHostingLobby(false), m_iPositionSequence(0), m_iKeyframeSequence(0),
+    m_bHasPositionKeyframe(false)
 {
     SetDefLessFunc(m_mapLobbyGhosts);
+    SetDefLessFunc(m_mapNextPeerUpdate);
 }
 
 CMomentumLobbySystem::~CMomentumLobbySystem()
@@ -301,6 +309,8 @@ void CMomentumLobbySystem::HandleLobbyEnter(LobbyEnter_t* pEnter)
 
     FIRE_GAME_WIDE_EVENT("lobby_join");
 
+    SteamMatchmaking()->SetLobbyMemberData(m_sLobbyID, LOBBY_DATA_NET_VERSION, CFmtStrN<10>("%i", LOBBY_NET_VERSION));
+
     UpdateCurrentLobbyMap(gpGlobals->mapname.ToCStr());
 
     g_pSteamRichPresence->Update();
@@ -386,6 +396,8 @@ void CMomentumLobbySystem::ClearCurrentGhosts(bool bLeavingLobby)
     }
 
     m_mapLobbyGhosts.RemoveAll();
+    m_mapNextPeerUpdate.RemoveAll();
+    m_PendingDecals.Clear();
 }
 
 bool CMomentumLobbySystem::SendPacket(MomentumPacket *packet, const CSteamID &target, int sendType /*= k_nSteamNetworkingSend_Unreliable*/) const
@@ -435,6 +447,90 @@ bool CMomentumLobbySystem::SendPacketToEveryone(MomentumPacket *pPacket, int sen
     return true;
 }
 
+bool CMomentumLobbySystem::SendBatch(BatchPacket &batch, uint64 target, int sendType, bool bCanBatch)
+{
+    if (batch.IsEmpty())
+        return false;
+
+    SteamNetworkingIdentity identity;
+    identity.SetSteamID64(target);
+
+    EResult eResult = k_EResultOK;
+    if (bCanBatch || batch.Count() == 1)
+    {
+        CUtlBuffer buf;
+        batch.Write(buf);
+        eResult = SteamNetworkingMessages()->SendMessageToUser(identity, buf.Base(), buf.TellPut(), sendType, 0);
+    }
+    else
+    {
+        // They can't read batches, so each packet goes out on its own
+        int offset = 0, size;
+        const void *pData;
+        while (eResult == k_EResultOK && batch.NextPacket(offset, pData, size))
+            eResult = SteamNetworkingMessages()->SendMessageToUser(identity, pData, size, sendType, 0);
+    }
+
+    if (eResult != k_EResultOK)
+    {
+        DevWarning("Failed to send the packet to %s!\n", SteamFriends()->GetFriendPersonaName(target));
+        return false;
+    }
+
+    return true;
+}
+
+void CMomentumLobbySystem::FlushPendingDecals()
+{
+    if (m_PendingDecals.IsEmpty())
+        return;
+
+    CHECK_STEAM_API(SteamNetworkingMessages());
+
+    auto index = m_mapLobbyGhosts.FirstInorder();
+    while (index != m_mapLobbyGhosts.InvalidIndex())
+    {
+        const auto peerID = m_mapLobbyGhosts.Key(index);
+        SendBatch(m_PendingDecals, peerID, k_nSteamNetworkingSend_Unreliable, CanPeerBatch(peerID));
+        index = m_mapLobbyGhosts.NextInorder(index);
+    }
+
+    m_PendingDecals.Clear();
+}
+
+float CMomentumLobbySystem::GetPeerUpdateRate(CMomentumOnlineGhostEntity *pPeer, const Vector &vecOurOrigin, const byte *pOurPVS, int iPVSSize)
+{
+    if (!mom_lobby_interest_enable.GetBool())
+        return MOM_ONLINE_GHOST_UPDATERATE;
+
+    // Spectators see the map from their target's view
+    CBaseEntity *pViewer = pPeer;
+    if (pPeer->IsSpectating())
+    {
+        const auto specTarget = pPeer->GetSpecTarget();
+        if (specTarget == SteamUser()->GetSteamID().ConvertToUint64())
+            return MOM_ONLINE_GHOST_UPDATERATE;
+
+        const auto pTarget = GetLobbyMemberEntity(specTarget);
+        if (pTarget)
+            pViewer = pTarget;
+    }
+
+    const Vector vecViewOrigin = pViewer->EyePosition();
+
+    const float flNear = mom_lobby_interest_near_dist.GetFloat();
+    const float flFar = Max(mom_lobby_interest_far_dist.GetFloat(), flNear + 1.0f);
+    const float flMinRate = mom_lobby_interest_min_rate.GetFloat();
+
+    float flRate = RemapValClamped(vecViewOrigin.DistTo(vecOurOrigin), flNear, flFar, MOM_ONLINE_GHOST_UPDATERATE, flMinRate);
+
+    const float flHiddenRate = mom_lobby_interest_hidden_rate.GetFloat();
+    if (flRate > flHiddenRate && pOurPVS && !engine->CheckOriginInPVS(vecViewOrigin, pOurPVS, iPVSSize))
+        flRate = flHiddenRate;
+
+    return flRate;
+}
+
 void CMomentumLobbySystem::WriteLobbyMessage(LobbyMessageType_t type, uint64 pID_int)
 {
     const auto pEvent = gameeventmanager->CreateEvent("lobby_update_msg");
@@ -576,6 +672,8 @@ void CMomentumLobbySystem::OnLobbyMemberLeave(const CSteamID &member)
     // Remove them if they're a requester
     g_pSavelocSystem->RequesterLeft(lobbyMemberID);
 
+    m_mapNextPeerUpdate.Remove(lobbyMemberID);
+
     const auto findIndex = m_mapLobbyGhosts.Find(lobbyMemberID);
 
     if (!m_mapLobbyGhosts.IsValidIndex(findIndex))
@@ -753,6 +851,9 @@ void CMomentumLobbySystem::CreateLobbyGhostEntity(const CSteamID &lobbyMember)
 
         m_mapLobbyGhosts.Insert(lobbyMemberID, pNewPlayer);
 
+        // They need a keyframe before they can read any of our deltas
+        m_bHasPositionKeyframe = false;
+
         if (m_flNextUpdateTime < 0)
             m_flNextUpdateTime = gpGlobals->curtime + (1.0f / MOM_ONLINE_GHOST_UPDATERATE);
 
@@ -865,131 +966,256 @@ void CMomentumLobbySystem::ReceiveP2PPackets()
             CUtlBuffer buf(pMessage->m_pData, pMessage->m_cbSize, CUtlBuffer::READ_ONLY);
             buf.SetBigEndian(false);
 
-            const auto type = buf.GetUnsignedChar();
-            switch (type)
-            {
-            case PACKET_TYPE_POSITION:
-            {
-                PositionPacket frame(buf);
-                CMomentumOnlineGhostEntity *pEntity = GetLobbyMemberEntity(fromWho);
-                if (pEntity)
-                    pEntity->AddPositionFrame(frame);
-            }
+            // Members on other maps don't have a ghost here, nothing they send about it is of use to us
+            const auto pEntity = GetLobbyMemberEntity(fromWho);
+            HandlePacket(fromWho, pEntity, buf, false);
+
+            pMessage->Release();
+        }
+
+        read = SteamNetworkingMessages()->ReceiveMessagesOnChannel(0, messages, MAX_MESSAGES_PER_READ);
+    }
+}
+
+void CMomentumLobbySystem::HandlePacket(const CSteamID &fromWho, CMomentumOnlineGhostEntity *pEntity, CUtlBuffer &buf, bool bInBatch)
+{
+    const auto type = buf.GetUnsignedChar();
+    switch (type)
+    {
+    case PACKET_TYPE_POSITION:
+    {
+        if (!pEntity)
             break;
-            case PACKET_TYPE_DECAL:
-            {
-                DecalPacket decals(buf);
-                if (decals.decal_type == DECAL_INVALID)
-                    break;
 
-                const auto pEntity = GetLobbyMemberEntity(fromWho);
-                if (pEntity)
-                {
-                    pEntity->AddDecalFrame(decals);
-                }
-            }
+        PositionPacket frame(buf);
+        pEntity->AddPositionFrame(frame);
+    }
+    break;
+    case PACKET_TYPE_POSITION_COMPACT:
+    {
+        if (!pEntity)
             break;
-            case PACKET_TYPE_SAVELOC_REQ:
-            {
-                SavelocReqPacket saveloc(buf);
 
-                // Done/fail states:
-                // 1. They hit "cancel" (most common)
-                // 2. They leave the map (same as 1, just accidental maybe)
-                // 3. They leave the lobby/server (manually, due to power outage, etc)
-                // 4. We leave the map
-                // 5. We leave the lobby/server
-                // 6. They get the savelocs they need
+        CompactPositionPacket frame(buf);
+        pEntity->AddCompactPositionFrame(frame);
+    }
+    break;
+    case PACKET_TYPE_DECAL:
+    {
+        if (!pEntity)
+            break;
 
-                // Of the above, 1 and 6 are the ones that are manually sent.
-                // 2<->5 can be automatically detected with lobby/server hooks
+        DecalPacket decals(buf);
+        if (decals.decal_type == DECAL_INVALID)
+            break;
 
-                // Fail requirements:
-                // Requester: set "requesting" to false, close the request UI
-                // Requestee: remove requester from requesters vector
+        pEntity->AddDecalFrame(decals);
+    }
+    break;
+    case PACKET_TYPE_BATCH:
+    {
+        // No batches in batches
+        if (bInBatch)
+            break;
 
-                if (mom_lobby_debug.GetBool())
-                    Log("Received a stage %i saveloc request packet!\n", saveloc.stage);
+        const int count = buf.GetUnsignedChar();
+        for (int i = 0; i < count && buf.IsValid(); i++)
+        {
+            const int size = buf.GetUnsignedShort();
+            if (!buf.IsValid() || size > buf.GetBytesRemaining())
+                break;
 
-                switch (saveloc.stage)
-                {
-                case SAVELOC_REQ_STAGE_COUNT_REQ:
-                {
-                    if (!g_pSavelocSystem->AddSavelocRequester(fromWho.ConvertToUint64()))
-                        break;
+            CUtlBuffer packetBuf(buf.PeekGet(), size, CUtlBuffer::READ_ONLY);
+            packetBuf.SetBigEndian(false);
+            HandlePacket(fromWho, pEntity, packetBuf, true);
 
-                    SavelocReqPacket response;
-                    response.stage = SAVELOC_REQ_STAGE_COUNT_ACK;
-                    response.saveloc_count = g_pSavelocSystem->GetSavelocCount();
+            buf.SeekGet(CUtlBuffer::SEEK_CURRENT, size);
+        }
+    }
+    break;
+    case PACKET_TYPE_SAVELOC_REQ:
+    {
+        SavelocReqPacket saveloc(buf);
 
-                    SendPacket(&response, fromWho, k_nSteamNetworkingSend_Reliable);
-                }
-                break;
-                case SAVELOC_REQ_STAGE_COUNT_ACK:
-                {
-                    KeyValues *pKV = new KeyValues("req_savelocs");
-                    pKV->SetInt("stage", SAVELOC_REQ_STAGE_COUNT_ACK);
-                    pKV->SetInt("count", saveloc.saveloc_count);
-                    g_pModuleComms->FireEvent(pKV);
-                }
-                break;
-                case SAVELOC_REQ_STAGE_SAVELOC_REQ:
-                {
-                    SavelocReqPacket response;
-                    response.stage = SAVELOC_REQ_STAGE_SAVELOC_ACK;
+        // Done/fail states:
+        // 1. They hit "cancel" (most common)
+        // 2. They leave the map (same as 1, just accidental maybe)
+        // 3. They leave the lobby/server (manually, due to power outage, etc)
+        // 4. We leave the map
+        // 5. We leave the lobby/server
+        // 6. They get the savelocs they need
 
-                    if (g_pSavelocSystem->WriteRequestedSavelocs(&saveloc, &response, fromWho.ConvertToUint64()))
-                        SendPacket(&response, fromWho, k_nSteamNetworkingSend_Reliable);
-                }
-                break;
-                case SAVELOC_REQ_STAGE_SAVELOC_ACK:
-                {
-                    if (g_pSavelocSystem->ReadReceivedSavelocs(&saveloc, fromWho.ConvertToUint64()))
-                    {
-                        SavelocReqPacket response;
-                        response.stage = SAVELOC_REQ_STAGE_DONE;
-                        if (SendPacket(&response, fromWho, k_nSteamNetworkingSend_Reliable))
-                        {
-                            KeyValues *pKv = new KeyValues("req_savelocs");
-                            pKv->SetInt("stage", SAVELOC_REQ_STAGE_DONE);
-                            g_pModuleComms->FireEvent(pKv);
-                        }
-                    }
-                }
-                break;
-                case SAVELOC_REQ_STAGE_DONE:
-                {
-                    g_pSavelocSystem->RequesterLeft(fromWho.ConvertToUint64());
-                }
+        // Of the above, 1 and 6 are the ones that are manually sent.
+        // 2<->5 can be automatically detected with lobby/server hooks
+
+        // Fail requirements:
+        // Requester: set "requesting" to false, close the request UI
+        // Requestee: remove requester from requesters vector
+
+        if (mom_lobby_debug.GetBool())
+            Log("Received a stage %i saveloc request packet!\n", saveloc.stage);
+
+        switch (saveloc.stage)
+        {
+        case SAVELOC_REQ_STAGE_COUNT_REQ:
+        {
+            // Older games expect the savelocs in one message, tell them we're done instead
+            if (!CanPeerTransferSavelocs(fromWho.ConvertToUint64()))
+            {
+                Warning("Can't send savelocs to %llu, their game is out of date!\n", fromWho.ConvertToUint64());
+
+                SavelocReqPacket response;
+                response.stage = SAVELOC_REQ_STAGE_DONE;
+                SendPacket(&response, fromWho, k_nSteamNetworkingSend_Reliable);
                 break;
-                case SAVELOC_REQ_STAGE_INVALID:
-                default:
-                    DevWarning(2, "Invalid stage for the saveloc request packet!\n");
-                    break;
-                }
             }
-            break;
-            default:
+
+            if (!g_pSavelocSystem->AddSavelocRequester(fromWho.ConvertToUint64()))
                 break;
-            }
 
-            pMessage->Release();
+            SavelocReqPacket response;
+            response.stage = SAVELOC_REQ_STAGE_COUNT_ACK;
+            response.saveloc_count = g_pSavelocSystem->GetSavelocCount();
+
+            SendPacket(&response, fromWho, k_nSteamNetworkingSend_Reliable);
         }
+        break;
+        case SAVELOC_REQ_STAGE_COUNT_ACK:
+        {
+            KeyValues *pKV = new KeyValues("req_savelocs");
+            pKV->SetInt("stage", SAVELOC_REQ_STAGE_COUNT_ACK);
+            pKV->SetInt("count", saveloc.saveloc_count);
+            g_pModuleComms->FireEvent(pKV);
+        }
+        break;
+        case SAVELOC_REQ_STAGE_SAVELOC_REQ:
+        {
+            if (!CanPeerTransferSavelocs(fromWho.ConvertToUint64()))
+                break;
 
-        read = SteamNetworkingMessages()->ReceiveMessagesOnChannel(0, messages, MAX_MESSAGES_PER_READ);
+            g_pSavelocSystem->WriteRequestedSavelocs(&saveloc, fromWho.ConvertToUint64());
+        }
+        break;
+        case SAVELOC_REQ_STAGE_SAVELOC_ACK:
+        {
+            g_pSavelocSystem->ReadReceivedSavelocs(&saveloc, fromWho.ConvertToUint64());
+        }
+        break;
+        case SAVELOC_REQ_STAGE_CHUNK_ACK:
+        {
+            g_pSavelocSystem->OnSavelocChunkAcked(fromWho.ConvertToUint64());
+        }
+        break;
+        case SAVELOC_REQ_STAGE_DONE:
+        {
+            g_pSavelocSystem->RequesterLeft(fromWho.ConvertToUint64());
+        }
+        break;
+        case SAVELOC_REQ_STAGE_INVALID:
+        default:
+            DevWarning(2, "Invalid stage for the saveloc request packet!\n");
+            break;
+        }
+    }
+    break;
+    default:
+        break;
     }
 }
 
 void CMomentumLobbySystem::SendP2PPackets()
 {
-    if (m_flNextUpdateTime > 0.0f && gpGlobals->curtime > m_flNextUpdateTime)
+    CHECK_STEAM_API(SteamNetworkingMessages());
+
+    if (m_flNextUpdateTime < 0.0f || gpGlobals->curtime <= m_flNextUpdateTime)
+    {
+        // Decals don't wait for the next position update
+        FlushPendingDecals();
+        return;
+    }
+
+    PositionPacket frame;
+    if (!g_pMomentumGhostClient->CreateNewNetFrame(frame))
+    {
+        FlushPendingDecals();
+        return;
+    }
+
+    QuantizedPosition_t quantized;
+    quantized.FromPacket(frame);
+
+    const uint16 sequence = ++m_iPositionSequence;
+    const bool bKeyframe = !m_bHasPositionKeyframe || static_cast<uint16>(sequence - m_iKeyframeSequence) >= POSITION_KEYFRAME_INTERVAL;
+
+    // Keyframes go out reliably to everyone that reads compact positions, they're what the deltas are built on
+    CompactPositionPacket packet(quantized, sequence, bKeyframe ? sequence : m_iKeyframeSequence, bKeyframe ? nullptr : &m_PositionKeyframe);
+
+    const Vector vecOurOrigin = frame.Position + Vector(0, 0, frame.ViewOffset);
+    const byte *pOurPVS = nullptr;
+    byte ourPVS[MAX_MAP_CLUSTERS / 8];
+    if (mom_lobby_interest_enable.GetBool())
+    {
+        engine->GetPVSForCluster(engine->GetClusterForOrigin(vecOurOrigin), sizeof(ourPVS), ourPVS);
+        pOurPVS = ourPVS;
+    }
+
+    bool bSent = false;
+
+    // Members on other maps don't have a ghost in ours, so they never get our position or decals
+    auto index = m_mapLobbyGhosts.FirstInorder();
+    while (index != m_mapLobbyGhosts.InvalidIndex())
     {
-        PositionPacket frame;
-        if (g_pMomentumGhostClient->CreateNewNetFrame(frame) && SendPacketToEveryone(&frame))
+        const auto peerID = m_mapLobbyGhosts.Key(index);
+        const auto pPeer = m_mapLobbyGhosts[index];
+        index = m_mapLobbyGhosts.NextInorder(index);
+
+        if (!pPeer)
+            continue;
+
+        auto nextIndex = m_mapNextPeerUpdate.Find(peerID);
+        if (!m_mapNextPeerUpdate.IsValidIndex(nextIndex))
+            nextIndex = m_mapNextPeerUpdate.Insert(peerID, 0.0f);
+
+        // Members from before compact positions can't decode them, nor the deltas they'd need keyframes for,
+        // and can't read batches either
+        const bool bCompact = CanPeerBatch(peerID);
+        MomentumPacket *pPosition = bCompact ? static_cast<MomentumPacket *>(&packet) : &frame;
+
+        BatchPacket batch;
+        if (!batch.AddBatch(m_PendingDecals))
         {
-            m_flNextUpdateTime = gpGlobals->curtime + (1.0f / MOM_ONLINE_GHOST_UPDATERATE);
+            // Only if the pending decals ever outgrow an empty batch, then they go ahead on their own
+            SendBatch(m_PendingDecals, peerID, k_nSteamNetworkingSend_Unreliable, bCompact);
         }
+
+        if ((bKeyframe && bCompact) || gpGlobals->curtime >= m_mapNextPeerUpdate[nextIndex])
+        {
+            if (!batch.AddPacket(pPosition))
+            {
+                SendBatch(batch, peerID, k_nSteamNetworkingSend_Unreliable, bCompact);
+                batch.Clear();
+                batch.AddPacket(pPosition);
+            }
+
+            const float flRate = GetPeerUpdateRate(pPeer, vecOurOrigin, pOurPVS, sizeof(ourPVS));
+            m_mapNextPeerUpdate[nextIndex] = gpGlobals->curtime + (1.0f / flRate);
+        }
+
+        const bool bReliable = bKeyframe && bCompact;
+        if (SendBatch(batch, peerID, bReliable ? k_nSteamNetworkingSend_Reliable : k_nSteamNetworkingSend_Unreliable, bCompact) && bCompact)
+            bSent = true;
     }
+
+    m_PendingDecals.Clear();
+
+    if (bKeyframe && bSent)
+    {
+        m_PositionKeyframe = quantized;
+        m_iKeyframeSequence = sequence;
+        m_bHasPositionKeyframe = true;
+    }
+
+    m_flNextUpdateTime = gpGlobals->curtime + (1.0f / MOM_ONLINE_GHOST_UPDATERATE);
 }
 
 void CMomentumLobbySystem::SetIsSpectating(bool bSpec)
@@ -1020,9 +1246,37 @@ uint64 CMomentumLobbySystem::GetSpectatingTargetFromMemberData(const CSteamID &p
     return toReturn;
 }
 
+int CMomentumLobbySystem::GetNetVersionFromMemberData(const CSteamID &member)
+{
+    CHECK_STEAM_API_I(SteamMatchmaking());
+
+    const auto pVersion = SteamMatchmaking()->GetLobbyMemberData(m_sLobbyID, member, LOBBY_DATA_NET_VERSION);
+    return (pVersion && pVersion[0]) ? Q_atoi(pVersion) : 0;
+}
+
+bool CMomentumLobbySystem::CanPeerBatch(uint64 peerID)
+{
+    return GetNetVersionFromMemberData(CSteamID(peerID)) >= LOBBY_NET_VERSION_BATCH;
+}
+
+bool CMomentumLobbySystem::CanPeerTransferSavelocs(uint64 peerID)
+{
+    return GetNetVersionFromMemberData(CSteamID(peerID)) >= LOBBY_NET_VERSION_SAVELOC_CHUNKS;
+}
+
 bool CMomentumLobbySystem::SendDecalPacket(DecalPacket *packet)
 {
-    return LobbyValid() && SendPacketToEveryone(packet);
+    if (!LobbyValid() || m_mapLobbyGhosts.Count() == 0)
+        return false;
+
+    // Queued up to go out with this tick's position update
+    if (!m_PendingDecals.AddPacket(packet))
+    {
+        FlushPendingDecals();
+        m_PendingDecals.AddPacket(packet);
+    }
+
+    return true;
 }
 
 void CMomentumLobbySystem::SetSpectatorTarget(const CSteamID &ghostTarget, bool bStartedSpectating, bool bLeft)
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "mom_shareddefs.h"
+#include "mom_ghostdefs.h"
 
 class MomentumPacket;
 class DecalPacket;
@@ -48,11 +49,13 @@ public:
     void SendAndReceiveP2PPackets();
     void ReceiveP2PPackets();
     void SendP2PPackets();
+    void HandlePacket(const CSteamID &fromWho, CMomentumOnlineGhostEntity *pEntity, CUtlBuffer &buf, bool bInBatch);
 
     void SetSpectatorTarget(const CSteamID &ghostTarget, bool bStarted, bool bLeft = false);
     void SetIsSpectating(bool bSpec);
     bool GetIsSpectatingFromMemberData(const CSteamID &who);
     uint64 GetSpectatingTargetFromMemberData(const CSteamID &person);
+    int GetNetVersionFromMemberData(const CSteamID &member); // 0 for members from before LOBBY_NET_VERSION
 
     bool SendDecalPacket(DecalPacket *packet);
 
@@ -77,9 +80,30 @@ private:
 
     bool m_bHostingLobby;
 
+    // Compact position packets we sent, the keyframe is the baseline of the deltas in between
+    uint16 m_iPositionSequence;
+    uint16 m_iKeyframeSequence;
+    bool m_bHasPositionKeyframe;
+    QuantizedPosition_t m_PositionKeyframe;
+
+    // Interest management, when each lobby member on our map is due its next position update
+    CUtlMap<uint64, float> m_mapNextPeerUpdate;
+    // Decals waiting to go out with the next batch
+    BatchPacket m_PendingDecals;
+
+    // Position updates per second a lobby member gets from us, based on how much of us they can see
+    float GetPeerUpdateRate(CMomentumOnlineGhostEntity *pPeer, const Vector &vecOurOrigin, const byte *pOurPVS, int iPVSSize);
+    void FlushPendingDecals();
+
     // Sends a packet to a specific person
     bool SendPacket(MomentumPacket *packet, const CSteamID &target, int sendType = k_nSteamNetworkingSend_Unreliable) const;
     bool SendPacketToEveryone(MomentumPacket *pPacket, int sendType = k_nSteamNetworkingSend_Unreliable);
+    // Sends the packets one by one instead if the target can't read batches
+    bool SendBatch(BatchPacket &batch, uint64 target, int sendType, bool bCanBatch);
+    // Whether the lobby member understands batches and compact positions
+    bool CanPeerBatch(uint64 peerID);
+    // Whether the lobby member understands chunked saveloc transfers
+    bool CanPeerTransferSavelocs(uint64 peerID);
 
     void WriteLobbyMessage(LobbyMessageType_t type, uint64 id);
     void WriteSpecMessage(SpectateMessageType_t type, uint64 playerID, uint64 targetID);
@@ -0,0 +1,454 @@
+#include "cbase.h"
+
+#include "mom_movement_sim.h"
+#include "mom_player.h"
+#include "mom_timer.h"
+#include "mom_triggers.h"
+#include "movehelper_server.h"
+#include "player_command.h"
+#include "run/mom_replay_base.h"
+#include "run/mom_replay_factory.h"
+#include "util/baseautocompletefilelist.h"
+#include "filesystem.h"
+
+#include "tier0/memdbgon.h"
+
+#define MOVESIM_PATH "movesim"
+
+static MAKE_CONVAR(mom_movesim_tolerance, "0.01", FCVAR_CHEAT,
+                   "How far (in units) the simulated origin can be from the recorded one before a tick counts as divergent.\n", 0.0f, 1000.0f);
+static MAKE_TOGGLE_CONVAR(mom_movesim_csv, "0", FCVAR_CHEAT, "If 1, mom_movesim also writes every tick's origins and divergence to movesim/<replay>.csv\n");
+
+extern ConVar cl_forwardspeed;
+extern ConVar cl_sidespeed;
+
+void MovementSimResult_t::Reset()
+{
+    m_vecDivergence.RemoveAll();
+    m_vecOrigins.RemoveAll();
+    m_iTicks = 0;
+    m_iResyncs = 0;
+    m_iFirstDivergentTick = -1;
+    m_iMaxDivergenceTick = -1;
+    m_flMaxDivergence = 0.0f;
+    m_flSimulationTime = 0.0;
+}
+
+void CMomMovementSimulator::SaveState(CMomentumPlayer *pPlayer, PlayerMoveState_t &state)
+{
+    state.m_vecOrigin = pPlayer->GetAbsOrigin();
+    state.m_vecVelocity = pPlayer->GetAbsVelocity();
+    state.m_vecBaseVelocity = pPlayer->GetBaseVelocity();
+    state.m_vecViewOffset = pPlayer->GetViewOffset();
+    state.m_angAbsAngles = pPlayer->GetAbsAngles();
+    state.m_angViewAngles = pPlayer->pl.v_angle;
+    state.m_angPunch = pPlayer->m_Local.m_vecPunchAngle;
+    state.m_fFlags = pPlayer->GetFlags();
+    state.m_MoveType = pPlayer->GetMoveType();
+    state.m_hGroundEntity = pPlayer->GetGroundEntity();
+    state.m_nButtons = pPlayer->m_nButtons;
+    state.m_afButtonPressed = pPlayer->m_afButtonPressed;
+    state.m_afButtonReleased = pPlayer->m_afButtonReleased;
+    state.m_afButtonLast = pPlayer->m_afButtonLast;
+    state.m_nOldButtons = pPlayer->m_Local.m_nOldButtons;
+    state.m_flSurfaceFriction = pPlayer->m_surfaceFriction;
+
+    state.m_bDucked = pPlayer->m_Local.m_bDucked;
+    state.m_bDucking = pPlayer->m_Local.m_bDucking;
+    state.m_bInDuckJump = pPlayer->m_Local.m_bInDuckJump;
+    state.m_flDucktime = pPlayer->m_Local.m_flDucktime;
+    state.m_flDuckJumpTime = pPlayer->m_Local.m_flDuckJumpTime;
+    state.m_flJumpTime = pPlayer->m_Local.m_flJumpTime;
+    state.m_flFallVelocity = pPlayer->m_Local.m_flFallVelocity;
+    state.m_flLurchTimer = pPlayer->m_Local.m_lurchTimer;
+    state.m_flSlideBoostCooldown = pPlayer->m_Local.m_slideBoostCooldown;
+    state.m_flWallRunTime = pPlayer->m_Local.m_flWallRunTime;
+
+    state.m_bPreventPlayerBhop = pPlayer->m_bPreventPlayerBhop;
+    state.m_bDidPlayerBhop = pPlayer->m_bDidPlayerBhop;
+    state.m_bSurfing = pPlayer->m_bSurfing;
+    state.m_bIsSprinting = pPlayer->m_bIsSprinting;
+    state.m_bWasInAir = pPlayer->m_bWasInAir;
+    state.m_iLandTick = pPlayer->m_iLandTick;
+    state.m_iLastBlock = pPlayer->m_iLastBlock;
+    state.m_fDuckTimer = pPlayer->m_fDuckTimer;
+    state.m_flPunishTime = pPlayer->m_flPunishTime;
+    state.m_flStamina = pPlayer->m_flStamina;
+    state.m_flLastJumpTime = pPlayer->m_Data.m_flLastJumpTime;
+    state.m_bIsPowerSliding = pPlayer->m_bIsPowerSliding;
+    state.m_nWallRunState = pPlayer->m_nWallRunState;
+    state.m_nAirJumpState = pPlayer->m_nAirJumpState;
+    state.m_vecWallNorm = pPlayer->m_vecWallNorm;
+    state.m_vecLastWallRunPos = pPlayer->m_vecLastWallRunPos;
+    state.m_flCoyoteTime = pPlayer->m_flCoyoteTime;
+    state.m_flNextWallRunTime = pPlayer->m_flNextWallRunTime;
+    state.m_hSlideTrigger = pPlayer->m_CurrentSlideTrigger.Get();
+
+    state.m_bInAirDueToJump = pPlayer->m_bInAirDueToJump;
+    state.m_iJumpTick = pPlayer->m_iJumpTick;
+    state.m_iSuccessiveBhops = pPlayer->m_iSuccessiveBhops;
+    state.m_flLastJumpVel = pPlayer->m_Data.m_flLastJumpVel;
+    state.m_flLastJumpZPos = pPlayer->m_Data.m_flLastJumpZPos;
+    state.m_bIsInZone = pPlayer->m_Data.m_bIsInZone;
+    state.m_iCurrentZone = pPlayer->m_Data.m_iCurrentZone;
+    state.m_vecRampBoardVel = pPlayer->m_vecRampBoardVel;
+    state.m_vecRampLeaveVel = pPlayer->m_vecRampLeaveVel;
+    for (int i = 0; i < SurfInt::TYPE_COUNT; i++)
+    {
+        state.m_surfIntList[i] = pPlayer->m_surfIntList[i];
+        state.m_surfIntHistory[i] = pPlayer->m_surfIntHistory[i];
+    }
+}
+
+void CMomMovementSimulator::RestoreState(CMomentumPlayer *pPlayer, const PlayerMoveState_t &state)
+{
+    // Before the flags, this only updates the physics shadow when the duck state changed
+    pPlayer->ToggleDuckThisFrame(state.m_bDucked);
+
+    pPlayer->SetMoveType(state.m_MoveType);
+    pPlayer->SetAbsOrigin(state.m_vecOrigin);
+    pPlayer->SetAbsVelocity(state.m_vecVelocity);
+    pPlayer->SetBaseVelocity(state.m_vecBaseVelocity);
+    pPlayer->SetViewOffset(state.m_vecViewOffset);
+    pPlayer->SetAbsAngles(state.m_angAbsAngles);
+    pPlayer->pl.v_angle = state.m_angViewAngles;
+    pPlayer->m_Local.m_vecPunchAngle = state.m_angPunch;
+    pPlayer->ClearFlags();
+    pPlayer->AddFlag(state.m_fFlags);
+    pPlayer->SetGroundEntity(state.m_hGroundEntity.Get());
+    pPlayer->m_nButtons = state.m_nButtons;
+    pPlayer->m_afButtonPressed = state.m_afButtonPressed;
+    pPlayer->m_afButtonReleased = state.m_afButtonReleased;
+    pPlayer->m_afButtonLast = state.m_afButtonLast;
+    pPlayer->m_Local.m_nOldButtons = state.m_nOldButtons;
+    pPlayer->m_surfaceFriction = state.m_flSurfaceFriction;
+
+    pPlayer->m_Local.m_bDucking = state.m_bDucking;
+    pPlayer->m_Local.m_bInDuckJump = state.m_bInDuckJump;
+    pPlayer->m_Local.m_flDucktime = state.m_flDucktime;
+    pPlayer->m_Local.m_flDuckJumpTime = state.m_flDuckJumpTime;
+    pPlayer->m_Local.m_flJumpTime = state.m_flJumpTime;
+    pPlayer->m_Local.m_flFallVelocity = state.m_flFallVelocity;
+    pPlayer->m_Local.m_lurchTimer = state.m_flLurchTimer;
+    pPlayer->m_Local.m_slideBoostCooldown = state.m_flSlideBoostCooldown;
+    pPlayer->m_Local.m_flWallRunTime = state.m_flWallRunTime;
+
+    pPlayer->m_bPreventPlayerBhop = state.m_bPreventPlayerBhop;
+    pPlayer->m_bDidPlayerBhop = state.m_bDidPlayerBhop;
+    pPlayer->m_bSurfing = state.m_bSurfing;
+    pPlayer->m_bIsSprinting = state.m_bIsSprinting;
+    pPlayer->m_bWasInAir = state.m_bWasInAir;
+    pPlayer->m_iLandTick = state.m_iLandTick;
+    pPlayer->m_iLastBlock = state.m_iLastBlock;
+    pPlayer->m_fDuckTimer = state.m_fDuckTimer;
+    pPlayer->m_flPunishTime = state.m_flPunishTime;
+    pPlayer->m_flStamina = state.m_flStamina;
+    pPlayer->m_Data.m_flLastJumpTime = state.m_flLastJumpTime;
+    pPlayer->m_bIsPowerSliding = state.m_bIsPowerSliding;
+    pPlayer->m_nWallRunState = state.m_nWallRunState;
+    pPlayer->m_nAirJumpState = state.m_nAirJumpState;
+    pPlayer->m_vecWallNorm = state.m_vecWallNorm;
+    pPlayer->m_vecLastWallRunPos = state.m_vecLastWallRunPos;
+    pPlayer->m_flCoyoteTime = state.m_flCoyoteTime;
+    pPlayer->m_flNextWallRunTime = state.m_flNextWallRunTime;
+    pPlayer->m_CurrentSlideTrigger = state.m_hSlideTrigger.Get();
+
+    pPlayer->m_bInAirDueToJump = state.m_bInAirDueToJump;
+    pPlayer->m_iJumpTick = state.m_iJumpTick;
+    pPlayer->m_iSuccessiveBhops = state.m_iSuccessiveBhops;
+    pPlayer->m_Data.m_flLastJumpVel = state.m_flLastJumpVel;
+    pPlayer->m_Data.m_flLastJumpZPos = state.m_flLastJumpZPos;
+    pPlayer->m_Data.m_bIsInZone = state.m_bIsInZone;
+    pPlayer->m_Data.m_iCurrentZone = state.m_iCurrentZone;
+    pPlayer->m_vecRampBoardVel = state.m_vecRampBoardVel;
+    pPlayer->m_vecRampLeaveVel = state.m_vecRampLeaveVel;
+    for (int i = 0; i < SurfInt::TYPE_COUNT; i++)
+    {
+        pPlayer->m_surfIntList[i] = state.m_surfIntList[i];
+        pPlayer->m_surfIntHistory[i] = state.m_surfIntHistory[i];
+    }
+}
+
+void CMomMovementSimulator::ResetPlayer(CMomentumPlayer *pPlayer, const CReplayFrame &frame, const Vector &vecVelocity)
+{
+    // The replay only has the view offset, the player is ducked if it's closer to the ducked one
+    const float flViewZ = frame.PlayerViewOffset();
+    const bool bDucked = fabsf(flViewZ - VEC_DUCK_VIEW_SCALED(pPlayer).z) < fabsf(flViewZ - VEC_VIEW_SCALED(pPlayer).z);
+    pPlayer->ToggleDuckThisFrame(bDucked);
+
+    pPlayer->SetMoveType(MOVETYPE_WALK);
+    pPlayer->SetAbsOrigin(frame.PlayerOrigin());
+    pPlayer->SetAbsVelocity(vecVelocity);
+    pPlayer->SetBaseVelocity(vec3_origin);
+    pPlayer->SetViewOffset(Vector(0.0f, 0.0f, flViewZ));
+    pPlayer->pl.v_angle = frame.EyeAngles();
+    pPlayer->m_Local.m_vecPunchAngle = vec3_angle;
+    pPlayer->SetGroundEntity(nullptr);
+    pPlayer->RemoveFlag(FL_BASEVELOCITY);
+    pPlayer->m_nButtons = frame.PlayerButtons() & ~IN_REPLAY_TELEPORTED;
+    pPlayer->m_Local.m_nOldButtons = pPlayer->m_nButtons;
+    pPlayer->m_surfaceFriction = 1.0f;
+
+    pPlayer->m_Local.m_bDucking = false;
+    pPlayer->m_Local.m_bInDuckJump = false;
+    pPlayer->m_Local.m_flDucktime = 0.0f;
+    pPlayer->m_Local.m_flDuckJumpTime = 0.0f;
+    pPlayer->m_Local.m_flJumpTime = 0.0f;
+    pPlayer->m_Local.m_flFallVelocity = 0.0f;
+    pPlayer->m_Local.m_lurchTimer = 0.0f;
+    pPlayer->m_Local.m_slideBoostCooldown = 0.0f;
+    pPlayer->m_Local.m_flWallRunTime = 0.0f;
+
+    pPlayer->m_bPreventPlayerBhop = false;
+    pPlayer->m_bDidPlayerBhop = false;
+    pPlayer->m_bSurfing = false;
+    pPlayer->m_bWasInAir = false;
+    pPlayer->m_iLandTick = 0;
+    pPlayer->m_iLastBlock = -1;
+    pPlayer->m_fDuckTimer = 0.0f;
+    pPlayer->m_flPunishTime = -1.0f;
+    pPlayer->m_flStamina = 0.0f;
+    pPlayer->m_bIsPowerSliding = false;
+    pPlayer->m_nWallRunState = WALLRUN_NOT;
+    pPlayer->m_nAirJumpState = AIRJUMP_READY;
+    pPlayer->m_flCoyoteTime = 0.0f;
+    pPlayer->m_flNextWallRunTime = 0.0f;
+    pPlayer->m_CurrentSlideTrigger = nullptr;
+
+    // Triggers aren't touched, so the player is never in a zone while simulating
+    pPlayer->m_bInAirDueToJump = false;
+    pPlayer->m_iJumpTick = 0;
+    pPlayer->m_iSuccessiveBhops = 0;
+    pPlayer->m_Data.m_bIsInZone = false;
+    pPlayer->m_Data.m_iCurrentZone = 0;
+}
+
+bool CMomMovementSimulator::Simulate(CMomentumPlayer *pPlayer, CMomReplayBase *pReplay, bool bResync, float flTolerance,
+                                     MovementSimResult_t &result, bool bKeepOrigins /*= false*/)
+{
+    result.Reset();
+
+    // The movement runs on the player, it mustn't happen in the middle of a run
+    if (g_pMomentumTimer->IsRunning())
+    {
+        Warning("Can't simulate movement while the timer is running!\n");
+        return false;
+    }
+
+    const int iFrames = pReplay->GetFrameCount();
+    if (iFrames < 2)
+    {
+        Warning("The replay has no movement to simulate!\n");
+        return false;
+    }
+
+    const float flInterval = pReplay->GetTickInterval();
+    if (!CloseEnough(flInterval, gpGlobals->interval_per_tick, FLT_EPSILON))
+    {
+        Warning("The replay was recorded with a tick interval of %f, the server is running %f!\n", flInterval, gpGlobals->interval_per_tick);
+        return false;
+    }
+
+    PlayerMoveState_t savedState;
+    SaveState(pPlayer, savedState);
+
+    const int iOldTickCount = gpGlobals->tickcount;
+    const float flOldCurTime = gpGlobals->curtime;
+    const float flOldFrameTime = gpGlobals->frametime;
+
+    result.m_vecDivergence.EnsureCapacity(iFrames - 1);
+    if (bKeepOrigins)
+        result.m_vecOrigins.EnsureCapacity(iFrames - 1);
+
+    // Frames may be streamed, so they're copied before the next lookup
+    CReplayFrame frame = *pReplay->GetFrame(0);
+    ResetPlayer(pPlayer, frame, (pReplay->GetFrame(1)->PlayerOrigin() - frame.PlayerOrigin()) / flInterval);
+
+    pPlayer->SetSimulatingMovement(true);
+    MoveHelperServer()->SetHost(pPlayer);
+    const double flStartTime = Plat_FloatTime();
+
+    // Frame N is where the player was after tick N's movement, so tick N runs frame N's input from frame N - 1's origin
+    for (int i = 1; i < iFrames; i++)
+    {
+        const Vector vecPrevOrigin = frame.PlayerOrigin();
+        frame = *pReplay->GetFrame(i);
+
+        if (frame.Teleported())
+        {
+            // Teleports aren't movement, so start over from wherever the replay went
+            Vector vecVelocity = vec3_origin;
+            if (i + 1 < iFrames)
+                vecVelocity = (pReplay->GetFrame(i + 1)->PlayerOrigin() - frame.PlayerOrigin()) / flInterval;
+
+            ResetPlayer(pPlayer, frame, vecVelocity);
+            result.m_iResyncs++;
+        }
+        else
+        {
+            if (bResync)
+                pPlayer->SetAbsOrigin(vecPrevOrigin);
+
+            gpGlobals->tickcount = iOldTickCount + i;
+            gpGlobals->curtime = flOldCurTime + i * flInterval;
+            gpGlobals->frametime = flInterval;
+
+            const int iButtons = frame.PlayerButtons() & ~IN_REPLAY_TELEPORTED;
+
+            CUserCmd cmd;
+            cmd.command_number = i;
+            cmd.tick_count = gpGlobals->tickcount;
+            cmd.viewangles = frame.EyeAngles();
+            cmd.buttons = iButtons;
+            if (iButtons & IN_FORWARD)
+                cmd.forwardmove += cl_forwardspeed.GetFloat();
+            if (iButtons & IN_BACK)
+                cmd.forwardmove -= cl_forwardspeed.GetFloat();
+            if (iButtons & IN_MOVERIGHT)
+                cmd.sidemove += cl_sidespeed.GetFloat();
+            if (iButtons & IN_MOVELEFT)
+                cmd.sidemove -= cl_sidespeed.GetFloat();
+
+            PlayerMove()->RunMovementOnly(pPlayer, &cmd, MoveHelperServer());
+        }
+
+        const Vector &vecOrigin = pPlayer->GetAbsOrigin();
+        const float flDivergence = vecOrigin.DistTo(frame.PlayerOrigin());
+        const int iTick = result.m_vecDivergence.AddToTail(flDivergence);
+
+        if (bKeepOrigins)
+            result.m_vecOrigins.AddToTail(vecOrigin);
+
+        if (flDivergence > result.m_flMaxDivergence)
+        {
+            result.m_flMaxDivergence = flDivergence;
+            result.m_iMaxDivergenceTick = iTick;
+        }
+
+        if (result.m_iFirstDivergentTick == -1 && flDivergence > flTolerance)
+            result.m_iFirstDivergentTick = iTick;
+    }
+
+    result.m_flSimulationTime = Plat_FloatTime() - flStartTime;
+    result.m_iTicks = result.m_vecDivergence.Count();
+
+    MoveHelperServer()->SetHost(nullptr);
+    pPlayer->SetSimulatingMovement(false);
+
+    gpGlobals->tickcount = iOldTickCount;
+    gpGlobals->curtime = flOldCurTime;
+    gpGlobals->frametime = flOldFrameTime;
+
+    RestoreState(pPlayer, savedState);
+
+    return true;
+}
+
+static void WriteMovementSimCSV(const char *pReplayPath, CMomReplayBase *pReplay, const MovementSimResult_t &result)
+{
+    char fileBase[MAX_PATH], csvPath[MAX_PATH];
+    V_FileBase(pReplayPath, fileBase, sizeof(fileBase));
+    V_DefaultExtension(fileBase, ".csv", sizeof(fileBase));
+    V_ComposeFileName(MOVESIM_PATH, fileBase, csvPath, sizeof(csvPath));
+
+    g_pFullFileSystem->CreateDirHierarchy(MOVESIM_PATH, "MOD");
+
+    const FileHandle_t hFile = g_pFullFileSystem->Open(csvPath, "w", "MOD");
+    if (!hFile)
+    {
+        Warning("Could not open %s for writing!\n", csvPath);
+        return;
+    }
+
+    g_pFullFileSystem->FPrintf(hFile, "tick,sim_x,sim_y,sim_z,rec_x,rec_y,rec_z,divergence\n");
+
+    // Tick i of the result is frame i + 1 of the replay
+    for (int i = 0; i < result.m_iTicks; i++)
+    {
+        const Vector &vecSim = result.m_vecOrigins[i];
+        const Vector vecRec = pReplay->GetFrame(i + 1)->PlayerOrigin();
+        g_pFullFileSystem->FPrintf(hFile, "%i,%f,%f,%f,%f,%f,%f,%f\n", i, vecSim.x, vecSim.y, vecSim.z,
+                                   vecRec.x, vecRec.y, vecRec.z, result.m_vecDivergence[i]);
+    }
+
+    g_pFullFileSystem->Close(hFile);
+
+    Msg("Wrote the per tick results to %s\n", csvPath);
+}
+
+static void MovementSimCommand(const CCommand &args)
+{
+    if (args.ArgC() < 2)
+    {
+        Msg("Usage: mom_movesim <replay> [resync 0/1 = 0] [passes = 1]\n");
+        return;
+    }
+
+    const auto pPlayer = CMomentumPlayer::GetLocalPlayer();
+    if (!pPlayer)
+        return;
+
+    if (g_pMomentumTimer->IsRunning() || pPlayer->GetObserverMode() != OBS_MODE_NONE)
+    {
+        Warning("Stop the timer and stop spectating before simulating movement!\n");
+        return;
+    }
+
+    char fileName[MAX_PATH], replayPath[MAX_PATH];
+    Q_strncpy(fileName, args.Arg(1), sizeof(fileName));
+    V_DefaultExtension(fileName, EXT_RECORDING_FILE, sizeof(fileName));
+    V_ComposeFileName(RECORDING_PATH, fileName, replayPath, sizeof(replayPath));
+
+    const auto pReplay = g_ReplayFactory.LoadReplayFile(replayPath);
+    if (!pReplay)
+    {
+        Warning("Could not load replay %s!\n", replayPath);
+        return;
+    }
+
+    if (Q_stricmp(STRING(gpGlobals->mapname), pReplay->GetMapName()))
+        Warning("The replay is from %s, the results won't mean much on %s.\n", pReplay->GetMapName(), STRING(gpGlobals->mapname));
+
+    const bool bResync = args.ArgC() > 2 && Q_atoi(args.Arg(2)) != 0;
+    const int iPasses = args.ArgC() > 3 ? max(1, Q_atoi(args.Arg(3))) : 1;
+    const float flTolerance = mom_movesim_tolerance.GetFloat();
+    const bool bCSV = mom_movesim_csv.GetBool();
+
+    CMomMovementSimulator simulator;
+    MovementSimResult_t result;
+    double flTotalTime = 0.0;
+    for (int i = 0; i < iPasses; i++)
+    {
+        if (!simulator.Simulate(pPlayer, pReplay, bResync, flTolerance, result, bCSV))
+        {
+            delete pReplay;
+            return;
+        }
+
+        flTotalTime += result.m_flSimulationTime;
+    }
+
+    Msg("Simulated %i ticks of %s (%s) in %.3f ms per pass, %.0f ticks/s\n", result.m_iTicks, replayPath,
+        bResync ? "resynced every tick" : "free running", 1000.0 * flTotalTime / iPasses,
+        flTotalTime > 0.0 ? result.m_iTicks * iPasses / flTotalTime : 0.0);
+    Msg("Max divergence: %.4f units at tick %i\n", result.m_flMaxDivergence, result.m_iMaxDivergenceTick);
+
+    if (result.m_iFirstDivergentTick == -1)
+        Msg("No tick diverged by more than %.4f units\n", flTolerance);
+    else
+        Msg("First tick diverging by more than %.4f units: %i\n", flTolerance, result.m_iFirstDivergentTick);
+
+    if (result.m_iResyncs)
+        Msg("Resynced to %i teleports\n", result.m_iResyncs);
+
+    if (bCSV)
+        WriteMovementSimCSV(replayPath, pReplay, result);
+
+    delete pReplay;
+}
+
+DECLARE_AUTOCOMPLETION_FUNCTION(mom_movesim, RECORDING_PATH, EXT_RECORDING_FILE)
+static ConCommand mom_movesim_command("mom_movesim", MovementSimCommand,
+                                      "Runs a replay's input back through the player movement on the current map and reports "
+                                      "how far it ends up from the recording.\nUsage: mom_movesim <replay> [resync 0/1 = 0] [passes = 1]\n",
+                                      FCVAR_CHEAT, AUTOCOMPLETION_FUNCTION(mom_movesim));
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "mom_shareddefs.h"
+#include "run/mom_run_entity.h"
+
+class CMomentumPlayer;
+class CMomReplayBase;
+class CReplayFrame;
+class CTriggerSlide;
+
+struct MovementSimResult_t
+{
+    MovementSimResult_t() { Reset(); }
+    void Reset();
+
+    CUtlVector<float> m_vecDivergence; // Distance from the recorded origin, per simulated tick
+    CUtlVector<Vector> m_vecOrigins; // Simulated origins, only filled when asked for
+
+    int m_iTicks;
+    int m_iResyncs; // Teleports in the replay the simulation had to snap to
+    int m_iFirstDivergentTick; // First tick over the tolerance, -1 if none
+    int m_iMaxDivergenceTick;
+    float m_flMaxDivergence;
+    double m_flSimulationTime; // Seconds spent in the movement code
+};
+
+// Runs a replay's recorded input back through the game movement against the loaded map's collision,
+// without thinking, touching triggers or networking, and compares where the player ends up with where
+// the replay says they were. The player's movement state is saved before and restored after, and the
+// player is flagged as simulating so the movement doesn't fire events, play sounds or touch the timer.
+class CMomMovementSimulator
+{
+public:
+    // With bResync, every tick starts from the previous recorded origin, so the divergence of a tick
+    // is only that tick's error. Without it errors carry over, like they would when playing the input back.
+    bool Simulate(CMomentumPlayer *pPlayer, CMomReplayBase *pReplay, bool bResync, float flTolerance,
+                  MovementSimResult_t &result, bool bKeepOrigins = false);
+
+private:
+    // Everything the movement code reads or writes on the player
+    struct PlayerMoveState_t
+    {
+        Vector m_vecOrigin, m_vecVelocity, m_vecBaseVelocity, m_vecViewOffset;
+        QAngle m_angAbsAngles, m_angViewAngles, m_angPunch;
+        int m_fFlags;
+        MoveType_t m_MoveType;
+        EHANDLE m_hGroundEntity;
+        int m_nButtons, m_afButtonPressed, m_afButtonReleased, m_afButtonLast, m_nOldButtons;
+        float m_flSurfaceFriction;
+
+        bool m_bDucked, m_bDucking, m_bInDuckJump;
+        float m_flDucktime, m_flDuckJumpTime, m_flJumpTime, m_flFallVelocity;
+        float m_flLurchTimer, m_flSlideBoostCooldown, m_flWallRunTime;
+
+        bool m_bPreventPlayerBhop, m_bDidPlayerBhop, m_bSurfing, m_bIsSprinting, m_bWasInAir;
+        int m_iLandTick, m_iLastBlock;
+        float m_fDuckTimer, m_flPunishTime, m_flStamina, m_flLastJumpTime;
+        bool m_bIsPowerSliding;
+        WallRunState m_nWallRunState;
+        AirJumpState m_nAirJumpState;
+        Vector m_vecWallNorm, m_vecLastWallRunPos;
+        float m_flCoyoteTime, m_flNextWallRunTime;
+        CHandle<CTriggerSlide> m_hSlideTrigger;
+
+        bool m_bInAirDueToJump;
+        int m_iJumpTick, m_iSuccessiveBhops;
+        float m_flLastJumpVel, m_flLastJumpZPos;
+        bool m_bIsInZone;
+        int m_iCurrentZone;
+        Vector m_vecRampBoardVel, m_vecRampLeaveVel;
+        SurfInt m_surfIntList[SurfInt::TYPE_COUNT];
+        SurfInt::Type m_surfIntHistory[SurfInt::TYPE_COUNT];
+    };
+
+    void SaveState(CMomentumPlayer *pPlayer, PlayerMoveState_t &state);
+    void RestoreState(CMomentumPlayer *pPlayer, const PlayerMoveState_t &state);
+
+    // Puts the player where the frame is, with fresh movement state
+    void ResetPlayer(CMomentumPlayer *pPlayer, const CReplayFrame &frame, const Vector &vecVelocity);
+};
@@ -32,7 +32,12 @@ static void RefreshGhostData(IConVar *var, const char *pValue, float oldValue)
     g_pMomentumGhostClient->ResetOtherAppearanceData();
 }
 
-static MAKE_CONVAR(mom_ghost_online_lerp, "0.5", FCVAR_REPLICATED | FCVAR_ARCHIVE, "The amount of time to render in the past (in seconds).\n", 0.1f, 2.0f);
+static MAKE_CONVAR(mom_ghost_online_lerp, "0.5", FCVAR_REPLICATED | FCVAR_ARCHIVE, "The amount of time to render in the past (in seconds). "
+                   "With mom_ghost_online_lerp_adaptive on, this is the most it will go up to.\n", 0.1f, 2.0f);
+static MAKE_TOGGLE_CONVAR(mom_ghost_online_lerp_adaptive, "1", FCVAR_REPLICATED | FCVAR_ARCHIVE,
+                          "Adapts the time online ghosts are rendered in the past to how steadily their packets arrive.\n");
+static MAKE_CONVAR(mom_ghost_online_extrapolate, "0.1", FCVAR_REPLICATED | FCVAR_ARCHIVE,
+                   "How long (in seconds) online ghosts keep moving when their packets stop coming in.\n", 0.0f, 0.5f);
 
 static MAKE_TOGGLE_CONVAR(mom_ghost_online_rotations, "0", FCVAR_REPLICATED | FCVAR_ARCHIVE, "Allows wonky rotations of ghosts to be set.\n");
 static MAKE_CONVAR(mom_ghost_online_interp_ticks, "0", FCVAR_REPLICATED | FCVAR_ARCHIVE, "Interpolation ticks to add to rendering online ghosts.\n", 0.0f, 100.0f);
@@ -56,7 +61,7 @@ static MAKE_TOGGLE_CONVAR_C(mom_ghost_online_flashlights_enable, "1", FCVAR_ARCH
 static MAKE_CONVAR(mom_ghost_online_sticky_alpha, "50", FCVAR_ARCHIVE | FCVAR_REPLICATED, "Sets the ghost stickybomb alpha value. 10 = more transparent, 255 = opaque.", 10.0f, 255.0f);
 static MAKE_CONVAR(mom_ghost_online_conc_alpha, "50", FCVAR_ARCHIVE | FCVAR_REPLICATED, "Sets the ghost conc grenade alpha value. 10 = more transparent, 255 = opaque.", 10.0f, 255.0f);
 
-CMomentumOnlineGhostEntity::CMomentumOnlineGhostEntity() : m_pCurrentFrame(nullptr), m_pNextFrame(nullptr), m_cvarPaintSound("mom_paint_apply_sound")
+CMomentumOnlineGhostEntity::CMomentumOnlineGhostEntity() : m_cvarPaintSound("mom_paint_apply_sound")
 {
     ListenForGameEvent("mapfinished_panel_closed");
     m_nGhostButtons = 0;
@@ -66,18 +71,26 @@ CMomentumOnlineGhostEntity::CMomentumOnlineGhostEntity() : m_pCurrentFrame(nullp
 
 CMomentumOnlineGhostEntity::~CMomentumOnlineGhostEntity()
 {
-    m_vecPositionPackets.Purge();
     m_vecDecalPackets.Purge();
 }
 
 void CMomentumOnlineGhostEntity::AddPositionFrame(const PositionPacket &newFrame)
 {
-    m_vecPositionPackets.Insert(new ReceivedFrame_t<PositionPacket>(gpGlobals->curtime, newFrame));
+    // Packets from older clients aren't timestamped, the receive time is the best we have for them
+    const float flSendTime = newFrame.SendTime > 0.0f ? newFrame.SendTime : gpGlobals->curtime;
+    m_PositionBuffer.AddPacket(flSendTime, gpGlobals->curtime, newFrame);
+}
+
+void CMomentumOnlineGhostEntity::AddCompactPositionFrame(CompactPositionPacket &packet)
+{
+    PositionPacket frame;
+    if (m_PositionBaselines.Decode(packet, frame))
+        AddPositionFrame(frame);
 }
 
 void CMomentumOnlineGhostEntity::AddDecalFrame(const DecalPacket &decal)
 {
-    m_vecDecalPackets.Insert(new ReceivedFrame_t<DecalPacket>(gpGlobals->curtime, decal));
+    m_vecDecalPackets.Insert(ReceivedFrame_t<DecalPacket>(gpGlobals->curtime, decal));
 }
 
 void CMomentumOnlineGhostEntity::FireDecal(const DecalPacket &decal)
@@ -285,7 +298,7 @@ void CMomentumOnlineGhostEntity::AppearanceModelColorChanged(const AppearanceDat
 void CMomentumOnlineGhostEntity::Spawn()
 {
     BaseClass::Spawn();
-    SetNextThink(gpGlobals->curtime + mom_ghost_online_lerp.GetFloat());
+    SetNextThink(gpGlobals->curtime);
 }
 
 void CMomentumOnlineGhostEntity::CreateTrail()
@@ -305,72 +318,44 @@ void CMomentumOnlineGhostEntity::Think()
     if (m_pCurrentSpecPlayer)
         HandleGhostFirstPerson();
 
-    // Emulate at the update rate (or slightly slower) for the smoothest interpolation
-    SetNextThink(gpGlobals->curtime + 1.0f / MOM_ONLINE_GHOST_UPDATERATE + (gpGlobals->interval_per_tick * mom_ghost_online_interp_ticks.GetFloat()));
+    // Sample the jitter buffer every tick, it interpolates between the packets
+    SetNextThink(gpGlobals->curtime + gpGlobals->interval_per_tick * (1.0f + mom_ghost_online_interp_ticks.GetFloat()));
 }
 void CMomentumOnlineGhostEntity::HandleGhost()
 {
-    float flCurtime = gpGlobals->curtime - mom_ghost_online_lerp.GetFloat(); // Render in a predetermined past buffer (allow some dropped packets)
-
     if (!m_vecDecalPackets.IsEmpty())
     {
-        // Similar fast-forward code to the positions except we aren't jumping here,
+        // Decals follow the positions' delay, but we aren't jumping here:
         // we want to place these decals ASAP (sound spam incoming) and get them out of the queue.
+        float flCurtime = gpGlobals->curtime - m_PositionBuffer.GetDelay();
         int upperBound = static_cast<int>(ceil(mom_ghost_online_lerp.GetFloat() * MOM_ONLINE_GHOST_UPDATERATE));
         while (m_vecDecalPackets.Count() > upperBound)
         {
-            ReceivedFrame_t<DecalPacket> *fireMeImmedately = m_vecDecalPackets.RemoveAtHead();
-            FireDecal(fireMeImmedately->frame);
-            delete fireMeImmedately;
-        }
-
-        if (m_vecDecalPackets.Head()->recvTime < flCurtime)
-        {
-            ReceivedFrame_t<DecalPacket> *fireMe = m_vecDecalPackets.RemoveAtHead();
-            FireDecal(fireMe->frame);
-            delete fireMe;
+            FireDecal(m_vecDecalPackets.RemoveAtHead().frame);
         }
-    }
 
-    if (!m_vecPositionPackets.IsEmpty())
-    {
-        // The fast-forward logic:
-        // Realistically, we're going to have a buffer of about MOM_GHOST_LERP * update rate. So for 25 updates
-        // in a second, a lerp of 0.1 seconds would make there be about 2.5 packets in the queue at all times.
-        // If there's ever any excess, we need to get rid of it, immediately.
-        int upperBound = static_cast<int>(ceil(mom_ghost_online_lerp.GetFloat() * MOM_ONLINE_GHOST_UPDATERATE));
-        while (m_vecPositionPackets.Count() > upperBound)
+        if (m_vecDecalPackets.Head().recvTime < flCurtime)
         {
-            ReceivedFrame_t<PositionPacket> *pTemp = m_vecPositionPackets.RemoveAtHead();
-            delete pTemp;
-        }
-
-        if (!m_pCurrentFrame)
-        {
-            ReceivedFrame_t<PositionPacket> *pHead = m_vecPositionPackets.Head();
-            if (flCurtime > pHead->recvTime)
-                m_pCurrentFrame = m_vecPositionPackets.RemoveAtHead();
+            FireDecal(m_vecDecalPackets.RemoveAtHead().frame);
         }
     }
 
-    if (m_pCurrentFrame)
+    PositionPacket frame;
+    if (m_PositionBuffer.Sample(gpGlobals->curtime, mom_ghost_online_lerp.GetFloat(), mom_ghost_online_lerp_adaptive.GetBool(),
+                                mom_ghost_online_extrapolate.GetFloat(), frame))
     {
-        SetAbsOrigin(m_pCurrentFrame->frame.Position);
+        SetAbsOrigin(frame.Position);
 
-        m_vecLookAngles = m_pCurrentFrame->frame.EyeAngle;
+        m_vecLookAngles = frame.EyeAngle;
         if (m_pCurrentSpecPlayer || mom_ghost_online_rotations.GetBool())
             SetAbsAngles(m_vecLookAngles);
         else
             SetAbsAngles(QAngle(0, m_vecLookAngles.y, m_vecLookAngles.z));
 
-        SetViewOffset(Vector(0, 0, m_pCurrentFrame->frame.ViewOffset));
-        SetAbsVelocity(m_pCurrentFrame->frame.Velocity);
-
-        m_nGhostButtons = m_pCurrentFrame->frame.Buttons;
+        SetViewOffset(Vector(0, 0, frame.ViewOffset));
+        SetAbsVelocity(frame.Velocity);
 
-        // Get rid of our current frame
-        delete m_pCurrentFrame;
-        m_pCurrentFrame = nullptr;
+        m_nGhostButtons = frame.Buttons;
     }
 }
 
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "mom_ghost_base.h"
+#include "mom_ghost_jitter_buffer.h"
 #include "utlqueue.h"
 #include "GameEventListener.h"
 
@@ -14,8 +15,10 @@ public:
     CMomentumOnlineGhostEntity();
     ~CMomentumOnlineGhostEntity();
 
-    // Adds a position frame to the queue for processing
+    // Adds a position frame to the jitter buffer for processing
     void AddPositionFrame(const PositionPacket &newFrame);
+    // Decodes a compact position packet against this ghost's keyframes and adds it as a position frame
+    void AddCompactPositionFrame(CompactPositionPacket &packet);
     // Adds a decal frame to the queue of processing
     // Note: We have to delay the decal packets to sort of sync up to position, to make spectating more accurate.
     void AddDecalFrame(const DecalPacket &decal);
@@ -68,10 +71,9 @@ private:
 
     void SetIsSpectating(bool bState);
 
-    CUtlQueue<ReceivedFrame_t<PositionPacket>*> m_vecPositionPackets;
-    ReceivedFrame_t<PositionPacket>* m_pCurrentFrame;
-    ReceivedFrame_t<PositionPacket>* m_pNextFrame;
-    CUtlQueue<ReceivedFrame_t<DecalPacket>*> m_vecDecalPackets;
+    CGhostJitterBuffer m_PositionBuffer;
+    CPositionBaselines m_PositionBaselines;
+    CUtlQueue<ReceivedFrame_t<DecalPacket>> m_vecDecalPackets;
 
     ConVarRef m_cvarPaintSound;
 };
@@ -215,7 +215,7 @@ static CMomentumPlayer *s_pPlayer = nullptr;
 CMomentumPlayer::CMomentumPlayer()
     : m_flStamina(0.0f),
       m_flLastVelocity(0.0f), m_nPerfectSyncTicks(0), m_nStrafeTicks(0), m_nAccelTicks(0),
-      m_nPrevButtons(0), m_flTweenVelValue(1.0f), m_bInAirDueToJump(false), m_iProgressNumber(-1), 
+      m_nPrevButtons(0), m_flTweenVelValue(1.0f), m_bInAirDueToJump(false), m_bSimulatingMovement(false), m_iProgressNumber(-1), 
       m_cvarMapFinMoveEnable("mom_mapfinished_movement_enable")
 {
     m_bSurfing = false;
@@ -523,6 +523,21 @@ void CMomentumPlayer::NewPreviousOrigin(Vector origin)
     m_vecPreviousOrigins[0] = origin;
 }
 
+// Same as the previous origins, stored alongside them so the zone sweep knows how the player was moving
+Vector CMomentumPlayer::GetPreviousVelocity(unsigned int previous_count) const
+{
+    return previous_count < MAX_PREVIOUS_ORIGINS ? m_vecPreviousVelocities[previous_count] : vec3_origin;
+}
+
+void CMomentumPlayer::NewPreviousVelocity(const Vector &velocity)
+{
+    for (int i = MAX_PREVIOUS_ORIGINS; i-- > 1;)
+    {
+        m_vecPreviousVelocities[i] = m_vecPreviousVelocities[i - 1];
+    }
+    m_vecPreviousVelocities[0] = velocity;
+}
+
 CBaseEntity *CMomentumPlayer::EntSelectSpawnPoint()
 {
     CBaseEntity *pStart = nullptr;
@@ -556,6 +571,9 @@ void CMomentumPlayer::OnJump()
     m_Data.m_flLastJumpZPos = GetLocalOrigin().z;
     m_iSuccessiveBhops++;
 
+    if (m_bSimulatingMovement)
+        return;
+
     // Set our runstats jump count
     if (g_pMomentumTimer->IsRunning())
     {
@@ -574,7 +592,8 @@ void CMomentumPlayer::OnLand()
 {
     m_iLandTick = gpGlobals->tickcount;
 
-    if (m_Data.m_bIsInZone && m_Data.m_iCurrentZone == 1 && GetMoveType() == MOVETYPE_WALK && !m_bHasPracticeMode)
+    if (m_Data.m_bIsInZone && m_Data.m_iCurrentZone == 1 && GetMoveType() == MOVETYPE_WALK && !m_bHasPracticeMode &&
+        !m_bSimulatingMovement)
     {
         // If we start timer on jump then we should reset on land
         g_pMomentumTimer->Reset(this);
@@ -2125,6 +2144,7 @@ void CMomentumPlayer::PostThink()
 {
     // Update previous origins
     NewPreviousOrigin(GetLocalOrigin());
+    NewPreviousVelocity(GetAbsVelocity());
     BaseClass::PostThink();
 }
 
@@ -2421,3 +2441,33 @@ void CMomentumPlayerCollectibles::LoadFromKeyValues(KeyValues *kv)
         pKvSub = pKvSub->GetNextKey();
     }
 }
+
+void CMomentumPlayerCollectibles::WriteToBuffer(CUtlBuffer &buf) const
+{
+    buf.PutInt(m_iCollectibleCount);
+    buf.PutInt(m_CollectibleList.Count());
+    FOR_EACH_VEC(m_CollectibleList, i)
+    {
+        buf.PutString(m_CollectibleList[i]);
+    }
+}
+
+bool CMomentumPlayerCollectibles::ReadFromBuffer(CUtlBuffer &buf)
+{
+    ClearCollectibles();
+
+    m_iCollectibleCount = buf.GetInt();
+    const int iNames = buf.GetInt();
+    if (!buf.IsValid() || iNames < 0 || iNames > buf.GetBytesRemaining())
+        return false;
+
+    for (int i = 0; i < iNames; i++)
+    {
+        char szName[256];
+        buf.GetString(szName);
+        // Pooled, like the entity names that get added while playing
+        m_CollectibleList.AddToTail(AllocPooledString(szName).ToCStr());
+    }
+
+    return buf.IsValid();
+}
@@ -19,6 +19,8 @@ public:
     void ClearCollectibles();
     void SaveToKeyValues(KeyValues *kv) const;
     void LoadFromKeyValues(KeyValues *kv);
+    void WriteToBuffer(CUtlBuffer &buf) const;
+    bool ReadFromBuffer(CUtlBuffer &buf);
 
     bool HasCollectible(const char *);
 
@@ -203,6 +205,8 @@ class CMomentumPlayer : public CBasePlayer, public CGameEventListener, public CM
     // Used by momentum triggers
     Vector GetPreviousOrigin(unsigned int previous_count = 0) const;
     void NewPreviousOrigin(Vector origin);
+    Vector GetPreviousVelocity(unsigned int previous_count = 0) const;
+    void NewPreviousVelocity(const Vector &velocity);
 
     // for calc avg
     int m_nZoneAvgCount[MAX_ZONES];
@@ -273,6 +277,11 @@ class CMomentumPlayer : public CBasePlayer, public CGameEventListener, public CM
     void SetIsInAirDueToJump(bool val) { m_bInAirDueToJump = val; }
     bool IsInAirDueToJump() const { return m_bInAirDueToJump; }
 
+    // Set while mom_movesim / the replay verifier run movement on this player, so the movement
+    // doesn't fire events, play sounds or touch the timer and run stats
+    void SetSimulatingMovement(bool bSimulating) { m_bSimulatingMovement = bSimulating; }
+    bool IsSimulatingMovement() const { return m_bSimulatingMovement; }
+
     SavedState_t *GetSavedRunState() { return &m_SavedRunState; }
 
     // Ahop stuff
@@ -372,6 +381,7 @@ class CMomentumPlayer : public CBasePlayer, public CGameEventListener, public CM
     CSteamID m_sSpecTargetSteamID;
 
     bool m_bInAirDueToJump;
+    bool m_bSimulatingMovement;
 
     bool m_bWasSpectating; // Was the player spectating and then respawned?
 
@@ -402,6 +412,7 @@ class CMomentumPlayer : public CBasePlayer, public CGameEventListener, public CM
 
     // for detecting bhop
     friend class CMomentumGameMovement;
+    friend class CMomMovementSimulator;
     float m_flPunishTime;
     int m_iLastBlock;
 
@@ -412,6 +423,7 @@ class CMomentumPlayer : public CBasePlayer, public CGameEventListener, public CM
 
     // Used by momentum triggers
     Vector m_vecPreviousOrigins[MAX_PREVIOUS_ORIGINS];
+    Vector m_vecPreviousVelocities[MAX_PREVIOUS_ORIGINS];
 
     float m_flTweenVelValue;
     bool m_bWasInAir;
@@ -29,7 +29,8 @@ BEGIN_DATADESC(CMomentumReplayGhostEntity)
 END_DATADESC();
 
 CMomentumReplayGhostEntity::CMomentumReplayGhostEntity()
-    : m_bIsActive(false), m_bReplayFirstPerson(false), m_pPlaybackReplay(nullptr), m_bHasJumped(false),
+    : m_bIsActive(false), m_bReplayFirstPerson(false), m_bRaceGhost(false), m_pPlaybackReplay(nullptr), m_flPlaybackTick(0.0f),
+      m_iLastThinkTick(-1), m_bHasJumped(false),
       m_flLastSyncVelocity(0), m_nStrafeTicks(0), m_nPerfectSyncTicks(0), m_nAccelTicks(0), m_nOldReplayButtons(0),
       m_vecLastVel(vec3_origin), m_cvarMapFinMoveEnable("mom_mapfinished_movement_enable")
 {
@@ -47,7 +48,8 @@ void CMomentumReplayGhostEntity::Precache(void) { BaseClass::Precache(); }
 
 void CMomentumReplayGhostEntity::FireGameEvent(IGameEvent *pEvent)
 {
-    if (!Q_strcmp(pEvent->GetName(), "mapfinished_panel_closed"))
+    // Race ghosts live until the race is stopped
+    if (!Q_strcmp(pEvent->GetName(), "mapfinished_panel_closed") && !m_bRaceGhost)
     {
         if (pEvent->GetBool("restart"))
         {
@@ -119,13 +121,17 @@ void CMomentumReplayGhostEntity::StartRun(bool firstPerson)
         }
 
         m_iCurrentTick = 0;
+        m_flPlaybackTick = 0.0f;
+        m_iLastThinkTick = -1;
         SetAbsOrigin(m_pPlaybackReplay->GetFrame(m_iCurrentTick)->PlayerOrigin());
 
         m_iTotalTicks = m_pPlaybackReplay->GetFrameCount() - 1;
 
         m_Data.m_iCurrentTrack = m_pPlaybackReplay->GetTrackNumber();
 
-        SetNextThink(gpGlobals->curtime + gpGlobals->interval_per_tick);
+        // Race ghosts don't think, the replay system steps them all at once
+        if (!m_bRaceGhost)
+            SetNextThink(gpGlobals->curtime + gpGlobals->interval_per_tick);
     }
     else
     {
@@ -134,7 +140,21 @@ void CMomentumReplayGhostEntity::StartRun(bool firstPerson)
     }
 }
 
-void CMomentumReplayGhostEntity::UpdateStep(int Skip)
+void CMomentumReplayGhostEntity::StartRaceRun(int iOffsetTick)
+{
+    m_bRaceGhost = true;
+    StartRun(false);
+
+    if (!m_bIsActive)
+        return;
+
+    // Start part way in so every racer leaves its start zone at the same time
+    m_flPlaybackTick = static_cast<float>(clamp<int>(iOffsetTick, 0, m_iTotalTicks));
+    m_iCurrentTick = static_cast<int>(m_flPlaybackTick);
+    m_iLastThinkTick = m_iCurrentTick - 1;
+}
+
+void CMomentumReplayGhostEntity::UpdateStep(float flSkip)
 {
     // Managed by replayui now
     if (!m_pPlaybackReplay)
@@ -143,16 +163,17 @@ void CMomentumReplayGhostEntity::UpdateStep(int Skip)
     if (m_bIsPaused)
     {
         if (mom_replay_selection.GetInt() == 1)
-            m_iCurrentTick -= Skip;
+            m_flPlaybackTick -= flSkip;
         else if (mom_replay_selection.GetInt() == 2)
-            m_iCurrentTick += Skip;
+            m_flPlaybackTick += flSkip;
     }
     else
     {
-        m_iCurrentTick += Skip;
+        m_flPlaybackTick += flSkip;
     }
 
-    m_iCurrentTick = clamp<int>(m_iCurrentTick, 0, m_iTotalTicks);
+    m_flPlaybackTick = clamp<float>(m_flPlaybackTick, 0.0f, static_cast<float>(m_iTotalTicks.Get()));
+    m_iCurrentTick = static_cast<int>(m_flPlaybackTick);
 }
 
 void CMomentumReplayGhostEntity::LoadFromReplayBase(CMomReplayBase *pReplay)
@@ -180,7 +201,30 @@ void CMomentumReplayGhostEntity::Think()
     if (!m_pPlaybackReplay)
         return;
 
-    if (m_iCurrentTick == m_Data.m_iStartTick)
+    float fTimeScale = mom_replay_timescale.GetFloat();
+
+    UpdatePlayback(fTimeScale);
+
+    if (fTimeScale < 1.0f)
+    {
+        SetNextThink(gpGlobals->curtime + gpGlobals->interval_per_tick * (1.0f / fTimeScale));
+    }
+    else
+    {
+        SetNextThink(gpGlobals->curtime + gpGlobals->interval_per_tick);
+    }
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Advances the replay by one server tick. Called from Think, or by the replay system for race ghosts.
+//-----------------------------------------------------------------------------
+void CMomentumReplayGhostEntity::UpdatePlayback(float fTimeScale)
+{
+    // Fast playback can step over the start tick, so check whether we passed it since the last think
+    const bool bReachedStart = m_iCurrentTick >= m_Data.m_iStartTick && m_iLastThinkTick < m_Data.m_iStartTick;
+    m_iLastThinkTick = m_iCurrentTick;
+
+    if (bReachedStart)
     {
         m_Data.m_bIsInZone = false;
         m_Data.m_bMapFinished = false;
@@ -198,8 +242,6 @@ void CMomentumReplayGhostEntity::Think()
         }
     }
 
-    float fTimeScale = mom_replay_timescale.GetFloat();
-
     // move the ghost
     if (m_iCurrentTick < 0 || m_iCurrentTick >= m_iTotalTicks)
     {
@@ -216,113 +258,15 @@ void CMomentumReplayGhostEntity::Think()
     }
     else
     {
-        if (fTimeScale <= 1.0f)
-            UpdateStep(1);
-        else
-        {
-            // MOM_TODO: IMPORTANT! Remember, this is probably not the proper way of speeding up the replay.
-            // Because it skips the steps that normally the engine would have "compensated".
-            // So it can results to unsmooth results, but this is probably the best you can get.
-            // Until we can find something else to modify timescale properly.
-            // We do it this way, because SetNextThink / engine doesn't allow faster updates at this timescale.
-
-            // Calculate our next step
-            int iNextStep = static_cast<int>(fTimeScale) + 1;
-
-            // Calculate the average of ticks that will be used for the next step or the current one
-            float fTicksAverage = (1.0f - (static_cast<float>(iNextStep) - fTimeScale));
-
-            // If it's null, then we just run the current step
-            if (fTicksAverage == 0.0f)
-            {
-                UpdateStep(iNextStep - 1);
-            }
-
-            // Otherwise if it's 1 we must run the next step
-            else if (fTicksAverage == 1.0f)
-            {
-                UpdateStep(iNextStep);
-            }
-
-            // Else, we calculate when we should be on the next step or the current one
-            else
-            {
-
-                // If we should first update on the next step or not
-                bool bShouldNextStepInstead = false;
-
-                // If the next step that must be run is higher than the current steps:
-                // We invert roles between current steps and next steps.
-                if (fTicksAverage > 0.5f)
-                {
-                    fTicksAverage = 0.5f - (fTicksAverage - 0.5f);
-                    bShouldNextStepInstead = true;
-                }
-
-                // Actually we don't need to check for the tickrate, we will let engine compensate it.
-                float fInvTicksAverage = 1.0f / fTicksAverage;
-
-                int iInvTicksAverage = static_cast<int>(fInvTicksAverage + 0.5f);
-
-                // 1) If the ticks elapsed is higher or equal to the ticks calculated we must run the next step or the
-                // current one depending on the average of current steps and next steps.
-                if (m_iTickElapsed >= iInvTicksAverage)
-                {
-                    // BLOCK1
-
-                    // If the average of next steps are higher than current steps, the current step must be called here.
-                    // Otherwise the next step must be called.
-
-                    UpdateStep(bShouldNextStepInstead ? (iNextStep - 1) : iNextStep);
-
-                    // Reset our elapsed ticks, to know when we will perform a new current step or a new next step.
-                    // At tick 1, because we're increasing only elapsed ticks after the condition of 1) and not before.
-                    // If we don't do this, we will be in late of 1 tick.
-
-                    /* --------------------------------------------------------------------------------------------------------------------------
-                    For example if m_flTimeScale = 3,5 -> then iInvTicksAverage is equal to 2 (1/0.5), and that we're
-                    resetting iTickElapsed on 0, it means that we will wait 2 ticks before being on that BLOCK1. And we
-                    don't want that because, we want the 1/2 of time the code running on both blocks and not 1/3 on
-                    BLOCK1 then 2/3 on BLOCK2, when timescale is 3,5. If we wait 2 ticks on BLOCK2 and only 1 on BLOCK1,
-                    logically, it won't correspond to 3,5 of m_flTimeScale. So we're doing like this way: iTickElapsed =
-                    1, or iInvTicksAverage = iInvTicksAverage - 1, to make it correspond perfectly to timescale. I hope
-                    you understood what I've meant. If not then contact that XutaxKamay ***** and tell him to fix his
-                    comments.
-                    ------------------------------------------------------------------------------------------------------------------------------
-                    */
-
-                    m_iTickElapsed = 1;
-                }
-                else
-                {
-
-                    // BLOCK2
-
-                    // If the average of next steps are higher than current steps, the next step must be called here.
-                    // Otherwise the current step must be called.
-
-                    UpdateStep(bShouldNextStepInstead ? (iNextStep) : (iNextStep - 1));
-
-                    // Wait for the ticks elapsing before we change to our current step or our next step.
-                    m_iTickElapsed++;
-                }
-            }
-        }
+        // Faster than realtime can't think more often, so advance the playhead by the timescale every tick
+        // and sample between frames instead of skipping whole ones unevenly
+        UpdateStep(fTimeScale <= 1.0f ? 1.0f : fTimeScale);
 
         if (m_pCurrentSpecPlayer)
             HandleGhostFirstPerson();
         else
             HandleGhost();
     }
-
-    if (fTimeScale < 1.0f)
-    {
-        SetNextThink(gpGlobals->curtime + gpGlobals->interval_per_tick * (1.0f / fTimeScale));
-    }
-    else
-    {
-        SetNextThink(gpGlobals->curtime + gpGlobals->interval_per_tick);
-    }
 }
 
 //-----------------------------------------------------------------------------
@@ -533,6 +477,8 @@ void CMomentumReplayGhostEntity::GoToTick(int tick)
     if (tick >= 0 && tick <= m_iTotalTicks)
     {
         m_iCurrentTick = tick;
+        m_flPlaybackTick = static_cast<float>(tick);
+        m_iLastThinkTick = tick;
         m_Data.m_bMapFinished = false;
 
         // Teleport to the new tick
@@ -566,49 +512,32 @@ void CMomentumReplayGhostEntity::EndRun()
     Remove();
 }
 
+CReplayFrame *CMomentumReplayGhostEntity::GetStepAt(float flTick, CReplayFrame &sample)
+{
+    flTick = clamp<float>(flTick, 0.0f, static_cast<float>(m_pPlaybackReplay->GetFrameCount() - 1));
+
+    const int iTick = static_cast<int>(flTick);
+    if (flTick > static_cast<float>(iTick) && m_pPlaybackReplay->SampleFrame(flTick, sample))
+        return &sample;
+
+    return m_pPlaybackReplay->GetFrame(iTick);
+}
+
 CReplayFrame* CMomentumReplayGhostEntity::GetCurrentStep()
 {
-    return m_pPlaybackReplay->GetFrame(max(min(m_iCurrentTick, m_pPlaybackReplay->GetFrameCount() - 1), 0));
+    return GetStepAt(m_flPlaybackTick, m_CurrentSample);
 }
 
 CReplayFrame *CMomentumReplayGhostEntity::GetNextStep()
 {
-    int nextStep = m_iCurrentTick;
-
-    if (mom_replay_selection.GetInt() == 1 && m_bIsPaused)
-    {
-        --nextStep;
-
-        nextStep = max(nextStep, 0);
-    }
-    else
-    {
-        ++nextStep;
-
-        nextStep = min(nextStep, m_pPlaybackReplay->GetFrameCount() - 1);
-    }
-
-    return m_pPlaybackReplay->GetFrame(nextStep);
+    const bool bBackwards = mom_replay_selection.GetInt() == 1 && m_bIsPaused;
+    return GetStepAt(m_flPlaybackTick + (bBackwards ? -1.0f : 1.0f), m_NextSample);
 }
 
 CReplayFrame *CMomentumReplayGhostEntity::GetPreviousStep()
 {
-    int nextStep = m_iCurrentTick;
-
-    if (mom_replay_selection.GetInt() == 1 && m_bIsPaused)
-    {
-        ++nextStep;
-
-        nextStep = min(nextStep, m_pPlaybackReplay->GetFrameCount() - 1);
-    }
-    else
-    {
-        --nextStep;
-
-        nextStep = max(nextStep, 0);
-    }
-
-    return m_pPlaybackReplay->GetFrame(nextStep);
+    const bool bBackwards = mom_replay_selection.GetInt() == 1 && m_bIsPaused;
+    return GetStepAt(m_flPlaybackTick + (bBackwards ? 1.0f : -1.0f), m_PrevSample);
 }
 
 void CMomentumReplayGhostEntity::OnZoneEnter(CTriggerZone *pTrigger)
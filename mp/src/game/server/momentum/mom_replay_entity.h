@@ -2,10 +2,10 @@
 
 #include "mom_ghost_base.h"
 #include "GameEventListener.h"
+#include "run/mom_replay_data.h"
 
 class CMomRunStats;
 class CMomReplayBase;
-class CReplayFrame;
 
 class CMomentumReplayGhostEntity : public CMomentumGhostBaseEntity, public CGameEventListener
 {
@@ -17,14 +17,22 @@ class CMomentumReplayGhostEntity : public CMomentumGhostBaseEntity, public CGame
     CMomentumReplayGhostEntity();
     ~CMomentumReplayGhostEntity();
 
-    // Increments the steps intelligently.
-    void UpdateStep(int Skip);
+    // Increments the steps intelligently. Fractional skips move the playhead between frames.
+    void UpdateStep(float flSkip);
 
     void LoadFromReplayBase(CMomReplayBase *pReplay);
+    // For when the replay gets deleted before the Remove() from EndRun goes through
+    void UnloadReplay() { m_pPlaybackReplay = nullptr; }
 
     void StartRun(bool firstPerson = false);
+    // Starts as one of the ghosts of a race, at iOffsetTick into the replay
+    void StartRaceRun(int iOffsetTick);
     void EndRun();
 
+    // Advances the replay by one server tick
+    void UpdatePlayback(float fTimeScale);
+    bool IsRaceGhost() const { return m_bRaceGhost; }
+
     void SetGhostAngles(QAngle angles);
     void DetermineGhostVisibility();
 
@@ -63,16 +71,24 @@ class CMomentumReplayGhostEntity : public CMomentumGhostBaseEntity, public CGame
     void CreateTrail() OVERRIDE;
 
   private:
+    // Frame at a (possibly fractional) tick, interpolated into sample when between frames
+    CReplayFrame *GetStepAt(float flTick, CReplayFrame &sample);
+
     CMomReplayBase *m_pPlaybackReplay;
 
+    float m_flPlaybackTick; // Fractional playhead, m_iCurrentTick is its whole part
+    int m_iLastThinkTick;
+    CReplayFrame m_CurrentSample, m_NextSample, m_PrevSample;
+
     bool m_bHasJumped;
     bool m_bIsActive;
     bool m_bReplayFirstPerson;
+    bool m_bRaceGhost;
 
     // for faking strafe sync calculations
     QAngle m_angLastEyeAngle;
     float m_flLastSyncVelocity;
-    int m_nStrafeTicks, m_nPerfectSyncTicks, m_nAccelTicks, m_nOldReplayButtons, m_iTickElapsed;
+    int m_nStrafeTicks, m_nPerfectSyncTicks, m_nAccelTicks, m_nOldReplayButtons;
     Vector m_vecLastVel;
 
     ConVarRef m_cvarMapFinMoveEnable;
@@ -10,6 +10,7 @@
 #include "fmtstr.h"
 #include "steam/steam_api.h"
 #include "run/mom_replay_factory.h"
+#include "run/mom_replay_index.h"
 #include "util/mom_util.h"
 #include "filesystem.h"
 
@@ -28,7 +29,8 @@ CMomentumReplaySystem::CMomentumReplaySystem(const char* pName) : CAutoGameSyste
     m_iStartTimerTick(0),
     m_iStopTimerTick(0),
     m_fRecEndTime(-1.0f),
-    m_bTeleportedThisFrame(false)
+    m_bTeleportedThisFrame(false),
+    m_bRacing(false)
 {
     m_szMapHash[0] = '\0';
 }
@@ -40,12 +42,18 @@ CMomentumReplaySystem::~CMomentumReplaySystem()
 
     if (m_pPlaybackReplay)
         delete m_pPlaybackReplay;
+
+    FOR_EACH_VEC(m_vecRaceGhosts, i)
+        delete m_vecRaceGhosts[i].m_pReplay;
 }
 
 void CMomentumReplaySystem::FrameUpdatePostEntityThink()
 {
     if (m_bRecording)
         UpdateRecordingParams();
+
+    if (m_bRacing)
+        UpdateRaceGhosts();
 }
 
 void CMomentumReplaySystem::LevelInitPostEntity()
@@ -62,6 +70,8 @@ void CMomentumReplaySystem::LevelShutdownPostEntity()
     if (m_pPlaybackReplay)
         UnloadPlayback(true);
 
+    StopRace();
+
     m_szMapHash[0] = '\0';
 }
 
@@ -205,7 +215,11 @@ bool CMomentumReplaySystem::StoreReplay(char *pOut, size_t outSize)
         CFmtStr newRecordingName("%s-%s%s", gpGlobals->mapname.ToCStr(), hash, EXT_RECORDING_FILE);
         V_ComposeFileName(RECORDING_PATH, newRecordingName.Get(), pOut, outSize);
         Log("Storing replay of version '%d' to %s ...\n", m_pRecordingReplay->GetVersion(), pOut);
-        return g_pFullFileSystem->WriteFile(pOut, "MOD", buf);
+        if (!g_pFullFileSystem->WriteFile(pOut, "MOD", buf))
+            return false;
+
+        g_ReplayIndex.AddReplay(m_pRecordingReplay, pOut);
+        return true;
     }
 
     return false;
@@ -219,7 +233,8 @@ void CMomentumReplaySystem::TrimReplay()
     if (m_iStartRecordingTick > 0 && m_iStartTimerTick > 0)
     {
         // MOM_TODO: If the map allows for prespeed in the trigger, we don't want to trim it!
-        const auto newStart = m_iStartTimerTick - static_cast<int>(START_TRIGGER_TIME_SEC / gpGlobals->interval_per_tick);
+        // The player left the zone somewhere in the tick before the timer started, so keep that one frame too
+        const auto newStart = m_iStartTimerTick - static_cast<int>(START_TRIGGER_TIME_SEC / gpGlobals->interval_per_tick) - 1;
 
         if (newStart > m_iStartRecordingTick)
         {
@@ -338,7 +353,10 @@ void CMomentumReplaySystem::UnloadPlayback(bool shutdown)
     if (m_pPlaybackReplay)
     {
         if (m_pPlaybackReplay->GetRunEntity() && !shutdown)
+        {
             m_pPlaybackReplay->GetRunEntity()->EndRun();
+            m_pPlaybackReplay->GetRunEntity()->UnloadReplay();
+        }
 
         delete m_pPlaybackReplay;
     }
@@ -364,26 +382,152 @@ void CMomentumReplaySystem::StopPlayback()
     UnloadPlayback();
 }
 
+bool CMomentumReplaySystem::AddRaceReplay(const char *pFileName, const char *pPathID)
+{
+    if (m_bRacing)
+    {
+        Warning("Can't add ghosts to a race that already started!\n");
+        return false;
+    }
+
+    if (m_vecRaceGhosts.Count() >= MAX_RACE_GHOSTS)
+    {
+        Warning("Races are limited to %i ghosts!\n", MAX_RACE_GHOSTS);
+        return false;
+    }
+
+    const auto pReplay = g_ReplayFactory.LoadReplayFile(pFileName, true, pPathID);
+    if (!pReplay)
+        return false;
+
+    if (Q_stricmp(gpGlobals->mapname.ToCStr(), pReplay->GetMapName()))
+    {
+        Warning("Error: Replay %s is for map %s!\n", pFileName, pReplay->GetMapName());
+        delete pReplay;
+        return false;
+    }
+
+    const auto pGhost = static_cast<CMomentumReplayGhostEntity *>(CreateEntityByName("mom_replay_ghost"));
+    if (!pGhost)
+    {
+        delete pReplay;
+        return false;
+    }
+
+    pGhost->LoadFromReplayBase(pReplay);
+
+    RaceGhost_t ghost;
+    ghost.m_pReplay = pReplay;
+    ghost.m_hGhost = pGhost;
+    m_vecRaceGhosts.AddToTail(ghost);
+    return true;
+}
+
+static int RaceEntrySort(const ReplayIndexEntry_t *const *lhs, const ReplayIndexEntry_t *const *rhs)
+{
+    const float lhsTime = (*lhs)->GetRunTime(), rhsTime = (*rhs)->GetRunTime();
+    return lhsTime < rhsTime ? -1 : (lhsTime > rhsTime ? 1 : 0);
+}
+
+int CMomentumReplaySystem::AddRaceTopReplays(int count)
+{
+    CUtlVector<const ReplayIndexEntry_t *> vecRuns;
+    g_ReplayIndex.GetRunsForMap(gpGlobals->mapname.ToCStr(), vecRuns);
+
+    const int iTrack = g_pMomentumTimer->GetTrackNumber();
+    for (int i = vecRuns.Count() - 1; i >= 0; --i)
+    {
+        const auto pEntry = vecRuns[i];
+        if (pEntry->m_iTrackNumber != iTrack || pEntry->m_iZoneNumber != 0 ||
+            !CloseEnough(pEntry->m_fTickInterval, gpGlobals->interval_per_tick, REPLAY_INDEX_TICK_INTERVAL_TOLERANCE))
+            vecRuns.Remove(i);
+    }
+
+    vecRuns.Sort(RaceEntrySort);
+
+    int added = 0;
+    for (int i = 0; i < vecRuns.Count() && added < count; i++)
+    {
+        if (AddRaceReplay(vecRuns[i]->m_szFilePath))
+            added++;
+    }
+
+    return added;
+}
+
+void CMomentumReplaySystem::StartRace()
+{
+    if (m_bRacing || m_vecRaceGhosts.IsEmpty())
+        return;
+
+    // Line the ghosts up so their timers all start on the same tick
+    uint32 iMinStartTick = m_vecRaceGhosts[0].m_pReplay->GetStartTick();
+    FOR_EACH_VEC(m_vecRaceGhosts, i)
+        iMinStartTick = min(iMinStartTick, m_vecRaceGhosts[i].m_pReplay->GetStartTick());
+
+    FOR_EACH_VEC(m_vecRaceGhosts, i)
+    {
+        const auto pGhost = m_vecRaceGhosts[i].m_hGhost.Get();
+        if (pGhost)
+            pGhost->StartRaceRun(m_vecRaceGhosts[i].m_pReplay->GetStartTick() - iMinStartTick);
+    }
+
+    m_bRacing = true;
+}
+
+void CMomentumReplaySystem::StopRace()
+{
+    FOR_EACH_VEC(m_vecRaceGhosts, i)
+    {
+        const auto pGhost = m_vecRaceGhosts[i].m_hGhost.Get();
+        if (pGhost)
+        {
+            pGhost->EndRun();
+            pGhost->UnloadReplay();
+        }
+
+        delete m_vecRaceGhosts[i].m_pReplay;
+    }
+
+    m_vecRaceGhosts.Purge();
+    m_bRacing = false;
+}
+
+void CMomentumReplaySystem::UpdateRaceGhosts()
+{
+    // One pass over every racer per tick; a streamed replay only decodes when it crosses into a new chunk
+    FOR_EACH_VEC(m_vecRaceGhosts, i)
+    {
+        const auto pGhost = m_vecRaceGhosts[i].m_hGhost.Get();
+        if (pGhost)
+            pGhost->UpdatePlayback(1.0f);
+    }
+}
+
 class CMOMReplayCommands
 {
   public:
+    static void GetRecordingName(const CCommand &args, char *pOut, int outSize)
+    {
+        char filename[MAX_PATH];
+
+        if (Q_strstr(args.ArgS(), EXT_RECORDING_FILE))
+        {
+            Q_snprintf(filename, MAX_PATH, "%s", args.ArgS());
+        }
+        else
+        {
+            Q_snprintf(filename, MAX_PATH, "%s%s", args.ArgS(), EXT_RECORDING_FILE);
+        }
+
+        V_ComposeFileName(RECORDING_PATH, filename, pOut, outSize);
+    }
     static void StartReplay(const CCommand &args, bool firstperson)
     {
         if (args.ArgC() > 0) // we passed any argument at all
         {
-            char filename[MAX_PATH];
-
-            if (Q_strstr(args.ArgS(), EXT_RECORDING_FILE))
-            {
-                Q_snprintf(filename, MAX_PATH, "%s", args.ArgS());
-            }
-            else
-            {
-                Q_snprintf(filename, MAX_PATH, "%s%s", args.ArgS(), EXT_RECORDING_FILE);
-            }
-
             char recordingName[MAX_PATH];
-            V_ComposeFileName(RECORDING_PATH, filename, recordingName, MAX_PATH);
+            GetRecordingName(args, recordingName, MAX_PATH);
 
             auto pLoaded = g_ReplaySystem.LoadPlayback(recordingName);
             if (pLoaded)
@@ -401,6 +545,17 @@ class CMOMReplayCommands
     }
     static void PlayReplayGhost(const CCommand &args) { StartReplay(args, false); }
     static void PlayReplayFirstPerson(const CCommand &args) { StartReplay(args, true); }
+    static void AddRaceReplay(const CCommand &args)
+    {
+        if (args.ArgC() > 1)
+        {
+            char recordingName[MAX_PATH];
+            GetRecordingName(args, recordingName, MAX_PATH);
+
+            if (g_ReplaySystem.AddRaceReplay(recordingName))
+                Msg("Added %s to the race (%i ghosts).\n", recordingName, g_ReplaySystem.GetRaceGhostCount());
+        }
+    }
 };
 
 CON_COMMAND_AUTOCOMPLETEFILE(mom_replay_play_ghost, CMOMReplayCommands::PlayReplayGhost,
@@ -408,6 +563,25 @@ CON_COMMAND_AUTOCOMPLETEFILE(mom_replay_play_ghost, CMOMReplayCommands::PlayRepl
 CON_COMMAND_AUTOCOMPLETEFILE(mom_replay_play, CMOMReplayCommands::PlayReplayFirstPerson,
                              "Begins a playback of a replay in first-person mode.", RECORDING_PATH, EXT_RECORDING_FILE);
 
+CON_COMMAND_AUTOCOMPLETEFILE(mom_replay_race_add, CMOMReplayCommands::AddRaceReplay,
+                             "Adds a replay to the race, started with mom_replay_race_start.", RECORDING_PATH, EXT_RECORDING_FILE);
+
+CON_COMMAND(mom_replay_race_top, "Adds the fastest local runs of this map to the race. Usage: mom_replay_race_top [count = 10]")
+{
+    const int count = clamp(args.ArgC() > 1 ? Q_atoi(args[1]) : 10, 1, MAX_RACE_GHOSTS);
+    Msg("Added %i ghosts to the race.\n", g_ReplaySystem.AddRaceTopReplays(count));
+}
+
+CON_COMMAND(mom_replay_race_start, "Starts racing every ghost added to the race.")
+{
+    g_ReplaySystem.StartRace();
+}
+
+CON_COMMAND(mom_replay_race_stop, "Stops the race and removes its ghosts.")
+{
+    g_ReplaySystem.StopRace();
+}
+
 CON_COMMAND(mom_replay_play_loaded, "Begins playing back a loaded replay (in first person), if there is one.")
 {
     if (g_ReplaySystem.GetPlaybackReplay() && !g_ReplaySystem.IsPlayingBack())
@@ -4,6 +4,8 @@ class CMomentumReplayGhostEntity;
 class CMomentumPlayer;
 class CMomReplayBase;
 
+#define MAX_RACE_GHOSTS 128
+
 class CMomentumReplaySystem : public CAutoGameSystemPerFrame
 {
 public:
@@ -37,6 +39,14 @@ public:
     void StartPlayback(bool firstperson);
     void StopPlayback();
 
+    // Race mode: several replays played back at once as ghosts, all stepped together every tick
+    bool AddRaceReplay(const char *pFileName, const char *pPathID = "MOD");
+    int AddRaceTopReplays(int count); // Adds the fastest local runs of the current map and track
+    void StartRace();
+    void StopRace();
+    bool IsRacing() const { return m_bRacing; }
+    int GetRaceGhostCount() const { return m_vecRaceGhosts.Count(); }
+
     void SetTeleportedThisFrame(); // Call me when player teleports.
     const CMomReplayBase *GetRecordingReplay() const { return m_pRecordingReplay; }
     CMomReplayBase *GetRecordingReplay() { return m_pRecordingReplay; }
@@ -50,6 +60,13 @@ public:
     void UpdateRecordingParams(); // called every game frame after entities think and update
     void SetReplayHeaderAndStats();
     bool StoreReplay(char *pPathOut, size_t outSize);
+    void UpdateRaceGhosts(); // Steps every race ghost, instead of each one scheduling its own think
+
+    struct RaceGhost_t
+    {
+        CMomReplayBase *m_pReplay;
+        CHandle<CMomentumReplayGhostEntity> m_hGhost;
+    };
 
     bool m_bRecording;
     bool m_bPlayingBack;
@@ -65,6 +82,9 @@ public:
     // Map SHA1 hash for version purposes
     char m_szMapHash[41];
     bool m_bTeleportedThisFrame;
+
+    bool m_bRacing;
+    CUtlVector<RaceGhost_t> m_vecRaceGhosts;
 };
 
 extern CMomentumReplaySystem g_ReplaySystem;
@@ -0,0 +1,359 @@
+#include "cbase.h"
+
+#include "mom_replay_verifier.h"
+#include "mom_movement_sim.h"
+#include "mom_player.h"
+#include "mom_timer.h"
+#include "mom_triggers.h"
+#include "mapzones.h"
+#include "mapzones_sweep.h"
+#include "run/mom_replay_base.h"
+#include "run/mom_replay_factory.h"
+#include "run/run_stats.h"
+#include "util/baseautocompletefilelist.h"
+#include "vstdlib/jobthread.h"
+#include "filesystem.h"
+
+#include "tier0/memdbgon.h"
+
+// How many ticks around the timer's start and stop ticks the zones are looked for
+#define REPLAY_VERIFY_ZONE_WINDOW 2
+
+// Replays that can't be simulated or checked against the zones at all
+#define REPLAY_VERIFY_UNUSABLE (REPLAY_VERIFY_LOAD_FAILED | REPLAY_VERIFY_WRONG_MAP | REPLAY_VERIFY_WRONG_TICKRATE | REPLAY_VERIFY_TICKS)
+
+static MAKE_CONVAR(mom_replay_verify_tolerance, "0.1", FCVAR_NONE,
+                   "How far (in units) a re-simulated tick can end up from the recorded origin before it counts as divergent.\n", 0.0f, 1000.0f);
+static MAKE_CONVAR(mom_replay_verify_max_divergent, "0.02", FCVAR_NONE,
+                   "The fraction of a run's ticks that can diverge before the replay fails verification.\n", 0.0f, 1.0f);
+static MAKE_CONVAR(mom_replay_verify_speed_slack, "1.25", FCVAR_NONE,
+                   "How much faster than the run stats' max velocity the recorded origins can move before the replay fails verification.\n", 1.0f, 10.0f);
+
+static const char *const g_szVerifyFlagNames[] =
+{
+    "could not be loaded",
+    "hash does not match the file name",
+    "recorded on another map",
+    "recorded at another tickrate",
+    "start/stop ticks don't match the frames or stats",
+    "moves faster than its stats allow",
+    "doesn't leave the start zone when the timer starts",
+    "doesn't reach the end zone when the timer stops",
+    "input doesn't reproduce the recorded movement",
+};
+
+ReplayVerifyResult_t::ReplayVerifyResult_t()
+{
+    m_szPath[0] = '\0';
+    m_pReplay = nullptr;
+    m_iFlags = REPLAY_VERIFY_OK;
+    m_iTeleports = 0;
+    m_iMaxStepSpeedTick = -1;
+    m_flMaxStepSpeed = 0.0f;
+    m_iSimulatedTicks = 0;
+    m_iDivergentTicks = 0;
+    m_iMaxDivergenceTick = -1;
+    m_flMaxDivergence = 0.0f;
+}
+
+bool CMomReplayVerifier::Verify(CMomentumPlayer *pPlayer, const CUtlStringList &vecPaths, CUtlVector<ReplayVerifyResult_t> &vecResults)
+{
+    if (g_pMomentumTimer->IsRunning())
+        return false;
+
+    vecResults.SetCount(vecPaths.Count());
+    FOR_EACH_VEC(vecPaths, i)
+    {
+        Q_strncpy(vecResults[i].m_szPath, vecPaths[i], sizeof(vecResults[i].m_szPath));
+    }
+
+    // Reading, decompressing and hashing the replays doesn't touch the game, so it's spread over every core
+    ParallelProcess("CMomReplayVerifier::LoadAndCheck", vecResults.Base(), vecResults.Count(), &CMomReplayVerifier::LoadAndCheck);
+
+    // The movement and zones use the entities and engine traces, those have to be done here one at a time
+    FOR_EACH_VEC(vecResults, i)
+    {
+        ReplayVerifyResult_t &result = vecResults[i];
+        if (!(result.m_iFlags & REPLAY_VERIFY_UNUSABLE))
+        {
+            CheckZones(result);
+            Simulate(pPlayer, result);
+        }
+
+        delete result.m_pReplay;
+        result.m_pReplay = nullptr;
+    }
+
+    return true;
+}
+
+void CMomReplayVerifier::LoadAndCheck(ReplayVerifyResult_t &result)
+{
+    CUtlBuffer buf;
+    if (!g_pFullFileSystem->ReadFile(result.m_szPath, "MOD", buf))
+    {
+        result.m_iFlags |= REPLAY_VERIFY_LOAD_FAILED;
+        return;
+    }
+
+    const auto pReplay = g_ReplayFactory.LoadReplayFromBuffer(buf, true);
+    if (!pReplay)
+    {
+        result.m_iFlags |= REPLAY_VERIFY_LOAD_FAILED;
+        return;
+    }
+
+    pReplay->SetFilePath(result.m_szPath);
+    result.m_pReplay = pReplay;
+
+    // Replays are stored as <map>-<hash>.mrf, renamed ones aren't held to it
+    char fileBase[MAX_PATH];
+    V_FileBase(result.m_szPath, fileBase, sizeof(fileBase));
+    const char *pNameHash = Q_strrchr(fileBase, '-');
+    if (pNameHash && Q_strlen(pNameHash + 1) == REPLAY_HASH_LENGTH && Q_stricmp(pNameHash + 1, pReplay->GetRunHash()))
+        result.m_iFlags |= REPLAY_VERIFY_HASH;
+
+    if (Q_stricmp(pReplay->GetMapName(), STRING(gpGlobals->mapname)))
+        result.m_iFlags |= REPLAY_VERIFY_WRONG_MAP;
+
+    const float flInterval = pReplay->GetTickInterval();
+    if (flInterval <= 0.0f || !CloseEnough(flInterval, gpGlobals->interval_per_tick, FLT_EPSILON))
+    {
+        result.m_iFlags |= REPLAY_VERIFY_WRONG_TICKRATE;
+        return;
+    }
+
+    const int iFrames = pReplay->GetFrameCount();
+    const int iStart = pReplay->GetStartTick();
+    const int iStop = pReplay->GetStopTick();
+    const auto pStats = pReplay->GetRunStats();
+    if (iStart >= iStop || iStop >= iFrames || (pStats && static_cast<int>(pStats->GetZoneTicks(0)) != iStop - iStart))
+    {
+        result.m_iFlags |= REPLAY_VERIFY_TICKS;
+        return;
+    }
+
+    // Frames are streamed, so only one is held at a time
+    Vector vecPrevOrigin = pReplay->GetFrame(0)->PlayerOrigin();
+    for (int i = 1; i < iFrames; i++)
+    {
+        const CReplayFrame *pFrame = pReplay->GetFrame(i);
+        const Vector vecOrigin = pFrame->PlayerOrigin();
+
+        if (pFrame->Teleported())
+        {
+            result.m_iTeleports++;
+        }
+        else if (i > iStart && i <= iStop)
+        {
+            const float flSpeed = vecOrigin.DistTo(vecPrevOrigin) / flInterval;
+            if (flSpeed > result.m_flMaxStepSpeed)
+            {
+                result.m_flMaxStepSpeed = flSpeed;
+                result.m_iMaxStepSpeedTick = i;
+            }
+        }
+
+        vecPrevOrigin = vecOrigin;
+    }
+
+    if (pStats)
+    {
+        const float flStatsMaxSpeed = pStats->GetZoneVelocityMax(0, false);
+        if (flStatsMaxSpeed > 0.0f && result.m_flMaxStepSpeed > flStatsMaxSpeed * mom_replay_verify_speed_slack.GetFloat())
+            result.m_iFlags |= REPLAY_VERIFY_SPEED;
+    }
+}
+
+bool CMomReplayVerifier::StepsCrossZone(CMomReplayBase *pReplay, int iTick, int iQueryFlags, bool bLeaving)
+{
+    const int iTrack = pReplay->GetTrackNumber();
+    const float flInterval = pReplay->GetTickInterval();
+    const int iFirst = max(1, iTick - REPLAY_VERIFY_ZONE_WINDOW);
+    const int iLast = min(pReplay->GetFrameCount() - 1, iTick + REPLAY_VERIFY_ZONE_WINDOW);
+
+    CUtlVector<ZoneSweepResult_t> vecHits;
+    for (int i = iFirst; i <= iLast; i++)
+    {
+        const Vector vecStart = pReplay->GetFrame(i - 1)->PlayerOrigin();
+        const CReplayFrame *pFrame = pReplay->GetFrame(i);
+        if (pFrame->Teleported())
+            continue;
+
+        // Only the origins are known, so the step is taken as a straight line
+        const Vector vecEnd = pFrame->PlayerOrigin();
+        const Vector vecVelocity = (vecEnd - vecStart) / flInterval;
+        const CZoneSweep sweep(vecStart, vecVelocity, vecEnd, vecVelocity, flInterval, VEC_HULL_MIN, VEC_HULL_MAX);
+
+        vecHits.RemoveAll();
+        sweep.SolveZones(iQueryFlags, vecHits);
+
+        FOR_EACH_VEC(vecHits, j)
+        {
+            const ZoneSweepResult_t &hit = vecHits[j];
+            const int iZoneTrack = static_cast<CBaseMomentumTrigger *>(hit.m_pZone)->GetTrackNumber();
+            if (iZoneTrack != iTrack && iZoneTrack != -1)
+                continue;
+
+            if (bLeaving ? !hit.m_bEndedInside : (hit.m_bEndedInside || !hit.m_bStartedInside))
+                return true;
+        }
+    }
+
+    return false;
+}
+
+void CMomReplayVerifier::CheckZones(ReplayVerifyResult_t &result)
+{
+    // Nothing to hold the run to without zones
+    CUtlVector<CBaseEntity *> vecZones;
+    g_MapZoneSystem.GetZoneBVH()->FindTriggersInBox(Vector(MIN_COORD_FLOAT, MIN_COORD_FLOAT, MIN_COORD_FLOAT),
+                                                    Vector(MAX_COORD_FLOAT, MAX_COORD_FLOAT, MAX_COORD_FLOAT),
+                                                    ZONE_QUERY_START | ZONE_QUERY_STOP, vecZones);
+    if (vecZones.IsEmpty())
+        return;
+
+    CMomReplayBase *pReplay = result.m_pReplay;
+
+    if (!StepsCrossZone(pReplay, pReplay->GetStartTick(), ZONE_QUERY_START, true))
+        result.m_iFlags |= REPLAY_VERIFY_START_ZONE;
+
+    if (!StepsCrossZone(pReplay, pReplay->GetStopTick(), ZONE_QUERY_STOP, false))
+        result.m_iFlags |= REPLAY_VERIFY_END_ZONE;
+}
+
+void CMomReplayVerifier::Simulate(CMomentumPlayer *pPlayer, ReplayVerifyResult_t &result)
+{
+    const float flTolerance = mom_replay_verify_tolerance.GetFloat();
+
+    // Resynced, so one bad tick is one divergent tick instead of throwing off the rest of the run
+    CMomMovementSimulator simulator;
+    MovementSimResult_t sim;
+    if (!simulator.Simulate(pPlayer, result.m_pReplay, true, flTolerance, sim))
+        return;
+
+    // Tick i of the simulation is frame i + 1, only the timed part of the run counts
+    const int iStart = result.m_pReplay->GetStartTick();
+    const int iStop = result.m_pReplay->GetStopTick();
+    for (int i = 0; i < sim.m_iTicks; i++)
+    {
+        const int iFrame = i + 1;
+        if (iFrame <= iStart || iFrame > iStop)
+            continue;
+
+        const float flDivergence = sim.m_vecDivergence[i];
+        result.m_iSimulatedTicks++;
+
+        if (flDivergence > flTolerance)
+            result.m_iDivergentTicks++;
+
+        if (flDivergence > result.m_flMaxDivergence)
+        {
+            result.m_flMaxDivergence = flDivergence;
+            result.m_iMaxDivergenceTick = iFrame;
+        }
+    }
+
+    if (result.m_iDivergentTicks > result.m_iSimulatedTicks * mom_replay_verify_max_divergent.GetFloat())
+        result.m_iFlags |= REPLAY_VERIFY_DIVERGED;
+}
+
+void CMomReplayVerifier::PrintResult(const ReplayVerifyResult_t &result)
+{
+    if (result.m_iFlags == REPLAY_VERIFY_OK)
+    {
+        Msg("PASS %s (%i ticks, %i divergent, max divergence %.4f at tick %i)\n", result.m_szPath, result.m_iSimulatedTicks,
+            result.m_iDivergentTicks, result.m_flMaxDivergence, result.m_iMaxDivergenceTick);
+        return;
+    }
+
+    Warning("FAIL %s\n", result.m_szPath);
+    for (int i = 0; i < static_cast<int>(ARRAYSIZE(g_szVerifyFlagNames)); i++)
+    {
+        if (result.m_iFlags & (1 << i))
+            Warning("    %s\n", g_szVerifyFlagNames[i]);
+    }
+
+    if (result.m_iFlags & REPLAY_VERIFY_SPEED)
+        Warning("    moved at %.1f u/s at tick %i\n", result.m_flMaxStepSpeed, result.m_iMaxStepSpeedTick);
+
+    if (result.m_iFlags & REPLAY_VERIFY_DIVERGED)
+        Warning("    %i of %i ticks diverged, by up to %.4f units at tick %i\n", result.m_iDivergentTicks, result.m_iSimulatedTicks,
+                result.m_flMaxDivergence, result.m_iMaxDivergenceTick);
+}
+
+static void VerifyReplaysCommand(const CCommand &args)
+{
+    const auto pPlayer = CMomentumPlayer::GetLocalPlayer();
+    if (!pPlayer)
+        return;
+
+    if (g_pMomentumTimer->IsRunning() || pPlayer->GetObserverMode() != OBS_MODE_NONE)
+    {
+        Warning("Stop the timer and stop spectating before verifying replays!\n");
+        return;
+    }
+
+    CUtlStringList vecPaths;
+    char replayPath[MAX_PATH];
+
+    if (args.ArgC() > 1)
+    {
+        for (int i = 1; i < args.ArgC(); i++)
+        {
+            char fileName[MAX_PATH];
+            Q_strncpy(fileName, args.Arg(i), sizeof(fileName));
+            V_DefaultExtension(fileName, EXT_RECORDING_FILE, sizeof(fileName));
+            V_ComposeFileName(RECORDING_PATH, fileName, replayPath, sizeof(replayPath));
+            vecPaths.CopyAndAddToTail(replayPath);
+        }
+    }
+    else
+    {
+        char search[MAX_PATH];
+        Q_snprintf(search, sizeof(search), "%s/%s-*%s", RECORDING_PATH, STRING(gpGlobals->mapname), EXT_RECORDING_FILE);
+        Q_FixSlashes(search);
+
+        FileFindHandle_t found;
+        const char *pFoundFile = g_pFullFileSystem->FindFirstEx(search, "MOD", &found);
+        while (pFoundFile)
+        {
+            V_ComposeFileName(RECORDING_PATH, pFoundFile, replayPath, sizeof(replayPath));
+            vecPaths.CopyAndAddToTail(replayPath);
+            pFoundFile = g_pFullFileSystem->FindNext(found);
+        }
+        g_pFullFileSystem->FindClose(found);
+    }
+
+    if (vecPaths.IsEmpty())
+    {
+        Msg("No replays to verify.\n");
+        return;
+    }
+
+    const double flStartTime = Plat_FloatTime();
+
+    CMomReplayVerifier verifier;
+    CUtlVector<ReplayVerifyResult_t> vecResults;
+    if (!verifier.Verify(pPlayer, vecPaths, vecResults))
+    {
+        Warning("Stop the timer before verifying replays!\n");
+        return;
+    }
+
+    int iPassed = 0;
+    FOR_EACH_VEC(vecResults, i)
+    {
+        CMomReplayVerifier::PrintResult(vecResults[i]);
+        if (vecResults[i].m_iFlags == REPLAY_VERIFY_OK)
+            iPassed++;
+    }
+
+    Msg("%i of %i replays passed verification (%.2f s)\n", iPassed, vecResults.Count(), Plat_FloatTime() - flStartTime);
+}
+
+DECLARE_AUTOCOMPLETION_FUNCTION(mom_replay_verify, RECORDING_PATH, EXT_RECORDING_FILE)
+static ConCommand mom_replay_verify_command("mom_replay_verify", VerifyReplaysCommand,
+                                            "Verifies replays by re-simulating their input on the current map.\n"
+                                            "Usage: mom_replay_verify [replay ...], verifies every replay of the map if none are given.\n",
+                                            FCVAR_CHEAT, AUTOCOMPLETION_FUNCTION(mom_replay_verify));
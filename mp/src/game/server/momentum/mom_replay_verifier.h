@@ -0,0 +1,62 @@
+#pragma once
+
+class CMomReplayBase;
+class CMomentumPlayer;
+
+// Why a replay failed verification, a replay can fail for more than one
+enum ReplayVerifyFlags_t
+{
+    REPLAY_VERIFY_OK = 0,
+    REPLAY_VERIFY_LOAD_FAILED = 1 << 0,
+    REPLAY_VERIFY_HASH = 1 << 1, // The file's contents don't hash to the name it was saved under
+    REPLAY_VERIFY_WRONG_MAP = 1 << 2,
+    REPLAY_VERIFY_WRONG_TICKRATE = 1 << 3,
+    REPLAY_VERIFY_TICKS = 1 << 4, // Start/stop ticks outside the frames, or not matching the run stats
+    REPLAY_VERIFY_SPEED = 1 << 5, // Moved faster between two frames than the run stats say the player ever went
+    REPLAY_VERIFY_START_ZONE = 1 << 6, // Didn't leave the track's start zone when the timer started
+    REPLAY_VERIFY_END_ZONE = 1 << 7, // Didn't reach the track's end zone when the timer stopped
+    REPLAY_VERIFY_DIVERGED = 1 << 8, // Too many ticks where the recorded input doesn't lead to the recorded origin
+};
+
+struct ReplayVerifyResult_t
+{
+    ReplayVerifyResult_t();
+
+    char m_szPath[MAX_PATH];
+    CMomReplayBase *m_pReplay;
+    int m_iFlags;
+
+    // Static checks, done while loading
+    int m_iTeleports;
+    int m_iMaxStepSpeedTick;
+    float m_flMaxStepSpeed; // Fastest speed between two recorded frames of the run
+
+    // Re-simulation, only done when the static checks pass
+    int m_iSimulatedTicks;
+    int m_iDivergentTicks;
+    int m_iMaxDivergenceTick;
+    float m_flMaxDivergence;
+};
+
+// Checks recorded runs of the current map without playing them back. Every replay is loaded, hashed
+// and checked against its own header and stats on the thread pool, then the ones that pass have their
+// input re-simulated through the player movement and their path checked against the map's zones.
+class CMomReplayVerifier
+{
+public:
+    // Verifies every given replay file, the results end up in the same order as the paths.
+    // Returns false without verifying anything while the timer is running, the simulation moves the player.
+    bool Verify(CMomentumPlayer *pPlayer, const CUtlStringList &vecPaths, CUtlVector<ReplayVerifyResult_t> &vecResults);
+
+    static void PrintResult(const ReplayVerifyResult_t &result);
+
+private:
+    // Thread pool side, mustn't touch entities or the engine
+    static void LoadAndCheck(ReplayVerifyResult_t &result);
+
+    void CheckZones(ReplayVerifyResult_t &result);
+    void Simulate(CMomentumPlayer *pPlayer, ReplayVerifyResult_t &result);
+
+    // Whether any step of the replay around the tick crosses the boundary of one of the track's zones
+    bool StepsCrossZone(CMomReplayBase *pReplay, int iTick, int iQueryFlags, bool bLeaving);
+};
@@ -0,0 +1,430 @@
+#include "cbase.h"
+
+#include "mom_saveloc_store.h"
+#include "mom_system_saveloc.h"
+
+#include "tier0/memdbgon.h"
+
+COMPILE_TIME_ASSERT(SAVELOC_STORE_SLOT_SIZE == SAVELOC_RECORD_SIZE + 8);
+
+CSavelocStore::CSavelocStore() : m_hFile(FILESYSTEM_INVALID_HANDLE), m_bInSync(false), m_iCurrentIndex(-1),
+                                 m_iCapacity(0), m_uDataEnd(0), m_uGarbage(0)
+{
+    m_szPath[0] = '\0';
+    Q_memset(m_StartMarkSlots, 0, sizeof(m_StartMarkSlots));
+}
+
+CSavelocStore::~CSavelocStore()
+{
+    Close();
+}
+
+void CSavelocStore::GetFilePath(const char *pMapName, char *pOut, int outSize)
+{
+    Q_snprintf(pOut, outSize, "%s/%s%s", SAVELOC_PATH, pMapName, EXT_SAVELOC_FILE);
+}
+
+bool CSavelocStore::Open(const char *pMapName, CUtlVector<SavedLocation_t *> &vecSavelocs, CUtlVector<SavedLocation_t *> &vecStartMarks, int &iCurrentIndex)
+{
+    Close();
+
+    GetFilePath(pMapName, m_szPath, sizeof(m_szPath));
+
+    CUtlBuffer buf;
+    if (!filesystem->ReadFile(m_szPath, "MOD", buf))
+        return false;
+
+    bool bDroppedStartMarks = false;
+    if (!Read(buf, vecSavelocs, vecStartMarks, iCurrentIndex, bDroppedStartMarks))
+    {
+        Warning("Saveloc file %s is outdated or corrupt, it will be rewritten.\n", m_szPath);
+        return false;
+    }
+
+    // Dropped start marks are still in the file, it's rewritten without them on the next write
+    m_hFile = filesystem->Open(m_szPath, "r+b", "MOD");
+    m_bInSync = m_hFile != FILESYSTEM_INVALID_HANDLE && !bDroppedStartMarks;
+    return true;
+}
+
+void CSavelocStore::Close()
+{
+    if (m_hFile != FILESYSTEM_INVALID_HANDLE)
+    {
+        filesystem->Close(m_hFile);
+        m_hFile = FILESYSTEM_INVALID_HANDLE;
+    }
+
+    m_szPath[0] = '\0';
+    m_bInSync = false;
+    m_iCurrentIndex = -1;
+    m_iCapacity = 0;
+    m_uDataEnd = 0;
+    m_uGarbage = 0;
+    m_vecSlots.RemoveAll();
+    Q_memset(m_StartMarkSlots, 0, sizeof(m_StartMarkSlots));
+}
+
+bool CSavelocStore::Read(CUtlBuffer &buf, CUtlVector<SavedLocation_t *> &vecSavelocs, CUtlVector<SavedLocation_t *> &vecStartMarks, int &iCurrentIndex,
+                         bool &bDroppedStartMarks)
+{
+    if (buf.GetUnsignedInt() != SAVELOC_STORE_MAGIC || buf.GetUnsignedChar() != SAVELOC_STORE_VERSION)
+        return false;
+
+    buf.SeekGet(CUtlBuffer::SEEK_HEAD, 8);
+    const int iCurrent = buf.GetInt();
+    const int iCount = buf.GetInt();
+    const int iCapacity = buf.GetInt();
+    const uint32 uDataEnd = buf.GetUnsignedInt();
+    const uint32 uGarbage = buf.GetUnsignedInt();
+
+    if (!buf.IsValid() || iCount < 0 || iCapacity < iCount)
+        return false;
+
+    // The counts are checked against the file's size before anything is allocated for them
+    const uint32 uFileSize = buf.TellMaxPut();
+    if (uFileSize < GetSlotOffset(0) || (uint32)iCapacity > (uFileSize - GetSlotOffset(0)) / SAVELOC_STORE_SLOT_SIZE)
+        return false;
+
+    const uint32 uDataStart = GetSlotOffset(iCapacity);
+    if (uDataEnd < uDataStart || uDataEnd > uFileSize)
+        return false;
+
+    // Everything's read into temporaries first so a bad file doesn't leave half of it loaded
+    CUtlVector<SavedLocation_t *> vecRead;
+    SavedLocation_t *pStartMarks[MAX_TRACKS] = {};
+    Slot_t startMarkSlots[MAX_TRACKS];
+    CUtlVector<Slot_t> vecSlots;
+    vecSlots.EnsureCount(iCount);
+
+    bool bValid = true;
+    for (int i = 0; i < MAX_TRACKS && bValid; i++)
+    {
+        buf.SeekGet(CUtlBuffer::SEEK_HEAD, GetStartMarkOffset(i));
+        pStartMarks[i] = new SavedLocation_t;
+        bValid = ReadSlot(buf, pStartMarks[i], startMarkSlots[i], uDataStart, uDataEnd);
+    }
+
+    for (int i = 0; i < iCount && bValid; i++)
+    {
+        buf.SeekGet(CUtlBuffer::SEEK_HEAD, GetSlotOffset(i));
+        vecRead.AddToTail(new SavedLocation_t);
+        bValid = ReadSlot(buf, vecRead.Tail(), vecSlots[i], uDataStart, uDataEnd);
+    }
+
+    if (!bValid)
+    {
+        vecRead.PurgeAndDeleteElements();
+        for (int i = 0; i < MAX_TRACKS; i++)
+            delete pStartMarks[i];
+
+        return false;
+    }
+
+    bDroppedStartMarks = false;
+    for (int i = 0; i < MAX_TRACKS; i++)
+    {
+        // Empty slots are written with no components, and start marks are only ever a position and angles
+        const int components = pStartMarks[i]->m_savedComponents;
+        if (components != (SAVELOC_POS | SAVELOC_ANG))
+        {
+            bDroppedStartMarks |= components != 0;
+            delete pStartMarks[i];
+            pStartMarks[i] = nullptr;
+        }
+
+        delete vecStartMarks[i];
+        vecStartMarks[i] = pStartMarks[i];
+    }
+
+    vecSavelocs.AddVectorToTail(vecRead);
+    iCurrentIndex = iCurrent;
+
+    m_iCurrentIndex = iCurrent;
+    m_iCapacity = iCapacity;
+    m_uDataEnd = uDataEnd;
+    m_uGarbage = uGarbage;
+    m_vecSlots.Swap(vecSlots);
+    Q_memcpy(m_StartMarkSlots, startMarkSlots, sizeof(m_StartMarkSlots));
+
+    return true;
+}
+
+bool CSavelocStore::ReadSlot(CUtlBuffer &buf, SavedLocation_t *pSaveloc, Slot_t &slot, uint32 uDataStart, uint32 uDataEnd)
+{
+    if (!pSaveloc->ReadRecord(buf))
+        return false;
+
+    slot.m_uDataOffset = buf.GetUnsignedInt();
+    slot.m_uDataSize = buf.GetUnsignedInt();
+    if (!buf.IsValid())
+        return false;
+
+    if (!pSaveloc->m_savedComponents)
+        return true;
+
+    // Written as the difference so a huge size can't wrap around
+    if (slot.m_uDataOffset < uDataStart || slot.m_uDataOffset > uDataEnd || slot.m_uDataSize > uDataEnd - slot.m_uDataOffset)
+        return false;
+
+    buf.SeekGet(CUtlBuffer::SEEK_HEAD, slot.m_uDataOffset);
+    return pSaveloc->ReadExtras(buf);
+}
+
+void CSavelocStore::WriteSlot(CUtlBuffer &buf, const SavedLocation_t *pSaveloc, const Slot_t &slot)
+{
+    if (pSaveloc)
+    {
+        pSaveloc->WriteRecord(buf);
+    }
+    else
+    {
+        for (int i = 0; i < SAVELOC_RECORD_SIZE; i++)
+            buf.PutUnsignedChar(0);
+    }
+
+    buf.PutUnsignedInt(slot.m_uDataOffset);
+    buf.PutUnsignedInt(slot.m_uDataSize);
+}
+
+void CSavelocStore::WriteHeader(CUtlBuffer &buf) const
+{
+    const int iStart = buf.TellPut();
+
+    buf.PutUnsignedInt(SAVELOC_STORE_MAGIC);
+    buf.PutUnsignedChar(SAVELOC_STORE_VERSION);
+    while (buf.TellPut() - iStart < 8)
+        buf.PutUnsignedChar(0);
+
+    buf.PutInt(m_iCurrentIndex);
+    buf.PutInt(m_vecSlots.Count());
+    buf.PutInt(m_iCapacity);
+    buf.PutUnsignedInt(m_uDataEnd);
+    buf.PutUnsignedInt(m_uGarbage);
+
+    while (buf.TellPut() - iStart < SAVELOC_STORE_HEADER_SIZE)
+        buf.PutUnsignedChar(0);
+}
+
+bool CSavelocStore::WriteAt(uint32 offset, const CUtlBuffer &buf)
+{
+    if (m_hFile == FILESYSTEM_INVALID_HANDLE)
+        return false;
+
+    filesystem->Seek(m_hFile, offset, FILESYSTEM_SEEK_HEAD);
+    return filesystem->Write(buf.Base(), buf.TellPut(), m_hFile) == buf.TellPut();
+}
+
+bool CSavelocStore::WriteHeaderToFile()
+{
+    CUtlBuffer buf;
+    WriteHeader(buf);
+    if (!WriteAt(0, buf))
+        return false;
+
+    filesystem->Flush(m_hFile);
+    return true;
+}
+
+bool CSavelocStore::Fail()
+{
+    m_bInSync = false;
+    return false;
+}
+
+uint32 CSavelocStore::GetLiveDataSize() const
+{
+    uint32 uSize = 0;
+    FOR_EACH_VEC(m_vecSlots, i)
+        uSize += m_vecSlots[i].m_uDataSize;
+    for (int i = 0; i < MAX_TRACKS; i++)
+        uSize += m_StartMarkSlots[i].m_uDataSize;
+
+    return uSize;
+}
+
+bool CSavelocStore::Append(const SavedLocation_t *pSaveloc, int iCurrentIndex)
+{
+    if (!m_bInSync || m_vecSlots.Count() >= m_iCapacity)
+        return Fail();
+
+    CUtlBuffer extras;
+    pSaveloc->WriteExtras(extras);
+
+    Slot_t slot;
+    slot.m_uDataOffset = m_uDataEnd;
+    slot.m_uDataSize = extras.TellPut();
+
+    CUtlBuffer record;
+    WriteSlot(record, pSaveloc, slot);
+
+    if (!WriteAt(slot.m_uDataOffset, extras) || !WriteAt(GetSlotOffset(m_vecSlots.Count()), record))
+        return Fail();
+
+    m_vecSlots.AddToTail(slot);
+    m_uDataEnd += slot.m_uDataSize;
+    m_iCurrentIndex = iCurrentIndex;
+
+    return WriteHeaderToFile() || Fail();
+}
+
+bool CSavelocStore::RemoveAt(int index, int iCurrentIndex)
+{
+    if (!m_bInSync || !m_vecSlots.IsValidIndex(index))
+        return Fail();
+
+    m_uGarbage += m_vecSlots[index].m_uDataSize;
+    m_vecSlots.Remove(index);
+    m_iCurrentIndex = iCurrentIndex;
+
+    // Once most of the data section is dead, rewrite the file instead
+    if (m_uGarbage > SAVELOC_STORE_MIN_GARBAGE && m_uGarbage > GetLiveDataSize())
+        return Fail();
+
+    // The slots after it are read before the header drops the last one from the count
+    const int iMoved = m_vecSlots.Count() - index;
+    CUtlBuffer moved;
+    if (iMoved > 0)
+    {
+        moved.EnsureCapacity(iMoved * SAVELOC_STORE_SLOT_SIZE);
+        filesystem->Seek(m_hFile, GetSlotOffset(index + 1), FILESYSTEM_SEEK_HEAD);
+        const int iRead = filesystem->Read(moved.Base(), iMoved * SAVELOC_STORE_SLOT_SIZE, m_hFile);
+        if (iRead != iMoved * SAVELOC_STORE_SLOT_SIZE)
+            return Fail();
+
+        moved.SeekPut(CUtlBuffer::SEEK_HEAD, iRead);
+    }
+
+    // Then shifted down by one, the extras stay where they are
+    if (!WriteHeaderToFile() || (iMoved > 0 && !WriteAt(GetSlotOffset(index), moved)))
+        return Fail();
+
+    filesystem->Flush(m_hFile);
+    return true;
+}
+
+bool CSavelocStore::SetStartMark(int track, const SavedLocation_t *pStartMark)
+{
+    if (!m_bInSync || track < 0 || track >= MAX_TRACKS)
+        return Fail();
+
+    Slot_t &slot = m_StartMarkSlots[track];
+    m_uGarbage += slot.m_uDataSize;
+    slot.m_uDataOffset = 0;
+    slot.m_uDataSize = 0;
+
+    if (pStartMark)
+    {
+        CUtlBuffer extras;
+        pStartMark->WriteExtras(extras);
+        slot.m_uDataOffset = m_uDataEnd;
+        slot.m_uDataSize = extras.TellPut();
+
+        if (!WriteAt(slot.m_uDataOffset, extras))
+            return Fail();
+
+        m_uDataEnd += slot.m_uDataSize;
+    }
+
+    CUtlBuffer record;
+    WriteSlot(record, pStartMark, slot);
+    if (!WriteAt(GetStartMarkOffset(track), record))
+        return Fail();
+
+    return WriteHeaderToFile() || Fail();
+}
+
+bool CSavelocStore::SetCurrentIndex(int iCurrentIndex)
+{
+    if (!m_bInSync)
+        return Fail();
+
+    if (iCurrentIndex == m_iCurrentIndex)
+        return true;
+
+    m_iCurrentIndex = iCurrentIndex;
+    return WriteHeaderToFile() || Fail();
+}
+
+bool CSavelocStore::WriteAll(const CUtlVector<SavedLocation_t *> &vecSavelocs, const CUtlVector<SavedLocation_t *> &vecStartMarks, int iCurrentIndex)
+{
+    if (!IsOpen())
+        return false;
+
+    // Maps that have never had a saveloc or start mark don't get a file until they do
+    if (m_hFile == FILESYSTEM_INVALID_HANDLE && vecSavelocs.IsEmpty() && !filesystem->FileExists(m_szPath, "MOD"))
+    {
+        bool bHasStartMark = false;
+        for (int i = 0; i < MAX_TRACKS && !bHasStartMark; i++)
+            bHasStartMark = vecStartMarks[i] != nullptr;
+
+        if (!bHasStartMark)
+            return Fail();
+    }
+
+    m_iCurrentIndex = iCurrentIndex;
+    m_iCapacity = max(SAVELOC_STORE_MIN_CAPACITY, vecSavelocs.Count() * 2);
+    m_uGarbage = 0;
+    m_uDataEnd = GetSlotOffset(m_iCapacity);
+    m_vecSlots.SetCount(vecSavelocs.Count());
+
+    CUtlBuffer data;
+    CUtlBuffer slots;
+    slots.EnsureCapacity(m_uDataEnd - SAVELOC_STORE_HEADER_SIZE);
+
+    for (int i = 0; i < MAX_TRACKS; i++)
+    {
+        Slot_t &slot = m_StartMarkSlots[i];
+        slot.m_uDataOffset = slot.m_uDataSize = 0;
+
+        const auto pStartMark = vecStartMarks[i];
+        if (pStartMark)
+        {
+            slot.m_uDataOffset = m_uDataEnd + data.TellPut();
+            pStartMark->WriteExtras(data);
+            slot.m_uDataSize = m_uDataEnd + data.TellPut() - slot.m_uDataOffset;
+        }
+
+        WriteSlot(slots, pStartMark, slot);
+    }
+
+    FOR_EACH_VEC(vecSavelocs, i)
+    {
+        Slot_t &slot = m_vecSlots[i];
+        slot.m_uDataOffset = m_uDataEnd + data.TellPut();
+        vecSavelocs[i]->WriteExtras(data);
+        slot.m_uDataSize = m_uDataEnd + data.TellPut() - slot.m_uDataOffset;
+
+        WriteSlot(slots, vecSavelocs[i], slot);
+    }
+
+    // The free slots
+    while ((uint32)(SAVELOC_STORE_HEADER_SIZE + slots.TellPut()) < m_uDataEnd)
+        slots.PutUnsignedChar(0);
+
+    m_uDataEnd += data.TellPut();
+
+    CUtlBuffer file;
+    file.EnsureCapacity(m_uDataEnd);
+    WriteHeader(file);
+    file.Put(slots.Base(), slots.TellPut());
+    file.Put(data.Base(), data.TellPut());
+
+    // Reopened after, as the handle can't truncate the file
+    if (m_hFile != FILESYSTEM_INVALID_HANDLE)
+    {
+        filesystem->Close(m_hFile);
+        m_hFile = FILESYSTEM_INVALID_HANDLE;
+    }
+
+    filesystem->CreateDirHierarchy(SAVELOC_PATH, "MOD");
+    if (!filesystem->WriteFile(m_szPath, "MOD", file))
+    {
+        Warning("Failed to write savelocs to %s!\n", m_szPath);
+        return Fail();
+    }
+
+    m_hFile = filesystem->Open(m_szPath, "r+b", "MOD");
+    m_bInSync = m_hFile != FILESYSTEM_INVALID_HANDLE;
+    return m_bInSync;
+}
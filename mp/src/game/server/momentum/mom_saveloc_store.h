@@ -0,0 +1,86 @@
+#pragma once
+
+#include "filesystem.h"
+#include "mom_shareddefs.h"
+
+struct SavedLocation_t;
+
+#define SAVELOC_STORE_MAGIC 0x534C534D // "MSLS"
+#define SAVELOC_STORE_VERSION 1
+#define SAVELOC_STORE_HEADER_SIZE 32
+#define SAVELOC_STORE_SLOT_SIZE 80 // SAVELOC_RECORD_SIZE, then where its extras are in the data section
+#define SAVELOC_STORE_MIN_CAPACITY 64
+#define SAVELOC_STORE_MIN_GARBAGE (64 * 1024) // Dead extras below this are never worth compacting
+
+// One map's savelocs and start marks in a binary file (savelocs/<map>.msl), laid out as:
+//   header | MAX_TRACKS start mark slots | capacity saveloc slots | data section
+// Every slot is a fixed-size record, so adding, removing or changing one saveloc only writes
+// that part of the file. The variable-size extras are appended to the data section; the space
+// of removed ones is left as garbage until the next full rewrite compacts it.
+// Writes go data -> slots -> header, the header's count only covers what has been written.
+// Removals are the exception: the header's lowered count goes first, then the slots are shifted
+// down, so an interrupted one can leave the removed saveloc in place of the last one, but never
+// the same saveloc twice.
+class CSavelocStore
+{
+public:
+    CSavelocStore();
+    ~CSavelocStore();
+
+    // Reads the map's file into the vectors (vecStartMarks must have MAX_TRACKS elements) and keeps
+    // it open for writing. A missing or unreadable file leaves the store out of sync, and the file is
+    // only created once the map has a saveloc or start mark to write.
+    bool Open(const char *pMapName, CUtlVector<SavedLocation_t *> &vecSavelocs, CUtlVector<SavedLocation_t *> &vecStartMarks, int &iCurrentIndex);
+    void Close();
+    bool IsOpen() const { return m_szPath[0] != '\0'; }
+
+    // Out of sync means the file no longer matches what's in memory, and only WriteAll can fix it
+    bool IsInSync() const { return m_bInSync; }
+    void MarkOutOfSync() { m_bInSync = false; }
+
+    // The incremental writes return false when they couldn't be done in place
+    // (no room for another slot, too much garbage, I/O error) and the file needs a WriteAll
+    bool Append(const SavedLocation_t *pSaveloc, int iCurrentIndex);
+    bool RemoveAt(int index, int iCurrentIndex);
+    bool SetStartMark(int track, const SavedLocation_t *pStartMark);
+    bool SetCurrentIndex(int iCurrentIndex);
+
+    // Rewrites the whole file, compacting the data section
+    bool WriteAll(const CUtlVector<SavedLocation_t *> &vecSavelocs, const CUtlVector<SavedLocation_t *> &vecStartMarks, int iCurrentIndex);
+
+    static void GetFilePath(const char *pMapName, char *pOut, int outSize);
+
+private:
+    struct Slot_t
+    {
+        uint32 m_uDataOffset;
+        uint32 m_uDataSize;
+    };
+
+    bool Read(CUtlBuffer &buf, CUtlVector<SavedLocation_t *> &vecSavelocs, CUtlVector<SavedLocation_t *> &vecStartMarks, int &iCurrentIndex,
+              bool &bDroppedStartMarks);
+    // The slot's extras have to be within [uDataStart, uDataEnd)
+    static bool ReadSlot(CUtlBuffer &buf, SavedLocation_t *pSaveloc, Slot_t &slot, uint32 uDataStart, uint32 uDataEnd);
+    static void WriteSlot(CUtlBuffer &buf, const SavedLocation_t *pSaveloc, const Slot_t &slot);
+    void WriteHeader(CUtlBuffer &buf) const;
+
+    bool WriteAt(uint32 offset, const CUtlBuffer &buf);
+    bool WriteHeaderToFile();
+    bool Fail(); // Marks the store out of sync, returning false
+
+    uint32 GetStartMarkOffset(int track) const { return SAVELOC_STORE_HEADER_SIZE + track * SAVELOC_STORE_SLOT_SIZE; }
+    uint32 GetSlotOffset(int index) const { return GetStartMarkOffset(MAX_TRACKS) + index * SAVELOC_STORE_SLOT_SIZE; }
+    uint32 GetLiveDataSize() const;
+
+    char m_szPath[MAX_PATH];
+    FileHandle_t m_hFile;
+    bool m_bInSync;
+
+    // Mirror of the file's header and slots
+    int m_iCurrentIndex;
+    int m_iCapacity;
+    uint32 m_uDataEnd;
+    uint32 m_uGarbage;
+    CUtlVector<Slot_t> m_vecSlots;
+    Slot_t m_StartMarkSlots[MAX_TRACKS];
+};
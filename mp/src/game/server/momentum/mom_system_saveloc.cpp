@@ -13,7 +13,8 @@
 
 #include "tier0/memdbgon.h"
 
-#define SAVELOC_FILE_NAME "savedlocs.txt"
+#define SAVELOC_FILE_NAME "savedlocs.txt" // Before savelocs had a file per map
+#define SAVELOC_FILE_NAME_IMPORTED "savedlocs.txt.imported"
 #define SAVELOC_KV_KEY_SAVELOCS "cps"
 #define SAVELOC_KV_KEY_CURRENTINDEX "cur"
 #define SAVELOC_KV_KEY_STARTMARKS "startmarks"
@@ -231,27 +232,193 @@ void SavedLocation_t::Teleport(CMomentumPlayer* pPlayer, bool bStopTimer /*= tru
 
 bool SavedLocation_t::Read(CUtlBuffer &mem)
 {
-    KeyValuesAD read("From Someone");
-    if (read->ReadAsBinary(mem))
+    m_savedComponents = mem.GetInt();
+
+    if ( m_savedComponents & SAVELOC_TARGETNAME )
+        mem.GetString(m_szTargetName);
+
+    if ( m_savedComponents & SAVELOC_CLASSNAME )
+        mem.GetString(m_szTargetClassName);
+
+    if ( m_savedComponents & SAVELOC_POS )
     {
-        Load(read);
-        return true;
+        for (int i = 0; i < 3; i++)
+            m_vecPos[i] = mem.GetFloat();
     }
 
-    return false;
+    if ( m_savedComponents & SAVELOC_VEL )
+    {
+        for (int i = 0; i < 3; i++)
+            m_vecVel[i] = mem.GetFloat();
+    }
+
+    if ( m_savedComponents & SAVELOC_ANG )
+    {
+        for (int i = 0; i < 3; i++)
+            m_qaAng[i] = mem.GetFloat();
+    }
+
+    if ( m_savedComponents & SAVELOC_DUCKED )
+        m_bCrouched = mem.GetUnsignedChar() != 0;
+
+    if ( m_savedComponents & SAVELOC_GRAVITY )
+        m_fGravityScale = mem.GetFloat();
+
+    if ( m_savedComponents & SAVELOC_MOVEMENTLAG )
+        m_fMovementLagScale = mem.GetFloat();
+
+    if ( m_savedComponents & SAVELOC_DISABLED_BTNS )
+        m_iDisabledButtons = mem.GetInt();
+
+    if ( m_savedComponents & SAVELOC_TRACK )
+        m_iTrack = mem.GetInt();
+
+    if ( m_savedComponents & SAVELOC_ZONE )
+        m_iZone = mem.GetInt();
+
+    if ( m_savedComponents & SAVELOC_TOGGLED_BTNS )
+        m_iToggledButtons = mem.GetInt();
+
+    if ( m_savedComponents & SAVELOC_EVENT_QUEUE && !entEventsState.ReadFromBuffer(mem) )
+        return false;
+
+    if ( m_savedComponents & SAVELOC_TIME )
+        m_iTimerTickOffset = mem.GetInt();
+
+    if ( m_savedComponents & SAVELOC_COLLECTIBLES && !m_Collectibles->ReadFromBuffer(mem) )
+        return false;
+
+    return mem.IsValid() && m_vecPos.IsValid() && m_vecVel.IsValid() && m_qaAng.IsValid();
 }
 
-bool SavedLocation_t::Write(CUtlBuffer &mem)
+void SavedLocation_t::Write(CUtlBuffer &mem) const
 {
-    KeyValuesAD write("To Someone");
-    Save(write);
-    return write->WriteAsBinary(mem);
+    mem.PutInt(m_savedComponents);
+
+    if ( m_savedComponents & SAVELOC_TARGETNAME )
+        mem.PutString(m_szTargetName);
+
+    if ( m_savedComponents & SAVELOC_CLASSNAME )
+        mem.PutString(m_szTargetClassName);
+
+    if ( m_savedComponents & SAVELOC_POS )
+    {
+        for (int i = 0; i < 3; i++)
+            mem.PutFloat(m_vecPos[i]);
+    }
+
+    if ( m_savedComponents & SAVELOC_VEL )
+    {
+        for (int i = 0; i < 3; i++)
+            mem.PutFloat(m_vecVel[i]);
+    }
+
+    if ( m_savedComponents & SAVELOC_ANG )
+    {
+        for (int i = 0; i < 3; i++)
+            mem.PutFloat(m_qaAng[i]);
+    }
+
+    if ( m_savedComponents & SAVELOC_DUCKED )
+        mem.PutUnsignedChar(m_bCrouched);
+
+    if ( m_savedComponents & SAVELOC_GRAVITY )
+        mem.PutFloat(m_fGravityScale);
+
+    if ( m_savedComponents & SAVELOC_MOVEMENTLAG )
+        mem.PutFloat(m_fMovementLagScale);
+
+    if ( m_savedComponents & SAVELOC_DISABLED_BTNS )
+        mem.PutInt(m_iDisabledButtons);
+
+    if ( m_savedComponents & SAVELOC_TRACK )
+        mem.PutInt(m_iTrack);
+
+    if ( m_savedComponents & SAVELOC_ZONE )
+        mem.PutInt(m_iZone);
+
+    if ( m_savedComponents & SAVELOC_TOGGLED_BTNS )
+        mem.PutInt(m_iToggledButtons);
+
+    if ( m_savedComponents & SAVELOC_EVENT_QUEUE )
+        entEventsState.WriteToBuffer(mem);
+
+    if ( m_savedComponents & SAVELOC_TIME )
+        mem.PutInt(m_iTimerTickOffset);
+
+    if ( m_savedComponents & SAVELOC_COLLECTIBLES )
+        m_Collectibles->WriteToBuffer(mem);
+}
+
+void SavedLocation_t::WriteRecord(CUtlBuffer &buf) const
+{
+    const int iStart = buf.TellPut();
+
+    buf.PutInt(m_savedComponents);
+    for (int i = 0; i < 3; i++)
+        buf.PutFloat(m_vecPos[i]);
+    for (int i = 0; i < 3; i++)
+        buf.PutFloat(m_vecVel[i]);
+    for (int i = 0; i < 3; i++)
+        buf.PutFloat(m_qaAng[i]);
+    buf.PutFloat(m_fGravityScale);
+    buf.PutFloat(m_fMovementLagScale);
+    buf.PutInt(m_iDisabledButtons);
+    buf.PutInt(m_iToggledButtons);
+    buf.PutInt(m_iTrack);
+    buf.PutInt(m_iZone);
+    buf.PutInt(m_iTimerTickOffset);
+    buf.PutUnsignedChar(m_bCrouched);
+
+    while (buf.TellPut() - iStart < SAVELOC_RECORD_SIZE)
+        buf.PutUnsignedChar(0);
+}
+
+bool SavedLocation_t::ReadRecord(CUtlBuffer &buf)
+{
+    const int iStart = buf.TellGet();
+
+    m_savedComponents = buf.GetInt();
+    for (int i = 0; i < 3; i++)
+        m_vecPos[i] = buf.GetFloat();
+    for (int i = 0; i < 3; i++)
+        m_vecVel[i] = buf.GetFloat();
+    for (int i = 0; i < 3; i++)
+        m_qaAng[i] = buf.GetFloat();
+    m_fGravityScale = buf.GetFloat();
+    m_fMovementLagScale = buf.GetFloat();
+    m_iDisabledButtons = buf.GetInt();
+    m_iToggledButtons = buf.GetInt();
+    m_iTrack = buf.GetInt();
+    m_iZone = buf.GetInt();
+    m_iTimerTickOffset = buf.GetInt();
+    m_bCrouched = buf.GetUnsignedChar() != 0;
+
+    buf.SeekGet(CUtlBuffer::SEEK_HEAD, iStart + SAVELOC_RECORD_SIZE);
+    return buf.IsValid();
+}
+
+void SavedLocation_t::WriteExtras(CUtlBuffer &buf) const
+{
+    buf.PutString(m_szTargetName);
+    buf.PutString(m_szTargetClassName);
+    entEventsState.WriteToBuffer(buf);
+    m_Collectibles->WriteToBuffer(buf);
+}
+
+bool SavedLocation_t::ReadExtras(CUtlBuffer &buf)
+{
+    buf.GetString(m_szTargetName);
+    buf.GetString(m_szTargetClassName);
+    return entEventsState.ReadFromBuffer(buf) && m_Collectibles->ReadFromBuffer(buf);
 }
 
 CSaveLocSystem::CSaveLocSystem(const char* pName): CAutoGameSystem(pName)
 {
-    m_pSavedLocsKV = new KeyValues(pName);
+    m_pChunkPacket = new SavelocReqPacket;
     m_iRequesting = 0;
+    m_iRequestedCount = 0;
+    m_iReceivedCount = 0;
     m_iCurrentSavelocIndx = -1;
     m_bUsingSavelocMenu = false;
     m_bHintedStartMarkForLevel = false;
@@ -269,8 +436,9 @@ CSaveLocSystem::CSaveLocSystem(const char* pName): CAutoGameSystem(pName)
 
 CSaveLocSystem::~CSaveLocSystem()
 {
-    m_pSavedLocsKV->deleteThis();
-    m_pSavedLocsKV = nullptr;
+    m_vecTransfers.PurgeAndDeleteElements();
+    delete m_pChunkPacket;
+    m_pChunkPacket = nullptr;
 }
 
 void CSaveLocSystem::PostInit()
@@ -283,66 +451,31 @@ void CSaveLocSystem::LevelInitPreEntity()
     m_bHintedStartMarkForLevel = false;
     ClearAllStartMarks(START_MARK);
 
-    // Note: We are not only loading in PostInit because if players edit their savelocs file (add
-    // savelocs from a friend or something), then we want to reload on map load again,
-    // and not force the player to restart the mod every time.
-    if (!LoadSavelocsIntoKV())
-        return;
+    ImportLegacySavelocs();
 
-    KeyValues *kvMapSavelocs = m_pSavedLocsKV->FindKey(gpGlobals->mapname.ToCStr());
-    if (!kvMapSavelocs || kvMapSavelocs->IsEmpty())
-        return;
-
-    m_iCurrentSavelocIndx = kvMapSavelocs->GetInt(SAVELOC_KV_KEY_CURRENTINDEX);
-    AddSavelocsFromKV(kvMapSavelocs->FindKey(SAVELOC_KV_KEY_SAVELOCS));
-
-    if (LoadStartMarks())
-        DevLog("Loaded startmarks from the savedlocs KV!\n");
-    else
-        DevWarning("Failed loading startmarks from the savedlocs file.\n");
-}
-
-bool CSaveLocSystem::LoadStartMarks()
-{
-    if (!m_pSavedLocsKV || m_pSavedLocsKV->IsEmpty())
-        return false;
-
-    KeyValues *kvMapSavelocs = m_pSavedLocsKV->FindKey(gpGlobals->mapname.ToCStr());
-    if (!kvMapSavelocs || kvMapSavelocs->IsEmpty())
-        return false;
-
-    KeyValues *kvStartMarks = kvMapSavelocs->FindKey(SAVELOC_KV_KEY_STARTMARKS);
-    if (!kvStartMarks)
-        return false;
-
-    FOR_EACH_SUBKEY(kvStartMarks, kvStartMark)
+    // We don't check mom_saveloc_save_between_sessions because we want to be able to load savelocs from friends
+    if (m_SavelocStore.Open(gpGlobals->mapname.ToCStr(), m_rcSavelocs, m_vecStartMarks, m_iCurrentSavelocIndx))
     {
-        int track = Q_atoi(kvStartMark->GetName());
+        DevLog("Loaded %i savelocs for %s!\n", m_rcSavelocs.Count(), gpGlobals->mapname.ToCStr());
 
-        const auto pStartmark = new SavedLocation_t;
-        pStartmark->Load(kvStartMark);
-
-        if (!pStartmark || track < 0 || track >= MAX_TRACKS || pStartmark->m_savedComponents != (SAVELOC_POS | SAVELOC_ANG))
-        {
-            delete pStartmark;
-            return false;
-        }
-
-        m_vecStartMarks[track] = pStartmark;
+        UpdateRequesters();
+        FireUpdateEvent();
     }
-
-    return true;
 }
 
 void CSaveLocSystem::LevelShutdownPreEntity()
 {
-    if (mom_saveloc_save_between_sessions.GetBool())
+    if (mom_saveloc_save_between_sessions.GetBool() && m_SavelocStore.IsOpen())
     {
-        SaveSavelocsToKV();
+        if (!m_SavelocStore.IsInSync() || !m_SavelocStore.SetCurrentIndex(m_iCurrentSavelocIndx))
+            WriteAllToStore();
     }
 
+    m_SavelocStore.Close();
+
     // Remove all requesters if we had any
     m_vecRequesters.RemoveAll();
+    m_vecTransfers.PurgeAndDeleteElements();
     m_bUsingSavelocMenu = false;
     RemoveAllSavelocs();
 }
@@ -354,6 +487,14 @@ void CSaveLocSystem::OnSavelocRequestEvent(KeyValues* pKv)
     if (stage == SAVELOC_REQ_STAGE_COUNT_REQ)
     {
         // They clicked "request savelocs" from a player, UI just opened, get the count to send back
+        if (!g_pMomentumGhostClient->CanPeerTransferSavelocs(target))
+        {
+            KeyValues *pOutdated = new KeyValues("req_savelocs");
+            pOutdated->SetInt("stage", SAVELOC_REQ_STAGE_OUTDATED);
+            g_pModuleComms->FireEvent(pOutdated);
+            return;
+        }
+
         SavelocReqPacket packet;
         packet.stage = SAVELOC_REQ_STAGE_COUNT_REQ;
         if (g_pMomentumGhostClient->SendSavelocReqPacket(target, &packet))
@@ -369,7 +510,11 @@ void CSaveLocSystem::OnSavelocRequestEvent(KeyValues* pKv)
         packet.stage = SAVELOC_REQ_STAGE_SAVELOC_REQ;
         packet.saveloc_count = pKv->GetInt("count");
         packet.dataBuf.CopyBuffer(pKv->GetPtr("nums"), sizeof(int) * packet.saveloc_count);
-        g_pMomentumGhostClient->SendSavelocReqPacket(target, &packet);
+        if (g_pMomentumGhostClient->SendSavelocReqPacket(target, &packet))
+        {
+            m_iRequestedCount = packet.saveloc_count;
+            m_iReceivedCount = 0;
+        }
     }
     else if (stage == SAVELOC_REQ_STAGE_CLICKED_CANCEL)
     {
@@ -406,6 +551,13 @@ void CSaveLocSystem::RequesterLeft(const uint64& requester)
 
     // If they were a requester to us (as well), remove them
     m_vecRequesters.FindAndFastRemove(requester);
+
+    const auto iTransfer = FindTransfer(requester);
+    if (iTransfer != m_vecTransfers.InvalidIndex())
+    {
+        delete m_vecTransfers[iTransfer];
+        m_vecTransfers.FastRemove(iTransfer);
+    }
 }
 
 void CSaveLocSystem::SetRequestingSavelocsFrom(const uint64& from)
@@ -419,32 +571,107 @@ void CSaveLocSystem::SetRequestingSavelocsFrom(const uint64& from)
     m_iRequesting = from;
 }
 
-bool CSaveLocSystem::WriteRequestedSavelocs(SavelocReqPacket *input, SavelocReqPacket *output, const uint64 &requester)
+int CSaveLocSystem::FindTransfer(const uint64 &requester) const
 {
-    if (!m_vecRequesters.HasElement(requester))
+    FOR_EACH_VEC(m_vecTransfers, i)
+    {
+        if (m_vecTransfers[i]->m_iRequester == requester)
+            return i;
+    }
+
+    return m_vecTransfers.InvalidIndex();
+}
+
+bool CSaveLocSystem::WriteRequestedSavelocs(SavelocReqPacket *input, const uint64 &requester)
+{
+    if (!m_vecRequesters.HasElement(requester) || input->saveloc_count <= 0)
         return false;
 
-    int count = 0;
+    // Chunks and acks of the running transfer are still on their way, starting over would send savelocs twice
+    if (FindTransfer(requester) != m_vecTransfers.InvalidIndex())
+    {
+        DevWarning("Already sending savelocs to %llu, ignoring their new request!\n", requester);
+        return false;
+    }
+
+    const auto pTransfer = new SavelocTransfer_t;
+    pTransfer->m_iRequester = requester;
+    pTransfer->m_iNext = 0;
+    pTransfer->m_iChunksInFlight = 0;
+    m_vecTransfers.AddToTail(pTransfer);
+
     for (int i = 0; i < input->saveloc_count && input->dataBuf.IsValid(); i++)
     {
         const auto requestedIndex = input->dataBuf.GetInt();
+        if (input->dataBuf.IsValid())
+            pTransfer->m_vecIndexes.AddToTail(requestedIndex);
+    }
 
-        const auto savedLoc = GetSaveloc(requestedIndex);
-        if (savedLoc)
-        {
-            if (!savedLoc->Write(output->dataBuf))
-                return false;
+    return SendSavelocChunks(pTransfer);
+}
+
+void CSaveLocSystem::OnSavelocChunkAcked(const uint64 &requester)
+{
+    const auto iTransfer = FindTransfer(requester);
+    if (iTransfer == m_vecTransfers.InvalidIndex())
+        return;
 
-            count++;
+    const auto pTransfer = m_vecTransfers[iTransfer];
+    if (pTransfer->m_iChunksInFlight > 0)
+        pTransfer->m_iChunksInFlight--;
+
+    SendSavelocChunks(pTransfer);
+}
+
+void CSaveLocSystem::AbortTransfer(SavelocTransfer_t *pTransfer)
+{
+    Warning("Failed to send savelocs to %llu, stopping the transfer.\n", pTransfer->m_iRequester);
+
+    // Worth a try, so they aren't left waiting on the rest
+    CSteamID target(pTransfer->m_iRequester);
+    SavelocReqPacket packet;
+    packet.stage = SAVELOC_REQ_STAGE_DONE;
+    g_pMomentumGhostClient->SendSavelocReqPacket(target, &packet);
+
+    m_vecTransfers.FindAndFastRemove(pTransfer);
+    delete pTransfer;
+}
+
+bool CSaveLocSystem::SendSavelocChunks(SavelocTransfer_t *pTransfer)
+{
+    const auto iTotal = pTransfer->m_vecIndexes.Count();
+    CSteamID target(pTransfer->m_iRequester);
+
+    // Keep a few chunks on the way instead of waiting for each one to be acknowledged before sending the next
+    while (pTransfer->m_iChunksInFlight < SAVELOC_REQ_CHUNK_WINDOW && pTransfer->m_iNext < iTotal)
+    {
+        m_pChunkPacket->stage = SAVELOC_REQ_STAGE_SAVELOC_ACK;
+        m_pChunkPacket->dataBuf.Clear();
+
+        // The count can be lower than asked for, if we deleted some savelocs while the request was on its way.
+        // The last chunk is still sent even if it turns out empty, so they know it's over.
+        int count = 0;
+        while (pTransfer->m_iNext < iTotal && m_pChunkPacket->dataBuf.TellPut() < SAVELOC_REQ_CHUNK_SIZE)
+        {
+            const auto savedLoc = GetSaveloc(pTransfer->m_vecIndexes[pTransfer->m_iNext++]);
+            if (savedLoc)
+            {
+                savedLoc->Write(m_pChunkPacket->dataBuf);
+                count++;
+            }
         }
-    }
 
-    if (count == 0)
-        return false;
+        m_pChunkPacket->saveloc_count = count;
+        m_pChunkPacket->saveloc_remaining = iTotal - pTransfer->m_iNext;
+
+        if (!g_pMomentumGhostClient->SendSavelocReqPacket(target, m_pChunkPacket))
+        {
+            AbortTransfer(pTransfer);
+            return false;
+        }
 
-    // We set the count here because we may have a different number of savelocs than requested
-    // (eg. when we delete some savelocs while the packet to request the original amount/indices is still live)
-    output->saveloc_count = count;
+        pTransfer->m_iChunksInFlight++;
+    }
 
     return true;
 }
@@ -454,29 +681,73 @@ bool CSaveLocSystem::ReadReceivedSavelocs(SavelocReqPacket *input, const uint64
     if (sender != m_iRequesting)
         return false;
 
-    if (input->saveloc_count > 0)
+    bool bFailed = false;
+    const int iFirstNew = m_rcSavelocs.Count();
+    for (int i = 0; i < input->saveloc_count; i++)
     {
-        for (int i = 0; i < input->saveloc_count && input->dataBuf.IsValid(); i++)
+        auto newSavedLoc = new SavedLocation_t;
+        if (!input->dataBuf.IsValid() || !newSavedLoc->Read(input->dataBuf))
         {
-            auto newSavedLoc = new SavedLocation_t;
-            if (newSavedLoc->Read(input->dataBuf))
-            {
-                m_rcSavelocs.AddToTail(newSavedLoc);
-            }
-            else
-            {
-                delete newSavedLoc;
-                return false;
-            }
+            delete newSavedLoc;
+            bFailed = true;
+            break;
         }
 
+        m_rcSavelocs.AddToTail(newSavedLoc);
+    }
+
+    if (m_rcSavelocs.Count() > iFirstNew)
+    {
+        m_iReceivedCount += m_rcSavelocs.Count() - iFirstNew;
+
+        AppendToStore(iFirstNew);
         FireUpdateEvent();
         UpdateRequesters();
+    }
+
+    CSteamID target(sender);
+    SavelocReqPacket response;
+    if (!bFailed && input->saveloc_remaining > 0)
+    {
+        response.stage = SAVELOC_REQ_STAGE_CHUNK_ACK;
+        response.saveloc_count = m_iReceivedCount;
+        if (g_pMomentumGhostClient->SendSavelocReqPacket(target, &response))
+        {
+            KeyValues *pKv = new KeyValues("req_savelocs");
+            pKv->SetInt("stage", SAVELOC_REQ_STAGE_PROGRESS);
+            pKv->SetInt("received", m_iReceivedCount);
+            pKv->SetInt("total", m_iRequestedCount);
+            g_pModuleComms->FireEvent(pKv);
+            return true;
+        }
+
+        // Without the ack they won't send the rest
+        bFailed = true;
+    }
+
+    if (bFailed)
+    {
+        // Keep what did make it, and tell them to stop sending the rest
+        Warning("Failed to receive the savelocs from %llu, stopping the transfer.\n", sender);
+        m_iRequesting = 0;
 
-        return true;
+        response.stage = SAVELOC_REQ_STAGE_DONE;
+        g_pMomentumGhostClient->SendSavelocReqPacket(target, &response);
+
+        KeyValues *pKv = new KeyValues("req_savelocs");
+        pKv->SetInt("stage", SAVELOC_REQ_STAGE_FAILED);
+        g_pModuleComms->FireEvent(pKv);
+        return false;
     }
 
-    return false;
+    response.stage = SAVELOC_REQ_STAGE_DONE;
+    if (!g_pMomentumGhostClient->SendSavelocReqPacket(target, &response))
+        return false;
+
+    KeyValues *pKv = new KeyValues("req_savelocs");
+    pKv->SetInt("stage", SAVELOC_REQ_STAGE_DONE);
+    g_pModuleComms->FireEvent(pKv);
+    return true;
 }
 
 SavedLocation_t* CSaveLocSystem::CreateSaveloc(int components /*= SAVELOC_ALL*/)
@@ -518,6 +789,7 @@ void CSaveLocSystem::AddSaveloc(SavedLocation_t* saveloc)
     else
         m_iCurrentSavelocIndx = priorCount; // Set it to the new checkpoint's index
 
+    AppendToStore(priorCount);
     FireUpdateEvent();
 }
 
@@ -527,12 +799,16 @@ void CSaveLocSystem::RemoveCurrentSaveloc()
         return;
 
     auto prevCount = m_rcSavelocs.Count();
+    const auto iRemoved = m_iCurrentSavelocIndx;
     m_rcSavelocs.PurgeAndDeleteElement(m_iCurrentSavelocIndx);
     // If there's one element left, we still need to decrease currentStep to -1
     if (m_iCurrentSavelocIndx == prevCount - 1)
         --m_iCurrentSavelocIndx;
     // else we want it to shift forward one until it catches back up to the last checkpoint
 
+    if (ShouldWriteIncrementally() && !m_SavelocStore.RemoveAt(iRemoved, m_iCurrentSavelocIndx))
+        WriteAllToStore();
+
     FireUpdateEvent();
     UpdateRequesters();
 }
@@ -542,6 +818,9 @@ void CSaveLocSystem::RemoveAllSavelocs()
     m_rcSavelocs.PurgeAndDeleteElements();
     m_iCurrentSavelocIndx = -1;
 
+    if (ShouldWriteIncrementally())
+        WriteAllToStore();
+
     FireUpdateEvent();
     UpdateRequesters();
 }
@@ -663,6 +942,10 @@ bool CSaveLocSystem::CreateStartMark()
 
     ClearStartMark(type, iMarkIndex, false);
     *pSaveLocAtIndex = pSaveloc;
+
+    // Stage marks are wiped every run, only start marks are kept between sessions
+    if (type == START_MARK && ShouldWriteIncrementally() && !m_SavelocStore.SetStartMark(iMarkIndex, pSaveloc))
+        WriteAllToStore();
     ClientPrint(pPlayer, HUD_PRINTTALK, type == START_MARK ? "Start Mark Created!" : "Stage Start Mark Created!");
 
     return true;
@@ -681,6 +964,9 @@ void CSaveLocSystem::ClearStartMark(StartMarkType_t eMarktype, int iMarkIndex, b
 
         delete m_vecStartMarks[iMarkIndex];
         m_vecStartMarks[iMarkIndex] = nullptr;
+
+        if (ShouldWriteIncrementally() && !m_SavelocStore.SetStartMark(iMarkIndex, nullptr))
+            WriteAllToStore();
     }
     else
     {
@@ -799,97 +1085,109 @@ void CSaveLocSystem::UpdateRequesters()
     }
 }
 
-bool CSaveLocSystem::LoadSavelocsIntoKV()
+bool CSaveLocSystem::ShouldWriteIncrementally()
 {
-    // We don't check mom_savelocs_save_between_sessions because we want to be able to load savelocs from friends
-    DevLog("Loading savelocs from %s ...\n", SAVELOC_FILE_NAME);
-
-    // Remove the past loaded stuff
-    m_pSavedLocsKV->Clear();
+    if (!m_SavelocStore.IsOpen())
+        return false;
 
-    // Note: This loading is going to contain all of the other maps' savelocs as well!
-    if (!m_pSavedLocsKV->LoadFromFile(filesystem, SAVELOC_FILE_NAME, "MOD"))
+    // Not saving this session; the file keeps what it had and gets rewritten if this is turned back on
+    if (!mom_saveloc_save_between_sessions.GetBool())
     {
-        DevWarning("Failed to savelocs file! It probably doesn't exist yet...\n");
+        m_SavelocStore.MarkOutOfSync();
         return false;
     }
 
-    if (m_pSavedLocsKV->IsEmpty())
+    if (!m_SavelocStore.IsInSync())
+    {
+        WriteAllToStore();
         return false;
-
-    DevLog("Loaded savelocs from %s!\n", SAVELOC_FILE_NAME);
+    }
 
     return true;
 }
 
-bool CSaveLocSystem::SaveSavelocsToKV()
+void CSaveLocSystem::WriteAllToStore()
 {
-    const auto pPlayer = CMomentumPlayer::GetLocalPlayer();
-    if (!pPlayer)
-        return false;
-
-    const auto pKvMapSavelocs = new KeyValues(gpGlobals->mapname.ToCStr());
+    m_SavelocStore.WriteAll(m_rcSavelocs, m_vecStartMarks, m_iCurrentSavelocIndx);
+}
 
-    // Set the current index
-    pKvMapSavelocs->SetInt(SAVELOC_KV_KEY_CURRENTINDEX, m_iCurrentSavelocIndx);
+void CSaveLocSystem::AppendToStore(int iFirstNew)
+{
+    if (!ShouldWriteIncrementally())
+        return;
 
-    // Add all your savelocs
-    const auto kvCPs = new KeyValues(SAVELOC_KV_KEY_SAVELOCS);
-    FOR_EACH_VEC(m_rcSavelocs, i)
+    for (int i = iFirstNew; i < m_rcSavelocs.Count(); i++)
     {
-        char szCheckpointNum[10]; // 999 million savelocs is pretty generous
-        Q_snprintf(szCheckpointNum, sizeof(szCheckpointNum), "%09i", i); // %09 because '\0' is the last (10)
-        KeyValues *kvCP = new KeyValues(szCheckpointNum);
-        m_rcSavelocs[i]->Save(kvCP);
-        kvCPs->AddSubKey(kvCP);
+        if (!m_SavelocStore.Append(m_rcSavelocs[i], m_iCurrentSavelocIndx))
+        {
+            WriteAllToStore();
+            return;
+        }
     }
+}
 
-    // Add startmarks
-    const auto kvStartMarks = new KeyValues(SAVELOC_KV_KEY_STARTMARKS);
-    for (int track = 0; track < MAX_TRACKS; track++)
-    {
-        SavedLocation_t *startMark = m_vecStartMarks[track];
-        if (!startMark) // Save location of valid startmarks only
-            continue;
-
-        char szTrackNum[4]; // 999 tracks should be enough
-        Q_snprintf(szTrackNum, sizeof(szTrackNum), "%03i", track);
-        const auto kvStartMark = new KeyValues(szTrackNum);
+void CSaveLocSystem::ImportLegacySavelocs()
+{
+    if (!filesystem->FileExists(SAVELOC_FILE_NAME, "MOD"))
+        return;
 
-        startMark->Save(kvStartMark);
-        kvStartMarks->AddSubKey(kvStartMark);
-    }
+    KeyValuesAD pKvLegacy("Savelocs");
+    if (!pKvLegacy->LoadFromFile(filesystem, SAVELOC_FILE_NAME, "MOD"))
+        return;
 
-    pKvMapSavelocs->AddSubKey(kvCPs);
-    pKvMapSavelocs->AddSubKey(kvStartMarks);
+    DevLog("Importing savelocs from %s ...\n", SAVELOC_FILE_NAME);
 
-    // Remove the map if it already exists in there
-    KeyValues *pExisting = m_pSavedLocsKV->FindKey(gpGlobals->mapname.ToCStr());
-    if (pExisting)
+    FOR_EACH_SUBKEY(pKvLegacy, pKvMap)
     {
-        m_pSavedLocsKV->RemoveSubKey(pExisting);
-        pExisting->deleteThis();
-    }
+        // Anything already in the new format wins
+        char path[MAX_PATH];
+        CSavelocStore::GetFilePath(pKvMap->GetName(), path, sizeof(path));
+        if (filesystem->FileExists(path, "MOD"))
+            continue;
 
-    m_pSavedLocsKV->AddSubKey(pKvMapSavelocs);
+        CUtlVector<SavedLocation_t *> vecSavelocs, vecStartMarks;
+        for (int i = 0; i < MAX_TRACKS; i++)
+            vecStartMarks.AddToTail(nullptr);
 
-    return m_pSavedLocsKV->SaveToFile(filesystem, SAVELOC_FILE_NAME, "MOD", true);
-}
+        const auto pKvSavelocs = pKvMap->FindKey(SAVELOC_KV_KEY_SAVELOCS);
+        if (pKvSavelocs)
+        {
+            FOR_EACH_SUBKEY(pKvSavelocs, pKvSaveloc)
+            {
+                const auto pSaveloc = new SavedLocation_t;
+                pSaveloc->Load(pKvSaveloc);
+                vecSavelocs.AddToTail(pSaveloc);
+            }
+        }
 
-void CSaveLocSystem::AddSavelocsFromKV(KeyValues *pSavelocData)
-{
-    if (!pSavelocData || pSavelocData->IsEmpty())
-        return;
+        const auto pKvStartMarks = pKvMap->FindKey(SAVELOC_KV_KEY_STARTMARKS);
+        if (pKvStartMarks)
+        {
+            FOR_EACH_SUBKEY(pKvStartMarks, pKvStartMark)
+            {
+                const int track = Q_atoi(pKvStartMark->GetName());
+                if (track < 0 || track >= MAX_TRACKS || vecStartMarks[track])
+                    continue;
 
-    FOR_EACH_SUBKEY(pSavelocData, kvSaveloc)
-    {
-        auto pSaveloc = new SavedLocation_t;
-        pSaveloc->Load(kvSaveloc);
-        m_rcSavelocs.AddToTail(pSaveloc);
+                vecStartMarks[track] = new SavedLocation_t;
+                vecStartMarks[track]->Load(pKvStartMark);
+            }
+        }
+
+        int iCurrentIndex = pKvMap->GetInt(SAVELOC_KV_KEY_CURRENTINDEX, -1);
+        CSavelocStore store;
+        store.Open(pKvMap->GetName(), vecSavelocs, vecStartMarks, iCurrentIndex);
+        store.WriteAll(vecSavelocs, vecStartMarks, iCurrentIndex);
+        store.Close();
+
+        vecSavelocs.PurgeAndDeleteElements();
+        vecStartMarks.PurgeAndDeleteElements();
     }
 
-    UpdateRequesters();
-    FireUpdateEvent();
+    // Kept around under another name, only so nothing is lost if the import went wrong
+    filesystem->RemoveFile(SAVELOC_FILE_NAME_IMPORTED, "MOD");
+    if (!filesystem->RenameFile(SAVELOC_FILE_NAME, SAVELOC_FILE_NAME_IMPORTED, "MOD"))
+        Warning("Failed to rename %s after importing it!\n", SAVELOC_FILE_NAME);
 }
 
 void CSaveLocSystem::ImportMapSavelocs(const char *pImportMapName)
@@ -903,19 +1201,28 @@ void CSaveLocSystem::ImportMapSavelocs(const char *pImportMapName)
     if (!pImportMapName || !pImportMapName[0])
         return;
 
-    const auto pImportKV = m_pSavedLocsKV->FindKey(pImportMapName);
-    if (!pImportKV)
-        return;
+    CUtlVector<SavedLocation_t *> vecImported, vecStartMarks;
+    for (int i = 0; i < MAX_TRACKS; i++)
+        vecStartMarks.AddToTail(nullptr);
 
-    const auto pImportSavelocsKV = pImportKV->FindKey(SAVELOC_KV_KEY_SAVELOCS);
-    if (!pImportSavelocsKV)
+    int iCurrentIndex;
+    CSavelocStore importStore;
+    importStore.Open(pImportMapName, vecImported, vecStartMarks, iCurrentIndex);
+    importStore.Close();
+    vecStartMarks.PurgeAndDeleteElements();
+
+    if (vecImported.IsEmpty())
     {
         Warning("Failed to import savelocs; map to import has no savelocs!\n");
         return;
     }
 
-    AddSavelocsFromKV(pImportSavelocsKV);
-    SaveSavelocsToKV();
+    const int iFirstNew = m_rcSavelocs.Count();
+    m_rcSavelocs.AddVectorToTail(vecImported);
+    AppendToStore(iFirstNew);
+
+    UpdateRequesters();
+    FireUpdateEvent();
 }
 
 CON_COMMAND_F(mom_saveloc_create, "Creates a saveloc that saves a player's state.\n", FCVAR_CLIENTCMD_CAN_EXECUTE)
@@ -971,20 +1278,29 @@ static int SavelocImportCompletion(const char *pPartial, char commands[COMMAND_C
 
     int current = 0;
 
-    const auto pSavelocsKV = g_pSavelocSystem->GetSavelocKV();
-    AssertMsg(pSavelocsKV, "Failed to complete saveloc autocomplete due to null KV!");
-    FOR_EACH_SUBKEY(pSavelocsKV, pSavelocMapKV)
+    char path[MAX_PATH];
+    Q_snprintf(path, MAX_PATH, "%s/*%s", SAVELOC_PATH, EXT_SAVELOC_FILE);
+    V_FixSlashes(path);
+
+    FileFindHandle_t found;
+    const char *pFoundFile = filesystem->FindFirstEx(path, "MOD", &found);
+    while (pFoundFile && current < COMMAND_COMPLETION_MAXITEMS)
     {
-        const auto pMapName = pSavelocMapKV->GetName();
-        const auto bMatchedName = bSubstringNullOrEmpty || Q_stristr(pMapName, pSubstring);
-        if (bMatchedName && !pSavelocMapKV->IsEmpty(SAVELOC_KV_KEY_SAVELOCS))
+        char mapName[MAX_PATH];
+        V_FileBase(pFoundFile, mapName, sizeof(mapName));
+
+        const auto bMatchedName = bSubstringNullOrEmpty || Q_stristr(mapName, pSubstring);
+        if (bMatchedName)
         {
             char command[COMMAND_COMPLETION_ITEM_LENGTH];
-            Q_snprintf(command, COMMAND_COMPLETION_ITEM_LENGTH, "%s %s", pCmdName, pMapName);
+            Q_snprintf(command, COMMAND_COMPLETION_ITEM_LENGTH, "%s %s", pCmdName, mapName);
             Q_strncpy(commands[current], command, COMMAND_COMPLETION_ITEM_LENGTH);
             current++;
         }
+
+        pFoundFile = filesystem->FindNext(found);
     }
+    filesystem->FindClose(found);
 
     return current;
 }
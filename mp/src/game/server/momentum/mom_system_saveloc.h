@@ -1,6 +1,7 @@
 #pragma once
 
 #include "eventqueue.h"
+#include "mom_saveloc_store.h"
 
 class CMomentumPlayer;
 class CMomentumPlayerCollectibles;
@@ -29,6 +30,8 @@ enum SavedLocationComponent_t
     SAVELOC_ALL = ~SAVELOC_NONE,
 };
 
+#define SAVELOC_RECORD_SIZE 72
+
 enum StartMarkType_t
 {
     START_MARK = 0,
@@ -69,8 +72,16 @@ struct SavedLocation_t
     // Called when the player wants to teleport to this checkpoint 
     void Teleport(CMomentumPlayer* pPlayer, bool bStopTimer = true);
 
+    // Packed form for sending to other players, only the saved components are written
     bool Read(CUtlBuffer &mem);
-    bool Write(CUtlBuffer &mem);
+    void Write(CUtlBuffer &mem) const;
+
+    // Binary form: the fixed-size fields as one SAVELOC_RECORD_SIZE record,
+    // and the variable-size rest (names, event queue, collectibles) separately
+    void WriteRecord(CUtlBuffer &buf) const;
+    bool ReadRecord(CUtlBuffer &buf);
+    void WriteExtras(CUtlBuffer &buf) const;
+    bool ReadExtras(CUtlBuffer &buf);
 };
 
 class CSaveLocSystem : public CAutoGameSystem
@@ -93,15 +104,14 @@ public:
     void SetRequestingSavelocsFrom(const uint64 &from);
     uint64 GetRequestingSavelocsFrom() const { return m_iRequesting; }
 
-    bool WriteRequestedSavelocs(SavelocReqPacket *input, SavelocReqPacket *output, const uint64 &requester);
+    // Called when somebody asks for specific savelocs, starts sending them in chunks
+    bool WriteRequestedSavelocs(SavelocReqPacket *input, const uint64 &requester);
+    // Called when a requester got one of our chunks, sends more if there are any
+    void OnSavelocChunkAcked(const uint64 &requester);
+    // Called when a chunk of the savelocs we requested arrives, acknowledges it
     bool ReadReceivedSavelocs(SavelocReqPacket *input, const uint64 &sender);
 
     // Local
-    // Loads savelocs from file
-    bool LoadSavelocsIntoKV();
-    bool SaveSavelocsToKV();
-    // Loads start marks from savelocs keyvalues
-    bool LoadStartMarks();
     // Gets the current menu Saveloc index
     uint32 GetCurrentSavelocMenuIndex() const { return m_iCurrentSavelocIndx; }
     // Is the player currently using the saveloc menu?
@@ -144,19 +154,38 @@ public:
     void ClearAllStartMarks(StartMarkType_t eMarktype);
     bool TeleportToStartMark(StartMarkType_t eMarktype, int iMarkIndex);
 
-    KeyValues *GetSavelocKV() const { return m_pSavedLocsKV; }
     void ImportMapSavelocs(const char *pImportMapName);
 
-    void AddSavelocsFromKV(KeyValues *pSavelocData);
-
 private:
+    struct SavelocTransfer_t
+    {
+        uint64 m_iRequester;
+        CUtlVector<int> m_vecIndexes; // The savelocs they asked for
+        int m_iNext; // Index into m_vecIndexes of the next one to send
+        int m_iChunksInFlight;
+    };
+
+    int FindTransfer(const uint64 &requester) const;
+    bool SendSavelocChunks(SavelocTransfer_t *pTransfer);
+    void AbortTransfer(SavelocTransfer_t *pTransfer); // Drops the transfer after a chunk failed to send
+
     void CheckTimer(); // Check the timer to see if we should stop it
     void FireUpdateEvent() const; // Fire tan event to the UI when we change our saveloc vector in any way, or stop using the saveloc menu
     void UpdateRequesters(); // Update any requesters with the updated saveloc count
 
-    KeyValues *m_pSavedLocsKV;
+    // Whether a change can be written to the map's saveloc file in place. If the file is out of sync it's rewritten instead.
+    bool ShouldWriteIncrementally();
+    void WriteAllToStore();
+    void AppendToStore(int iFirstNew); // Writes the savelocs from iFirstNew on
+    // Moves the savelocs of the old savedlocs.txt into per-map files, once
+    void ImportLegacySavelocs();
+
+    CSavelocStore m_SavelocStore;
     CUtlVector<uint64> m_vecRequesters;
+    CUtlVector<SavelocTransfer_t *> m_vecTransfers; // Savelocs being sent to requesters
+    SavelocReqPacket *m_pChunkPacket; // Reused for every chunk we send, so its buffer only grows once
     uint64 m_iRequesting; // The Steam ID of the person we are requesting savelocs from, if any
+    int m_iRequestedCount, m_iReceivedCount; // Progress of the savelocs we are requesting
 
     CUtlVector<SavedLocation_t*> m_rcSavelocs;
     int m_iCurrentSavelocIndx;
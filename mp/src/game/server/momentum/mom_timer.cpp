@@ -10,7 +10,8 @@
 #include "mom_triggers.h"
 #include "movevars_shared.h"
 #include "run/mom_run_safeguards.h"
-#include "trigger_trace_enums.h"
+#include "mapzones.h"
+#include "mapzones_sweep.h"
 #include "tier0/icommandline.h"
 
 #include "tier0/memdbgon.h"
@@ -22,6 +23,7 @@ CMomentumTimer::CMomentumTimer() : CAutoGameSystemPerFrame("CMomentumTimer"),
       m_bCanStart(false), m_bWasCheatsMsgShown(false),
       m_iTrackNumber(0), m_bShouldUseStartZoneOffset(false)
 {
+    V_memset(m_flTickOffsetFix, 0, sizeof(m_flTickOffsetFix));
 }
 
 bool CMomentumTimer::Init()
@@ -307,29 +309,38 @@ void CMomentumTimer::CalculateTickIntervalOffset(CMomentumPlayer *pPlayer, const
     if (!pPlayer)
         return;
 
-    Ray_t ray;
-    Vector start, end, offset;
-
     // Since EndTouch is called after PostThink (which is where previous origins are stored) we need to go 1 more tick
     // in the previous data to get the real previous origin.
-    if (zoneType == ZONE_TYPE_START) // EndTouch
-    {
-        start = pPlayer->GetLocalOrigin();
-        end = pPlayer->GetPreviousOrigin(1);
-    }
-    else // StartTouch
+    const int iPrevious = zoneType == ZONE_TYPE_START ? 1 : 0;
+
+    const CZoneSweep sweep(pPlayer->GetPreviousOrigin(iPrevious), pPlayer->GetPreviousVelocity(iPrevious),
+                           pPlayer->GetLocalOrigin(), pPlayer->GetAbsVelocity(), gpGlobals->interval_per_tick,
+                           pPlayer->CollisionProp()->OBBMins(), pPlayer->CollisionProp()->OBBMaxs());
+
+    CUtlVector<ZoneSweepResult_t> vecResults;
+    sweep.SolveZones(ZoneTypeToQueryFlag(zoneType), vecResults);
+
+    // The timer only reacts at the end of the tick, so the offset is how long before that we actually
+    // left the start zone, or entered any other zone. Overlapping zones take the earliest entry and latest exit.
+    float flFraction = -1.0f;
+    FOR_EACH_VEC(vecResults, i)
     {
-        start = pPlayer->GetPreviousOrigin();
-        end = pPlayer->GetLocalOrigin();
+        const auto &result = vecResults[i];
+        if (zoneType == ZONE_TYPE_START)
+        {
+            if (!result.m_bEndedInside)
+                flFraction = Max(flFraction, result.m_flExit);
+        }
+        else if (!result.m_bStartedInside)
+        {
+            flFraction = flFraction < 0.0f ? result.m_flEnter : Min(flFraction, result.m_flEnter);
+        }
     }
 
-    ray.Init(start, end, pPlayer->CollisionProp()->OBBMins(), pPlayer->CollisionProp()->OBBMaxs());
-    CTimeTriggerTraceEnum endTriggerTraceEnum(&ray, pPlayer->GetAbsVelocity());
-    enginetrace->EnumerateEntities(ray, true, &endTriggerTraceEnum);
+    const float flOffset = flFraction >= 0.0f ? (1.0f - flFraction) * gpGlobals->interval_per_tick : 0.0f;
 
-    DevLog("Time offset was %f seconds (%s)\n", endTriggerTraceEnum.GetOffset(),
-           zoneType == ZONE_TYPE_START ? "EndTouch" : "StartTouch");
-    SetIntervalOffset(zoneNumber, endTriggerTraceEnum.GetOffset());
+    DevLog("Time offset was %f seconds (%s)\n", flOffset, zoneType == ZONE_TYPE_START ? "EndTouch" : "StartTouch");
+    SetIntervalOffset(zoneNumber, flOffset);
 }
 
 // Practice mode that stops the timer and allows the player to noclip.
@@ -66,6 +66,7 @@ class CMomentumTimer : public CAutoGameSystemPerFrame
     void SetCanStart(bool canStart) { m_bCanStart = canStart; }
 
     // creates fraction of a tick to be used as a time "offset" in precisely calculating the real run time.
+    // Uses the zone sweep, see CZoneSweep for how far off it can be. Not called yet, see m_flTickOffsetFix.
     void CalculateTickIntervalOffset(CMomentumPlayer *pPlayer, int zoneType, int iZoneNumber);
     void SetIntervalOffset(int stage, float offset) { m_flTickOffsetFix[stage] = offset; }
 
@@ -86,6 +87,8 @@ class CMomentumTimer : public CAutoGameSystemPerFrame
     // this works by adding the starting offset to the final time, since the timer starts after we actually exit the
     // start trigger
     // also, subtract the ending offset from the time, since we end after we actually enter the ending trigger
+    // NOTE: Not applied yet. Run times are whole ticks everywhere (timer, replay header, run stats, leaderboards),
+    // so the offsets aren't calculated until they can go into the run time.
     float m_flTickOffsetFix[MAX_ZONES]; // index 0 = endzone, 1 = startzone, 2 = stage 2, 3 = stage3, etc
     bool m_bShouldUseStartZoneOffset;
     float m_flDistFixTraceCorners[8]; // array of floats representing the trace distance from each corner of the
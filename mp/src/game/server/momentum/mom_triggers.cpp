@@ -12,7 +12,7 @@
 #include "fmtstr.h"
 #include "mom_timer.h"
 #include "mom_modulecomms.h"
-#include "trigger_trace_enums.h"
+#include "mapzones.h"
 #include "movevars_shared.h"
 #include "mom_system_tricks.h"
 
@@ -48,6 +48,8 @@ void CBaseMomentumTrigger::Spawn()
     BaseClass::Spawn();
     InitTrigger();
 
+    g_MapZoneSystem.GetZoneBVH()->MarkDirty();
+
     m_debugOverlays |= ((OVERLAY_BBOX_BIT * mom_triggers_overlay_bbox_enable.GetBool()) |
                         (OVERLAY_TEXT_BIT * mom_triggers_overlay_text_enable.GetBool()));
 }
@@ -363,15 +365,14 @@ bool CBaseMomZoneTrigger::FindStandableGroundBelow(const Vector& traceStartPos,
     // Check if we would land in a teleport trigger
     Ray_t tpRay;
     tpRay.Init(traceStartPos, solidTr.endpos);
-    CTeleportTriggerTraceEnum traceEnum(&tpRay);
-    enginetrace->EnumerateEntities(tpRay, true, &traceEnum);
+    const auto pTeleport = g_MapZoneSystem.GetZoneBVH()->TraceRay(tpRay, ZONE_QUERY_TELEPORT);
 
     // Check if one of the following happened:
     // We would land on a trigger_teleport
     // We didn't actually find any ground to stand on
     // We would land on a ramp you cannot stand on
     bool dropOnGround =
-        traceEnum.GetTeleportEntity() == nullptr
+        pTeleport == nullptr
         && solidTr.DidHit()
         && (!solidTr.allsolid && solidTr.plane.normal.z >= 0.7);
     dropPos = dropOnGround ? solidTr.endpos : traceStartPos;
@@ -1098,6 +1098,7 @@ protected:
 	friend class CDODGameMovement;
 	friend class CPortalGameMovement;
     friend class CMomentumGameMovement;
+    friend class CMomMovementSimulator;
     friend class CEnvPlayerSurfaceTrigger;
 	
 	// Accessors for gamemovement
@@ -17,6 +17,7 @@
 #include "in_buttons.h"
 #include "movevars_shared.h"
 #include "momentum/mom_player.h"
+#include "momentum/mom_movement_profiler.h"
 #include "mom_system_gamemode.h"
 
 // memdbgon must be the last include file in a .cpp file!!!
@@ -540,6 +541,7 @@ void CPlayerMove::RunCommand ( CBasePlayer *player, CUserCmd *ucmd, IMoveHelper
         player->SetCollisionBounds(newMins, maxs);
         
         VPROF_SCOPE_BEGIN("moveHelper->ProcessImpacts");
+        MOVEMENT_PROFILE_SCOPE(MOVEPROF_TRIGGERTOUCH);
         moveHelper->ProcessImpacts();
         VPROF_SCOPE_END();
 
@@ -549,6 +551,7 @@ void CPlayerMove::RunCommand ( CBasePlayer *player, CUserCmd *ucmd, IMoveHelper
 	{
 		// Let server invoke any needed impact functions
 		VPROF_SCOPE_BEGIN( "moveHelper->ProcessImpacts" );
+		MOVEMENT_PROFILE_SCOPE( MOVEPROF_TRIGGERTOUCH );
 		moveHelper->ProcessImpacts();
 		VPROF_SCOPE_END();
 	}
@@ -565,3 +568,33 @@ void CPlayerMove::RunCommand ( CBasePlayer *player, CUserCmd *ucmd, IMoveHelper
 		player->m_nTickBase++;
 	}
 }
+
+//-----------------------------------------------------------------------------
+// Purpose: Runs the movement of a command and nothing else, used to simulate
+//			recorded input against the game movement
+// Input  : *player - 
+//			*ucmd - 
+//			*moveHelper - 
+//-----------------------------------------------------------------------------
+void CPlayerMove::RunMovementOnly( CBasePlayer *player, CUserCmd *ucmd, IMoveHelper *moveHelper )
+{
+	StartCommand( player, ucmd );
+
+	ucmd->buttons |= player->m_afButtonForced;
+	ucmd->buttons &= ~player->m_afButtonDisabled;
+
+	player->UpdateButtonState( ucmd->buttons );
+
+	CheckMovingGround( player, gpGlobals->frametime );
+
+	g_pMoveData->m_vecOldAngles = player->pl.v_angle.Get();
+	player->pl.v_angle.GetForModify() = ucmd->viewangles;
+
+	player->m_vecOldOrigin = player->GetAbsOrigin();
+
+	SetupMove( player, ucmd, moveHelper, g_pMoveData );
+	g_pGameMovement->ProcessMovement( player, g_pMoveData );
+	FinishMove( player, ucmd, g_pMoveData );
+
+	FinishCommand( player );
+}
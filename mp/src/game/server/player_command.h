@@ -34,6 +34,10 @@ public:
 	// Run a movement command from the player
 	void			RunCommand ( CBasePlayer *player, CUserCmd *ucmd, IMoveHelper *moveHelper );
 
+	// Runs only the movement part of a command, without thinking, touching triggers or advancing
+	//  the tick base. The caller sets up the globals.
+	void			RunMovementOnly( CBasePlayer *player, CUserCmd *ucmd, IMoveHelper *moveHelper );
+
 protected:
 	// Prepare for running movement
 	virtual void	SetupMove( CBasePlayer *player, CUserCmd *ucmd, IMoveHelper *pHelper, CMoveData *move );
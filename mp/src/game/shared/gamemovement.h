@@ -244,7 +244,7 @@ protected:
 	virtual CBaseHandle		TestPlayerPosition( const Vector& pos, int collisionGroup, trace_t& pm );
 
 	// Checks to see if we should actually jump 
-	void			PlaySwimSound();
+	virtual void	PlaySwimSound();
 
 	bool			IsDead( void ) const;
 
@@ -2,6 +2,7 @@
 
 #include "in_buttons.h"
 #include "mom_gamemovement.h"
+#include "mom_movement_profiler.h"
 #include "mom_player_shared.h"
 #include "mom_shareddefs.h"
 #include "movevars_shared.h"
@@ -53,21 +54,105 @@ ConVar sv_ladder_angle("sv_ladder_angle", "-0.707", FCVAR_REPLICATED,
 
 ConVar sv_rngfix_enable("sv_rngfix_enable", "0", FCVAR_MAPPING);
 
+ConVar sv_movement_trace_cache("sv_movement_trace_cache", "1", FCVAR_REPLICATED,
+                               "Reuse the results of identical hull traces within a movement tick.", true, 0, true, 1);
+
 #ifndef CLIENT_DLL
 #include "env_player_surface_trigger.h"
 static ConVar dispcoll_drawplane("dispcoll_drawplane", "0");
 #endif
 
-CMomentumGameMovement::CMomentumGameMovement() : m_pPlayer(nullptr) {}
+CMomentumGameMovement::CMomentumGameMovement()
+    : m_pPlayer(nullptr), m_bCheckForGrabbableLadder(false), m_iCachedTraces(0), m_iNextCachedTrace(0),
+      m_iTraceCacheHits(0), m_iTraceCacheMisses(0), m_iTraceCacheTicks(0)
+{
+}
 
 void CMomentumGameMovement::ProcessMovement(CBasePlayer *pPlayer, CMoveData *data)
 {
     m_pPlayer = ToCMOMPlayer(pPlayer);
     Assert(m_pPlayer);
 
+    // Anything could have moved (or teleported the player) since the last tick
+    InvalidateTraceCache();
+    m_iTraceCacheTicks++;
+
+    MOVEMENT_PROFILE_BEGIN_TICK();
+
     BaseClass::ProcessMovement(pPlayer, data);
 }
 
+void CMomentumGameMovement::TracePlayerBBox(const Vector &start, const Vector &end, unsigned int fMask, int collisionGroup, trace_t &pm)
+{
+    VPROF("CMomentumGameMovement::TracePlayerBBox");
+
+    TraceHullCached(start, end, GetPlayerMins(), GetPlayerMaxs(), fMask, collisionGroup, pm);
+}
+
+void CMomentumGameMovement::TryTouchGround(const Vector &start, const Vector &end, const Vector &mins, const Vector &maxs,
+                                           unsigned int fMask, int collisionGroup, trace_t &pm)
+{
+    VPROF("CMomentumGameMovement::TryTouchGround");
+
+    TraceHullCached(start, end, mins, maxs, fMask, collisionGroup, pm);
+}
+
+void CMomentumGameMovement::TraceHullCached(const Vector &start, const Vector &end, const Vector &mins, const Vector &maxs,
+                                            unsigned int fMask, int collisionGroup, trace_t &pm)
+{
+    const bool bUseCache = sv_movement_trace_cache.GetBool();
+    if (bUseCache)
+    {
+        for (int i = 0; i < m_iCachedTraces; i++)
+        {
+            const CachedTrace_t &cached = m_CachedTraces[i];
+            if (cached.m_fMask == fMask && cached.m_iCollisionGroup == collisionGroup && cached.m_vecStart == start &&
+                cached.m_vecEnd == end && cached.m_vecMins == mins && cached.m_vecMaxs == maxs)
+            {
+                pm = cached.m_Trace;
+                m_iTraceCacheHits++;
+                return;
+            }
+        }
+    }
+
+    Ray_t ray;
+    ray.Init(start, end, mins, maxs);
+    UTIL_TraceRay(ray, fMask, mv->m_nPlayerHandle.Get(), collisionGroup, &pm);
+    m_iTraceCacheMisses++;
+    MOVEMENT_PROFILE_TRACE();
+
+    if (!bUseCache)
+        return;
+
+    CachedTrace_t &cached = m_CachedTraces[m_iNextCachedTrace];
+    cached.m_vecStart = start;
+    cached.m_vecEnd = end;
+    cached.m_vecMins = mins;
+    cached.m_vecMaxs = maxs;
+    cached.m_fMask = fMask;
+    cached.m_iCollisionGroup = collisionGroup;
+    cached.m_Trace = pm;
+
+    m_iNextCachedTrace = (m_iNextCachedTrace + 1) % MOVEMENT_TRACE_CACHE_SIZE;
+    m_iCachedTraces = min(m_iCachedTraces + 1, MOVEMENT_TRACE_CACHE_SIZE);
+}
+
+void CMomentumGameMovement::PrintTraceCacheStats() const
+{
+    const uint64 iTraces = m_iTraceCacheHits + m_iTraceCacheMisses;
+    Msg("Movement hull traces: %llu over %llu ticks (%.2f per tick)\n", iTraces, m_iTraceCacheTicks,
+        m_iTraceCacheTicks ? static_cast<double>(iTraces) / m_iTraceCacheTicks : 0.0);
+    Msg("Served from the cache: %llu (%.1f%%), traced: %llu (%.2f per tick)\n", m_iTraceCacheHits,
+        iTraces ? 100.0 * m_iTraceCacheHits / iTraces : 0.0, m_iTraceCacheMisses,
+        m_iTraceCacheTicks ? static_cast<double>(m_iTraceCacheMisses) / m_iTraceCacheTicks : 0.0);
+}
+
+void CMomentumGameMovement::ResetTraceCacheStats()
+{
+    m_iTraceCacheHits = m_iTraceCacheMisses = m_iTraceCacheTicks = 0;
+}
+
 float CMomentumGameMovement::LadderDistance() const
 {
     if (player->GetMoveType() == MOVETYPE_LADDER)
@@ -1156,6 +1241,8 @@ void CMomentumGameMovement::FinishDuck()
 
 void CMomentumGameMovement::PlayerMove()
 {
+    MOVEMENT_PROFILE_SCOPE(MOVEPROF_PLAYERMOVE);
+
     BaseClass::PlayerMove();
 
     if (player->IsAlive())
@@ -1248,6 +1335,16 @@ void CMomentumGameMovement::WaterJump()
     BaseClass::WaterJump();
 }
 
+void CMomentumGameMovement::PlaySwimSound()
+{
+#ifndef CLIENT_DLL
+    if (m_pPlayer->IsSimulatingMovement())
+        return;
+#endif
+
+    BaseClass::PlaySwimSound();
+}
+
 void CMomentumGameMovement::CheckVelocity()
 {
     if (m_pPlayer->m_nWallRunState == WALLRUN_RUNNING)
@@ -1276,6 +1373,8 @@ bool CMomentumGameMovement::ShouldApplyGroundFriction()
 
 bool CMomentumGameMovement::CheckJumpButton()
 {
+    MOVEMENT_PROFILE_SCOPE(MOVEPROF_CHECKJUMPBUTTON);
+
     trace_t pm;
 
     // Avoid nullptr access, return false if somehow we don't have a player
@@ -1658,7 +1757,7 @@ bool CMomentumGameMovement::CheckJumpButton()
     m_pPlayer->SetIsInAirDueToJump(true);
     // Fire that we jumped
     m_pPlayer->OnJump();
-    IGameEvent *pEvent = gameeventmanager->CreateEvent("player_jumped");
+    IGameEvent *pEvent = m_pPlayer->IsSimulatingMovement() ? nullptr : gameeventmanager->CreateEvent("player_jumped");
     if (pEvent)
         gameeventmanager->FireEvent(pEvent);
 #endif
@@ -1668,6 +1767,8 @@ bool CMomentumGameMovement::CheckJumpButton()
 
 void CMomentumGameMovement::CategorizePosition()
 {
+    MOVEMENT_PROFILE_SCOPE(MOVEPROF_CATEGORIZEPOSITION);
+
     Vector point;
     trace_t pm;
 
@@ -1898,6 +1999,8 @@ void CMomentumGameMovement::StartGravity()
 
 void CMomentumGameMovement::FullWalkMove()
 {
+    MOVEMENT_PROFILE_SCOPE(MOVEPROF_FULLWALKMOVE);
+
     if (!InWater() &&
         m_pPlayer->m_nWallRunState != WALLRUN_RUNNING &&
         player->m_flWaterJumpTime <= 0.0f)
@@ -2392,6 +2495,8 @@ void CMomentumGameMovement::AirMove()
 
 int CMomentumGameMovement::TryPlayerMove(Vector *pFirstDest, trace_t *pFirstTrace)
 {
+    MOVEMENT_PROFILE_SCOPE(MOVEPROF_TRYPLAYERMOVE);
+
     int bumpcount, numbumps;
     Vector dir;
     float d;
@@ -3495,6 +3600,8 @@ void CMomentumGameMovement::CheckWallRun(Vector &vecWallNormal, trace_t &pm)
 // Handle wallrun movement
 void CMomentumGameMovement::WallRunMove()
 {
+    MOVEMENT_PROFILE_SCOPE(MOVEPROF_WALLRUNMOVE);
+
     if (player->m_Local.m_flWallRunTime <= 0.0f)
     {
         // time's up
@@ -4427,6 +4534,16 @@ void CMomentumGameMovement::WallRunEscapeCorner(Vector &wishdir)
 
 // Expose our interface.
 static CMomentumGameMovement g_GameMovement;
+
+CON_COMMAND(mom_movement_trace_stats, "Prints how many of the movement's hull traces were served by the per-tick trace cache.\n"
+                                      "Pass 1 to reset the counters afterwards.\n")
+{
+    g_GameMovement.PrintTraceCacheStats();
+
+    if (args.ArgC() > 1 && Q_atoi(args.Arg(1)))
+        g_GameMovement.ResetTraceCacheStats();
+}
+
 CMomentumGameMovement *g_pMomentumGameMovement = &g_GameMovement;
 IGameMovement *g_pGameMovement = &g_GameMovement;
 
@@ -8,6 +8,8 @@
 
 class CMomentumPlayer;
 
+#define MOVEMENT_TRACE_CACHE_SIZE 16
+
 class CMomentumGameMovement : public CGameMovement
 {
     typedef CGameMovement BaseClass;
@@ -43,6 +45,14 @@ public:
 
     void ProcessMovement(CBasePlayer *pBasePlayer, CMoveData *pMove) override;
 
+    // Hull traces go through the per-tick trace cache
+    void TracePlayerBBox(const Vector &start, const Vector &end, unsigned int fMask, int collisionGroup, trace_t &pm) override;
+    void TryTouchGround(const Vector &start, const Vector &end, const Vector &mins, const Vector &maxs, unsigned int fMask,
+                        int collisionGroup, trace_t &pm) override;
+
+    void PrintTraceCacheStats() const;
+    void ResetTraceCacheStats();
+
     void Friction() override;
 
     float GetWaterWaistOffset() override;
@@ -80,6 +90,7 @@ public:
 
     void CheckWaterJump() override;
     void WaterJump() override;
+    void PlaySwimSound() override;
     void CheckVelocity() override;
     bool ShouldApplyGroundFriction() override;
 
@@ -137,9 +148,30 @@ public:
     void PerformLurchChecks();
 
 private:
+    // The checks of a tick often trace the same hull over the same path more than once. Nothing the player
+    // can hit moves while the player does, so a trace's result holds for the rest of the tick.
+    struct CachedTrace_t
+    {
+        Vector m_vecStart, m_vecEnd, m_vecMins, m_vecMaxs;
+        unsigned int m_fMask;
+        int m_iCollisionGroup;
+        trace_t m_Trace;
+    };
+
+    void TraceHullCached(const Vector &start, const Vector &end, const Vector &mins, const Vector &maxs, unsigned int fMask,
+                         int collisionGroup, trace_t &pm);
+    void InvalidateTraceCache() { m_iCachedTraces = m_iNextCachedTrace = 0; }
+
     CMomentumPlayer *m_pPlayer;
 
     bool m_bCheckForGrabbableLadder;
+
+    CachedTrace_t m_CachedTraces[MOVEMENT_TRACE_CACHE_SIZE];
+    int m_iCachedTraces;
+    int m_iNextCachedTrace; // Slot the next miss goes into, the oldest one once the cache is full
+    uint64 m_iTraceCacheHits;
+    uint64 m_iTraceCacheMisses;
+    uint64 m_iTraceCacheTicks;
 };
 
 extern CMomentumGameMovement *g_pMomentumGameMovement;
\ No newline at end of file
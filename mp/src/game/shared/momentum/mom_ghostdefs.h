@@ -1,6 +1,7 @@
 #pragma once
 
 #include "utlbuffer.h"
+#include "tier1/bitbuf.h"
 #include "mom_shareddefs.h"
 
 enum PacketType
@@ -8,6 +9,8 @@ enum PacketType
     PACKET_TYPE_POSITION = 0,
     PACKET_TYPE_DECAL,
     PACKET_TYPE_SAVELOC_REQ,
+    PACKET_TYPE_POSITION_COMPACT,
+    PACKET_TYPE_BATCH,
 
     PACKET_TYPE_COUNT
 };
@@ -15,6 +18,28 @@ enum PacketType
 // Number of updates per second for online ghosts
 #define MOM_ONLINE_GHOST_UPDATERATE 40.0f
 
+// Version of the compact position packet format, bump when changing it
+#define POSITION_COMPACT_VERSION 1
+// Lobby networking we understand, advertised in our lobby member data. Members that don't advertise it
+// are from before compact position packets and batches, they still get the full PACKET_TYPE_POSITION
+// and every batched packet on its own.
+#define LOBBY_NET_VERSION 2
+// The first LOBBY_NET_VERSION with compact position packets and batches
+#define LOBBY_NET_VERSION_BATCH 1
+// The first LOBBY_NET_VERSION with chunked saveloc transfers, older members can't send or receive savelocs with us
+#define LOBBY_NET_VERSION_SAVELOC_CHUNKS 2
+// Every this many position packets a keyframe is sent reliably, the ones in between are deltas against it
+#define POSITION_KEYFRAME_INTERVAL 20
+// Keyframes kept per sender to decode deltas against
+#define POSITION_BASELINE_HISTORY 4
+// Largest encoded compact position, a keyframe with every varint at its longest fits in this
+#define POSITION_COMPACT_MAX_BYTES 64
+
+// Most packets coalesced into one batch, the count is sent as a byte
+#define BATCH_PACKET_MAX_PACKETS 255
+// Largest batch we build, keeps unreliable batches inside a single MTU
+#define BATCH_PACKET_MAX_BYTES 1200
+
 #define APPEARANCE_BODYGROUP_MIN 0
 #define APPEARANCE_BODYGROUP_MAX 14
 #define APPEARANCE_TRAIL_LEN_MIN 1
@@ -90,6 +115,7 @@ public:
     QAngle EyeAngle;
     Vector Position;
     Vector Velocity;
+    float SendTime; // Sender's curtime when this was sent, used to order and time packets on the other end
 
     PositionPacket(const QAngle eyeAngle, const Vector position, const Vector velocity, const float viewOffsetZ, const int buttons)
     {
@@ -99,11 +125,12 @@ public:
 
         Buttons = buttons;
         ViewOffset = viewOffsetZ;
+        SendTime = 0.0f;
 
         Validate();
     }
 
-    PositionPacket(): Buttons(0), ViewOffset(0)
+    PositionPacket(): Buttons(0), ViewOffset(0), SendTime(0)
     {
         EyeAngle.Init();
         Position.Init();
@@ -117,6 +144,8 @@ public:
         buf.Get(&Velocity, sizeof(Vector));
         Buttons = buf.GetInt();
         ViewOffset = buf.GetFloat();
+        // Older clients don't send the timestamp, the receiver falls back to the receive time
+        SendTime = buf.GetBytesRemaining() >= static_cast<int>(sizeof(float)) ? buf.GetFloat() : 0.0f;
 
         Validate();
     }
@@ -131,6 +160,7 @@ public:
         buf.Put(&Velocity, sizeof(Vector));
         buf.PutInt(Buttons);
         buf.PutFloat(ViewOffset);
+        buf.PutFloat(SendTime);
     }
 
     void Validate()
@@ -144,6 +174,9 @@ public:
         if (!Velocity.IsValid() || !IsEntityVelocityReasonable(Velocity))
             Velocity = vec3_origin;
 
+        if (!IsFinite(SendTime))
+            SendTime = 0.0f;
+
         ViewOffset = Clamp(ViewOffset, VEC_DUCK_VIEW.z, VEC_VIEW.z);
     }
 
@@ -154,6 +187,7 @@ public:
         EyeAngle = other.EyeAngle;
         Position = other.Position;
         Velocity = other.Velocity;
+        SendTime = other.SendTime;
         Validate();
         return *this;
     }
@@ -168,6 +202,235 @@ public:
     }
 };
 
+// PositionPacket quantized to what the compact format sends: positions to 1/32 unit, velocities to 1/4 unit/s,
+// angles to 16 bits and the view offset to 1/2 unit. Deltas are taken between these so they decode exactly.
+struct QuantizedPosition_t
+{
+    int32 m_iPosition[3];
+    int32 m_iVelocity[3];
+    uint16 m_iAngles[3];
+    uint8 m_iViewOffset;
+    int32 m_iButtons;
+    float m_flSendTime;
+
+    void FromPacket(const PositionPacket &packet)
+    {
+        for (int i = 0; i < 3; i++)
+        {
+            m_iPosition[i] = RoundFloatToInt(clamp(packet.Position[i], MIN_COORD_FLOAT, MAX_COORD_FLOAT) * 32.0f);
+            m_iVelocity[i] = RoundFloatToInt(packet.Velocity[i] * 4.0f);
+            m_iAngles[i] = static_cast<uint16>(RoundFloatToInt(anglemod(packet.EyeAngle[i]) * (65536.0f / 360.0f)));
+        }
+
+        m_iViewOffset = static_cast<uint8>(clamp(RoundFloatToInt(packet.ViewOffset * 2.0f), 0, 255));
+        m_iButtons = packet.Buttons;
+        m_flSendTime = packet.SendTime;
+    }
+
+    void ToPacket(PositionPacket &packet) const
+    {
+        QAngle angles;
+        Vector position, velocity;
+        for (int i = 0; i < 3; i++)
+        {
+            position[i] = m_iPosition[i] / 32.0f;
+            velocity[i] = m_iVelocity[i] / 4.0f;
+            angles[i] = AngleNormalize(m_iAngles[i] * (360.0f / 65536.0f));
+        }
+
+        packet = PositionPacket(angles, position, velocity, m_iViewOffset / 2.0f, m_iButtons);
+        packet.SendTime = m_flSendTime;
+    }
+};
+
+// Bit-packed PositionPacket. Keyframes carry the whole (quantized) frame, every other packet only
+// carries the differences to the latest keyframe. Keyframes are sent reliably, so the baseline of a
+// delta is always one the receiver gets, even if it may still be on its way.
+class CompactPositionPacket : public MomentumPacket
+{
+  public:
+    uint8 Version;
+    uint16 Sequence;         // Goes up by one every packet
+    uint16 BaselineSequence; // Keyframe this is a delta against, same as Sequence for keyframes
+    QuantizedPosition_t Frame;
+
+    // Encodes frame as a keyframe when pBaseline is null, otherwise as a delta against it
+    CompactPositionPacket(const QuantizedPosition_t &frame, uint16 sequence, uint16 baselineSequence, const QuantizedPosition_t *pBaseline)
+        : Version(POSITION_COMPACT_VERSION), Sequence(sequence), BaselineSequence(pBaseline ? baselineSequence : sequence),
+          Frame(frame), m_pBaseline(pBaseline), m_nDataBytes(0), m_iFrameBit(0)
+    {
+    }
+
+    // Only reads the header, Decode reads the frame once the baseline is known
+    CompactPositionPacket(CUtlBuffer &buf) : Sequence(0), BaselineSequence(0), m_pBaseline(nullptr), m_iFrameBit(0)
+    {
+        V_memset(&Frame, 0, sizeof(Frame));
+
+        Version = buf.GetUnsignedChar();
+        m_nDataBytes = clamp(buf.GetBytesRemaining(), 0, static_cast<int>(sizeof(m_Data)));
+        buf.Get(m_Data, m_nDataBytes);
+
+        if (Version != POSITION_COMPACT_VERSION || !buf.IsValid())
+        {
+            Version = 0;
+            return;
+        }
+
+        bf_read bits(m_Data, m_nDataBytes);
+        Sequence = static_cast<uint16>(bits.ReadUBitLong(16));
+        BaselineSequence = bits.ReadOneBit() ? Sequence : static_cast<uint16>(Sequence - bits.ReadUBitVar());
+        m_iFrameBit = bits.GetNumBitsRead();
+
+        if (bits.IsOverflowed())
+            Version = 0;
+    }
+
+    bool IsValid() const { return Version == POSITION_COMPACT_VERSION; }
+    bool IsKeyframe() const { return Sequence == BaselineSequence; }
+
+    // Reads the frame, pBaseline has to be the keyframe with BaselineSequence (null for keyframes)
+    bool Decode(const QuantizedPosition_t *pBaseline)
+    {
+        if (!IsValid() || IsKeyframe() == (pBaseline != nullptr))
+            return false;
+
+        bf_read bits(m_Data, m_nDataBytes);
+        bits.Seek(m_iFrameBit);
+
+        if (!pBaseline)
+        {
+            Frame.m_flSendTime = bits.ReadFloat();
+            for (int i = 0; i < 3; i++)
+                Frame.m_iPosition[i] = bits.ReadSBitLong(21);
+            for (int i = 0; i < 3; i++)
+                Frame.m_iVelocity[i] = bits.ReadSignedVarInt32();
+            for (int i = 0; i < 3; i++)
+                Frame.m_iAngles[i] = static_cast<uint16>(bits.ReadUBitLong(16));
+            Frame.m_iViewOffset = static_cast<uint8>(bits.ReadUBitLong(8));
+            Frame.m_iButtons = bits.ReadUBitVar();
+        }
+        else
+        {
+            Frame.m_flSendTime = pBaseline->m_flSendTime + bits.ReadUBitVar() / 1000.0f;
+            for (int i = 0; i < 3; i++)
+                Frame.m_iPosition[i] = pBaseline->m_iPosition[i] + bits.ReadSignedVarInt32();
+            for (int i = 0; i < 3; i++)
+                Frame.m_iVelocity[i] = pBaseline->m_iVelocity[i] + bits.ReadSignedVarInt32();
+            for (int i = 0; i < 3; i++)
+                Frame.m_iAngles[i] = static_cast<uint16>(pBaseline->m_iAngles[i] + bits.ReadSignedVarInt32());
+            Frame.m_iViewOffset = bits.ReadOneBit() ? static_cast<uint8>(bits.ReadUBitLong(8)) : pBaseline->m_iViewOffset;
+            Frame.m_iButtons = bits.ReadOneBit() ? bits.ReadUBitVar() : pBaseline->m_iButtons;
+        }
+
+        return !bits.IsOverflowed();
+    }
+
+    PacketType GetType() const OVERRIDE { return PACKET_TYPE_POSITION_COMPACT; }
+
+    void Write(CUtlBuffer &buf) OVERRIDE
+    {
+        MomentumPacket::Write(buf);
+        buf.PutUnsignedChar(Version);
+
+        bf_write bits(m_Data, sizeof(m_Data));
+        bits.WriteUBitLong(Sequence, 16);
+        bits.WriteOneBit(IsKeyframe());
+
+        if (!m_pBaseline)
+        {
+            bits.WriteFloat(Frame.m_flSendTime);
+            for (int i = 0; i < 3; i++)
+                bits.WriteSBitLong(Frame.m_iPosition[i], 21);
+            for (int i = 0; i < 3; i++)
+                bits.WriteSignedVarInt32(Frame.m_iVelocity[i]);
+            for (int i = 0; i < 3; i++)
+                bits.WriteUBitLong(Frame.m_iAngles[i], 16);
+            bits.WriteUBitLong(Frame.m_iViewOffset, 8);
+            bits.WriteUBitVar(Frame.m_iButtons);
+        }
+        else
+        {
+            const QuantizedPosition_t &base = *m_pBaseline;
+            bits.WriteUBitVar(static_cast<uint16>(Sequence - BaselineSequence));
+            bits.WriteUBitVar(Max(RoundFloatToInt((Frame.m_flSendTime - base.m_flSendTime) * 1000.0f), 0));
+            for (int i = 0; i < 3; i++)
+                bits.WriteSignedVarInt32(Frame.m_iPosition[i] - base.m_iPosition[i]);
+            for (int i = 0; i < 3; i++)
+                bits.WriteSignedVarInt32(Frame.m_iVelocity[i] - base.m_iVelocity[i]);
+            // Wrapped to the short way around
+            for (int i = 0; i < 3; i++)
+                bits.WriteSignedVarInt32(static_cast<int16>(Frame.m_iAngles[i] - base.m_iAngles[i]));
+
+            bits.WriteOneBit(Frame.m_iViewOffset != base.m_iViewOffset);
+            if (Frame.m_iViewOffset != base.m_iViewOffset)
+                bits.WriteUBitLong(Frame.m_iViewOffset, 8);
+
+            bits.WriteOneBit(Frame.m_iButtons != base.m_iButtons);
+            if (Frame.m_iButtons != base.m_iButtons)
+                bits.WriteUBitVar(Frame.m_iButtons);
+        }
+
+        Assert(!bits.IsOverflowed());
+        buf.Put(m_Data, bits.GetNumBytesWritten());
+    }
+
+  private:
+    const QuantizedPosition_t *m_pBaseline;
+    uint32 m_Data[POSITION_COMPACT_MAX_BYTES / sizeof(uint32)]; // bitbufs need 4 byte alignment
+    int m_nDataBytes;
+    int m_iFrameBit;
+};
+
+// The last few keyframes received from a lobby member, to decode their compact position packets against
+class CPositionBaselines
+{
+  public:
+    CPositionBaselines() { Reset(); }
+
+    void Reset()
+    {
+        m_iNext = 0;
+        for (int i = 0; i < POSITION_BASELINE_HISTORY; i++)
+            m_bValid[i] = false;
+    }
+
+    // Decodes the packet into out. Returns false if it's broken or relative to a keyframe we haven't got.
+    bool Decode(CompactPositionPacket &packet, PositionPacket &out)
+    {
+        if (!packet.IsValid())
+            return false;
+
+        if (packet.IsKeyframe())
+        {
+            if (!packet.Decode(nullptr))
+                return false;
+
+            m_Keyframes[m_iNext] = packet.Frame;
+            m_iSequences[m_iNext] = packet.Sequence;
+            m_bValid[m_iNext] = true;
+            m_iNext = (m_iNext + 1) % POSITION_BASELINE_HISTORY;
+        }
+        else
+        {
+            int iBaseline = 0;
+            while (iBaseline < POSITION_BASELINE_HISTORY && !(m_bValid[iBaseline] && m_iSequences[iBaseline] == packet.BaselineSequence))
+                iBaseline++;
+
+            if (iBaseline == POSITION_BASELINE_HISTORY || !packet.Decode(&m_Keyframes[iBaseline]))
+                return false;
+        }
+
+        packet.Frame.ToPacket(out);
+        return true;
+    }
+
+  private:
+    QuantizedPosition_t m_Keyframes[POSITION_BASELINE_HISTORY];
+    uint16 m_iSequences[POSITION_BASELINE_HISTORY];
+    bool m_bValid[POSITION_BASELINE_HISTORY];
+    int m_iNext;
+};
+
 // Used for keeping track of when we receive certain packets.
 // NOTE: The packet used as the Generic (T) here needs to have
 // a default constructor and an operator= overload!
@@ -177,6 +440,8 @@ struct ReceivedFrame_t
     float recvTime;
     T frame;
 
+    ReceivedFrame_t() : recvTime(0.0f) {}
+
     ReceivedFrame_t(float recvTime, T recvFrame)
     {
         this->recvTime = recvTime;
@@ -366,17 +631,24 @@ enum SavelocRequestStage
     SAVELOC_REQ_STAGE_COUNT_REQ,    // Asking how many savelocs there are
     SAVELOC_REQ_STAGE_COUNT_ACK,    // Telling how many savelocs there are
     SAVELOC_REQ_STAGE_SAVELOC_REQ,  // Requesting specific savelocs at specific indexes
-    SAVELOC_REQ_STAGE_SAVELOC_ACK,  // Giving the specific savelocs
+    SAVELOC_REQ_STAGE_SAVELOC_ACK,  // Giving a chunk of the specific savelocs
+    SAVELOC_REQ_STAGE_CHUNK_ACK,    // Got a chunk, another one can be sent
 
     // Internal
     SAVELOC_REQ_STAGE_REQUESTER_LEFT,
     SAVELOC_REQ_STAGE_CLICKED_CANCEL,
+    SAVELOC_REQ_STAGE_PROGRESS,     // How many of the requested savelocs have arrived so far
+    SAVELOC_REQ_STAGE_FAILED,       // A chunk couldn't be read, the rest of the transfer was dropped
+    SAVELOC_REQ_STAGE_OUTDATED,     // The other player's game is from before chunked saveloc transfers
 
     // Bounds for online
     SAVELOC_REQ_STAGE_FIRST = SAVELOC_REQ_STAGE_DONE,
-    SAVELOC_REQ_STAGE_LAST = SAVELOC_REQ_STAGE_SAVELOC_ACK
+    SAVELOC_REQ_STAGE_LAST = SAVELOC_REQ_STAGE_CHUNK_ACK
 };
 
+#define SAVELOC_REQ_CHUNK_SIZE 16384 // Requested savelocs are sent in chunks of about this many bytes
+#define SAVELOC_REQ_CHUNK_WINDOW 4 // How many chunks can be on the way before one has to be acknowledged
+
 class SavelocReqPacket : public MomentumPacket
 {
   public:
@@ -384,19 +656,25 @@ class SavelocReqPacket : public MomentumPacket
     int stage;
 
     // Stage == _COUNT_ACK ? (The number of savelocs we have to offer)
-    // Stage == (_SAVELOC_REQ || _SAVELOC_ACK) ? (The number of savelocs we have chosen to download)
+    // Stage == _SAVELOC_REQ ? (The number of savelocs we have chosen to download)
+    // Stage == _SAVELOC_ACK ? (The number of savelocs in this chunk)
+    // Stage == _CHUNK_ACK ? (The number of savelocs received so far)
     int saveloc_count;
 
+    // Stage == _SAVELOC_ACK ? (The number of requested savelocs still to come after this chunk)
+    int saveloc_remaining;
+
     // Stage == _SAVELOC_REQ ? (The selected nums of savelocs to download)
     // Stage == _SAVELOC_ACK ? (The actual saveloc data, in binary)
+    // When read from a message this points into the message's data rather than copying it
     CUtlBuffer dataBuf;
 
-    SavelocReqPacket(): stage(0), saveloc_count(0)
+    SavelocReqPacket(): stage(0), saveloc_count(0), saveloc_remaining(0)
     {
         dataBuf.SetBigEndian(false);
     }
 
-    SavelocReqPacket(CUtlBuffer &buf)
+    SavelocReqPacket(CUtlBuffer &buf): saveloc_count(0), saveloc_remaining(0)
     {
         stage = buf.GetInt();
 
@@ -407,11 +685,14 @@ class SavelocReqPacket : public MomentumPacket
         {
             saveloc_count = buf.GetInt();
 
-            if (stage > SAVELOC_REQ_STAGE_COUNT_ACK && buf.IsValid())
+            if (stage == SAVELOC_REQ_STAGE_SAVELOC_ACK)
+                saveloc_remaining = buf.GetInt();
+
+            const int size = buf.GetBytesRemaining();
+            if (stage > SAVELOC_REQ_STAGE_COUNT_ACK && buf.IsValid() && size > 0)
             {
-                dataBuf.Clear();
+                dataBuf.SetExternalBuffer(const_cast<void *>(buf.PeekGet()), size, size, CUtlBuffer::READ_ONLY);
                 dataBuf.SetBigEndian(false);
-                dataBuf.Put(buf.PeekGet(), buf.GetBytesRemaining());
             }
         }
     }
@@ -426,8 +707,95 @@ class SavelocReqPacket : public MomentumPacket
         {
             buf.PutInt(saveloc_count);
 
+            if (stage == SAVELOC_REQ_STAGE_SAVELOC_ACK)
+                buf.PutInt(saveloc_remaining);
+
             if (stage > SAVELOC_REQ_STAGE_COUNT_ACK)
                 buf.Put(dataBuf.Base(), dataBuf.TellPut());
         }
     }
-};
\ No newline at end of file
+};
+
+// Several packets for the same peer coalesced into one message. Each one is prefixed by its size,
+// a batch holding a single packet is written as just that packet.
+class BatchPacket : public MomentumPacket
+{
+  public:
+    BatchPacket() : m_iCount(0)
+    {
+        m_Data.SetBigEndian(false);
+    }
+
+    PacketType GetType() const OVERRIDE { return PACKET_TYPE_BATCH; }
+
+    int Count() const { return m_iCount; }
+    bool IsEmpty() const { return m_iCount == 0; }
+
+    void Clear()
+    {
+        m_Data.Purge();
+        m_iCount = 0;
+    }
+
+    bool AddPacket(MomentumPacket *pPacket)
+    {
+        CUtlBuffer buf;
+        pPacket->Write(buf);
+        return AddPacketData(buf.Base(), buf.TellPut());
+    }
+
+    // Appends every packet of another batch, fails without adding any if they don't all fit
+    bool AddBatch(const BatchPacket &other)
+    {
+        if (m_iCount + other.m_iCount > BATCH_PACKET_MAX_PACKETS || m_Data.TellPut() + other.m_Data.TellPut() > BATCH_PACKET_MAX_BYTES)
+            return false;
+
+        m_Data.Put(other.m_Data.Base(), other.m_Data.TellPut());
+        m_iCount += other.m_iCount;
+        return true;
+    }
+
+    // Walks the packets one at a time, start with iOffset at 0. Returns false past the last one.
+    bool NextPacket(int &iOffset, const void *&pData, int &size) const
+    {
+        if (iOffset >= m_Data.TellPut())
+            return false;
+
+        CUtlBuffer buf(static_cast<const uint8 *>(m_Data.Base()) + iOffset, m_Data.TellPut() - iOffset, CUtlBuffer::READ_ONLY);
+        buf.SetBigEndian(false);
+        size = buf.GetUnsignedShort();
+        pData = buf.PeekGet();
+        iOffset += sizeof(uint16) + size;
+        return true;
+    }
+
+    void Write(CUtlBuffer &buf) OVERRIDE
+    {
+        if (m_iCount == 1)
+        {
+            // Skip past the size prefix
+            buf.Put(static_cast<const uint8 *>(m_Data.Base()) + sizeof(uint16), m_Data.TellPut() - sizeof(uint16));
+            return;
+        }
+
+        MomentumPacket::Write(buf);
+        buf.PutUnsignedChar(m_iCount);
+        buf.Put(m_Data.Base(), m_Data.TellPut());
+    }
+
+  private:
+    bool AddPacketData(const void *pData, int size)
+    {
+        const int entrySize = size + sizeof(uint16);
+        if (m_iCount >= BATCH_PACKET_MAX_PACKETS || m_Data.TellPut() + entrySize > BATCH_PACKET_MAX_BYTES)
+            return false;
+
+        m_Data.PutUnsignedShort(size);
+        m_Data.Put(pData, size);
+        m_iCount++;
+        return true;
+    }
+
+    CUtlBuffer m_Data;
+    int m_iCount;
+};
@@ -0,0 +1,234 @@
+#include "cbase.h"
+
+#include "mom_movement_profiler.h"
+#include "mom_shareddefs.h"
+#include "filesystem.h"
+
+#include "tier0/memdbgon.h"
+
+#define MOVEMENT_PROFILE_PATH "movementprofile"
+
+static MAKE_TOGGLE_CONVAR(mom_movement_profile, "0", FCVAR_NONE,
+                          "Records per tick time and trace counts of the movement code. Only does anything in builds "
+                          "with the movement profiler compiled in. 0 = OFF, 1 = ON\n");
+
+static const char *const s_pSectionNames[MOVEPROF_COUNT] =
+{
+    "PlayerMove",
+    "FullWalkMove",
+    "TryPlayerMove",
+    "CategorizePosition",
+    "WallRunMove",
+    "CheckJumpButton",
+    "TriggerTouch",
+};
+
+static int SortFloats(const float *a, const float *b)
+{
+    if (*a < *b)
+        return -1;
+
+    return *a > *b ? 1 : 0;
+}
+
+CMovementProfiler g_MovementProfiler;
+
+CMovementProfiler::CMovementProfiler() : m_bEnabled(false)
+{
+    Reset();
+}
+
+const char *CMovementProfiler::GetSectionName(int iSection)
+{
+    return iSection >= 0 && iSection < MOVEPROF_COUNT ? s_pSectionNames[iSection] : "Unknown";
+}
+
+void CMovementProfiler::Reset()
+{
+    m_iNextSample = 0;
+    m_iSampleCount = 0;
+    m_bTickOpen = false;
+    V_memset(&m_Current, 0, sizeof(m_Current));
+    V_memset(m_iDepth, 0, sizeof(m_iDepth));
+}
+
+void CMovementProfiler::BeginTick()
+{
+    if (m_bTickOpen)
+        CommitTick();
+
+    const bool bEnabled = mom_movement_profile.GetBool();
+    if (bEnabled != m_bEnabled)
+    {
+        m_bEnabled = bEnabled;
+        V_memset(m_iDepth, 0, sizeof(m_iDepth));
+    }
+
+    if (!m_bEnabled)
+        return;
+
+    V_memset(&m_Current, 0, sizeof(m_Current));
+    m_bTickOpen = true;
+}
+
+void CMovementProfiler::CommitTick()
+{
+    m_Samples[m_iNextSample] = m_Current;
+    m_iNextSample = (m_iNextSample + 1) % MOVEMENT_PROFILER_HISTORY;
+    m_iSampleCount = min(m_iSampleCount + 1, MOVEMENT_PROFILER_HISTORY);
+    m_bTickOpen = false;
+}
+
+void CMovementProfiler::EnterSection(int iSection)
+{
+    if (!m_bTickOpen)
+        return;
+
+    if (m_iDepth[iSection]++ == 0)
+        m_Timers[iSection].Start();
+
+    if (m_Current.m_iCalls[iSection] < 0xFFFF)
+        m_Current.m_iCalls[iSection]++;
+}
+
+void CMovementProfiler::ExitSection(int iSection)
+{
+    if (!m_bTickOpen || m_iDepth[iSection] <= 0)
+        return;
+
+    if (--m_iDepth[iSection] == 0)
+    {
+        m_Timers[iSection].End();
+        m_Current.m_flTime[iSection] += m_Timers[iSection].GetDuration().GetMillisecondsF();
+    }
+}
+
+void CMovementProfiler::CountTrace()
+{
+    if (!m_bTickOpen)
+        return;
+
+    for (int i = 0; i < MOVEPROF_COUNT; i++)
+    {
+        if (m_iDepth[i] > 0 && m_Current.m_iTraces[i] < 0xFFFF)
+            m_Current.m_iTraces[i]++;
+    }
+}
+
+void CMovementProfiler::Summarize(int iSection, SectionSummary_t &summary) const
+{
+    V_memset(&summary, 0, sizeof(summary));
+    if (m_iSampleCount == 0)
+        return;
+
+    CUtlVector<float> vecTimes;
+    vecTimes.EnsureCapacity(m_iSampleCount);
+
+    float flTotalTime = 0.0f;
+    int iTotalCalls = 0, iTotalTraces = 0;
+    for (int i = 0; i < m_iSampleCount; i++)
+    {
+        const TickSample_t &sample = m_Samples[i];
+        vecTimes.AddToTail(sample.m_flTime[iSection]);
+        flTotalTime += sample.m_flTime[iSection];
+        iTotalCalls += sample.m_iCalls[iSection];
+        iTotalTraces += sample.m_iTraces[iSection];
+    }
+
+    vecTimes.Sort(SortFloats);
+
+    const int iLast = m_iSampleCount - 1;
+    summary.m_flAverage = flTotalTime / m_iSampleCount;
+    summary.m_flMedian = vecTimes[iLast / 2];
+    summary.m_flP90 = vecTimes[iLast * 90 / 100];
+    summary.m_flP99 = vecTimes[iLast * 99 / 100];
+    summary.m_flMax = vecTimes[iLast];
+    summary.m_flCallsPerTick = float(iTotalCalls) / m_iSampleCount;
+    summary.m_flTracesPerTick = float(iTotalTraces) / m_iSampleCount;
+}
+
+void CMovementProfiler::PrintReport()
+{
+    if (m_iSampleCount == 0)
+    {
+        Msg("No movement ticks have been profiled yet. Set mom_movement_profile 1 first.\n");
+        return;
+    }
+
+    Msg("Movement profile of the last %i ticks (%s), times in ms per tick:\n", m_iSampleCount,
+        CBaseEntity::IsServer() ? "server" : "client");
+    Msg("%-20s %9s %9s %9s %9s %9s %9s %9s\n", "Section", "Avg", "p50", "p90", "p99", "Max", "Calls", "Traces");
+
+    for (int i = 0; i < MOVEPROF_COUNT; i++)
+    {
+        SectionSummary_t summary;
+        Summarize(i, summary);
+
+        Msg("%-20s %9.4f %9.4f %9.4f %9.4f %9.4f %9.2f %9.2f\n", s_pSectionNames[i], summary.m_flAverage,
+            summary.m_flMedian, summary.m_flP90, summary.m_flP99, summary.m_flMax, summary.m_flCallsPerTick,
+            summary.m_flTracesPerTick);
+    }
+}
+
+bool CMovementProfiler::Export(const char *pFileName)
+{
+    const FileHandle_t hFile = g_pFullFileSystem->Open(pFileName, "w", "MOD");
+    if (!hFile)
+    {
+        Warning("Could not open %s for writing!\n", pFileName);
+        return false;
+    }
+
+    g_pFullFileSystem->FPrintf(hFile, "tick");
+    for (int i = 0; i < MOVEPROF_COUNT; i++)
+    {
+        g_pFullFileSystem->FPrintf(hFile, ",%s_ms,%s_calls,%s_traces", s_pSectionNames[i], s_pSectionNames[i],
+                                   s_pSectionNames[i]);
+    }
+    g_pFullFileSystem->FPrintf(hFile, "\n");
+
+    // Oldest tick first
+    const int iOldest = m_iSampleCount < MOVEMENT_PROFILER_HISTORY ? 0 : m_iNextSample;
+    for (int i = 0; i < m_iSampleCount; i++)
+    {
+        const TickSample_t &sample = m_Samples[(iOldest + i) % MOVEMENT_PROFILER_HISTORY];
+
+        g_pFullFileSystem->FPrintf(hFile, "%i", i);
+        for (int j = 0; j < MOVEPROF_COUNT; j++)
+        {
+            g_pFullFileSystem->FPrintf(hFile, ",%f,%i,%i", sample.m_flTime[j], sample.m_iCalls[j],
+                                       sample.m_iTraces[j]);
+        }
+        g_pFullFileSystem->FPrintf(hFile, "\n");
+    }
+
+    g_pFullFileSystem->Close(hFile);
+
+    return true;
+}
+
+CON_COMMAND(mom_movement_profile_print, "Prints the average, percentile and max time per tick of each profiled part "
+                                        "of the movement, with their calls and traces per tick.\n")
+{
+    g_MovementProfiler.PrintReport();
+}
+
+CON_COMMAND(mom_movement_profile_reset, "Clears the ticks recorded by the movement profiler.\n")
+{
+    g_MovementProfiler.Reset();
+}
+
+CON_COMMAND(mom_movement_profile_export, "Writes every tick recorded by the movement profiler to a CSV file in "
+                                         MOVEMENT_PROFILE_PATH "/. Takes the file name as an optional parameter.\n")
+{
+    char fileName[MAX_PATH], filePath[MAX_PATH];
+    V_strncpy(fileName, args.ArgC() > 1 ? args.Arg(1) : (CBaseEntity::IsServer() ? "server" : "client"),
+              sizeof(fileName));
+    V_DefaultExtension(fileName, ".csv", sizeof(fileName));
+    V_ComposeFileName(MOVEMENT_PROFILE_PATH, fileName, filePath, sizeof(filePath));
+
+    g_pFullFileSystem->CreateDirHierarchy(MOVEMENT_PROFILE_PATH, "MOD");
+
+    if (g_MovementProfiler.Export(filePath))
+        Msg("Wrote the movement profile to %s\n", filePath);
+}
@@ -0,0 +1,115 @@
+#pragma once
+
+#include "tier0/fasttimer.h"
+#include "tier0/vprof.h"
+
+// Compiled into debug builds, release builds only get it with /define:MOVEMENT_PROFILER passed to vpc
+#if defined(_DEBUG) || defined(MOM_MOVEMENT_PROFILER)
+#define MOVEMENT_PROFILER_ENABLED
+#endif
+
+#define MOVEMENT_PROFILER_HISTORY 1024 // Ticks kept in the ring buffer
+
+enum MovementProfileSection_t
+{
+    MOVEPROF_PLAYERMOVE = 0,
+    MOVEPROF_FULLWALKMOVE,
+    MOVEPROF_TRYPLAYERMOVE,
+    MOVEPROF_CATEGORIZEPOSITION,
+    MOVEPROF_WALLRUNMOVE,
+    MOVEPROF_CHECKJUMPBUTTON,
+    MOVEPROF_TRIGGERTOUCH,
+
+    MOVEPROF_COUNT
+};
+
+// Per tick time, call and trace counts of the hot parts of the player movement. A section's time includes
+// the sections run inside of it, and a recursive call is only timed once.
+class CMovementProfiler
+{
+public:
+    CMovementProfiler();
+
+    bool IsEnabled() const { return m_bEnabled; }
+
+    // Starts a movement tick, storing the previous one. Trigger touches after the movement count towards its tick.
+    // Turning the profiler on or off only happens here, so a tick is never half profiled.
+    void BeginTick();
+
+    void EnterSection(int iSection);
+    void ExitSection(int iSection);
+    // An engine trace, counted for every section it happened in
+    void CountTrace();
+
+    void Reset();
+    void PrintReport();
+    // Writes every stored tick as CSV, one time/calls/traces column triple per section
+    bool Export(const char *pFileName);
+
+    static const char *GetSectionName(int iSection);
+
+private:
+    struct TickSample_t
+    {
+        float m_flTime[MOVEPROF_COUNT]; // Milliseconds
+        uint16 m_iCalls[MOVEPROF_COUNT];
+        uint16 m_iTraces[MOVEPROF_COUNT];
+    };
+
+    struct SectionSummary_t
+    {
+        float m_flAverage, m_flMedian, m_flP90, m_flP99, m_flMax;
+        float m_flCallsPerTick, m_flTracesPerTick;
+    };
+
+    void CommitTick();
+    void Summarize(int iSection, SectionSummary_t &summary) const;
+
+    bool m_bEnabled;
+
+    TickSample_t m_Samples[MOVEMENT_PROFILER_HISTORY];
+    int m_iNextSample;
+    int m_iSampleCount;
+
+    TickSample_t m_Current;
+    bool m_bTickOpen;
+    int m_iDepth[MOVEPROF_COUNT];
+    CFastTimer m_Timers[MOVEPROF_COUNT];
+};
+
+extern CMovementProfiler g_MovementProfiler;
+
+class CMovementProfileScope
+{
+public:
+    CMovementProfileScope(int iSection) : m_iSection(iSection), m_bActive(g_MovementProfiler.IsEnabled())
+    {
+        if (m_bActive)
+            g_MovementProfiler.EnterSection(m_iSection);
+    }
+
+    ~CMovementProfileScope()
+    {
+        if (m_bActive)
+            g_MovementProfiler.ExitSection(m_iSection);
+    }
+
+private:
+    int m_iSection;
+    bool m_bActive;
+};
+
+#ifdef MOVEMENT_PROFILER_ENABLED
+// Also shows up in VProf, under the player budget group
+#define MOVEMENT_PROFILE_SCOPE(section)                                                                                \
+    VPROF_BUDGET(CMovementProfiler::GetSectionName(section), VPROF_BUDGETGROUP_PLAYER);                               \
+    CMovementProfileScope movementProfileScope(section)
+#define MOVEMENT_PROFILE_BEGIN_TICK() g_MovementProfiler.BeginTick()
+#define MOVEMENT_PROFILE_TRACE()                                                                                       \
+    if (g_MovementProfiler.IsEnabled())                                                                                \
+    g_MovementProfiler.CountTrace()
+#else
+#define MOVEMENT_PROFILE_SCOPE(section) ((void)0)
+#define MOVEMENT_PROFILE_BEGIN_TICK() ((void)0)
+#define MOVEMENT_PROFILE_TRACE() ((void)0)
+#endif
@@ -61,7 +61,7 @@ void CMomentumPlayer::SetRampBoardVelocity(const Vector &vecVel)
     m_bSurfing = true;
 
 #ifdef GAME_DLL
-    IGameEvent *pEvent = gameeventmanager->CreateEvent("ramp_board");
+    IGameEvent *pEvent = m_bSimulatingMovement ? nullptr : gameeventmanager->CreateEvent("ramp_board");
     if (pEvent)
     {
         pEvent->SetFloat("speed", vecVel.Length());
@@ -75,7 +75,7 @@ void CMomentumPlayer::SetRampLeaveVelocity(const Vector &vecVel)
     m_bSurfing = false;
 
 #ifdef GAME_DLL
-    IGameEvent *pEvent = gameeventmanager->CreateEvent("ramp_leave");
+    IGameEvent *pEvent = m_bSimulatingMovement ? nullptr : gameeventmanager->CreateEvent("ramp_leave");
     if (pEvent)
     {
         pEvent->SetFloat("speed", vecVel.Length());
@@ -461,6 +461,11 @@ void CMomentumPlayer::PlayStepSound(const Vector &vecOrigin, surfacedata_t *psur
     if (m_bIsPowerSliding)
         return;
 
+#ifdef GAME_DLL
+    if (m_bSimulatingMovement)
+        return;
+#endif
+
     BaseClass::PlayStepSound(vecOrigin, psurface, fvol, force);
 }
 
@@ -470,6 +475,9 @@ void CMomentumPlayer::PlayAirjumpSound(const Vector &vecOrigin)
     // during prediction play footstep sounds only once
     if (prediction->InPrediction() && !prediction->IsFirstTimePredicted())
         return;
+#else
+    if (m_bSimulatingMovement)
+        return;
 #endif
 
     CRecipientFilter filter;
@@ -492,6 +500,9 @@ void CMomentumPlayer::PlayPowerSlideSound(const Vector &vecOrigin)
     // during prediction play footstep sounds only once
     if (prediction->InPrediction() && !prediction->IsFirstTimePredicted())
         return;
+#else
+    if (m_bSimulatingMovement)
+        return;
 #endif
 
     CRecipientFilter filter;
@@ -523,6 +534,9 @@ void CMomentumPlayer::PlayWallRunSound(const Vector &vecOrigin)
     // during prediction play footstep sounds only once
     if (prediction->InPrediction() && !prediction->IsFirstTimePredicted())
         return;
+#else
+    if (m_bSimulatingMovement)
+        return;
 #endif
 
     CRecipientFilter filter;
@@ -337,8 +337,10 @@ enum WallRunState
 #define ZONE_FOLDER "zones"
 #define RECORDING_PATH "replays"
 #define RECORDING_ONLINE_PATH "online"
+#define SAVELOC_PATH "savelocs"
 #define EXT_ZONE_FILE ".zon"
 #define EXT_RECORDING_FILE ".mrf"
+#define EXT_SAVELOC_FILE ".msl"
 
 // MOM_TODO: Replace this with the custom player model
 #define ENTITY_MODEL "models/player/player_shape_base.mdl"
@@ -355,6 +357,7 @@ enum WallRunState
 #define LOBBY_DATA_TYPING "isTyping"
 #define LOBBY_DATA_SPEC_TARGET "specTargetID"
 #define LOBBY_DATA_IS_SPEC "isSpectating"
+#define LOBBY_DATA_NET_VERSION "netVersion"
 // Use these with GetLobbyData
 #define LOBBY_DATA_OWNER "owner"
 #define LOBBY_DATA_OWNER_MAP "owner_map" // Note: this is used by public and roaming lobbies
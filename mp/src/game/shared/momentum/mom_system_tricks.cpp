@@ -74,6 +74,12 @@ CON_COMMAND_F(mom_tricks_tele_to_trick, "Teleports to a given trick start zone.
 
     g_pTrickSystem->TeleportToTrick(Q_atoi(args.Arg(1)));
 }
+
+CON_COMMAND_F(mom_tricks_benchmark, "Replays the recent trick zone touches (or every trick's zones if there are none) through the trick matching "
+                                    "and prints how long it took. Takes the number of passes as an optional parameter.\n", FCVAR_CLIENTCMD_CAN_EXECUTE)
+{
+    g_pTrickSystem->RunBenchmark(args.ArgC() > 1 ? Q_atoi(args.Arg(1)) : 100);
+}
 #endif
 
 TrickStepConstraint_MaxSpeed::TrickStepConstraint_MaxSpeed()
@@ -284,6 +290,63 @@ void CTrick::SaveToKV(KeyValues* pKvOut)
     pKvOut->AddSubKey(pKvSteps);
 }
 
+void CTrick::CompileSteps()
+{
+    m_vecStepTransitions.Purge();
+
+    const auto iStepCount = m_vecSteps.Count();
+    m_vecStepTransitions.EnsureCount(iStepCount);
+
+    for (int iCurrent = 0; iCurrent < iStepCount; iCurrent++)
+    {
+        auto &transitions = m_vecStepTransitions[iCurrent];
+
+        for (int iNext = iCurrent + 1; iNext < iStepCount; iNext++)
+        {
+            const auto pStep = m_vecSteps[iNext];
+            const auto iZoneID = pStep->GetTriggerID();
+
+            // The first step in order wins when a zone shows up more than once
+            bool bDuplicate = false;
+            FOR_EACH_VEC(transitions, i)
+            {
+                if (transitions[i].m_iZoneID == iZoneID)
+                {
+                    bDuplicate = true;
+                    break;
+                }
+            }
+
+            if (!bDuplicate)
+            {
+                StepTransition_t transition;
+                transition.m_iZoneID = iZoneID;
+                transition.m_iStep = iNext;
+                transitions.AddToTail(transition);
+            }
+
+            // Can't skip past a required step
+            if (!pStep->IsOptional())
+                break;
+        }
+    }
+}
+
+int CTrick::GetNextStep(int iCurrentStep, int iZoneID) const
+{
+    if (!m_vecStepTransitions.IsValidIndex(iCurrentStep))
+        return -1;
+
+    const auto &transitions = m_vecStepTransitions[iCurrentStep];
+    FOR_EACH_VEC(transitions, i)
+    {
+        if (transitions[i].m_iZoneID == iZoneID)
+            return transitions[i].m_iStep;
+    }
+
+    return -1;
+}
+
 bool CTrick::LoadFromKV(KeyValues* pKvIn)
 {
     m_iID = Q_atoi(pKvIn->GetName());
@@ -305,6 +368,8 @@ bool CTrick::LoadFromKV(KeyValues* pKvIn)
         m_vecSteps.AddToTail(pStep);
     }
 
+    CompileSteps();
+
     return true;
 }
 
@@ -317,57 +382,35 @@ CTrickAttempt::CTrickAttempt(CTrick *pTrick) : m_pTrick(pTrick)
 #ifdef GAME_DLL
 bool CTrickAttempt::ShouldContinue(CTriggerTrickZone *pZone, CMomentumPlayer *pPlayer)
 {
-    int iTotalSteps = m_pTrick->StepCount();
-    int iNextStep = m_iCurrentStep + 1;
+    // The transition table already steps over the optional zones in between
+    const int iNextStep = m_pTrick->GetNextStep(m_iCurrentStep, pZone->m_iID);
 
-    // Go through the trick stepping over optional zones to find our next step
-    for (auto pNextStep = m_pTrick->Step(iNextStep);
-         iNextStep < iTotalSteps && pNextStep;
-         pNextStep = m_pTrick->Step(++iNextStep))
-    {
-        // Early out if this trick's sequence is properly broken
-        if (pNextStep->GetTrigger() != pZone && !pNextStep->IsOptional())
-            return false;
-
-        // Here: the trigger is our zone, AND/OR we're optional
-
-        if (pNextStep->GetTrigger() == pZone)
-        {
-            if (pNextStep->IsOptional())
-            {
-                // Increase our step and continue
-                m_iCurrentStep = iNextStep;
-                return true;
-            }
-
-            // Otherwise we're necessary
+    // Early out if this trick's sequence is properly broken
+    if (iNextStep == -1)
+        return false;
 
-            // Do we pass the constraints?
-            if (!pNextStep->PlayerPassesConstraints(pPlayer))
-                return false;
+    const auto pNextStep = m_pTrick->Step(iNextStep);
+    if (pNextStep->IsOptional())
+    {
+        // Increase our step and continue
+        m_iCurrentStep = iNextStep;
+        return true;
+    }
 
-            // Trigger was our guy, wasn't optional, and we passed the constraints. Get outta here.
-            break;
-        }
+    // Otherwise we're necessary
 
-        // Otherwise the trigger isn't our guy, but we're still optional, so we continue the loop.
-        // We either find the next optional zone in the sequence, the next required zone,
-        // or you hit a no-no zone and your trick will crash and burn
-    }
+    // Do we pass the constraints?
+    if (!pNextStep->PlayerPassesConstraints(pPlayer))
+        return false;
 
     // Is the trick done?
-    if (iNextStep == iTotalSteps - 1)
+    if (iNextStep == m_pTrick->StepCount() - 1)
     {
         Complete(pPlayer);
         g_pTrickSystem->CompleteTrick(this);
         return false; // This removes the attempt automatically
     }
 
-    if (iNextStep >= iTotalSteps)
-    {
-        return false;
-    }
-
     m_iCurrentStep = iNextStep;
     return true;
 }
@@ -419,6 +462,7 @@ CTrickSystem::CTrickSystem() : CAutoGameSystem("CTrickSystem"
 #ifdef GAME_DLL
     m_iTrackedTrick = -1;
     m_bRecording = false;
+    m_iZoneEventLogHead = 0;
 #endif
 }
 
@@ -487,6 +531,10 @@ void CTrickSystem::LevelShutdownPreEntity()
     SaveTrickDataToFile();
     ClearTrickAttempts();
     SetTrackedTrick(-1);
+
+    m_vecTricksByStartZone.Purge();
+    m_vecZoneEventLog.Purge();
+    m_iZoneEventLogHead = 0;
 #endif
 
     m_vecRecordedZones.RemoveAll();
@@ -506,6 +554,8 @@ void CTrickSystem::OnTrickZoneEnter(CTriggerTrickZone *pZone, CMomentumPlayer *p
     }
     else
     {
+        LogZoneEvent(pZone, true);
+
         FOR_EACH_VEC_BACK(m_vecCurrentTrickAttempts, i)
         {
             const auto pTrickAttempt = m_vecCurrentTrickAttempts[i];
@@ -545,12 +595,17 @@ void CTrickSystem::OnTrickZoneExit(CTriggerTrickZone *pZone, CMomentumPlayer *pP
     }
     else
     {
-        FOR_EACH_LL(m_llTrickList, i)
+        LogZoneEvent(pZone, false);
+
+        if (m_vecTricksByStartZone.IsValidIndex(pZone->m_iID))
         {
-            const auto pTrick = m_llTrickList[i];
-            const auto pTrickFirstStep = pTrick->Step(0);
-            if (pTrickFirstStep->GetTrigger() == pZone && pTrickFirstStep->PlayerPassesConstraints(pPlayer))
+            const auto &vecStartingTricks = m_vecTricksByStartZone[pZone->m_iID];
+            FOR_EACH_VEC(vecStartingTricks, i)
             {
+                const auto pTrick = vecStartingTricks[i];
+                if (!pTrick->Step(0)->PlayerPassesConstraints(pPlayer))
+                    continue;
+
                 bool bFound = false;
                 FOR_EACH_VEC(m_vecCurrentTrickAttempts, trickItr)
                 {
@@ -585,6 +640,34 @@ void CTrickSystem::OnTrickZoneExit(CTriggerTrickZone *pZone, CMomentumPlayer *pP
     }
 }
 
+void CTrickSystem::IndexTrick(CTrick *pTrick)
+{
+    const auto pFirstStep = pTrick->Step(0);
+    if (!pFirstStep || pFirstStep->GetTriggerID() < 0)
+        return;
+
+    const auto iStartZone = pFirstStep->GetTriggerID();
+    m_vecTricksByStartZone.EnsureCount(iStartZone + 1);
+    m_vecTricksByStartZone[iStartZone].AddToTail(pTrick);
+}
+
+void CTrickSystem::LogZoneEvent(CTriggerTrickZone *pZone, bool bEnter)
+{
+    ZoneEvent_t event;
+    event.m_iZoneID = pZone->m_iID;
+    event.m_bEnter = bEnter;
+
+    if (m_vecZoneEventLog.Count() < TRICK_ZONE_EVENT_LOG_SIZE)
+    {
+        m_vecZoneEventLog.AddToTail(event);
+    }
+    else
+    {
+        m_vecZoneEventLog[m_iZoneEventLogHead] = event;
+        m_iZoneEventLogHead = (m_iZoneEventLogHead + 1) % TRICK_ZONE_EVENT_LOG_SIZE;
+    }
+}
+
 void CTrickSystem::CompleteTrick(CTrickAttempt* pAttempt)
 {
     // Woohoo!
@@ -768,6 +851,9 @@ void CTrickSystem::StopRecording(const char *pTrickName)
         pTrick->AddStep(pTrickStep);
     }
 
+    pTrick->CompileSteps();
+    IndexTrick(pTrick);
+
     m_bRecording = false;
 
     Warning("================= MOM_TODO: Needs to network to the client!\n");
@@ -997,6 +1083,162 @@ void CTrickSystem::GoToMapTeleport(int iTeleportNum)
 
     m_vecMapTeleports[iTeleportNum - 1]->m_pLoc->Teleport(CMomentumPlayer::GetLocalPlayer());
 }
+
+// The step walk tricks used before their steps were compiled, kept as the baseline for the benchmark.
+// Constraints are left out of both sides, there is no player to check them against.
+static int LinearNextStep(CTrick *pTrick, int iCurrentStep, int iZoneID)
+{
+    const int iTotalSteps = pTrick->StepCount();
+    for (int iNextStep = iCurrentStep + 1; iNextStep < iTotalSteps; iNextStep++)
+    {
+        const auto pNextStep = pTrick->Step(iNextStep);
+        if (pNextStep->GetTriggerID() == iZoneID)
+            return iNextStep;
+
+        if (!pNextStep->IsOptional())
+            return -1;
+    }
+
+    return -1;
+}
+
+struct BenchmarkAttempt_t
+{
+    CTrick *m_pTrick;
+    int m_iStep;
+};
+
+// Steps every attempt forward on a zone enter, returns how many tricks got completed
+static int BenchmarkZoneEnter(CUtlVector<BenchmarkAttempt_t> &attempts, int iZoneID, bool bCompiled)
+{
+    int iCompleted = 0;
+    FOR_EACH_VEC_BACK(attempts, i)
+    {
+        auto &attempt = attempts[i];
+        const int iNextStep = bCompiled ? attempt.m_pTrick->GetNextStep(attempt.m_iStep, iZoneID)
+                                        : LinearNextStep(attempt.m_pTrick, attempt.m_iStep, iZoneID);
+
+        if (iNextStep == -1)
+        {
+            attempts.Remove(i);
+            continue;
+        }
+
+        if (!attempt.m_pTrick->Step(iNextStep)->IsOptional() && iNextStep == attempt.m_pTrick->StepCount() - 1)
+        {
+            iCompleted++;
+            attempts.Remove(i);
+            continue;
+        }
+
+        attempt.m_iStep = iNextStep;
+    }
+
+    return iCompleted;
+}
+
+static void BenchmarkStartAttempt(CUtlVector<BenchmarkAttempt_t> &attempts, CTrick *pTrick)
+{
+    FOR_EACH_VEC(attempts, i)
+    {
+        if (attempts[i].m_pTrick == pTrick)
+            return;
+    }
+
+    BenchmarkAttempt_t attempt;
+    attempt.m_pTrick = pTrick;
+    attempt.m_iStep = 0;
+    attempts.AddToTail(attempt);
+}
+
+void CTrickSystem::RunBenchmark(int iPasses)
+{
+    if (m_llTrickList.Count() == 0)
+    {
+        Warning("No tricks loaded to benchmark!\n");
+        return;
+    }
+
+    iPasses = Max(iPasses, 1);
+
+    // Oldest first
+    CUtlVector<ZoneEvent_t> vecEvents;
+    vecEvents.EnsureCapacity(m_vecZoneEventLog.Count());
+    for (int i = 0; i < m_vecZoneEventLog.Count(); i++)
+    {
+        vecEvents.AddToTail(m_vecZoneEventLog[(m_iZoneEventLogHead + i) % m_vecZoneEventLog.Count()]);
+    }
+
+    // Nothing touched yet, run through every trick as if it was done perfectly
+    if (vecEvents.IsEmpty())
+    {
+        FOR_EACH_LL(m_llTrickList, i)
+        {
+            const auto pTrick = m_llTrickList[i];
+            for (int iStep = 0; iStep < pTrick->StepCount(); iStep++)
+            {
+                ZoneEvent_t event;
+                event.m_iZoneID = pTrick->Step(iStep)->GetTriggerID();
+                event.m_bEnter = iStep > 0;
+                vecEvents.AddToTail(event);
+            }
+        }
+    }
+
+    int iCompleted[2] = {0, 0};
+    double flElapsed[2] = {0.0, 0.0};
+    CUtlVector<BenchmarkAttempt_t> attempts;
+
+    for (int iMode = 0; iMode < 2; iMode++)
+    {
+        const bool bCompiled = iMode == 1;
+
+        const double flStart = Plat_FloatTime();
+        for (int iPass = 0; iPass < iPasses; iPass++)
+        {
+            attempts.RemoveAll();
+
+            FOR_EACH_VEC(vecEvents, i)
+            {
+                const auto &event = vecEvents[i];
+                if (event.m_bEnter)
+                {
+                    iCompleted[iMode] += BenchmarkZoneEnter(attempts, event.m_iZoneID, bCompiled);
+                }
+                else if (bCompiled)
+                {
+                    if (m_vecTricksByStartZone.IsValidIndex(event.m_iZoneID))
+                    {
+                        const auto &vecStartingTricks = m_vecTricksByStartZone[event.m_iZoneID];
+                        FOR_EACH_VEC(vecStartingTricks, trickItr)
+                        {
+                            BenchmarkStartAttempt(attempts, vecStartingTricks[trickItr]);
+                        }
+                    }
+                }
+                else
+                {
+                    FOR_EACH_LL(m_llTrickList, trickItr)
+                    {
+                        const auto pTrick = m_llTrickList[trickItr];
+                        const auto pFirstStep = pTrick->Step(0);
+                        if (pFirstStep && pFirstStep->GetTriggerID() == event.m_iZoneID)
+                            BenchmarkStartAttempt(attempts, pTrick);
+                    }
+                }
+            }
+        }
+        flElapsed[iMode] = Plat_FloatTime() - flStart;
+    }
+
+    const double flEvents = static_cast<double>(vecEvents.Count()) * iPasses;
+    Msg("Trick benchmark: %i tricks, %i zone touches, %i passes\n", m_llTrickList.Count(), vecEvents.Count(), iPasses);
+    Msg("  Linear:   %.3f ms (%.0f touches/s), %i completions\n", flElapsed[0] * 1000.0, flEvents / Max(flElapsed[0], 1e-9), iCompleted[0]);
+    Msg("  Compiled: %.3f ms (%.0f touches/s), %i completions\n", flElapsed[1] * 1000.0, flEvents / Max(flElapsed[1], 1e-9), iCompleted[1]);
+
+    if (iCompleted[0] != iCompleted[1])
+        Warning("Compiled trick matching disagrees with the linear walk!\n");
+}
 #endif
 
 void CTrickSystem::LoadTrickDataFromFile(KeyValues *pKvTrickData)
@@ -1067,6 +1309,9 @@ void CTrickSystem::LoadTrickDataFromFile(KeyValues *pKvTrickData)
         if (pNewTrick->LoadFromKV(pTrickKV))
         {
             m_llTrickList.AddToTail(pNewTrick);
+#ifdef GAME_DLL
+            IndexTrick(pNewTrick);
+#endif
         }
     }
 }
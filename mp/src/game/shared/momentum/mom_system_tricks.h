@@ -4,6 +4,9 @@
 
 #define TRICK_DATA_KEY "TrickData"
 
+// Number of trick zone touches kept around for mom_tricks_benchmark
+#define TRICK_ZONE_EVENT_LOG_SIZE 8192
+
 #ifdef CLIENT_DLL
 #define CMomentumPlayer C_MomentumPlayer
 #define CTriggerTrickZone C_TriggerTrickZone
@@ -78,6 +81,7 @@ public:
     void AddConstraint(ITrickStepConstraint *pConstraint) { m_vecConstraints.AddToTail(pConstraint); }
 
     void SetTriggerID(int iTriggerID) { m_iTrickZoneID = iTriggerID; }
+    int GetTriggerID() const { return m_iTrickZoneID; }
     CTriggerTrickZone *GetTrigger();
 
     void SetOptional(bool bOptional) { m_bOptional = bOptional; }
@@ -129,6 +133,11 @@ public:
 
     void AddStep(CTrickStep *pStep) { m_vecSteps.AddToTail(pStep); }
 
+    // Builds the step transition table, needs to be called once all of the steps are added
+    void CompileSteps();
+    // The step that entering the zone moves us to from iCurrentStep, or -1 if it breaks the trick
+    int GetNextStep(int iCurrentStep, int iZoneID) const;
+
     int GetDifficulty() const { return m_Info.m_iDifficulty; }
     void SetDifficulty(int iDifficulty) { m_Info.m_iDifficulty = iDifficulty; }
 
@@ -140,6 +149,14 @@ private:
     CTrickInfo m_Info;
 
     CUtlVector<CTrickStep*> m_vecSteps;
+
+    struct StepTransition_t
+    {
+        int m_iZoneID;
+        int m_iStep;
+    };
+    // Per step, the zones that can come next: every optional step up to and including the next required one
+    CUtlVector<CUtlVector<StepTransition_t>> m_vecStepTransitions;
 };
 
 class CTrickAttempt
@@ -228,6 +245,9 @@ public:
 
     void CreateMapTeleport(const char *pName);
     void GoToMapTeleport(int iTeleportNum);
+
+    // Replays the logged zone touches through the trick matching, old linear scan vs compiled tables
+    void RunBenchmark(int iPasses);
 #else
     void LevelInitPreEntity() override;
     void OnTrickDataReceived(KeyValues *pData);
@@ -240,6 +260,20 @@ private:
     int m_iTrackedTrick;
     bool m_bRecording;
     CUtlVector<CTrickAttempt*> m_vecCurrentTrickAttempts;
+
+    // Tricks by the ID of their start zone
+    CUtlVector<CUtlVector<CTrick*>> m_vecTricksByStartZone;
+    void IndexTrick(CTrick *pTrick);
+
+    struct ZoneEvent_t
+    {
+        int m_iZoneID;
+        bool m_bEnter;
+    };
+    // Ring buffer of the last TRICK_ZONE_EVENT_LOG_SIZE zone touches
+    CUtlVector<ZoneEvent_t> m_vecZoneEventLog;
+    int m_iZoneEventLogHead;
+    void LogZoneEvent(CTriggerTrickZone *pZone, bool bEnter);
 #else
     void InitializeTrickData(KeyValues *pKvTrickData);
 #endif
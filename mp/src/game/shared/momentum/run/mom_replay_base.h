@@ -3,6 +3,7 @@
 #include <momentum/util/serialization.h>
 #include "mom_replay_data.h"
 #include "run/run_stats.h"
+#include "util/mom_util.h"
 
 class CMomentumReplayGhostEntity;
 
@@ -33,7 +34,14 @@ class CMomReplayBase : public ISerializable
     virtual uint8 GetTrackNumber() { return m_rhHeader.m_iTrackNumber; }
     virtual uint8 GetZoneNumber() { return m_rhHeader.m_iZoneNumber; }
     virtual CMomentumReplayGhostEntity *GetRunEntity() { return m_pEntity; }
-    virtual const char *GetRunHash() { return m_pszRunHash; }
+    virtual const char *GetRunHash()
+    {
+        // Header-only loads defer hashing the file until something actually needs the hash
+        if (!m_pszRunHash[0] && m_pszFilePath[0])
+            MomUtil::GetFileHash(m_pszRunHash, sizeof(m_pszRunHash), m_pszFilePath, "MOD");
+
+        return m_pszRunHash;
+    }
     virtual const char *GetFilePath() { return m_pszFilePath; }
 
   public:
@@ -62,6 +70,45 @@ class CMomReplayBase : public ISerializable
     virtual CMomRunStats *CreateRunStats(uint8 zones) = 0;
     virtual void RemoveFrames(int num) = 0;
 
+  public:
+    // Samples the replay at a fractional tick, interpolating between the two frames around it.
+    // GetFrame is random access, so this costs two frame lookups wherever in the replay it is.
+    // Teleports are never interpolated across. Returns false if the tick is out of range.
+    virtual bool SampleFrame(float flTick, CReplayFrame &out)
+    {
+        const int32 frameCount = GetFrameCount();
+        if (frameCount <= 0 || flTick < 0.0f || flTick > float(frameCount - 1))
+            return false;
+
+        const int32 iFrom = static_cast<int32>(flTick);
+        const CReplayFrame *pFrom = GetFrame(iFrom);
+        if (!pFrom)
+            return false;
+
+        // Copy before looking up the next frame, streamed replays may decode another chunk for it
+        out = *pFrom;
+
+        const float flFrac = flTick - float(iFrom);
+        if (flFrac <= 0.0f || iFrom + 1 >= frameCount)
+            return true;
+
+        const CReplayFrame *pTo = GetFrame(iFrom + 1);
+        if (!pTo || pTo->Teleported())
+            return true;
+
+        Vector origin;
+        VectorLerp(out.PlayerOrigin(), pTo->PlayerOrigin(), flFrac, origin);
+
+        const QAngle from = out.EyeAngles(), to = pTo->EyeAngles();
+        QAngle eyes;
+        for (int i = 0; i < 3; i++)
+            eyes[i] = AngleNormalize(from[i] + AngleDiff(to[i], from[i]) * flFrac);
+
+        // Buttons (and the teleport flag) come from the frame we're on
+        out = CReplayFrame(eyes, origin, Lerp(flFrac, out.PlayerViewOffset(), pTo->PlayerViewOffset()), out.PlayerButtons(), false);
+        return true;
+    }
+
   protected:
     CReplayHeader m_rhHeader;
     CMomentumReplayGhostEntity *m_pEntity;
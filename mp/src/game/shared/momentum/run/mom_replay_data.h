@@ -8,6 +8,9 @@
 // Remember to update me if more button flags are added!!!
 #define IN_REPLAY_TELEPORTED            (1 << 27)
 
+// Bytes a frame takes when serialized one after another (V1 replays)
+#define REPLAY_FRAME_SERIALIZED_SIZE 32
+
 // A single frame of the replay.
 class CReplayFrame : public ISerializable
 {
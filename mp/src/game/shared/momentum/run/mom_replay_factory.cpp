@@ -2,6 +2,7 @@
 #include "mom_replay_factory.h"
 #include "filesystem.h"
 #include "mom_replay_versions.h"
+#include "mom_replay_layout.h"
 #ifdef GAME_DLL
 #include "momentum/mom_replay_entity.h"
 #endif
@@ -25,6 +26,8 @@ CMomReplayBase *CMomReplayFactory::CreateEmptyReplay(uint8 version)
     switch(version)
     {
         case 0: //Place 0 before the newest version's case, without a `break;`
+        case 3:
+            return new CMomReplayV3();
         case 1:
             return new CMomReplayV1();
             
@@ -39,6 +42,8 @@ CMomReplayBase *CMomReplayFactory::CreateReplay(uint8 version, CUtlBuffer &reade
     switch(version)
     {
         case 0:
+        case 3:
+            return new CMomReplayV3(reader, bFullLoad);
         case 1:
             return new CMomReplayV1(reader, bFullLoad);
         
@@ -56,7 +61,7 @@ CMomReplayBase* CMomReplayFactory::LoadReplayFile(const char *pFileName, bool bF
         Log("Loading a replay from '%s'...\n", pFileName);
 
     CUtlBuffer reader;
-    bool bFile = filesystem->ReadFile(pFileName, pPathID, reader);
+    bool bFile = filesystem->ReadFile(pFileName, pPathID, reader, bFullLoad ? 0 : REPLAY_HEADER_READ_SIZE);
 
     if (!bFile)
     {
@@ -83,27 +88,28 @@ CMomReplayBase* CMomReplayFactory::LoadReplayFromBuffer(CUtlBuffer &reader, bool
         return nullptr;
     }
 
-    uint32 magic = reader.GetUnsignedInt();
-
-    if (magic != REPLAY_MAGIC_LE && magic != REPLAY_MAGIC_BE)
+    uint8 version;
+    if (!ReplayLayout::ReadMagic(reader, version))
     {
         Warning("Not a replay file!\n");
         return nullptr;
     }
 
-    if (magic == REPLAY_MAGIC_BE)
-        reader.ActivateByteSwapping(true);
-
-    uint8 version = reader.GetUnsignedChar();
-
     if (bLogReplay)
         Log("Loading replay of version '%d'...\n", version);
 
     // MOM_TODO: Verify that replay parsing was successful.
     CMomReplayBase *toReturn = CreateReplay(version, reader, bFullLoad);
-    char hash[REPLAY_HASH_LENGTH + 1];
-    if (MomUtil::GetSHA1Hash(reader, hash, sizeof(hash)))
-        toReturn->SetRunHash(hash);
+    if (!toReturn)
+        return nullptr;
+
+    // Partial loads don't have the whole file to hash, GetRunHash() will hash it when needed
+    if (bFullLoad)
+    {
+        char hash[REPLAY_HASH_LENGTH + 1];
+        if (MomUtil::GetSHA1Hash(reader, hash, sizeof(hash)))
+            toReturn->SetRunHash(hash);
+    }
 
     if (bLogReplay)
         Log("Successfully loaded replay.\n");
@@ -146,6 +152,9 @@ AsyncReplayStatus_t CMomReplayFactory::AsyncLoadReplaysByFilename(const CUtlStri
 
     FOR_EACH_VEC(filenames, i)
     {
+        // Only the header and stats are needed here, clamp the read to them (or the file itself if smaller)
+        const int fileSize = filesystem->Size(filenames[i], pathID);
+        internalRequest.vecFSRequests[i].nBytes = fileSize > 0 ? min(fileSize, REPLAY_HEADER_READ_SIZE) : 0;
         internalRequest.vecFSRequests[i].pszFilename = filenames[i];
         internalRequest.vecFSRequests[i].pfnCallback = FilesystemCallbackForward;
         internalRequest.vecFSRequests[i].pszPathID = pathID;
@@ -4,6 +4,10 @@
 #define REPLAY_MAGIC_BE 0x4D4F4D52
 #define REPLAY_HASH_LENGTH 40
 
+// Upper bound on everything in front of the frame data (magic, version, V3 frame info, header, run stats),
+// used to read only the start of a replay file when frames aren't needed
+#define REPLAY_HEADER_READ_SIZE (4 + 1 + 8 + (MAX_MAP_NAME_SAVE + 41 + MAX_PLAYER_NAME_LENGTH + 20 + 4 + 4 + 20 + 4 + 4 + 1 + 1) + (1 + 1 + (MAX_ZONES + 1) * 14 * 4))
+
 class CMomReplayBase;
 
 #ifdef CLIENT_DLL
@@ -37,6 +41,8 @@ class CMomReplayFactory
     CMomReplayBase *CreateReplay(uint8 version, CUtlBuffer &reader, bool bFullLoad);
 
     // Returns a replay file and constructs a versioned replay object.
+    // If bFullLoad is false, only the header and run stats are read from disk and the run hash
+    // is computed lazily on the first GetRunHash() call.
     CMomReplayBase *LoadReplayFile(const char *pFileName, bool bFullLoad = true, const char *pPathID = "MOD");
     CMomReplayBase *LoadReplayFromBuffer(CUtlBuffer &reader, bool bFullLoad = true);
 
@@ -0,0 +1,364 @@
+#include "cbase.h"
+#include "mom_replay_index.h"
+#include "filesystem.h"
+#include "mom_replay_base.h"
+#include "mom_replay_factory.h"
+#include "mom_shareddefs.h"
+
+#include "tier0/memdbgon.h"
+
+// Sort by map, track, zone, flags, tickrate, then time. GetBestTime relies on the time being last.
+bool CReplayIndexLess::Less(const ReplayIndexEntry_t *lhs, const ReplayIndexEntry_t *rhs, void *) const
+{
+    const int mapCmp = Q_stricmp(lhs->m_szMapName, rhs->m_szMapName);
+    if (mapCmp != 0)
+        return mapCmp < 0;
+    if (lhs->m_iTrackNumber != rhs->m_iTrackNumber)
+        return lhs->m_iTrackNumber < rhs->m_iTrackNumber;
+    if (lhs->m_iZoneNumber != rhs->m_iZoneNumber)
+        return lhs->m_iZoneNumber < rhs->m_iZoneNumber;
+    if (lhs->m_iRunFlags != rhs->m_iRunFlags)
+        return lhs->m_iRunFlags < rhs->m_iRunFlags;
+    if (lhs->m_fTickInterval != rhs->m_fTickInterval)
+        return lhs->m_fTickInterval < rhs->m_fTickInterval;
+    if (lhs->GetRunTime() != rhs->GetRunTime())
+        return lhs->GetRunTime() < rhs->GetRunTime();
+
+    // Keep duplicate times distinct so lookups by entry find the right one
+    return Q_stricmp(lhs->m_szFilePath, rhs->m_szFilePath) < 0;
+}
+
+static void FillEntryFromReplay(ReplayIndexEntry_t *pEntry, CMomReplayBase *pReplay, const char *pFilePath)
+{
+    Q_strncpy(pEntry->m_szMapName, pReplay->GetMapName(), sizeof(pEntry->m_szMapName));
+    Q_strncpy(pEntry->m_szFilePath, pFilePath, sizeof(pEntry->m_szFilePath));
+    Q_FixSlashes(pEntry->m_szFilePath, '/');
+    Q_strncpy(pEntry->m_szPlayerName, pReplay->GetPlayerName(), sizeof(pEntry->m_szPlayerName));
+    pEntry->m_ulSteamID = pReplay->GetPlayerSteamID();
+    pEntry->m_iFileTime = filesystem->GetFileTime(pFilePath, "MOD");
+    pEntry->m_iTrackNumber = pReplay->GetTrackNumber();
+    pEntry->m_iZoneNumber = pReplay->GetZoneNumber();
+    pEntry->m_fTickInterval = pReplay->GetTickInterval();
+    pEntry->m_iRunFlags = pReplay->GetRunFlags();
+    pEntry->m_iStartTick = pReplay->GetStartTick();
+    pEntry->m_iStopTick = pReplay->GetStopTick();
+    pEntry->m_iRunDate = pReplay->GetRunDate();
+}
+
+CMomReplayIndex::CMomReplayIndex() : CAutoGameSystem("CMomReplayIndex"), m_bLoaded(false), m_bDirty(false)
+{
+}
+
+CMomReplayIndex::~CMomReplayIndex()
+{
+    Clear();
+}
+
+void CMomReplayIndex::AddReplay(CMomReplayBase *pReplay, const char *pFilePath)
+{
+    if (!pReplay || !pFilePath)
+        return;
+
+    EnsureLoaded();
+
+    const int existing = FindByPath(pFilePath);
+    if (existing != -1)
+        RemoveEntry(existing);
+
+    const auto pEntry = new ReplayIndexEntry_t;
+    FillEntryFromReplay(pEntry, pReplay, pFilePath);
+    InsertEntry(pEntry);
+
+    m_bDirty = true;
+}
+
+bool CMomReplayIndex::AddReplayFile(const char *pFilePath)
+{
+    const auto pReplay = g_ReplayFactory.LoadReplayFile(pFilePath, false);
+    if (!pReplay)
+        return false;
+
+    AddReplay(pReplay, pFilePath);
+    delete pReplay;
+    return true;
+}
+
+void CMomReplayIndex::RemoveReplay(const char *pFilePath)
+{
+    EnsureLoaded();
+
+    const int existing = FindByPath(pFilePath);
+    if (existing == -1)
+        return;
+
+    RemoveEntry(existing);
+    m_bDirty = true;
+}
+
+const ReplayIndexEntry_t *CMomReplayIndex::GetBestTime(const char *pMapName, float tickInterval, int trackNumber, uint32 flags)
+{
+    if (!pMapName)
+        return nullptr;
+
+    RefreshMap(pMapName);
+
+    // The fastest run sorts first in its group, so the first entry not less than a zero-time key is the best one.
+    // Start the search below the tick interval so intervals a bit under it within the tolerance are found too.
+    ReplayIndexEntry_t key;
+    V_memset(&key, 0, sizeof(key));
+    Q_strncpy(key.m_szMapName, pMapName, sizeof(key.m_szMapName));
+    key.m_iTrackNumber = trackNumber;
+    key.m_iRunFlags = flags;
+    key.m_fTickInterval = tickInterval - REPLAY_INDEX_TICK_INTERVAL_TOLERANCE;
+
+    const ReplayIndexEntry_t *pBest = nullptr;
+    for (int i = m_vecEntries.FindLess(&key) + 1; i < m_vecEntries.Count(); ++i)
+    {
+        const auto pEntry = m_vecEntries[i];
+        if (Q_stricmp(pEntry->m_szMapName, pMapName) || pEntry->m_iTrackNumber != trackNumber || pEntry->m_iZoneNumber != 0 ||
+            pEntry->m_iRunFlags != flags || pEntry->m_fTickInterval > tickInterval + REPLAY_INDEX_TICK_INTERVAL_TOLERANCE)
+            break;
+
+        if (!pBest || pEntry->GetRunTime() < pBest->GetRunTime())
+            pBest = pEntry;
+
+        // The rest of this tick interval's runs are slower, skip to the next interval
+        key.m_fTickInterval = pEntry->m_fTickInterval;
+        key.m_iStopTick = UINT32_MAX;
+        i = m_vecEntries.FindLess(&key);
+    }
+
+    return pBest;
+}
+
+void CMomReplayIndex::GetRunsForMap(const char *pMapName, CUtlVector<const ReplayIndexEntry_t *> &vecOut)
+{
+    if (!pMapName)
+        return;
+
+    RefreshMap(pMapName);
+
+    ReplayIndexEntry_t key;
+    V_memset(&key, 0, sizeof(key));
+    Q_strncpy(key.m_szMapName, pMapName, sizeof(key.m_szMapName));
+    key.m_fTickInterval = -FLT_MAX;
+
+    for (int i = m_vecEntries.FindLess(&key) + 1; i < m_vecEntries.Count(); ++i)
+    {
+        if (Q_stricmp(m_vecEntries[i]->m_szMapName, pMapName))
+            break;
+
+        vecOut.AddToTail(m_vecEntries[i]);
+    }
+}
+
+CMomReplayBase *CMomReplayIndex::CreateReplayFromEntry(const ReplayIndexEntry_t &entry)
+{
+    const auto pReplay = g_ReplayFactory.CreateEmptyReplay(0);
+    if (!pReplay)
+        return nullptr;
+
+    pReplay->SetMapName(entry.m_szMapName);
+    pReplay->SetPlayerName(entry.m_szPlayerName);
+    pReplay->SetPlayerSteamID(entry.m_ulSteamID);
+    pReplay->SetTrackNumber(entry.m_iTrackNumber);
+    pReplay->SetZoneNumber(entry.m_iZoneNumber);
+    pReplay->SetTickInterval(entry.m_fTickInterval);
+    pReplay->SetRunFlags(entry.m_iRunFlags);
+    pReplay->SetStartTick(entry.m_iStartTick);
+    pReplay->SetStopTick(entry.m_iStopTick);
+    pReplay->SetRunDate(entry.m_iRunDate);
+    pReplay->SetFilePath(entry.m_szFilePath);
+    return pReplay;
+}
+
+void CMomReplayIndex::Flush()
+{
+    if (!m_bDirty)
+        return;
+
+    m_bDirty = false;
+#ifdef CLIENT_DLL
+    Save();
+#endif
+}
+
+void CMomReplayIndex::EnsureLoaded()
+{
+    // Only the client writes the file, so neither side has to reread it
+    if (m_bLoaded)
+        return;
+
+    Load();
+    m_bLoaded = true;
+}
+
+void CMomReplayIndex::RefreshMap(const char *pMapName)
+{
+    EnsureLoaded();
+
+#ifdef CLIENT_DLL
+    // The client hears about every replay the server stores, so one scan per map is enough.
+    // The server doesn't see the client deleting replays, so it always rescans.
+    if (m_mapRefreshedMaps.Defined(pMapName) && m_mapRefreshedMaps[pMapName])
+        return;
+
+    m_mapRefreshedMaps[pMapName] = true;
+#endif
+
+    char path[MAX_PATH];
+    Q_snprintf(path, MAX_PATH, "%s/%s-*%s", RECORDING_PATH, pMapName, EXT_RECORDING_FILE);
+    V_FixSlashes(path);
+
+    CUtlStringMap<bool> mapSeen;
+    bool bChanged = false;
+
+    // Only files that are new or were modified since they were indexed get their header read
+    FileFindHandle_t found;
+    const char *pFoundFile = filesystem->FindFirstEx(path, "MOD", &found);
+    while (pFoundFile)
+    {
+        char replayPath[MAX_PATH];
+        V_ComposeFileName(RECORDING_PATH, pFoundFile, replayPath, MAX_PATH);
+        Q_FixSlashes(replayPath, '/');
+        mapSeen[replayPath] = true;
+
+        const int existing = FindByPath(replayPath);
+        if (existing == -1 || m_vecEntries[existing]->m_iFileTime != filesystem->GetFileTime(replayPath, "MOD"))
+        {
+            const auto pReplay = g_ReplayFactory.LoadReplayFile(replayPath, false);
+            if (pReplay)
+            {
+                if (existing != -1)
+                    RemoveEntry(existing);
+
+                const auto pEntry = new ReplayIndexEntry_t;
+                FillEntryFromReplay(pEntry, pReplay, replayPath);
+                InsertEntry(pEntry);
+                delete pReplay;
+                bChanged = true;
+            }
+        }
+
+        pFoundFile = filesystem->FindNext(found);
+    }
+    filesystem->FindClose(found);
+
+    // Drop anything that was deleted from disk behind our back
+    for (int i = m_vecEntries.Count() - 1; i >= 0; --i)
+    {
+        if (!Q_stricmp(m_vecEntries[i]->m_szMapName, pMapName) && !mapSeen.Defined(m_vecEntries[i]->m_szFilePath))
+        {
+            RemoveEntry(i);
+            bChanged = true;
+        }
+    }
+
+    if (bChanged)
+        m_bDirty = true;
+}
+
+bool CMomReplayIndex::Load()
+{
+    CUtlBuffer buf;
+    if (!filesystem->ReadFile(REPLAY_INDEX_FILE, "MOD", buf))
+        return false;
+
+    if (buf.GetUnsignedInt() != REPLAY_INDEX_MAGIC || buf.GetUnsignedChar() != REPLAY_INDEX_VERSION)
+    {
+        Warning("Replay index is outdated or corrupt, it will be rebuilt.\n");
+        return false;
+    }
+
+    const int count = buf.GetInt();
+    for (int i = 0; i < count && buf.IsValid(); ++i)
+    {
+        const auto pEntry = new ReplayIndexEntry_t;
+        buf.GetStringManualCharCount(pEntry->m_szMapName, sizeof(pEntry->m_szMapName));
+        buf.GetStringManualCharCount(pEntry->m_szFilePath, sizeof(pEntry->m_szFilePath));
+        buf.GetStringManualCharCount(pEntry->m_szPlayerName, sizeof(pEntry->m_szPlayerName));
+        pEntry->m_ulSteamID = static_cast<uint64>(buf.GetInt64());
+        pEntry->m_iFileTime = buf.GetInt64();
+        pEntry->m_iTrackNumber = buf.GetUnsignedChar();
+        pEntry->m_iZoneNumber = buf.GetUnsignedChar();
+        pEntry->m_fTickInterval = buf.GetFloat();
+        pEntry->m_iRunFlags = buf.GetUnsignedInt();
+        pEntry->m_iStartTick = buf.GetUnsignedInt();
+        pEntry->m_iStopTick = buf.GetUnsignedInt();
+        pEntry->m_iRunDate = buf.GetInt64();
+
+        if (!buf.IsValid())
+        {
+            delete pEntry;
+            break;
+        }
+
+        InsertEntry(pEntry);
+    }
+
+    return true;
+}
+
+void CMomReplayIndex::Save()
+{
+    CUtlBuffer buf;
+    buf.PutUnsignedInt(REPLAY_INDEX_MAGIC);
+    buf.PutUnsignedChar(REPLAY_INDEX_VERSION);
+    buf.PutInt(m_vecEntries.Count());
+
+    FOR_EACH_VEC(m_vecEntries, i)
+    {
+        const auto pEntry = m_vecEntries[i];
+        buf.PutString(pEntry->m_szMapName);
+        buf.PutString(pEntry->m_szFilePath);
+        buf.PutString(pEntry->m_szPlayerName);
+        buf.PutUint64(pEntry->m_ulSteamID);
+        buf.PutInt64(pEntry->m_iFileTime);
+        buf.PutUnsignedChar(pEntry->m_iTrackNumber);
+        buf.PutUnsignedChar(pEntry->m_iZoneNumber);
+        buf.PutFloat(pEntry->m_fTickInterval);
+        buf.PutUnsignedInt(pEntry->m_iRunFlags);
+        buf.PutUnsignedInt(pEntry->m_iStartTick);
+        buf.PutUnsignedInt(pEntry->m_iStopTick);
+        buf.PutInt64(pEntry->m_iRunDate);
+    }
+
+    if (!filesystem->WriteFile(REPLAY_INDEX_FILE, "MOD", buf))
+        Warning("Failed to write the replay index!\n");
+}
+
+void CMomReplayIndex::Clear()
+{
+    m_vecEntries.PurgeAndDeleteElements();
+    m_mapByPath.Purge();
+    m_mapRefreshedMaps.Purge();
+}
+
+int CMomReplayIndex::FindByPath(const char *pFilePath) const
+{
+    char path[MAX_PATH];
+    Q_strncpy(path, pFilePath, sizeof(path));
+    Q_FixSlashes(path, '/');
+
+    const UtlSymId_t sym = m_mapByPath.Find(path);
+    if (sym == m_mapByPath.InvalidIndex() || !m_mapByPath[sym])
+        return -1;
+
+    return m_vecEntries.Find(m_mapByPath[sym]);
+}
+
+void CMomReplayIndex::InsertEntry(ReplayIndexEntry_t *pEntry)
+{
+    m_vecEntries.Insert(pEntry);
+    m_mapByPath[pEntry->m_szFilePath] = pEntry;
+}
+
+void CMomReplayIndex::RemoveEntry(int sortedIndex)
+{
+    const auto pEntry = m_vecEntries[sortedIndex];
+    m_mapByPath[pEntry->m_szFilePath] = nullptr;
+    m_vecEntries.Remove(sortedIndex);
+    delete pEntry;
+}
+
+CMomReplayIndex g_ReplayIndex;
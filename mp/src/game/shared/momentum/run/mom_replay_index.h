@@ -0,0 +1,91 @@
+#pragma once
+
+#include "tier1/UtlSortVector.h"
+#include "tier1/UtlStringMap.h"
+
+class CMomReplayBase;
+
+#define REPLAY_INDEX_MAGIC 0x58494D52 // "RMIX"
+#define REPLAY_INDEX_VERSION 2
+#define REPLAY_INDEX_FILE RECORDING_PATH "/replayindex.dat"
+// Tick intervals this close together are the same tickrate, for both sorting lookups and matching
+#define REPLAY_INDEX_TICK_INTERVAL_TOLERANCE 0.0001f
+
+// Everything needed to rank and list a local replay without opening it
+struct ReplayIndexEntry_t
+{
+    char m_szMapName[MAX_MAP_NAME_SAVE];
+    char m_szFilePath[MAX_PATH];
+    char m_szPlayerName[MAX_PLAYER_NAME_LENGTH];
+    uint64 m_ulSteamID;
+    long m_iFileTime;       // Modification time of the replay when it was indexed
+    uint8 m_iTrackNumber;
+    uint8 m_iZoneNumber;
+    float m_fTickInterval;
+    uint32 m_iRunFlags;
+    uint32 m_iStartTick;
+    uint32 m_iStopTick;
+    time_t m_iRunDate;
+
+    float GetRunTime() const { return m_fTickInterval * float(m_iStopTick - m_iStartTick); }
+};
+
+class CReplayIndexLess
+{
+  public:
+    bool Less(const ReplayIndexEntry_t *lhs, const ReplayIndexEntry_t *rhs, void *) const;
+};
+
+// Persistent index of the local replays in RECORDING_PATH, kept in sync by the replay system when
+// storing replays and incrementally refreshed (by file time) when a map is queried.
+// Entries are sorted by map, track, zone, flags, tickrate and then time, so best-time and per-map
+// lookups are binary searches instead of directory scans that read every file.
+// The client owns the index file and writes it out at level shutdown. The server only reads it once
+// and keeps its changes in memory, rescanning the map's replays on every query instead.
+class CMomReplayIndex : public CAutoGameSystem
+{
+  public:
+    CMomReplayIndex();
+    ~CMomReplayIndex();
+
+    void LevelShutdownPostEntity() OVERRIDE { Flush(); }
+    void Shutdown() OVERRIDE { Flush(); }
+
+    // Adds (or updates) the entry for a replay that was just written to pFilePath
+    void AddReplay(CMomReplayBase *pReplay, const char *pFilePath);
+    // Reads the header of a replay file on disk and indexes it
+    bool AddReplayFile(const char *pFilePath);
+    void RemoveReplay(const char *pFilePath);
+
+    // Returns nullptr if there is no matching run
+    const ReplayIndexEntry_t *GetBestTime(const char *pMapName, float tickInterval, int trackNumber, uint32 flags);
+    // Fills vecOut with every run of the given map, fastest first within each track/flags/tickrate group
+    void GetRunsForMap(const char *pMapName, CUtlVector<const ReplayIndexEntry_t *> &vecOut);
+
+    // Creates a header-only replay object from an index entry. It has no run stats and no frames, and the run hash
+    // is only computed from the file if something asks for it. Must be deleted by the caller.
+    CMomReplayBase *CreateReplayFromEntry(const ReplayIndexEntry_t &entry);
+
+    // Writes the index out if it changed (client only)
+    void Flush();
+
+  private:
+    void EnsureLoaded();
+    void RefreshMap(const char *pMapName);
+    bool Load();
+    void Save();
+    void Clear();
+
+    int FindByPath(const char *pFilePath) const;
+    void InsertEntry(ReplayIndexEntry_t *pEntry);
+    void RemoveEntry(int sortedIndex);
+
+    CUtlSortVector<ReplayIndexEntry_t *, CReplayIndexLess> m_vecEntries;
+    CUtlStringMap<ReplayIndexEntry_t *> m_mapByPath;
+    CUtlStringMap<bool> m_mapRefreshedMaps;
+
+    bool m_bLoaded;
+    bool m_bDirty;
+};
+
+extern CMomReplayIndex g_ReplayIndex;
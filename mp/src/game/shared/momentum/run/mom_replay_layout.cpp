@@ -0,0 +1,54 @@
+#include "cbase.h"
+#include "mom_replay_layout.h"
+#include "mom_replay_factory.h"
+
+#include "tier0/memdbgon.h"
+
+bool ReplayLayout::ReadMagic(CUtlBuffer &reader, uint8 &version)
+{
+    const uint32 magic = reader.GetUnsignedInt();
+    if (magic != REPLAY_MAGIC_LE && magic != REPLAY_MAGIC_BE)
+        return false;
+
+    if (magic == REPLAY_MAGIC_BE)
+        reader.ActivateByteSwapping(true);
+
+    version = reader.GetUnsignedChar();
+    return reader.IsValid();
+}
+
+void ReplayLayout::ReadFrameInfo(CUtlBuffer &reader, FrameInfo_t &info)
+{
+    info.m_iFrameCount = reader.GetInt();
+    info.m_iFrameDataOffset = reader.GetUnsignedInt();
+}
+
+bool ReplayLayout::ReadFramesV1(CUtlBuffer &reader, CUtlVector<CReplayFrame> &frames)
+{
+    const int32 frameCount = reader.GetInt();
+    if (!reader.IsValid() || frameCount <= 0 || int64(frameCount) * REPLAY_FRAME_SERIALIZED_SIZE > reader.GetBytesRemaining())
+        return false;
+
+    frames.EnsureCapacity(frames.Count() + frameCount);
+    for (int32 i = 0; i < frameCount; ++i)
+        frames.AddToTail(CReplayFrame(reader));
+
+    return reader.IsValid();
+}
+
+bool ReplayLayout::LoadFramesV3(CUtlBuffer &reader, const FrameInfo_t &info, CReplayFrameStream &stream)
+{
+    // Anything between the stats and the frames is not ours to read
+    if (info.m_iFrameDataOffset < static_cast<uint32>(reader.TellGet()) || info.m_iFrameDataOffset > static_cast<uint32>(reader.TellPut()))
+        return false;
+
+    reader.SeekGet(CUtlBuffer::SEEK_HEAD, info.m_iFrameDataOffset);
+
+    if (!stream.Load(reader) || stream.GetFrameCount() != info.m_iFrameCount)
+    {
+        stream.Purge();
+        return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include "mom_replay_data.h"
+#include "mom_replay_stream.h"
+
+// The version-specific parts of the replay file layout, read the same way by the game's replay
+// versions and by replaytool. The header (CReplayHeader) and run stats in between are read by the caller.
+//   V1: magic | version | header | stats | frame count | frames
+//   V3: magic | version | frame count | frame data offset | header | stats | ... | frame section
+namespace ReplayLayout
+{
+    struct FrameInfo_t
+    {
+        int32 m_iFrameCount;
+        uint32 m_iFrameDataOffset; // Absolute offset in the file of the frame section
+    };
+
+    // Reads the magic and version. Big-endian replays turn on byte swapping for the rest of the buffer.
+    // Returns false if the buffer isn't a replay.
+    bool ReadMagic(CUtlBuffer &reader, uint8 &version);
+
+    // V3 only, what comes right after the version
+    void ReadFrameInfo(CUtlBuffer &reader, FrameInfo_t &info);
+
+    // V1, after the stats. The frame count is checked against what's left of the buffer before reserving anything.
+    bool ReadFramesV1(CUtlBuffer &reader, CUtlVector<CReplayFrame> &frames);
+
+    // V3, after the stats. Seeks to the frame section and loads it, it has to hold as many frames as the info says.
+    bool LoadFramesV3(CUtlBuffer &reader, const FrameInfo_t &info, CReplayFrameStream &stream);
+}
@@ -0,0 +1,296 @@
+#include "cbase.h"
+#include "mom_replay_stream.h"
+
+#include "tier1/snappy.h"
+
+#include "tier0/memdbgon.h"
+
+// Frame quantization, in steps per unit/degree
+#define REPLAY_STREAM_ANGLE_SCALE 1024.0f
+#define REPLAY_STREAM_ORIGIN_SCALE 128.0f
+#define REPLAY_STREAM_VIEWOFFSET_SCALE 128.0f
+
+// Number of quantized components stored per frame: 3 angles, 3 origin, 1 view offset
+#define REPLAY_STREAM_COMPONENTS 7
+
+static void PutVarUInt(CUtlBuffer &out, uint32 value)
+{
+    while (value >= 0x80)
+    {
+        out.PutUnsignedChar(static_cast<uint8>(value | 0x80));
+        value >>= 7;
+    }
+    out.PutUnsignedChar(static_cast<uint8>(value));
+}
+
+static bool GetVarUInt(const uint8 *&pCur, const uint8 *pEnd, uint32 &value)
+{
+    value = 0;
+    for (int shift = 0; shift < 35; shift += 7)
+    {
+        if (pCur >= pEnd)
+            return false;
+
+        const uint8 byte = *pCur++;
+        value |= static_cast<uint32>(byte & 0x7F) << shift;
+        if (!(byte & 0x80))
+            return true;
+    }
+
+    return false;
+}
+
+static inline uint32 ZigZagEncode(int32 value) { return (static_cast<uint32>(value) << 1) ^ static_cast<uint32>(value >> 31); }
+static inline int32 ZigZagDecode(uint32 value) { return static_cast<int32>(value >> 1) ^ -static_cast<int32>(value & 1); }
+
+static void QuantizeFrame(const CReplayFrame &frame, int32 *pOut)
+{
+    const QAngle eye = frame.EyeAngles();
+    const Vector origin = frame.PlayerOrigin();
+
+    pOut[0] = RoundFloatToInt(eye.x * REPLAY_STREAM_ANGLE_SCALE);
+    pOut[1] = RoundFloatToInt(eye.y * REPLAY_STREAM_ANGLE_SCALE);
+    pOut[2] = RoundFloatToInt(eye.z * REPLAY_STREAM_ANGLE_SCALE);
+    pOut[3] = RoundFloatToInt(origin.x * REPLAY_STREAM_ORIGIN_SCALE);
+    pOut[4] = RoundFloatToInt(origin.y * REPLAY_STREAM_ORIGIN_SCALE);
+    pOut[5] = RoundFloatToInt(origin.z * REPLAY_STREAM_ORIGIN_SCALE);
+    pOut[6] = RoundFloatToInt(frame.PlayerViewOffset() * REPLAY_STREAM_VIEWOFFSET_SCALE);
+}
+
+CReplayFrameStream::CReplayFrameStream() : m_iFrameCount(0), m_iChunkFrames(0), m_iUseCounter(0), m_iLastSlot(0)
+{
+    for (int i = 0; i < REPLAY_STREAM_CACHED_CHUNKS; ++i)
+    {
+        m_DecodedChunks[i].m_iChunk = -1;
+        m_DecodedChunks[i].m_iLastUse = 0;
+    }
+}
+
+void CReplayFrameStream::Encode(const CUtlVector<CReplayFrame> &frames, CUtlBuffer &writer)
+{
+    const int32 frameCount = frames.Count();
+    const int32 chunkCount = (frameCount + REPLAY_STREAM_CHUNK_FRAMES - 1) / REPLAY_STREAM_CHUNK_FRAMES;
+
+    writer.PutInt(frameCount);
+    writer.PutUnsignedInt(REPLAY_STREAM_CHUNK_FRAMES);
+    writer.PutInt(chunkCount);
+
+    // The offset table gets patched once the chunks are compressed
+    const int tablePos = writer.TellPut();
+    for (int32 i = 0; i <= chunkCount; ++i)
+        writer.PutUnsignedInt(0);
+
+    const int dataPos = writer.TellPut();
+
+    CUtlBuffer deltas;
+    CUtlMemory<char> compressed;
+    CUtlVector<uint32> offsets;
+    offsets.EnsureCapacity(chunkCount + 1);
+
+    for (int32 chunk = 0; chunk < chunkCount; ++chunk)
+    {
+        offsets.AddToTail(writer.TellPut() - dataPos);
+
+        // Deltas restart from zero at every chunk, making its first frame a keyframe
+        int32 prev[REPLAY_STREAM_COMPONENTS] = {0};
+        int prevButtons = 0;
+
+        deltas.Clear();
+
+        const int32 start = chunk * REPLAY_STREAM_CHUNK_FRAMES;
+        const int32 end = min(start + REPLAY_STREAM_CHUNK_FRAMES, frameCount);
+        for (int32 i = start; i < end; ++i)
+        {
+            const CReplayFrame &frame = frames[i];
+
+            int32 cur[REPLAY_STREAM_COMPONENTS];
+            QuantizeFrame(frame, cur);
+
+            for (int c = 0; c < REPLAY_STREAM_COMPONENTS; ++c)
+            {
+                PutVarUInt(deltas, ZigZagEncode(cur[c] - prev[c]));
+                prev[c] = cur[c];
+            }
+
+            // Buttons rarely change, so store which ones were pressed or released this tick
+            PutVarUInt(deltas, static_cast<uint32>(frame.PlayerButtons() ^ prevButtons));
+            prevButtons = frame.PlayerButtons();
+        }
+
+        compressed.EnsureCapacity(snappy::MaxCompressedLength(deltas.TellPut()));
+
+        size_t compressedSize = 0;
+        snappy::RawCompress(static_cast<const char *>(deltas.Base()), deltas.TellPut(), compressed.Base(), &compressedSize);
+        writer.Put(compressed.Base(), compressedSize);
+    }
+
+    offsets.AddToTail(writer.TellPut() - dataPos);
+
+    const int endPos = writer.TellPut();
+    writer.SeekPut(CUtlBuffer::SEEK_HEAD, tablePos);
+    FOR_EACH_VEC(offsets, i)
+        writer.PutUnsignedInt(offsets[i]);
+    writer.SeekPut(CUtlBuffer::SEEK_HEAD, endPos);
+}
+
+bool CReplayFrameStream::Load(CUtlBuffer &reader)
+{
+    Purge();
+
+    const int32 frameCount = reader.GetInt();
+    const uint32 chunkFrames = reader.GetUnsignedInt();
+    const int32 chunkCount = reader.GetInt();
+
+    if (!reader.IsValid() || frameCount <= 0 || chunkFrames == 0 || chunkCount <= 0 ||
+        chunkCount != static_cast<int32>((frameCount + chunkFrames - 1) / chunkFrames) ||
+        (chunkCount + 1) * static_cast<int>(sizeof(uint32)) > reader.GetBytesRemaining())
+        return false;
+
+    m_vecChunkOffsets.EnsureCount(chunkCount + 1);
+    for (int32 i = 0; i <= chunkCount; ++i)
+    {
+        m_vecChunkOffsets[i] = reader.GetUnsignedInt();
+        if (i > 0 && m_vecChunkOffsets[i] < m_vecChunkOffsets[i - 1])
+            return false;
+    }
+
+    const uint32 dataSize = m_vecChunkOffsets[chunkCount];
+    if (m_vecChunkOffsets[0] != 0 || dataSize > static_cast<uint32>(reader.GetBytesRemaining()))
+    {
+        m_vecChunkOffsets.Purge();
+        return false;
+    }
+
+    m_Compressed.EnsureCapacity(dataSize);
+    reader.Get(m_Compressed.Base(), dataSize);
+
+    m_iFrameCount = frameCount;
+    m_iChunkFrames = chunkFrames;
+    return true;
+}
+
+void CReplayFrameStream::Purge()
+{
+    m_iFrameCount = 0;
+    m_iChunkFrames = 0;
+    m_vecChunkOffsets.Purge();
+    m_Compressed.Purge();
+
+    for (int i = 0; i < REPLAY_STREAM_CACHED_CHUNKS; ++i)
+    {
+        m_DecodedChunks[i].m_iChunk = -1;
+        m_DecodedChunks[i].m_vecFrames.Purge();
+    }
+}
+
+CReplayFrame *CReplayFrameStream::GetFrame(int32 index)
+{
+    if (index < 0 || index >= m_iFrameCount)
+        return nullptr;
+
+    // The chunk offset table doubles as the seek table: any frame is one chunk decode away
+    const int32 chunk = index / static_cast<int32>(m_iChunkFrames);
+    const int32 inChunk = index % static_cast<int32>(m_iChunkFrames);
+
+    // Playback almost always stays in the chunk it used last
+    DecodedChunk_t &last = m_DecodedChunks[m_iLastSlot];
+    if (last.m_iChunk == chunk)
+    {
+        last.m_iLastUse = ++m_iUseCounter;
+        return last.m_vecFrames.IsValidIndex(inChunk) ? &last.m_vecFrames[inChunk] : nullptr;
+    }
+
+    // Find the chunk in the cache, otherwise evict the least recently used one
+    int lru = 0;
+    for (int i = 0; i < REPLAY_STREAM_CACHED_CHUNKS; ++i)
+    {
+        DecodedChunk_t &cached = m_DecodedChunks[i];
+        if (cached.m_iChunk == chunk)
+        {
+            cached.m_iLastUse = ++m_iUseCounter;
+            m_iLastSlot = i;
+            return cached.m_vecFrames.IsValidIndex(inChunk) ? &cached.m_vecFrames[inChunk] : nullptr;
+        }
+
+        if (cached.m_iLastUse < m_DecodedChunks[lru].m_iLastUse)
+            lru = i;
+    }
+
+    DecodedChunk_t &slot = m_DecodedChunks[lru];
+    slot.m_vecFrames.RemoveAll();
+    if (!DecodeChunk(chunk, slot.m_vecFrames))
+    {
+        Warning("Replay frame data is corrupt (chunk %i)!\n", chunk);
+        slot.m_iChunk = -1;
+        slot.m_vecFrames.RemoveAll();
+        return nullptr;
+    }
+
+    slot.m_iChunk = chunk;
+    slot.m_iLastUse = ++m_iUseCounter;
+    m_iLastSlot = lru;
+    return slot.m_vecFrames.IsValidIndex(inChunk) ? &slot.m_vecFrames[inChunk] : nullptr;
+}
+
+bool CReplayFrameStream::DecodeAll(CUtlVector<CReplayFrame> &out) const
+{
+    out.EnsureCapacity(out.Count() + m_iFrameCount);
+
+    for (int32 chunk = 0; chunk < m_vecChunkOffsets.Count() - 1; ++chunk)
+    {
+        if (!DecodeChunk(chunk, out))
+            return false;
+    }
+
+    return true;
+}
+
+bool CReplayFrameStream::DecodeChunk(int32 chunk, CUtlVector<CReplayFrame> &out) const
+{
+    const char *pCompressed = reinterpret_cast<const char *>(m_Compressed.Base()) + m_vecChunkOffsets[chunk];
+    const size_t compressedSize = m_vecChunkOffsets[chunk + 1] - m_vecChunkOffsets[chunk];
+
+    size_t uncompressedSize = 0;
+    if (!snappy::GetUncompressedLength(pCompressed, compressedSize, &uncompressedSize))
+        return false;
+
+    CUtlMemory<uint8> deltas;
+    deltas.EnsureCapacity(uncompressedSize);
+    if (!snappy::RawUncompress(pCompressed, compressedSize, reinterpret_cast<char *>(deltas.Base())))
+        return false;
+
+    const uint8 *pCur = deltas.Base();
+    const uint8 *pEnd = pCur + uncompressedSize;
+
+    const int32 chunkFrames = static_cast<int32>(m_iChunkFrames);
+    const int32 frames = min(chunkFrames, m_iFrameCount - chunk * chunkFrames);
+    out.EnsureCapacity(out.Count() + frames);
+
+    int32 cur[REPLAY_STREAM_COMPONENTS] = {0};
+    uint32 buttons = 0;
+
+    for (int32 i = 0; i < frames; ++i)
+    {
+        uint32 value;
+        for (int c = 0; c < REPLAY_STREAM_COMPONENTS; ++c)
+        {
+            if (!GetVarUInt(pCur, pEnd, value))
+                return false;
+
+            cur[c] += ZigZagDecode(value);
+        }
+
+        if (!GetVarUInt(pCur, pEnd, value))
+            return false;
+
+        buttons ^= value;
+
+        const QAngle eye(cur[0] / REPLAY_STREAM_ANGLE_SCALE, cur[1] / REPLAY_STREAM_ANGLE_SCALE, cur[2] / REPLAY_STREAM_ANGLE_SCALE);
+        const Vector origin(cur[3] / REPLAY_STREAM_ORIGIN_SCALE, cur[4] / REPLAY_STREAM_ORIGIN_SCALE, cur[5] / REPLAY_STREAM_ORIGIN_SCALE);
+
+        // The teleport flag lives in the buttons already, so don't let the constructor add it again
+        out.AddToTail(CReplayFrame(eye, origin, cur[6] / REPLAY_STREAM_VIEWOFFSET_SCALE, static_cast<int>(buttons), false));
+    }
+
+    return pCur == pEnd;
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "mom_replay_data.h"
+
+// Frames per independently compressed chunk. Every chunk starts from absolute values (a keyframe),
+// so any chunk can be decoded without touching the ones before it.
+#define REPLAY_STREAM_CHUNK_FRAMES 1024
+// How many decoded chunks are kept around at once. Must be at least 2 so the frames around a chunk
+// boundary (previous/current/next step) stay valid together.
+#define REPLAY_STREAM_CACHED_CHUNKS 4
+
+// Compressed, chunked storage for replay frames.
+// Only the compressed chunks stay resident; frames are decoded a chunk at a time on demand,
+// so memory use is bounded no matter how long the run is and playback can start after decoding one chunk.
+//
+// Layout of the frame section:
+//   int32  frame count
+//   uint32 frames per chunk
+//   int32  chunk count
+//   uint32 chunk offsets[chunk count + 1] (relative to the start of the chunk data)
+//   chunk data, each chunk a snappy compressed stream of quantized zigzag varint deltas
+class CReplayFrameStream
+{
+  public:
+    CReplayFrameStream();
+
+    // Writes the frame section for the given frames
+    static void Encode(const CUtlVector<CReplayFrame> &frames, CUtlBuffer &writer);
+
+    // Reads the frame section at the current get position. Only the compressed chunks are copied.
+    bool Load(CUtlBuffer &reader);
+    void Purge();
+
+    bool IsLoaded() const { return m_iFrameCount > 0; }
+    int32 GetFrameCount() const { return m_iFrameCount; }
+
+    // The returned frame stays valid until REPLAY_STREAM_CACHED_CHUNKS other chunks have been decoded
+    CReplayFrame *GetFrame(int32 index);
+
+    // Decodes every frame, used when a streamed replay needs to be edited
+    bool DecodeAll(CUtlVector<CReplayFrame> &out) const;
+
+  private:
+    struct DecodedChunk_t
+    {
+        int32 m_iChunk;
+        uint32 m_iLastUse;
+        CUtlVector<CReplayFrame> m_vecFrames;
+    };
+
+    bool DecodeChunk(int32 chunk, CUtlVector<CReplayFrame> &out) const;
+
+    int32 m_iFrameCount;
+    uint32 m_iChunkFrames;
+    CUtlVector<uint32> m_vecChunkOffsets;
+    CUtlMemory<uint8> m_Compressed;
+
+    DecodedChunk_t m_DecodedChunks[REPLAY_STREAM_CACHED_CHUNKS];
+    uint32 m_iUseCounter;
+    int m_iLastSlot; // Slot of the chunk that was used last
+};
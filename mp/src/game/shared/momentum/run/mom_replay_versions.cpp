@@ -1,5 +1,6 @@
 #include "cbase.h"
 #include "mom_replay_versions.h"
+#include "mom_replay_layout.h"
 
 #ifdef GAME_DLL
 #include "momentum/mom_replay_entity.h"
@@ -87,17 +88,105 @@ void CMomReplayV1::Deserialize(CUtlBuffer &reader, bool bFull)
         m_pRunStats = new CMomRunStats(reader);
     }
 
-    if (bFull)
+    if (bFull && !ReplayLayout::ReadFramesV1(reader, m_rgFrames))
     {
-        // Read the count of frames in the replay
-        // and ensure we have the capacity to store them.
-        int32 frameCount = reader.GetInt();
+        Warning("Replay frame data is corrupt!\n");
+        m_rgFrames.Purge();
+    }
+}
+
+CMomReplayV3::CMomReplayV3() : CMomReplayV1(), m_iFrameDataOffset(0) {}
+
+CMomReplayV3::CMomReplayV3(CUtlBuffer &reader, bool bFull) : CMomReplayV1(), m_iFrameDataOffset(0)
+{
+    Deserialize(reader, bFull);
+}
+
+int32 CMomReplayV3::GetFrameCount()
+{
+    return m_FrameStream.IsLoaded() ? m_FrameStream.GetFrameCount() : m_rgFrames.Count();
+}
+
+CReplayFrame *CMomReplayV3::GetFrame(int32 index)
+{
+    if (m_FrameStream.IsLoaded())
+        return m_FrameStream.GetFrame(index);
+
+    return CMomReplayV1::GetFrame(index);
+}
+
+void CMomReplayV3::AddFrame(const CReplayFrame &frame)
+{
+    MaterializeFrames();
+    CMomReplayV1::AddFrame(frame);
+}
+
+bool CMomReplayV3::SetFrame(int32 index, const CReplayFrame &frame)
+{
+    MaterializeFrames();
+    return CMomReplayV1::SetFrame(index, frame);
+}
+
+void CMomReplayV3::RemoveFrames(int num)
+{
+    MaterializeFrames();
+    CMomReplayV1::RemoveFrames(num);
+}
+
+void CMomReplayV3::Serialize(CUtlBuffer &writer)
+{
+    MaterializeFrames();
+
+    // Frame count and offset come first, the offset is patched in once the header and stats are written
+    writer.PutInt(m_rgFrames.Count());
+    const int offsetPos = writer.TellPut();
+    writer.PutUnsignedInt(0);
+
+    // Header and stats are laid out exactly like V1
+    m_rhHeader.Serialize(writer);
+
+    writer.PutUnsignedChar(m_pRunStats != nullptr);
+
+    if (m_pRunStats != nullptr)
+        m_pRunStats->Serialize(writer);
+
+    m_iFrameDataOffset = writer.TellPut();
+    writer.SeekPut(CUtlBuffer::SEEK_HEAD, offsetPos);
+    writer.PutUnsignedInt(m_iFrameDataOffset);
+    writer.SeekPut(CUtlBuffer::SEEK_HEAD, m_iFrameDataOffset);
+
+    CReplayFrameStream::Encode(m_rgFrames, writer);
+}
+
+void CMomReplayV3::Deserialize(CUtlBuffer &reader, bool bFull)
+{
+    ReplayLayout::FrameInfo_t frameInfo;
+    ReplayLayout::ReadFrameInfo(reader, frameInfo);
+    m_iFrameDataOffset = frameInfo.m_iFrameDataOffset;
 
-        if (frameCount <= 0)
-            return;
+    m_rhHeader = CReplayHeader(reader);
 
-        // And read all the frames.
-        for (int32 i = 0; i < frameCount; ++i)
-            m_rgFrames.AddToTail(CReplayFrame(reader));
+    if (reader.GetUnsignedChar())
+    {
+        m_pRunStats = new CMomRunStats(reader);
     }
-}
\ No newline at end of file
+
+    // Only the compressed chunks are kept, frames get decoded as playback reaches them
+    if (bFull && !ReplayLayout::LoadFramesV3(reader, frameInfo, m_FrameStream))
+        Warning("Replay frame data is corrupt!\n");
+}
+
+void CMomReplayV3::MaterializeFrames()
+{
+    if (!m_FrameStream.IsLoaded())
+        return;
+
+    m_rgFrames.Purge();
+    if (!m_FrameStream.DecodeAll(m_rgFrames))
+    {
+        Warning("Replay frame data is corrupt!\n");
+        m_rgFrames.Purge();
+    }
+
+    m_FrameStream.Purge();
+}
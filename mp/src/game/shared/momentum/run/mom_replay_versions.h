@@ -2,6 +2,7 @@
 
 #include "mom_replay_base.h"
 #include "run_stats.h"
+#include "mom_replay_stream.h"
 
 class CMomReplayV1 : public CMomReplayBase
 {
@@ -29,4 +30,36 @@ private:
 protected:
     CMomRunStats *m_pRunStats;
     CUtlVector<CReplayFrame> m_rgFrames;
+};
+
+// Frames are stored as chunked, quantized per-tick deltas (see CReplayFrameStream).
+// Version 2 was only ever written by development builds while this layout was still changing, and isn't readable.
+// The frame count and frame data offset are written before the header so scans can stop early.
+// Loaded replays stream their frames from the compressed chunks; recordings (or loaded replays
+// that get edited) keep every frame decoded in m_rgFrames like V1.
+class CMomReplayV3 : public CMomReplayV1
+{
+public:
+    CMomReplayV3();
+    CMomReplayV3(CUtlBuffer &reader, bool bFull);
+
+public:
+    virtual uint8 GetVersion() OVERRIDE { return 3; }
+    virtual int32 GetFrameCount() OVERRIDE;
+    virtual CReplayFrame *GetFrame(int32 index) OVERRIDE;
+    virtual void AddFrame(const CReplayFrame &frame) OVERRIDE;
+    virtual bool SetFrame(int32 index, const CReplayFrame &frame) OVERRIDE;
+    virtual void RemoveFrames(int num) OVERRIDE;
+
+public:
+    virtual void Serialize(CUtlBuffer &writer) OVERRIDE;
+
+private:
+    void Deserialize(CUtlBuffer &reader, bool bFull = true);
+
+    // Decodes the whole stream into m_rgFrames so it can be edited
+    void MaterializeFrames();
+
+    CReplayFrameStream m_FrameStream;
+    uint32 m_iFrameDataOffset; // Absolute offset in the file of the frame section
 };
\ No newline at end of file
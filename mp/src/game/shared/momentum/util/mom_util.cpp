@@ -6,6 +6,7 @@
 #include "mom_util.h"
 #include "momentum/mom_shareddefs.h"
 #include "run/mom_replay_factory.h"
+#include "run/mom_replay_index.h"
 #include "run/mom_replay_base.h"
 #include "run/run_compare.h"
 #include "run/run_stats.h"
@@ -407,60 +408,15 @@ void MomUtil::GetHexStringFromColor(const Color& color, char* pBuffer, int maxLe
     Q_snprintf(pBuffer, maxLen, "%08x", colorHex);
 }
 
-inline bool CheckReplayB(CMomReplayBase *pFastest, CMomReplayBase *pCheck, float tickrate, int trackNumber, uint32 flags)
-{
-    if (pCheck)
-    {
-        if (pCheck->GetRunFlags() == flags && pCheck->GetTrackNumber() == trackNumber && CloseEnough(tickrate, pCheck->GetTickInterval(), FLT_EPSILON))
-        {
-            if (pFastest)
-            {
-                return pCheck->GetRunTime() < pFastest->GetRunTime();
-            }
-            
-            return true;
-        }
-    }
-
-    return false;
-}
-
 //!!! NOTE: The value returned here MUST BE DELETED, otherwise you get a memory leak!
 CMomReplayBase *MomUtil::GetBestTime(const char *szMapName, float tickrate, int trackNumber, uint32 flags)
 {
     if (szMapName)
     {
-        char path[MAX_PATH];
-        Q_snprintf(path, MAX_PATH, "%s/%s-*%s", RECORDING_PATH, szMapName, EXT_RECORDING_FILE);
-        V_FixSlashes(path);
-
-        CMomReplayBase *pFastest = nullptr;
-
-        FileFindHandle_t found;
-        const char *pFoundFile = filesystem->FindFirstEx(path, "MOD", &found);
-        while (pFoundFile)
-        {
-            // NOTE: THIS NEEDS TO BE MANUALLY CLEANED UP!
-            char pReplayPath[MAX_PATH];
-            V_ComposeFileName(RECORDING_PATH, pFoundFile, pReplayPath, MAX_PATH);
-
-            CMomReplayBase *pBase = g_ReplayFactory.LoadReplayFile(pReplayPath, false);
-            assert(pBase != nullptr);
-                
-            if (CheckReplayB(pFastest, pBase, tickrate, trackNumber, flags))
-            {
-                pFastest = pBase;
-            }
-            else // Not faster, get rid of it
-            {
-                delete pBase;
-            }
-
-            pFoundFile = filesystem->FindNext(found);
-        }
-
-        filesystem->FindClose(found);
-        return pFastest;
+        // The index knows which file is fastest, so only that one needs its header and stats read
+        const auto pBest = g_ReplayIndex.GetBestTime(szMapName, tickrate, trackNumber, flags);
+        if (pBest)
+            return g_ReplayFactory.LoadReplayFile(pBest->m_szFilePath, false);
     }
     return nullptr;
 }
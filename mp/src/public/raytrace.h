@@ -41,6 +41,21 @@ public:
 
 };
 
+// 8 rays, as two packets of 4. Trace8Rays traces them together on CPUs with AVX2, otherwise as
+// two separate packets.
+class EightRays
+{
+public:
+	FourRays half[2];										// rays 0-3 and 4-7
+
+	// returns direction sign mask for all 8 rays, or -1 if they can not be traced as one bundle.
+	inline int CalculateDirectionSignMask(void) const
+	{
+		int msk=half[0].CalculateDirectionSignMask();
+		return ( msk==half[1].CalculateDirectionSignMask() ) ? msk : -1;
+	}
+};
+
 /// The format a triangle is stored in for intersections. size of this structure is important.
 /// This structure can be in one of two forms. Before the ray tracing environment is set up, the
 /// ProjectedEdgeEquations hold the coordinates of the 3 vertices, for facilitating bounding box
@@ -220,6 +235,10 @@ public:
 #define RTE_FLAGS_FAST_TREE_GENERATION 1
 #define RTE_FLAGS_DONT_STORE_TRIANGLE_COLORS 2				// saves memory if not needed
 #define RTE_FLAGS_DONT_STORE_TRIANGLE_MATERIALS 4
+#define RTE_FLAGS_REFERENCE_TREE_GENERATION 8				// build the kd tree with the original
+															// per-vertex split search (RefineNode)
+															// instead of the binned one
+#define RTE_FLAGS_NO_AVX2 16								// always trace 8 rays as 2 SSE packets
 
 enum RayTraceLightingMode_t {
 	DIRECT_LIGHTING,										// just dot product lighting
@@ -253,6 +272,11 @@ public:
 	virtual bool VisitTriangle_ShouldContinue( const TriIntersectData_t &triangle, const FourRays &rays, fltx4 *hitMask, fltx4 *b0, fltx4 *b1, fltx4 *b2, int32 hitID ) = 0;
 };
 
+// Lets the application run the independent subtrees of the kd tree build on its own threads.
+// It has to call pfnItem for every item in [0,nItems), in any order, before returning.
+typedef void (*RayTraceParallelItemFn)(int item, void *pUserData);
+typedef void (*RayTraceParallelForFn)(int nItems, RayTraceParallelItemFn pfnItem, void *pUserData);
+
 class RayTracingEnvironment
 {
 public:
@@ -267,12 +291,14 @@ public:
 	CUtlVector<LightDesc_t> LightList;						//< the list of lights
 	CUtlVector<Vector> TriangleColors;						//< color of tries
 	CUtlVector<int32> TriangleMaterials;					//< material index of tries
+	RayTraceParallelForFn m_pfnParallelFor;					//< NULL builds the kd tree on one thread
 
 public:
 	RayTracingEnvironment() : OptimizedTriangleList( 1024 )
 	{
 		BackgroundColor.DuplicateVector(Vector(1,0,0));		// red
 		Flags=0;
+		m_pfnParallelFor=NULL;
 	}
 
 
@@ -297,6 +323,11 @@ public:
 	// SetupAccelerationStructure to prepare for tracing
 	void SetupAccelerationStructure(void);
 
+	// the two halves of SetupAccelerationStructure. BuildKDTree can be called more than once (it
+	// replaces the tree) until the triangles are changed into intersection format.
+	void BuildKDTree(void);
+	void ConvertTrianglesToIntersectionFormat(void);
+
 
 	// lowest level intersection routine - fire 4 rays through the scene. all 4 rays must pass the
 	// Check() function, and t extents must be initialized. skipid can be set to exclude a
@@ -310,6 +341,16 @@ public:
 					RayTracingResult *rslt_out,
 					int32 skip_id=-1, ITransparentTriangleCallback *pCallback = NULL);
 
+	// traces 8 rays at once, with the AVX2 tracer if the CPU has it and all 8 point the same way.
+	// pTMin, pTMax, rslt_out and ppCallbacks each point at 2, one for each half of the rays.
+	// The closest hit of each ray within its TMax is the same as Trace4Rays would find.
+	void Trace8Rays(const EightRays &rays, const fltx4 *pTMin, const fltx4 *pTMax,
+					RayTracingResult *rslt_out,
+					int32 skip_id=-1, ITransparentTriangleCallback **ppCallbacks = NULL);
+
+	// whether Trace8Rays is faster than two Trace4Rays on this CPU
+	bool CanTrace8RaysTogether(void) const;
+
 	// compute virtual light sources to model inter-reflection
 	void ComputeVirtualLightSources(void);
 
@@ -356,6 +397,15 @@ public:
 	void CalculateTriangleListBounds(int32 const *tris,int ntris,
 									 Vector &minout, Vector &maxout);
 
+	// the AVX2 half of Trace8Rays. all 8 rays must have the same direction signs.
+	void Trace8RaysAVX2(const EightRays &rays, const fltx4 *pTMin, const fltx4 *pTMax,
+						int DirectionSignMask, RayTracingResult *rslt_out,
+						int32 skip_id, ITransparentTriangleCallback **ppCallbacks);
+
+	// binned surface area heuristic build, same tree layout as RefineNode. Subtrees are built
+	// through m_pfnParallelFor, the result doesn't depend on how many threads it has.
+	void BuildKDTreeBinned(void);
+
 	void AddInfinitePointLight(const Vector &position,				// light center
 							   const Vector &intensity);			// rgb amount
 
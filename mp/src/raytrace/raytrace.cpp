@@ -5,6 +5,12 @@
 #include <filesystem_tools.h>
 #include <cmdlib.h>
 #include <stdio.h>
+#if !USE_STDC_FOR_SIMD
+#include <immintrin.h>
+#ifdef _WIN32
+#include <intrin.h>
+#endif
+#endif
 
 static bool SameSign(float a, float b)
 {
@@ -592,6 +598,351 @@ void RayTracingEnvironment::Trace4Rays(const FourRays &rays, fltx4 TMin, fltx4 T
 }
 
 
+//-----------------------------------------------------------------------------
+// 8 wide tracing. The AVX2 code is only run on CPUs that have it, so the file (and everything
+// inlined from the shared headers) is still compiled for SSE, only the functions below use AVX.
+//-----------------------------------------------------------------------------
+#if USE_STDC_FOR_SIMD == 0
+#define RAYTRACE_AVX2
+#endif
+
+#ifdef RAYTRACE_AVX2
+
+#ifdef __GNUC__
+#define AVX2_FUNC __attribute__((target("avx2")))
+#define AVX2_INLINE static inline __attribute__((target("avx2"),always_inline))
+#else
+#define AVX2_FUNC
+#define AVX2_INLINE static FORCEINLINE
+#endif
+
+static bool CPUHasAVX2(void)
+{
+#ifdef _WIN32
+	int info[4];
+	__cpuid(info,0);
+	if (info[0]<7)
+		return false;
+
+	// needs AVX, and the OS saving the ymm registers
+	__cpuid(info,1);
+	if ((info[2] & 0x18000000)!=0x18000000 || (_xgetbv(0) & 6)!=6)
+		return false;
+
+	__cpuidex(info,7,0);
+	return (info[1] & 0x20)!=0;
+#else
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx2")!=0;
+#endif
+}
+
+static bool s_bCPUHasAVX2=CPUHasAVX2();
+
+struct NodeToVisit8 {
+	CacheOptimizedKDNode const *node;
+	__m256 TMin;
+	__m256 TMax;
+};
+
+// the two halves of a packet as one register
+#define AVX2_COMBINE(lo,hi) _mm256_insertf128_ps(_mm256_castps128_ps256(lo),(hi),1)
+
+AVX2_INLINE __m256 Dot8(__m256 ax, __m256 ay, __m256 az, __m256 bx, __m256 by, __m256 bz)
+{
+	// same operation order as FourVectors::operator*, so the results match Trace4Rays
+	__m256 dot=_mm256_mul_ps(ax,bx);
+	dot=_mm256_add_ps(_mm256_mul_ps(ay,by),dot);
+	return _mm256_add_ps(_mm256_mul_ps(az,bz),dot);
+}
+
+AVX2_INLINE __m256 Select8(__m256 mask, __m256 a, __m256 b)	// mask ? a : b
+{
+	return _mm256_or_ps(_mm256_and_ps(a,mask),_mm256_andnot_ps(mask,b));
+}
+
+AVX2_FUNC void RayTracingEnvironment::Trace8RaysAVX2(const EightRays &rays, const fltx4 *pTMin,
+													 const fltx4 *pTMax, int DirectionSignMask,
+													 RayTracingResult *rslt_out, int32 skip_id,
+													 ITransparentTriangleCallback **ppCallbacks)
+{
+	// set up each half the same way Trace4Rays does, so the reciprocals and the clipped t ranges
+	// are the exact same numbers
+	FourVectors OneOverRayDir[2];
+	fltx4 TMin4[2],TMax4[2];
+	for(int h=0;h<2;h++)
+	{
+		rays.half[h].Check();
+		OneOverRayDir[h]=rays.half[h].direction;
+		OneOverRayDir[h].MakeReciprocalSaturate();
+
+		TMin4[h]=pTMin[h];
+		TMax4[h]=pTMax[h];
+		for(int c=0;c<3;c++)
+		{
+			fltx4 isect_min_t=
+				MulSIMD(SubSIMD(ReplicateX4(m_MinBound[c]),rays.half[h].origin[c]),OneOverRayDir[h][c]);
+			fltx4 isect_max_t=
+				MulSIMD(SubSIMD(ReplicateX4(m_MaxBound[c]),rays.half[h].origin[c]),OneOverRayDir[h][c]);
+			TMin4[h]=MaxSIMD(TMin4[h],MinSIMD(isect_min_t,isect_max_t));
+			TMax4[h]=MinSIMD(TMax4[h],MaxSIMD(isect_min_t,isect_max_t));
+		}
+
+		memset(rslt_out[h].HitIds,0xff,sizeof(rslt_out[h].HitIds));
+		rslt_out[h].HitDistance=ReplicateX4(1.0e23);
+		rslt_out[h].surface_normal.DuplicateVector(Vector(0.,0.,0.));
+	}
+
+	if (!IsAnyNegative(CmpLeSIMD(TMin4[0],TMax4[0])) && !IsAnyNegative(CmpLeSIMD(TMin4[1],TMax4[1])))
+		return;												// missed bounding box
+
+	__m256 Origin[3],Direction[3],InvDirection[3];
+	for(int c=0;c<3;c++)
+	{
+		Origin[c]=AVX2_COMBINE(rays.half[0].origin[c],rays.half[1].origin[c]);
+		Direction[c]=AVX2_COMBINE(rays.half[0].direction[c],rays.half[1].direction[c]);
+		InvDirection[c]=AVX2_COMBINE(OneOverRayDir[0][c],OneOverRayDir[1][c]);
+	}
+	__m256 TMin=AVX2_COMBINE(TMin4[0],TMin4[1]);
+	__m256 TMax=AVX2_COMBINE(TMax4[0],TMax4[1]);
+
+	// the distance and barycentric tests use the same FourZeros Trace4Rays does so edge hits
+	// resolve identically on both paths
+	const __m256 Zeros=_mm256_broadcast_ps( &FourZeros );
+	const __m256 Epsilons=_mm256_set1_ps(1.0e-10);
+	const __m256 NegativeEpsilons=_mm256_set1_ps(-1.0e-10);
+	const __m256 Ones=_mm256_set1_ps(1.0);
+
+	__m256 HitIds=_mm256_castsi256_ps(_mm256_set1_epi32(-1));
+	__m256 HitDistance=_mm256_set1_ps(1.0e23);
+	__m256 HitNormal[3]={_mm256_setzero_ps(),_mm256_setzero_ps(),_mm256_setzero_ps()};
+
+	int32 mailboxids[MAILBOX_HASH_SIZE];					// used to avoid redundant triangle tests
+	memset(mailboxids,0xff,sizeof(mailboxids));
+
+	int front_idx[3],back_idx[3];							// based on ray direction, whether to
+															// visit left or right node first
+	for(int c=0;c<3;c++)
+	{
+		back_idx[c]=(DirectionSignMask & (1<<c)) ? 0 : 1;
+		front_idx[c]=1-back_idx[c];
+	}
+
+	NodeToVisit8 NodeQueue[MAX_NODE_STACK_LEN];
+	CacheOptimizedKDNode const *CurNode=&(OptimizedKDTree[0]);
+	NodeToVisit8 *stack_ptr=&NodeQueue[MAX_NODE_STACK_LEN];
+	while(1)
+	{
+		while (CurNode->NodeType() != KDNODE_STATE_LEAF)		// traverse until next leaf
+		{
+			int split_plane_number=CurNode->NodeType();
+			CacheOptimizedKDNode const *FrontChild=&(OptimizedKDTree[CurNode->LeftChild()]);
+
+			__m256 dist_to_sep_plane=						// dist=(split-org)/dir
+				_mm256_mul_ps(
+					_mm256_sub_ps(_mm256_set1_ps(CurNode->SplittingPlaneValue),
+								  Origin[split_plane_number]),InvDirection[split_plane_number]);
+			__m256 activeRays=_mm256_cmp_ps(TMin,TMax,_CMP_LE_OQ);
+
+			// now, decide how to traverse children. can either do front,back, or do front and push
+			// back.
+			__m256 hits_front=_mm256_and_ps(activeRays,_mm256_cmp_ps(dist_to_sep_plane,TMin,_CMP_GE_OQ));
+			if (!_mm256_movemask_ps(hits_front))
+			{
+				// missed the front. only traverse back
+				CurNode=FrontChild+back_idx[split_plane_number];
+				TMin=_mm256_max_ps(TMin,dist_to_sep_plane);
+			}
+			else
+			{
+				__m256 hits_back=_mm256_and_ps(activeRays,_mm256_cmp_ps(dist_to_sep_plane,TMax,_CMP_LE_OQ));
+				if (!_mm256_movemask_ps(hits_back))
+				{
+					// missed the back - only need to traverse front node
+					CurNode=FrontChild+front_idx[split_plane_number];
+					TMax=_mm256_min_ps(TMax,dist_to_sep_plane);
+				}
+				else
+				{
+					// at least some rays hit both nodes.
+					// must push far, traverse near
+					assert(stack_ptr>NodeQueue);
+					--stack_ptr;
+					stack_ptr->node=FrontChild+back_idx[split_plane_number];
+					stack_ptr->TMin=_mm256_max_ps(TMin,dist_to_sep_plane);
+					stack_ptr->TMax=TMax;
+					CurNode=FrontChild+front_idx[split_plane_number];
+					TMax=_mm256_min_ps(TMax,dist_to_sep_plane);
+				}
+			}
+		}
+		// hit a leaf! must do intersection check
+		int ntris=CurNode->NumberOfTrianglesInLeaf();
+		if (ntris)
+		{
+			int32 const *tlist=&(TriangleIndexList[CurNode->TriangleIndexStart()]);
+			do
+			{
+				int tnum=*(tlist++);
+				// check mailbox
+				int mbox_slot=tnum & (MAILBOX_HASH_SIZE-1);
+				TriIntersectData_t const *tri = &( OptimizedTriangleList[tnum].m_Data.m_IntersectData );
+				if ( ( mailboxids[mbox_slot] == tnum ) || ( tri->m_nTriangleID == skip_id ) )
+					continue;
+				mailboxids[mbox_slot] = tnum;
+
+				// compute plane intersection
+				__m256 Nx=_mm256_set1_ps( tri->m_flNx );
+				__m256 Ny=_mm256_set1_ps( tri->m_flNy );
+				__m256 Nz=_mm256_set1_ps( tri->m_flNz );
+
+				__m256 DDotN=Dot8( Direction[0], Direction[1], Direction[2], Nx, Ny, Nz );
+				// mask off zero or near zero (ray parallel to surface)
+				__m256 did_hit=_mm256_or_ps( _mm256_cmp_ps( DDotN, Epsilons, _CMP_GT_OQ ),
+											 _mm256_cmp_ps( DDotN, NegativeEpsilons, _CMP_LT_OQ ) );
+
+				__m256 numerator=_mm256_sub_ps( _mm256_set1_ps( tri->m_flD ),
+												Dot8( Origin[0], Origin[1], Origin[2], Nx, Ny, Nz ) );
+
+				__m256 isect_t=_mm256_div_ps( numerator, DDotN );
+				// now, we have the distance to the plane. lets update our mask
+				did_hit=_mm256_and_ps( did_hit, _mm256_cmp_ps( isect_t, Zeros, _CMP_GT_OQ ) );
+				did_hit=_mm256_and_ps( did_hit, _mm256_cmp_ps( isect_t, HitDistance, _CMP_LT_OQ ) );
+
+				if ( !_mm256_movemask_ps( did_hit ) )
+					continue;
+
+				// now, check 3 edges
+				__m256 hitc1=_mm256_add_ps( Origin[tri->m_nCoordSelect0],
+											_mm256_mul_ps( isect_t, Direction[tri->m_nCoordSelect0] ) );
+				__m256 hitc2=_mm256_add_ps( Origin[tri->m_nCoordSelect1],
+											_mm256_mul_ps( isect_t, Direction[tri->m_nCoordSelect1] ) );
+
+				// do barycentric coordinate check
+				__m256 B0=_mm256_mul_ps( _mm256_set1_ps( tri->m_ProjectedEdgeEquations[0] ), hitc1 );
+				B0=_mm256_add_ps( B0, _mm256_mul_ps( _mm256_set1_ps( tri->m_ProjectedEdgeEquations[1] ), hitc2 ) );
+				B0=_mm256_add_ps( B0, _mm256_set1_ps( tri->m_ProjectedEdgeEquations[2] ) );
+
+				did_hit=_mm256_and_ps( did_hit, _mm256_cmp_ps( B0, Zeros, _CMP_GE_OQ ) );
+
+				__m256 B1=_mm256_mul_ps( _mm256_set1_ps( tri->m_ProjectedEdgeEquations[3] ), hitc1 );
+				B1=_mm256_add_ps( B1, _mm256_mul_ps( _mm256_set1_ps( tri->m_ProjectedEdgeEquations[4] ), hitc2 ) );
+				B1=_mm256_add_ps( B1, _mm256_set1_ps( tri->m_ProjectedEdgeEquations[5] ) );
+
+				did_hit=_mm256_and_ps( did_hit, _mm256_cmp_ps( B1, Zeros, _CMP_GE_OQ ) );
+
+				__m256 B2=_mm256_add_ps( B1, B0 );
+				did_hit=_mm256_and_ps( did_hit, _mm256_cmp_ps( B2, Ones, _CMP_LE_OQ ) );
+
+				int hitmask=_mm256_movemask_ps( did_hit );
+				if ( !hitmask )
+					continue;
+
+				// if the triangle is transparent, ask each half's callback like Trace4Rays would
+				if ( ( tri->m_nFlags & FCACHETRI_TRANSPARENT ) && ppCallbacks )
+				{
+					ALIGN16 float flHit[8] ALIGN16_POST, flB0[8] ALIGN16_POST, flB1[8] ALIGN16_POST, flB2[8] ALIGN16_POST;
+					_mm256_storeu_ps( flHit, did_hit );
+					_mm256_storeu_ps( flB0, B0 );
+					_mm256_storeu_ps( flB1, B1 );
+					_mm256_storeu_ps( flB2, _mm256_sub_ps( Ones, B2 ) );	// the real third coordinate
+					_mm256_zeroupper();
+
+					for(int h=0;h<2;h++)
+					{
+						if ( !( ( hitmask >> ( 4*h ) ) & 0xf ) || !ppCallbacks[h] )
+							continue;
+
+						// same 1, 2, 0 barycentric order as Trace4Rays passes
+						fltx4 hit4=LoadAlignedSIMD( flHit+4*h );
+						fltx4 b0=LoadAlignedSIMD( flB0+4*h );
+						fltx4 b1=LoadAlignedSIMD( flB1+4*h );
+						fltx4 b2=LoadAlignedSIMD( flB2+4*h );
+						if ( ppCallbacks[h]->VisitTriangle_ShouldContinue( *tri, rays.half[h], &hit4, &b1, &b2, &b0, tnum ) )
+						{
+							hit4=Four_Zeros;
+						}
+						StoreAlignedSIMD( flHit+4*h, hit4 );
+					}
+					did_hit=_mm256_loadu_ps( flHit );
+				}
+
+				// now, set the hit_id and closest_hit fields for any enabled rays
+				HitIds=Select8( did_hit, _mm256_castsi256_ps( _mm256_set1_epi32( tnum ) ), HitIds );
+				HitDistance=Select8( did_hit, isect_t, HitDistance );
+				HitNormal[0]=Select8( did_hit, Nx, HitNormal[0] );
+				HitNormal[1]=Select8( did_hit, Ny, HitNormal[1] );
+				HitNormal[2]=Select8( did_hit, Nz, HitNormal[2] );
+			} while (--ntris);
+			// now, check if all rays have terminated
+			__m256 raydone=_mm256_cmp_ps( TMax, HitDistance, _CMP_LE_OQ );
+			if ( !_mm256_movemask_ps( raydone ) )
+				break;
+		}
+
+		if (stack_ptr==&NodeQueue[MAX_NODE_STACK_LEN])
+			break;
+
+		// pop stack!
+		CurNode=stack_ptr->node;
+		TMin=stack_ptr->TMin;
+		TMax=stack_ptr->TMax;
+		stack_ptr++;
+	}
+
+	// hand the results back in the Trace4Rays layout
+	ALIGN16 float flOut[5][8] ALIGN16_POST;
+	_mm256_storeu_ps( flOut[0], HitIds );
+	_mm256_storeu_ps( flOut[1], HitDistance );
+	_mm256_storeu_ps( flOut[2], HitNormal[0] );
+	_mm256_storeu_ps( flOut[3], HitNormal[1] );
+	_mm256_storeu_ps( flOut[4], HitNormal[2] );
+	_mm256_zeroupper();
+
+	for(int h=0;h<2;h++)
+	{
+		memcpy( rslt_out[h].HitIds, flOut[0]+4*h, sizeof( rslt_out[h].HitIds ) );
+		rslt_out[h].HitDistance=LoadAlignedSIMD( flOut[1]+4*h );
+		rslt_out[h].surface_normal.x=LoadAlignedSIMD( flOut[2]+4*h );
+		rslt_out[h].surface_normal.y=LoadAlignedSIMD( flOut[3]+4*h );
+		rslt_out[h].surface_normal.z=LoadAlignedSIMD( flOut[4]+4*h );
+	}
+}
+
+#endif // RAYTRACE_AVX2
+
+
+bool RayTracingEnvironment::CanTrace8RaysTogether(void) const
+{
+#ifdef RAYTRACE_AVX2
+	return s_bCPUHasAVX2 && !(Flags & RTE_FLAGS_NO_AVX2);
+#else
+	return false;
+#endif
+}
+
+
+void RayTracingEnvironment::Trace8Rays(const EightRays &rays, const fltx4 *pTMin, const fltx4 *pTMax,
+									   RayTracingResult *rslt_out,
+									   int32 skip_id, ITransparentTriangleCallback **ppCallbacks)
+{
+#ifdef RAYTRACE_AVX2
+	if (CanTrace8RaysTogether())
+	{
+		int msk=rays.CalculateDirectionSignMask();
+		if (msk!=-1)
+		{
+			Trace8RaysAVX2(rays,pTMin,pTMax,msk,rslt_out,skip_id,ppCallbacks);
+			return;
+		}
+	}
+#endif
+	for(int h=0;h<2;h++)
+		Trace4Rays(rays.half[h],pTMin[h],pTMax[h],&rslt_out[h],skip_id,
+				   ppCallbacks ? ppCallbacks[h] : NULL);
+}
+
+
 int RayTracingEnvironment::MakeLeafNode(int first_tri, int last_tri)
 {
 	CacheOptimizedKDNode ret;
@@ -869,8 +1220,441 @@ void RayTracingEnvironment::RefineNode(int node_number,int32 const *tri_list,int
 }
 
 
-void RayTracingEnvironment::SetupAccelerationStructure(void)
+// The binned build. Instead of classifying every triangle against every candidate split, each
+// axis of a node is cut into KD_SAH_BINS bins and the triangles are counted into the bins they
+// start and end in, which gives an estimate of the split cost at every bin boundary in one pass.
+// The best boundary is then classified exactly (same rules as ClassifyAgainstAxisSplit), and the
+// cost formula, "growing" of empty halves and termination are the same as in RefineNode. Small
+// nodes try every triangle extent as a split instead, like RefineNode does.
+//
+// Nodes under KD_PARALLEL_SUBTREE_TRIS triangles are built as separate subtrees, in parallel when
+// there's a m_pfnParallelFor, and then stitched into OptimizedKDTree in the order RefineNode would
+// have added them in. No triangle data is written while building, so subtrees can share triangles.
+
+#define KD_SAH_BINS 32
+#define KD_EXACT_SPLIT_TRIS 32								// try all triangle extents below this
+#define KD_PARALLEL_SUBTREE_TRIS 4096
+#define KDBUILD_SUBTREE 4									// node built as a separate subtree
+
+struct KDTriBounds_t
+{
+	float m_Mins[4];
+	float m_Maxs[4];
+};
+
+struct KDBuildNode_t
+{
+	int m_nType;											// KDNODE_STATE_xx or KDBUILD_SUBTREE
+	float m_flSplitValue;
+	int m_nLeft, m_nRight;									// child nodes, m_nLeft is the subtree
+															// for KDBUILD_SUBTREE
+	int m_nFirstTri, m_nTris;								// leaf triangles in m_TriIndices
+#ifdef DEBUG_RAYTRACE
+	Vector m_vecMins, m_vecMaxs;
+#endif
+};
+
+class CKDSubtree
+{
+public:
+	CUtlVector<KDBuildNode_t> m_Nodes;						// root is 0
+	CUtlVector<int32> m_TriIndices;
+
+	// input, freed once built
+	CUtlVector<int32> m_Tris;
+	Vector m_vecMins, m_vecMaxs;
+	int m_nDepth;
+};
+
+class CKDTreeBuilder
+{
+public:
+	CKDTreeBuilder(RayTracingEnvironment *pEnv) : m_pEnv(pEnv) {}
+
+	void ComputeTriangleBounds(void);
+	void Build(void);
+
+private:
+	void ComputeListBounds(int32 const *tris, int ntris, Vector &minout, Vector &maxout) const;
+	void CountSplit(int axis, float split_value, int32 const *tris, int ntris,
+					int &nleft, int &nright, int &nboth) const;
+	float CostOfSplit(int axis, float split_value, const Vector &MinBound, const Vector &MaxBound,
+					  int nleft, int nright, int nboth) const;
+	bool FindBestSplitBinned(int32 const *tris, int ntris, const Vector &MinBound,
+							 const Vector &MaxBound, const Vector &TriMins, const Vector &TriMaxs,
+							 int &best_axis, float &best_split) const;
+	bool FindBestSplitExact(int32 const *tris, int ntris, const Vector &MinBound,
+							const Vector &MaxBound, int &best_axis, float &best_split) const;
+
+	int Refine(CKDSubtree &tree, int32 const *tris, int ntris, const Vector &MinBound,
+			   const Vector &MaxBound, int depth, bool bDefer);
+	int MakeLeaf(CKDSubtree &tree, int32 const *tris, int ntris, const Vector &MinBound,
+				 const Vector &MaxBound);
+
+	static void BuildSubtree(int item, void *pUserData);
+	void Flatten(const CKDSubtree &tree, int node, int out_node);
+
+	RayTracingEnvironment *m_pEnv;
+	CUtlVector<KDTriBounds_t> m_TriBounds;
+	CUtlVector<CKDSubtree *> m_Subtrees;
+};
+
+
+void CKDTreeBuilder::ComputeTriangleBounds(void)
+{
+	int ntris = m_pEnv->OptimizedTriangleList.Count();
+	m_TriBounds.SetCount( ntris );
+	for( int t = 0; t < ntris; t++ )
+	{
+		const CacheOptimizedTriangle &tri = m_pEnv->OptimizedTriangleList[t];
+		// the 4th lane reads past the last vertex, into the flags. it's never used.
+		fltx4 v0 = LoadUnalignedSIMD( &tri.Vertex( 0 ).x );
+		fltx4 v1 = LoadUnalignedSIMD( &tri.Vertex( 1 ).x );
+		fltx4 v2 = LoadUnalignedSIMD( &tri.Vertex( 2 ).x );
+		StoreUnalignedSIMD( m_TriBounds[t].m_Mins, MinSIMD( v0, MinSIMD( v1, v2 ) ) );
+		StoreUnalignedSIMD( m_TriBounds[t].m_Maxs, MaxSIMD( v0, MaxSIMD( v1, v2 ) ) );
+	}
+}
+
+
+void CKDTreeBuilder::ComputeListBounds(int32 const *tris, int ntris, Vector &minout, Vector &maxout) const
+{
+	fltx4 mins = ReplicateX4( 1.0e23 );
+	fltx4 maxs = ReplicateX4( -1.0e23 );
+	for( int i = 0; i < ntris; i++ )
+	{
+		const KDTriBounds_t &bounds = m_TriBounds[tris[i]];
+		mins = MinSIMD( mins, LoadUnalignedSIMD( bounds.m_Mins ) );
+		maxs = MaxSIMD( maxs, LoadUnalignedSIMD( bounds.m_Maxs ) );
+	}
+	minout.Init( SubFloat( mins, 0 ), SubFloat( mins, 1 ), SubFloat( mins, 2 ) );
+	maxout.Init( SubFloat( maxs, 0 ), SubFloat( maxs, 1 ), SubFloat( maxs, 2 ) );
+}
+
+
+void CKDTreeBuilder::CountSplit(int axis, float split_value, int32 const *tris, int ntris,
+								int &nleft, int &nright, int &nboth) const
+{
+	nleft = nright = nboth = 0;
+	for( int i = 0; i < ntris; i++ )
+	{
+		// same as ClassifyAgainstAxisSplit
+		float minc = m_TriBounds[tris[i]].m_Mins[axis];
+		float maxc = m_TriBounds[tris[i]].m_Maxs[axis];
+		if ( minc >= split_value )
+			nright++;
+		else if ( maxc <= split_value )
+			nleft++;
+		else
+			nboth++;
+	}
+}
+
+
+float CKDTreeBuilder::CostOfSplit(int axis, float split_value, const Vector &MinBound,
+								  const Vector &MaxBound, int nleft, int nright, int nboth) const
+{
+	Vector LeftMaxes = MaxBound;
+	Vector RightMins = MinBound;
+	LeftMaxes[axis] = split_value;
+	RightMins[axis] = split_value;
+	float SA_L = BoxSurfaceArea( MinBound, LeftMaxes );
+	float SA_R = BoxSurfaceArea( RightMins, MaxBound );
+	float ISA = 1.0 / BoxSurfaceArea( MinBound, MaxBound );
+	return COST_OF_TRAVERSAL + COST_OF_INTERSECTION * ( nboth + ( SA_L * ISA * nleft ) + ( SA_R * ISA * nright ) );
+}
+
+
+bool CKDTreeBuilder::FindBestSplitBinned(int32 const *tris, int ntris, const Vector &MinBound,
+										 const Vector &MaxBound, const Vector &TriMins,
+										 const Vector &TriMaxs, int &best_axis, float &best_split) const
+{
+	float best_cost = 1.0e23;
+	for( int axis = 0; axis < 3; axis++ )
+	{
+		// no point in splitting outside of the triangles
+		float lo = max( MinBound[axis], TriMins[axis] );
+		float hi = min( MaxBound[axis], TriMaxs[axis] );
+		if ( hi <= lo )
+			continue;
+
+		int starts[KD_SAH_BINS], ends[KD_SAH_BINS];
+		memset( starts, 0, sizeof( starts ) );
+		memset( ends, 0, sizeof( ends ) );
+
+		float bin_scale = KD_SAH_BINS / ( hi - lo );
+		for( int i = 0; i < ntris; i++ )
+		{
+			const KDTriBounds_t &bounds = m_TriBounds[tris[i]];
+			int start_bin = (int) ( ( bounds.m_Mins[axis] - lo ) * bin_scale );
+			int end_bin = (int) ( ( bounds.m_Maxs[axis] - lo ) * bin_scale );
+			starts[clamp( start_bin, 0, KD_SAH_BINS - 1 )]++;
+			ends[clamp( end_bin, 0, KD_SAH_BINS - 1 )]++;
+		}
+
+		// boundary b is between bins b-1 and b. left of it are the triangles that ended in a lower
+		// bin, right of it the ones that start in bin b or higher.
+		int nleft = 0;
+		int nright = ntris;
+		for( int b = 1; b < KD_SAH_BINS; b++ )
+		{
+			nleft += ends[b - 1];
+			nright -= starts[b - 1];
+			float split_value = lo + b * ( hi - lo ) / KD_SAH_BINS;
+			float cost = CostOfSplit( axis, split_value, MinBound, MaxBound, nleft, nright,
+									  ntris - nleft - nright );
+			if ( cost < best_cost )
+			{
+				best_cost = cost;
+				best_axis = axis;
+				best_split = split_value;
+			}
+		}
+	}
+	return best_cost < 1.0e23;
+}
+
+
+bool CKDTreeBuilder::FindBestSplitExact(int32 const *tris, int ntris, const Vector &MinBound,
+										const Vector &MaxBound, int &best_axis, float &best_split) const
+{
+	// the cost only changes slope at triangle extents, so those (and the middle) are all the
+	// candidates worth trying
+	float best_cost = 1.0e23;
+	for( int axis = 0; axis < 3; axis++ )
+	{
+		for( int c = -1; c < 2 * ntris; c++ )
+		{
+			float split_value;
+			if ( c == -1 )
+				split_value = 0.5 * ( MinBound[axis] + MaxBound[axis] );
+			else
+			{
+				const KDTriBounds_t &bounds = m_TriBounds[tris[c >> 1]];
+				split_value = ( c & 1 ) ? bounds.m_Maxs[axis] : bounds.m_Mins[axis];
+				if ( ( split_value > MaxBound[axis] ) || ( split_value < MinBound[axis] ) )
+					continue;
+			}
+
+			int nleft, nright, nboth;
+			CountSplit( axis, split_value, tris, ntris, nleft, nright, nboth );
+			float cost = CostOfSplit( axis, split_value, MinBound, MaxBound, nleft, nright, nboth );
+			if ( cost < best_cost )
+			{
+				best_cost = cost;
+				best_axis = axis;
+				best_split = split_value;
+			}
+		}
+	}
+	return best_cost < 1.0e23;
+}
+
+
+int CKDTreeBuilder::MakeLeaf(CKDSubtree &tree, int32 const *tris, int ntris, const Vector &MinBound,
+							 const Vector &MaxBound)
+{
+	int node = tree.m_Nodes.AddToTail();
+	KDBuildNode_t &leaf = tree.m_Nodes[node];
+	leaf.m_nType = KDNODE_STATE_LEAF;
+	leaf.m_nFirstTri = tree.m_TriIndices.Count();
+	leaf.m_nTris = ntris;
+#ifdef DEBUG_RAYTRACE
+	leaf.m_vecMins = MinBound;
+	leaf.m_vecMaxs = MaxBound;
+#endif
+	tree.m_TriIndices.AddMultipleToTail( ntris, tris );
+	return node;
+}
+
+
+int CKDTreeBuilder::Refine(CKDSubtree &tree, int32 const *tris, int ntris, const Vector &MinBound,
+						   const Vector &MaxBound, int depth, bool bDefer)
 {
+	if ( ntris < 3 )										// never split empty lists
+		return MakeLeaf( tree, tris, ntris, MinBound, MaxBound );
+
+	if ( bDefer && ( ntris < KD_PARALLEL_SUBTREE_TRIS ) )
+	{
+		CKDSubtree *pSubtree = new CKDSubtree;
+		pSubtree->m_Tris.AddMultipleToTail( ntris, tris );
+		pSubtree->m_vecMins = MinBound;
+		pSubtree->m_vecMaxs = MaxBound;
+		pSubtree->m_nDepth = depth;
+
+		int node = tree.m_Nodes.AddToTail();
+		tree.m_Nodes[node].m_nType = KDBUILD_SUBTREE;
+		tree.m_Nodes[node].m_nLeft = m_Subtrees.AddToTail( pSubtree );
+		return node;
+	}
+
+	Vector TriMins, TriMaxs;
+	ComputeListBounds( tris, ntris, TriMins, TriMaxs );
+
+	int split_plane = 0;
+	float split_value = 0;
+	bool bFound = ( ntris < KD_EXACT_SPLIT_TRIS ) ?
+		FindBestSplitExact( tris, ntris, MinBound, MaxBound, split_plane, split_value ) :
+		FindBestSplitBinned( tris, ntris, MinBound, MaxBound, TriMins, TriMaxs, split_plane, split_value );
+
+	int nleft = 0, nright = 0, nboth = 0;
+	float best_cost = 1.0e23;
+	if ( bFound )
+	{
+		CountSplit( split_plane, split_value, tris, ntris, nleft, nright, nboth );
+
+		// if the split resulted in one half being empty, "grow" the empty half
+		if ( nleft && ( nboth == 0 ) && ( nright == 0 ) )
+			split_value = TriMaxs[split_plane];
+		if ( nright && ( nboth == 0 ) && ( nleft == 0 ) )
+			split_value = TriMins[split_plane];
+
+		best_cost = CostOfSplit( split_plane, split_value, MinBound, MaxBound, nleft, nright, nboth );
+	}
+
+	float cost_of_no_split = COST_OF_INTERSECTION * ntris;
+	if ( ( cost_of_no_split <= best_cost ) || NEVER_SPLIT || ( depth > MAX_TREE_DEPTH ) )
+		return MakeLeaf( tree, tris, ntris, MinBound, MaxBound );
+
+	// same layout as RefineNode: left ones, then straddling ones, then right ones backwards
+	CUtlVector<int32> new_triangle_list;
+	new_triangle_list.SetCount( ntris );
+	int n_left_output = 0, n_both_output = 0, n_right_output = 0;
+	for( int t = 0; t < ntris; t++ )
+	{
+		float minc = m_TriBounds[tris[t]].m_Mins[split_plane];
+		float maxc = m_TriBounds[tris[t]].m_Maxs[split_plane];
+		if ( minc >= split_value )
+			new_triangle_list[ntris - ( ++n_right_output )] = tris[t];
+		else if ( maxc <= split_value )
+			new_triangle_list[n_left_output++] = tris[t];
+		else
+			new_triangle_list[nleft + ( n_both_output++ )] = tris[t];
+	}
+
+	Vector LeftMaxes = MaxBound;
+	Vector RightMins = MinBound;
+	LeftMaxes[split_plane] = split_value;
+	RightMins[split_plane] = split_value;
+
+	int node = tree.m_Nodes.AddToTail();
+	tree.m_Nodes[node].m_nType = split_plane;
+	tree.m_Nodes[node].m_flSplitValue = split_value;
+#ifdef DEBUG_RAYTRACE
+	tree.m_Nodes[node].m_vecMins = MinBound;
+	tree.m_Nodes[node].m_vecMaxs = MaxBound;
+#endif
+
+	if ( ( ntris < 20 ) && ( ( nleft == 0 ) || ( nright == 0 ) ) )
+		depth += 100;
+	int left = Refine( tree, new_triangle_list.Base(), nleft + nboth, MinBound, LeftMaxes, depth + 1, bDefer );
+	int right = Refine( tree, new_triangle_list.Base() + nleft, nright + nboth, RightMins, MaxBound, depth + 1, bDefer );
+	tree.m_Nodes[node].m_nLeft = left;
+	tree.m_Nodes[node].m_nRight = right;
+	return node;
+}
+
+
+void CKDTreeBuilder::BuildSubtree(int item, void *pUserData)
+{
+	CKDTreeBuilder *pBuilder = (CKDTreeBuilder *) pUserData;
+	CKDSubtree *pSubtree = pBuilder->m_Subtrees[item];
+	pBuilder->Refine( *pSubtree, pSubtree->m_Tris.Base(), pSubtree->m_Tris.Count(), pSubtree->m_vecMins,
+					  pSubtree->m_vecMaxs, pSubtree->m_nDepth, false );
+	pSubtree->m_Tris.Purge();
+}
+
+
+void CKDTreeBuilder::Flatten(const CKDSubtree &tree, int node, int out_node)
+{
+	const KDBuildNode_t &build = tree.m_Nodes[node];
+	if ( build.m_nType == KDBUILD_SUBTREE )
+	{
+		Flatten( *m_Subtrees[build.m_nLeft], 0, out_node );
+		return;
+	}
+
+	CacheOptimizedKDNode &out = m_pEnv->OptimizedKDTree[out_node];
+#ifdef DEBUG_RAYTRACE
+	out.vecMins = build.m_vecMins;
+	out.vecMaxs = build.m_vecMaxs;
+#endif
+	if ( build.m_nType == KDNODE_STATE_LEAF )
+	{
+		out.Children = KDNODE_STATE_LEAF + ( m_pEnv->TriangleIndexList.Count() << 2 );
+		out.SetNumberOfTrianglesInLeafNode( build.m_nTris );
+		m_pEnv->TriangleIndexList.AddMultipleToTail( build.m_nTris, tree.m_TriIndices.Base() + build.m_nFirstTri );
+		return;
+	}
+
+	int left_child = m_pEnv->OptimizedKDTree.Count();
+	out.Children = build.m_nType + ( left_child << 2 );
+	out.SplittingPlaneValue = build.m_flSplitValue;
+	m_pEnv->OptimizedKDTree.AddMultipleToTail( 2 );			// invalidates out
+	Flatten( tree, build.m_nLeft, left_child );
+	Flatten( tree, build.m_nRight, left_child + 1 );
+}
+
+
+void CKDTreeBuilder::Build(void)
+{
+	ComputeTriangleBounds();
+
+	int ntris = m_pEnv->OptimizedTriangleList.Count();
+	CUtlVector<int32> root_triangle_list;
+	root_triangle_list.SetCount( ntris );
+	for( int t = 0; t < ntris; t++ )
+		root_triangle_list[t] = t;
+	ComputeListBounds( root_triangle_list.Base(), ntris, m_pEnv->m_MinBound, m_pEnv->m_MaxBound );
+
+	// the top of the tree on this thread, down to where the subtrees are small enough to hand out
+	CKDSubtree top;
+	Refine( top, root_triangle_list.Base(), ntris, m_pEnv->m_MinBound, m_pEnv->m_MaxBound, 0, true );
+	root_triangle_list.Purge();
+
+	if ( m_pEnv->m_pfnParallelFor && m_Subtrees.Count() > 1 )
+		m_pEnv->m_pfnParallelFor( m_Subtrees.Count(), BuildSubtree, this );
+	else
+	{
+		for( int i = 0; i < m_Subtrees.Count(); i++ )
+			BuildSubtree( i, this );
+	}
+
+	int nNodes = top.m_Nodes.Count();
+	int nIndices = top.m_TriIndices.Count();
+	for( int i = 0; i < m_Subtrees.Count(); i++ )
+	{
+		nNodes += m_Subtrees[i]->m_Nodes.Count();
+		nIndices += m_Subtrees[i]->m_TriIndices.Count();
+	}
+	m_pEnv->OptimizedKDTree.EnsureCapacity( nNodes );
+	m_pEnv->TriangleIndexList.EnsureCapacity( nIndices );
+
+	m_pEnv->OptimizedKDTree.AddToTail();
+	Flatten( top, 0, 0 );
+
+	m_Subtrees.PurgeAndDeleteElements();
+}
+
+
+void RayTracingEnvironment::BuildKDTreeBinned(void)
+{
+	CKDTreeBuilder builder( this );
+	builder.Build();
+}
+
+
+void RayTracingEnvironment::BuildKDTree(void)
+{
+	OptimizedKDTree.RemoveAll();
+	TriangleIndexList.RemoveAll();
+
+	if ( !( Flags & RTE_FLAGS_REFERENCE_TREE_GENERATION ) )
+	{
+		BuildKDTreeBinned();
+		return;
+	}
+
 	CacheOptimizedKDNode root;
 	OptimizedKDTree.AddToTail(root);
 	int32 *root_triangle_list=new int32[OptimizedTriangleList.Count()];
@@ -880,13 +1664,24 @@ void RayTracingEnvironment::SetupAccelerationStructure(void)
 								m_MaxBound);
 	RefineNode(0,root_triangle_list,OptimizedTriangleList.Count(),m_MinBound,m_MaxBound,0);
 	delete[] root_triangle_list;
+}
+
 
+void RayTracingEnvironment::ConvertTrianglesToIntersectionFormat(void)
+{
 	// now, convert all triangles to "intersection format"
 	for(int i=0;i<OptimizedTriangleList.Count();i++)
 		OptimizedTriangleList[i].ChangeIntoIntersectionFormat();
 }
 
 
+void RayTracingEnvironment::SetupAccelerationStructure(void)
+{
+	BuildKDTree();
+	ConvertTrianglesToIntersectionFormat();
+}
+
+
 
 void RayTracingEnvironment::AddInfinitePointLight(const Vector &position, const Vector &intensity)
 {
@@ -1,6 +1,6 @@
 //========= Copyright Valve Corporation, All rights reserved. ============//
 //
-// Purpose: 
+// Purpose:
 //
 // $Workfile:     $
 // $Date:         $
@@ -18,8 +18,17 @@
 #define NO_THREAD_NAMES
 #include "threads.h"
 #include "pacifier.h"
+#include "tier0/threadtools.h"
 
-#define	MAX_THREADS	32
+// How many runs can be shared with the pool at once (nested runs each take one). Past that a run
+// just happens on the thread that asked for it.
+#define	MAX_THREAD_JOBS	64
+
+// A thread's remaining [begin, end) of a job's work items, packed so that taking from the front
+// (the owner) and splitting off the back (a thief) are both a single compare-exchange.
+#define PACK_RANGE( begin, end )	( ( (int64)(end) << 32 ) | (uint32)(begin) )
+#define RANGE_BEGIN( range )		( (int)( (range) & 0xFFFFFFFF ) )
+#define RANGE_END( range )			( (int)( (range) >> 32 ) )
 
 
 class CRunThreadsData
@@ -30,71 +39,593 @@ public:
 	RunThreadsFn m_Fn;
 };
 
-CRunThreadsData g_RunThreadsData[MAX_THREADS];
+CUtlVector<CRunThreadsData> g_RunThreadsData;
 
 
-int		dispatch;
-int		workcount;
 qboolean		pacifier;
 
 qboolean	threaded;
 bool g_bLowPriorityThreads = false;
 
-HANDLE g_ThreadHandles[MAX_THREADS];
+CUtlVector<HANDLE> g_ThreadHandles;
+
+
+CToolThreadArrayBase *CToolThreadArrayBase::s_pHead = NULL;
+
+CToolThreadArrayBase::CToolThreadArrayBase()
+{
+	m_pNext = s_pHead;
+	s_pHead = this;
+}
 
+void CToolThreadArrayBase::SetAllThreadCounts( int nThreads )
+{
+	for ( CToolThreadArrayBase *pArray = s_pHead; pArray; pArray = pArray->m_pNext )
+		pArray->SetThreadCount( nThreads );
+}
 
 
 /*
-=============
-GetThreadWork
+===================================================================
 
-=============
+WORK STEALING POOL
+
+===================================================================
 */
-int	GetThreadWork (void)
+
+enum EThreadJobState
 {
-	int	r;
+	k_eThreadJob_Free=0,
+	k_eThreadJob_Owned,		// Being set up or torn down by the thread that runs it
+	k_eThreadJob_Active		// The pool threads can take work from it
+};
+
+class CThreadJob
+{
+public:
+	long volatile	m_nState;
+	long volatile	m_nUsers;			// Pool threads looking at the job, it can't be reused until they're out
+
+	ThreadRangeFn	m_RangeFn;			// RunThreadsOnRange jobs
+	RunThreadsFn	m_ThreadFn;			// RunThreadsOn jobs, called once per thread and takes items through GetThreadWork
+	void			*m_pUserData;
+	int				m_nWorkCount;
+	int				m_nChunkSize;
+	bool			m_bInOrder;			// Hand the items out in ascending order from m_nNextItem instead of per thread ranges
+
+	long volatile	m_nNextItem;		// In order jobs: the next item to hand out
+	long volatile	m_nItemsLeft;		// Range jobs: not finished yet. RunThreadsOn jobs: not handed out yet.
+	long volatile	m_nCallsRunning;	// m_ThreadFn calls that haven't returned
+	long volatile	m_bDone;
+	HANDLE			m_hDoneEvent;		// Signalled with m_bDone, for a caller outside the pool
+
+	int64 volatile	*m_pRanges;			// Per pool thread
+	bool			*m_pEntered;		// Per pool thread, whether it called m_ThreadFn yet
+};
+
+class CToolThread
+{
+public:
+	HANDLE	m_hThread;
+	int		m_nDepth;			// Work items this thread is inside of, only the outermost one counts as busy
+	double	m_flBusyTime;		// Seconds spent running work items
+	int		m_nSteals;
+};
+
+static CThreadJob g_ThreadJobs[MAX_THREAD_JOBS];
+static CToolThread *g_pToolThreads = NULL;
+static int g_nToolThreads = 0;
+static HANDLE g_hWorkSemaphore = NULL;
+static bool volatile g_bStopToolThreads = false;
+
+// Index + 1 of the pool thread this is, 0 outside the pool
+static CTHREADLOCALINT g_iToolThread;
+// The RunThreadsOn job GetThreadWork takes from
+static CTHREADLOCALPTR( CThreadJob ) g_pCurrentJob;
+
 
-	ThreadLock ();
+static inline int64 ReadRange( int64 volatile *pRange )
+{
+	// A plain 64 bit read can tear on 32 bit builds
+	return ThreadInterlockedCompareExchange64( pRange, 0, 0 );
+}
 
-	if (dispatch == workcount)
+// Takes up to nMax items from the front of the thread's own range.
+static bool PopWork( CThreadJob *pJob, int iThread, int nMax, int &iStart, int &iEnd )
+{
+	int64 volatile *pRange = &pJob->m_pRanges[iThread];
+	while ( 1 )
 	{
-		ThreadUnlock ();
-		return -1;
+		int64 range = ReadRange( pRange );
+		int iBegin = RANGE_BEGIN( range );
+		int iRangeEnd = RANGE_END( range );
+		if ( iBegin >= iRangeEnd )
+			return false;
+
+		int iTake = min( nMax, iRangeEnd - iBegin );
+		if ( ThreadInterlockedAssignIf64( pRange, PACK_RANGE( iBegin + iTake, iRangeEnd ), range ) )
+		{
+			iStart = iBegin;
+			iEnd = iBegin + iTake;
+			return true;
+		}
+	}
+}
+
+// Moves the back half of another thread's range (or all of it when it's small) into this thread's
+// own range, which has to be empty.
+static bool StealWork( CThreadJob *pJob, int iThread )
+{
+	for ( int i=1; i < g_nToolThreads; i++ )
+	{
+		int iVictim = ( iThread + i ) % g_nToolThreads;
+		int64 volatile *pRange = &pJob->m_pRanges[iVictim];
+
+		while ( 1 )
+		{
+			int64 range = ReadRange( pRange );
+			int iBegin = RANGE_BEGIN( range );
+			int iRangeEnd = RANGE_END( range );
+			int nLeft = iRangeEnd - iBegin;
+			if ( nLeft <= 0 )
+				break;
+
+			int iSplit = nLeft <= pJob->m_nChunkSize ? iBegin : iBegin + nLeft / 2;
+			if ( !ThreadInterlockedAssignIf64( pRange, PACK_RANGE( iBegin, iSplit ), range ) )
+				continue;
+
+			ThreadInterlockedExchange64( &pJob->m_pRanges[iThread], PACK_RANGE( iSplit, iRangeEnd ) );
+			g_pToolThreads[iThread].m_nSteals++;
+
+			// Still worth splitting, so get a sleeping thread to come take some of it
+			if ( iRangeEnd - iSplit > pJob->m_nChunkSize )
+				ReleaseSemaphore( g_hWorkSemaphore, 1, NULL );
+
+			return true;
+		}
 	}
 
-	UpdatePacifier( (float)dispatch / workcount );
+	return false;
+}
+
+// Takes the next up to nMax items for the thread. In order jobs share one cursor, the rest take from
+// the thread's own range and steal when it's empty.
+static bool TakeWork( CThreadJob *pJob, int iThread, int nMax, int &iStart, int &iEnd )
+{
+	if ( pJob->m_bInOrder )
+	{
+		iStart = ThreadInterlockedExchangeAdd( &pJob->m_nNextItem, nMax );
+		if ( iStart >= pJob->m_nWorkCount )
+			return false;
+
+		iEnd = min( iStart + nMax, pJob->m_nWorkCount );
+		return true;
+	}
 
-	r = dispatch;
-	dispatch++;
-	ThreadUnlock ();
+	return PopWork( pJob, iThread, nMax, iStart, iEnd ) ||
+		( StealWork( pJob, iThread ) && PopWork( pJob, iThread, nMax, iStart, iEnd ) );
+}
 
-	return r;
+static void FinishJob( CThreadJob *pJob )
+{
+	if ( ThreadInterlockedExchange( &pJob->m_bDone, 1 ) == 0 && pJob->m_hDoneEvent )
+		SetEvent( pJob->m_hDoneEvent );
 }
 
+static void BeginWorkItem( int iThread, double &flStart )
+{
+	CToolThread &thread = g_pToolThreads[iThread];
+	if ( thread.m_nDepth++ == 0 )
+		flStart = Plat_FloatTime();
+}
 
-ThreadWorkerFn workfunction;
+static void EndWorkItem( int iThread, double flStart )
+{
+	CToolThread &thread = g_pToolThreads[iThread];
+	if ( --thread.m_nDepth == 0 )
+		thread.m_flBusyTime += Plat_FloatTime() - flStart;
+}
 
-void ThreadWorkerFunction( int iThread, void *pUserData )
+// Does whatever this thread can of the job, returns true if it did anything.
+static bool WorkOnJob( CThreadJob *pJob, int iThread )
 {
-	int		work;
+	double flStart = 0.0;
 
-	while (1)
+	if ( pJob->m_ThreadFn )
 	{
-		work = GetThreadWork ();
-		if (work == -1)
-			break;
-		 
-		workfunction( iThread, work );
+		if ( pJob->m_pEntered[iThread] || pJob->m_nItemsLeft <= 0 )
+			return false;
+
+		pJob->m_pEntered[iThread] = true;
+		ThreadInterlockedIncrement( &pJob->m_nCallsRunning );
+
+		CThreadJob *pOuterJob = g_pCurrentJob;
+		g_pCurrentJob = pJob;
+
+		BeginWorkItem( iThread, flStart );
+		pJob->m_ThreadFn( iThread, pJob->m_pUserData );
+		EndWorkItem( iThread, flStart );
+
+		g_pCurrentJob = pOuterJob;
+
+		if ( ThreadInterlockedDecrement( &pJob->m_nCallsRunning ) == 0 && pJob->m_nItemsLeft <= 0 )
+			FinishJob( pJob );
+
+		return true;
 	}
+
+	bool bDidWork = false;
+	int iStart, iEnd;
+	while ( TakeWork( pJob, iThread, pJob->m_nChunkSize, iStart, iEnd ) )
+	{
+		BeginWorkItem( iThread, flStart );
+		pJob->m_RangeFn( iThread, iStart, iEnd, pJob->m_pUserData );
+		EndWorkItem( iThread, flStart );
+
+		if ( ThreadInterlockedExchangeAdd( &pJob->m_nItemsLeft, -( iEnd - iStart ) ) == iEnd - iStart )
+			FinishJob( pJob );
+
+		bDidWork = true;
+	}
+
+	return bDidWork;
 }
 
-void RunThreadsOnIndividual (int workcnt, qboolean showpacifier, ThreadWorkerFn func)
+static bool FindWork( int iThread )
+{
+	bool bDidWork = false;
+	for ( int i=0; i < MAX_THREAD_JOBS; i++ )
+	{
+		CThreadJob *pJob = &g_ThreadJobs[i];
+		if ( pJob->m_nState != k_eThreadJob_Active )
+			continue;
+
+		// Check again after registering, the owner waits for users to leave before reusing the job
+		ThreadInterlockedIncrement( &pJob->m_nUsers );
+		if ( pJob->m_nState == k_eThreadJob_Active )
+			bDidWork |= WorkOnJob( pJob, iThread );
+		ThreadInterlockedDecrement( &pJob->m_nUsers );
+	}
+
+	return bDidWork;
+}
+
+DWORD WINAPI ToolThreadFn( LPVOID pParameter )
+{
+	int iThread = (int)(intp)pParameter;
+	g_iToolThread = iThread + 1;
+
+	while ( !g_bStopToolThreads )
+	{
+		if ( !FindWork( iThread ) )
+			WaitForSingleObject( g_hWorkSemaphore, INFINITE );
+	}
+
+	return 0;
+}
+
+
+// GetActiveProcessorCount and friends only exist from Windows 7 on, and without them a process
+// can't see or use more than one group of 64 processors.
+struct ToolGroupAffinity_t
+{
+	ULONG_PTR	m_Mask;
+	WORD		m_nGroup;
+	WORD		m_Reserved[3];
+};
+
+typedef DWORD (WINAPI *GetActiveProcessorCountFn)( WORD nGroup );
+typedef WORD (WINAPI *GetActiveProcessorGroupCountFn)();
+typedef BOOL (WINAPI *SetThreadGroupAffinityFn)( HANDLE hThread, const ToolGroupAffinity_t *pAffinity, ToolGroupAffinity_t *pOldAffinity );
+
+#define ALL_PROCESSOR_GROUPS_INDEX	0xffff
+
+static int GetProcessorCount()
+{
+	HMODULE hKernel = GetModuleHandleA( "kernel32.dll" );
+	GetActiveProcessorCountFn pGetActiveProcessorCount = hKernel ? (GetActiveProcessorCountFn)GetProcAddress( hKernel, "GetActiveProcessorCount" ) : NULL;
+	if ( pGetActiveProcessorCount )
+		return pGetActiveProcessorCount( ALL_PROCESSOR_GROUPS_INDEX );
+
+	SYSTEM_INFO info;
+	GetSystemInfo (&info);
+	return info.dwNumberOfProcessors;
+}
+
+// Spreads the threads over the processor groups, filling each group before the next.
+static void SetProcessorGroup( HANDLE hThread, int iThread )
 {
-	if (numthreads == -1)
+	HMODULE hKernel = GetModuleHandleA( "kernel32.dll" );
+	if ( !hKernel )
+		return;
+
+	GetActiveProcessorCountFn pGetActiveProcessorCount = (GetActiveProcessorCountFn)GetProcAddress( hKernel, "GetActiveProcessorCount" );
+	GetActiveProcessorGroupCountFn pGetActiveProcessorGroupCount = (GetActiveProcessorGroupCountFn)GetProcAddress( hKernel, "GetActiveProcessorGroupCount" );
+	SetThreadGroupAffinityFn pSetThreadGroupAffinity = (SetThreadGroupAffinityFn)GetProcAddress( hKernel, "SetThreadGroupAffinity" );
+	if ( !pGetActiveProcessorCount || !pGetActiveProcessorGroupCount || !pSetThreadGroupAffinity )
+		return;
+
+	int nGroups = pGetActiveProcessorGroupCount();
+	if ( nGroups <= 1 )
+		return;
+
+	int iProcessor = iThread % pGetActiveProcessorCount( ALL_PROCESSOR_GROUPS_INDEX );
+	for ( int iGroup=0; iGroup < nGroups; iGroup++ )
+	{
+		int nInGroup = pGetActiveProcessorCount( iGroup );
+		if ( iProcessor < nInGroup )
+		{
+			ToolGroupAffinity_t affinity;
+			memset( &affinity, 0, sizeof( affinity ) );
+			affinity.m_Mask = nInGroup >= (int)( sizeof( ULONG_PTR ) * 8 ) ? ~(ULONG_PTR)0 : ( (ULONG_PTR)1 << nInGroup ) - 1;
+			affinity.m_nGroup = iGroup;
+			pSetThreadGroupAffinity( hThread, &affinity, NULL );
+			return;
+		}
+
+		iProcessor -= nInGroup;
+	}
+}
+
+
+static void StopToolThreads()
+{
+	if ( !g_pToolThreads )
+		return;
+
+	g_bStopToolThreads = true;
+	ReleaseSemaphore( g_hWorkSemaphore, g_nToolThreads, NULL );
+
+	for ( int i=0; i < g_nToolThreads; i++ )
+	{
+		WaitForSingleObject( g_pToolThreads[i].m_hThread, INFINITE );
+		CloseHandle( g_pToolThreads[i].m_hThread );
+	}
+
+	for ( int i=0; i < MAX_THREAD_JOBS; i++ )
+	{
+		delete [] g_ThreadJobs[i].m_pRanges;
+		delete [] g_ThreadJobs[i].m_pEntered;
+		g_ThreadJobs[i].m_pRanges = NULL;
+		g_ThreadJobs[i].m_pEntered = NULL;
+	}
+
+	delete [] g_pToolThreads;
+	g_pToolThreads = NULL;
+	g_nToolThreads = 0;
+	g_bStopToolThreads = false;
+}
+
+// Starts the pool (again, if numthreads changed), only from outside of it.
+static void StartToolThreads()
+{
+	if ( numthreads == -1 )
 		ThreadSetDefault ();
-	
-	workfunction = func;
-	RunThreadsOn (workcnt, showpacifier, ThreadWorkerFunction);
+
+	Assert( numthreads > 0 );
+	CToolThreadArrayBase::SetAllThreadCounts( numthreads );
+
+	if ( g_pToolThreads && g_nToolThreads != numthreads )
+		StopToolThreads();
+
+	if ( !g_hWorkSemaphore )
+		g_hWorkSemaphore = CreateSemaphore( NULL, 0, 0x7fffffff, NULL );
+
+	if ( !g_pToolThreads )
+	{
+		g_nToolThreads = numthreads;
+		g_pToolThreads = new CToolThread[g_nToolThreads];
+		memset( g_pToolThreads, 0, g_nToolThreads * sizeof( CToolThread ) );
+
+		for ( int i=0; i < MAX_THREAD_JOBS; i++ )
+		{
+			g_ThreadJobs[i].m_pRanges = new int64[g_nToolThreads];
+			g_ThreadJobs[i].m_pEntered = new bool[g_nToolThreads];
+		}
+
+		for ( int i=0; i < g_nToolThreads; i++ )
+		{
+			DWORD dwDummy;
+			g_pToolThreads[i].m_hThread = CreateThread( NULL, 0, ToolThreadFn, (LPVOID)(intp)i, 0, &dwDummy );
+			SetProcessorGroup( g_pToolThreads[i].m_hThread, i );
+		}
+	}
+
+	for ( int i=0; i < g_nToolThreads; i++ )
+		SetThreadPriority( g_pToolThreads[i].m_hThread, g_bLowPriorityThreads ? THREAD_PRIORITY_LOWEST : THREAD_PRIORITY_NORMAL );
+}
+
+// Runs a job on the pool and waits for it. A pool thread works on the job itself while it waits,
+// anything else sleeps and keeps the pacifier going.
+static void RunJob( CThreadJob &setup, qboolean showpacifier )
+{
+	int iToolThread = g_iToolThread - 1;
+	if ( setup.m_nWorkCount <= 0 )
+		return;
+
+	CThreadJob *pJob = NULL;
+	for ( int i=0; i < MAX_THREAD_JOBS && !pJob; i++ )
+	{
+		if ( ThreadInterlockedAssignIf( &g_ThreadJobs[i].m_nState, k_eThreadJob_Owned, k_eThreadJob_Free ) )
+			pJob = &g_ThreadJobs[i];
+	}
+
+	if ( !pJob )
+	{
+		// Too deeply nested to share, this thread does it all
+		Assert( iToolThread >= 0 );
+		if ( setup.m_RangeFn )
+		{
+			setup.m_RangeFn( iToolThread, 0, setup.m_nWorkCount, setup.m_pUserData );
+		}
+		else
+		{
+			Error( "RunThreadsOn: out of thread jobs\n" );
+		}
+		return;
+	}
+
+	pJob->m_RangeFn = setup.m_RangeFn;
+	pJob->m_ThreadFn = setup.m_ThreadFn;
+	pJob->m_pUserData = setup.m_pUserData;
+	pJob->m_nWorkCount = setup.m_nWorkCount;
+	pJob->m_nChunkSize = max( setup.m_nChunkSize, 1 );
+	pJob->m_bInOrder = setup.m_bInOrder;
+	pJob->m_nNextItem = 0;
+	pJob->m_nItemsLeft = setup.m_nWorkCount;
+	pJob->m_nCallsRunning = 0;
+	pJob->m_bDone = 0;
+	if ( iToolThread < 0 && !pJob->m_hDoneEvent )
+		pJob->m_hDoneEvent = CreateEvent( NULL, FALSE, FALSE, NULL );
+
+	for ( int i=0; i < g_nToolThreads; i++ )
+	{
+		int64 iBegin = (int64)setup.m_nWorkCount * i / g_nToolThreads;
+		int64 iEnd = (int64)setup.m_nWorkCount * ( i + 1 ) / g_nToolThreads;
+		pJob->m_pRanges[i] = PACK_RANGE( iBegin, iEnd );
+		pJob->m_pEntered[i] = false;
+	}
+
+	ThreadInterlockedExchange( &pJob->m_nState, k_eThreadJob_Active );
+	ReleaseSemaphore( g_hWorkSemaphore, g_nToolThreads, NULL );
+
+	if ( iToolThread >= 0 )
+	{
+		while ( !pJob->m_bDone )
+		{
+			if ( !WorkOnJob( pJob, iToolThread ) )
+				ThreadPause();
+		}
+	}
+	else
+	{
+		// The event can be left over from a nested job that had this slot, so it's only a hint
+		while ( !pJob->m_bDone )
+		{
+			WaitForSingleObject( pJob->m_hDoneEvent, 100 );
+			if ( showpacifier )
+				UpdatePacifier( 1.0f - (float)pJob->m_nItemsLeft / pJob->m_nWorkCount );
+		}
+	}
+
+	ThreadInterlockedExchange( &pJob->m_nState, k_eThreadJob_Owned );
+	while ( pJob->m_nUsers > 0 )
+		ThreadPause();
+	ThreadInterlockedExchange( &pJob->m_nState, k_eThreadJob_Free );
+}
+
+static double GetToolThreadBusyTime( int *pSteals )
+{
+	double flBusy = 0.0;
+	int nSteals = 0;
+	for ( int i=0; i < g_nToolThreads; i++ )
+	{
+		flBusy += g_pToolThreads[i].m_flBusyTime;
+		nSteals += g_pToolThreads[i].m_nSteals;
+	}
+
+	if ( pSteals )
+		*pSteals = nSteals;
+	return flBusy;
+}
+
+// Wraps a run with the pacifier and the stage's timing. Only the outermost run (from outside the pool) reports.
+static void RunStage( CThreadJob &setup, qboolean showpacifier )
+{
+	if ( g_iToolThread > 0 )
+	{
+		RunJob( setup, false );
+		return;
+	}
+
+	int		start, end;
+	double	flStart = Plat_FloatTime();
+
+	start = flStart;
+	StartPacifier("");
+	pacifier = showpacifier;
+
+	threaded = true;
+
+	StartToolThreads();
+
+	int nStartSteals;
+	double flStartBusy = GetToolThreadBusyTime( &nStartSteals );
+
+	RunJob( setup, showpacifier );
+
+	int nSteals;
+	double flBusy = GetToolThreadBusyTime( &nSteals ) - flStartBusy;
+	double flElapsed = Plat_FloatTime() - flStart;
+
+	threaded = false;
+
+	end = Plat_FloatTime();
+	if (pacifier)
+	{
+		EndPacifier(false);
+
+		// How much of the time the threads spent on work items rather than waiting for them
+		float flUtilization = flElapsed > 0.0 ? 100.0f * flBusy / ( flElapsed * g_nToolThreads ) : 100.0f;
+		printf (" (%i, %.0f%% of %i threads, %i steals)\n", end-start, min( flUtilization, 100.0f ), g_nToolThreads, nSteals - nStartSteals);
+	}
+}
+
+
+/*
+=============
+GetThreadWork
+
+=============
+*/
+int	GetThreadWork (void)
+{
+	CThreadJob *pJob = g_pCurrentJob;
+	int iThread = g_iToolThread - 1;
+	if ( !pJob || iThread < 0 )
+	{
+		Assert( !"GetThreadWork called outside of RunThreadsOn" );
+		return -1;
+	}
+
+	int iStart, iEnd;
+	if ( !TakeWork( pJob, iThread, 1, iStart, iEnd ) )
+		return -1;
+
+	ThreadInterlockedDecrement( &pJob->m_nItemsLeft );
+	return iStart;
+}
+
+
+class CIndividualWorkData
+{
+public:
+	ThreadWorkerFn m_Fn;
+};
+
+static void IndividualRangeFn( int iThread, int iStart, int iEnd, void *pUserData )
+{
+	CIndividualWorkData *pData = (CIndividualWorkData*)pUserData;
+	for ( int i=iStart; i < iEnd; i++ )
+		pData->m_Fn( iThread, i );
+}
+
+void RunThreadsOnIndividual (int workcnt, qboolean showpacifier, ThreadWorkerFn func)
+{
+	CIndividualWorkData data;
+	data.m_Fn = func;
+
+	// One at a time, the items these are used for can take wildly different times. Callers like vvis
+	// sort their items so the ones the others depend on come first, so they go out in order.
+	CThreadJob setup;
+	memset( &setup, 0, sizeof( setup ) );
+	setup.m_RangeFn = IndividualRangeFn;
+	setup.m_pUserData = &data;
+	setup.m_nWorkCount = workcnt;
+	setup.m_nChunkSize = 1;
+	setup.m_bInOrder = true;
+
+	RunStage( setup, showpacifier );
 }
 
 
@@ -130,16 +661,15 @@ void SetLowPriority()
 
 void ThreadSetDefault (void)
 {
-	SYSTEM_INFO info;
-
 	if (numthreads == -1)	// not set manually
 	{
-		GetSystemInfo (&info);
-		numthreads = info.dwNumberOfProcessors;
-		if (numthreads < 1 || numthreads > 32)
+		numthreads = GetProcessorCount();
+		if (numthreads < 1)
 			numthreads = 1;
 	}
 
+	CToolThreadArrayBase::SetAllThreadCounts( numthreads );
+
 	Msg ("%i threads\n", numthreads);
 }
 
@@ -179,8 +709,10 @@ void RunThreads_Start( RunThreadsFn fn, void *pUserData, ERunThreadsPriority ePr
 	Assert( numthreads > 0 );
 	threaded = true;
 
-	if ( numthreads > MAX_TOOL_THREADS )
-		numthreads = MAX_TOOL_THREADS;
+	CToolThreadArrayBase::SetAllThreadCounts( numthreads );
+
+	g_RunThreadsData.SetCount( numthreads );
+	g_ThreadHandles.SetCount( numthreads );
 
 	for ( int i=0; i < numthreads ;i++ )
 	{
@@ -197,6 +729,8 @@ void RunThreads_Start( RunThreadsFn fn, void *pUserData, ERunThreadsPriority ePr
 		   0,			// DWORD fdwCreate,
 		   &dwDummy );
 
+		SetProcessorGroup( g_ThreadHandles[i], i );
+
 		if ( ePriority == k_eRunThreadsPriority_UseGlobalState )
 		{
 			if( g_bLowPriorityThreads )
@@ -212,13 +746,18 @@ void RunThreads_Start( RunThreadsFn fn, void *pUserData, ERunThreadsPriority ePr
 
 void RunThreads_End()
 {
-	WaitForMultipleObjects( numthreads, g_ThreadHandles, TRUE, INFINITE );
-	for ( int i=0; i < numthreads; i++ )
+	// WaitForMultipleObjects can't take more than MAXIMUM_WAIT_OBJECTS handles
+	for ( int i=0; i < g_ThreadHandles.Count(); i++ )
+	{
+		WaitForSingleObject( g_ThreadHandles[i], INFINITE );
 		CloseHandle( g_ThreadHandles[i] );
+	}
+
+	g_ThreadHandles.RemoveAll();
 
 	threaded = false;
 }
-	
+
 
 /*
 =============
@@ -227,31 +766,25 @@ RunThreadsOn
 */
 void RunThreadsOn( int workcnt, qboolean showpacifier, RunThreadsFn fn, void *pUserData )
 {
-	int		start, end;
-
-	start = Plat_FloatTime();
-	dispatch = 0;
-	workcount = workcnt;
-	StartPacifier("");
-	pacifier = showpacifier;
-
-#ifdef _PROFILE
-	threaded = false;
-	(*func)( 0 );
-	return;
-#endif
-
-	
-	RunThreads_Start( fn, pUserData );
-	RunThreads_End();
-
-
-	end = Plat_FloatTime();
-	if (pacifier)
-	{
-		EndPacifier(false);
-		printf (" (%i)\n", end-start);
-	}
+	CThreadJob setup;
+	memset( &setup, 0, sizeof( setup ) );
+	setup.m_ThreadFn = fn;
+	setup.m_pUserData = pUserData;
+	setup.m_nWorkCount = workcnt;
+	setup.m_nChunkSize = 1;
+	setup.m_bInOrder = true;
+
+	RunStage( setup, showpacifier );
 }
 
-
+void RunThreadsOnRange( int workcnt, int chunkSize, qboolean showpacifier, ThreadRangeFn fn, void *pUserData )
+{
+	CThreadJob setup;
+	memset( &setup, 0, sizeof( setup ) );
+	setup.m_RangeFn = fn;
+	setup.m_pUserData = pUserData;
+	setup.m_nWorkCount = workcnt;
+	setup.m_nChunkSize = chunkSize;
+
+	RunStage( setup, showpacifier );
+}
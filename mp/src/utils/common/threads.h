@@ -16,10 +16,12 @@
 #pragma once
 
 
-// Arrays that are indexed by thread should always be MAX_TOOL_THREADS+1
-// large so THREADINDEX_MAIN can be used from the main thread.
-#define MAX_TOOL_THREADS	32
-#define THREADINDEX_MAIN	(MAX_TOOL_THREADS)
+#include "tier1/utlvector.h"
+
+
+// Arrays that are indexed by thread should always be numthreads+1 large (see CToolThreadArray)
+// so THREADINDEX_MAIN can be used from the main thread.
+#define THREADINDEX_MAIN	(numthreads)
 
 
 extern	int		numthreads;
@@ -29,6 +31,8 @@ extern bool	g_bLowPriorityThreads;
 
 typedef void (*ThreadWorkerFn)( int iThread, int iWorkItem );
 typedef void (*RunThreadsFn)( int iThread, void *pUserData );
+// Runs work items [iStart, iEnd).
+typedef void (*ThreadRangeFn)( int iThread, int iStart, int iEnd, void *pUserData );
 
 
 enum ERunThreadsPriority
@@ -43,12 +47,24 @@ enum ERunThreadsPriority
 void SetLowPriority();
 
 void ThreadSetDefault (void);
+
+// Only valid inside a RunThreadsOn function. Returns -1 when there's no work left.
 int	GetThreadWork (void);
 
+// The RunThreadsOn* functions share their work out between a pool of numthreads threads, without taking a
+// lock per item. They can be called from inside another run's work items, the calling thread then works on
+// the inner run alongside any idle threads.
+
+// These hand the work items out one at a time in ascending order, like the old dispatch counter did.
 void RunThreadsOnIndividual ( int workcnt, qboolean showpacifier, ThreadWorkerFn fn );
 
 void RunThreadsOn ( int workcnt, qboolean showpacifier, RunThreadsFn fn, void *pUserData=NULL );
 
+// Hands out the work items in chunks of up to chunkSize, for items too cheap to be dispatched one at a time.
+// Each thread starts with an even slice of the items and steals half of another thread's remaining slice
+// when it runs out, so there's no order between the chunks.
+void RunThreadsOnRange ( int workcnt, int chunkSize, qboolean showpacifier, ThreadRangeFn fn, void *pUserData=NULL );
+
 // This version doesn't track work items - it just runs your function and waits for it to finish.
 void RunThreads_Start( RunThreadsFn fn, void *pUserData, ERunThreadsPriority ePriority=k_eRunThreadsPriority_UseGlobalState );
 void RunThreads_End();
@@ -57,9 +73,56 @@ void ThreadLock (void);
 void ThreadUnlock (void);
 
 
+// Base for the per thread arrays, so they can all be grown when the thread count is known.
+class CToolThreadArrayBase
+{
+public:
+	CToolThreadArrayBase();
+
+	virtual void SetThreadCount( int nThreads ) = 0;
+
+	static void SetAllThreadCounts( int nThreads );
+
+private:
+	CToolThreadArrayBase *m_pNext;
+	static CToolThreadArrayBase *s_pHead;
+};
+
+// An array with an entry per tool thread, plus one for THREADINDEX_MAIN. Entries start zeroed like the
+// fixed size arrays this replaces, and it's sized by ThreadSetDefault (or the first RunThreadsOn*), so it
+// can't be used before then. It only ever grows, so entries keep their contents.
+template< class T >
+class CToolThreadArray : public CToolThreadArrayBase
+{
+public:
+	T &operator[]( int iThread )
+	{
+		Assert( iThread >= 0 && iThread < m_Data.Count() );
+		return m_Data[iThread];
+	}
+
+	T *Base()			{ return m_Data.Base(); }
+	int Count() const	{ return m_Data.Count(); }
+
+	virtual void SetThreadCount( int nThreads )
+	{
+		int nOld = m_Data.Count();
+		if ( nThreads + 1 <= nOld )
+			return;
+
+		m_Data.SetCountNonDestructively( nThreads + 1 );
+		memset( &m_Data[nOld], 0, ( m_Data.Count() - nOld ) * sizeof( T ) );
+	}
+
+private:
+	CUtlVector<T> m_Data;
+};
+
+
 #ifndef NO_THREAD_NAMES
 #define RunThreadsOn(n,p,f) { if (p) printf("%-20s ", #f ":"); RunThreadsOn(n,p,f); }
 #define RunThreadsOnIndividual(n,p,f) { if (p) printf("%-20s ", #f ":"); RunThreadsOnIndividual(n,p,f); }
+#define RunThreadsOnRange(n,c,p,f,u) { if (p) printf("%-20s ", #f ":"); RunThreadsOnRange(n,c,p,f,u); }
 #endif
 
 #endif // THREADS_H
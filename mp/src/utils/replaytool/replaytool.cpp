@@ -0,0 +1,626 @@
+#include "cbase.h"
+
+#include "tier0/platform.h"
+#include "tier0/threadtools.h"
+#include "tier1/fmtstr.h"
+#include "tier1/utlstring.h"
+#include "in_buttons.h"
+
+#include "momentum/mom_shareddefs.h"
+#include "momentum/run/mom_replay_data.h"
+#include "momentum/run/mom_replay_factory.h"
+#include "momentum/run/mom_replay_layout.h"
+#include "momentum/run/mom_replay_stream.h"
+
+#include <stdio.h>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <dirent.h>
+#endif
+
+#include "tier0/memdbgon.h"
+
+// Vertical speed gained in a single tick while holding jump that counts as a jump (a jump is ~268 u/s)
+#define JUMP_IMPULSE_THRESHOLD 150.0f
+// Frames carry no ground information, so any vertical movement counts as being in the air
+#define AIRBORNE_SPEED_EPSILON 0.01f
+
+enum OutputFormat_t
+{
+    OUTPUT_CSV = 0,
+    OUTPUT_JSON,
+};
+
+static OutputFormat_t g_OutputFormat = OUTPUT_CSV;
+static int g_iCurveStep = 0;
+static int g_iThreads = 0;
+static int g_iBenchPasses = 0;
+
+// Overall (zone 0) run stats as written by CMomRunStats::Serialize
+struct StoredStats_t
+{
+    bool m_bValid;
+    uint8 m_iTotalZones;
+    uint32 m_iJumps, m_iStrafes;
+    float m_flSync, m_flSync2;
+    uint32 m_iEnterTick, m_iTicks;
+    float m_flVelMax3D, m_flVelMax2D, m_flVelAvg3D, m_flVelAvg2D;
+    float m_flEnter3D, m_flEnter2D, m_flExit3D, m_flExit2D;
+};
+
+struct RunAnalysis_t
+{
+    RunAnalysis_t() : m_bParsed(false), m_iVersion(0), m_iFileSize(0), m_iFrames(0)
+    {
+        V_memset(&m_Stored, 0, sizeof(m_Stored));
+        V_memset(&m_Computed, 0, sizeof(m_Computed));
+        m_iTeleports = 0;
+    }
+
+    CUtlString m_sFile;
+    bool m_bParsed;
+    uint8 m_iVersion;
+    int m_iFileSize;
+    int32 m_iFrames;
+    CReplayHeader m_Header;
+
+    StoredStats_t m_Stored;
+    StoredStats_t m_Computed; // Same stats recomputed from the frames
+    uint32 m_iTeleports;
+    CUtlVector<float> m_vecSpeedCurve; // Horizontal speed every g_iCurveStep ticks of the timed run
+};
+
+static void ReadStoredStats(CUtlBuffer &reader, StoredStats_t &stats)
+{
+    stats.m_bValid = true;
+    stats.m_iTotalZones = reader.GetUnsignedChar();
+
+    for (int i = 0; i < stats.m_iTotalZones + 1; ++i)
+    {
+        StoredStats_t zone;
+        zone.m_iJumps = reader.GetUnsignedInt();
+        zone.m_iStrafes = reader.GetUnsignedInt();
+        zone.m_flSync = reader.GetFloat();
+        zone.m_flSync2 = reader.GetFloat();
+        zone.m_iEnterTick = reader.GetUnsignedInt();
+        zone.m_iTicks = reader.GetUnsignedInt();
+        zone.m_flVelMax3D = reader.GetFloat();
+        zone.m_flVelMax2D = reader.GetFloat();
+        zone.m_flVelAvg3D = reader.GetFloat();
+        zone.m_flVelAvg2D = reader.GetFloat();
+        zone.m_flEnter3D = reader.GetFloat();
+        zone.m_flEnter2D = reader.GetFloat();
+        zone.m_flExit3D = reader.GetFloat();
+        zone.m_flExit2D = reader.GetFloat();
+
+        if (i == 0)
+        {
+            zone.m_bValid = true;
+            zone.m_iTotalZones = stats.m_iTotalZones;
+            stats = zone;
+        }
+    }
+}
+
+// Reads the file through the same layout code as CMomReplayV1/V3::Deserialize, only the stats are read
+// into StoredStats_t instead of CMomRunStats, which needs the game
+static bool ParseReplay(CUtlBuffer &reader, RunAnalysis_t &run, CUtlVector<CReplayFrame> &frames)
+{
+    frames.RemoveAll();
+
+    if (!ReplayLayout::ReadMagic(reader, run.m_iVersion))
+        return false;
+
+    switch (run.m_iVersion)
+    {
+    case 1:
+        {
+            run.m_Header = CReplayHeader(reader);
+            if (reader.GetUnsignedChar())
+                ReadStoredStats(reader, run.m_Stored);
+
+            if (!ReplayLayout::ReadFramesV1(reader, frames))
+                return false;
+        }
+        break;
+    case 3:
+        {
+            ReplayLayout::FrameInfo_t frameInfo;
+            ReplayLayout::ReadFrameInfo(reader, frameInfo);
+
+            run.m_Header = CReplayHeader(reader);
+            if (reader.GetUnsignedChar())
+                ReadStoredStats(reader, run.m_Stored);
+
+            CReplayFrameStream stream;
+            if (!ReplayLayout::LoadFramesV3(reader, frameInfo, stream) || !stream.DecodeAll(frames))
+                return false;
+        }
+        break;
+    default:
+        return false;
+    }
+
+    run.m_iFrames = frames.Count();
+    return reader.IsValid();
+}
+
+// Recomputes the overall run stats from the frames, the way CMomentumReplayGhostEntity::UpdateStats does
+static void AnalyzeRun(const CUtlVector<CReplayFrame> &frames, RunAnalysis_t &run)
+{
+    const float interval = run.m_Header.m_fTickInterval;
+    if (frames.Count() < 2 || interval <= 0.0f)
+        return;
+
+    const int start = clamp<int>(run.m_Header.m_iStartTick, 1, frames.Count() - 1);
+    const int stop = clamp<int>(run.m_Header.m_iStopTick, start, frames.Count() - 1);
+
+    StoredStats_t &stats = run.m_Computed;
+    stats.m_bValid = true;
+    stats.m_iEnterTick = start;
+    stats.m_iTicks = stop - start;
+
+    Vector prevVel = vec3_origin;
+    int prevButtons = frames[0].PlayerButtons();
+    double sum3D = 0.0, sum2D = 0.0;
+    int strafeTicks = 0, perfectSyncTicks = 0, accelTicks = 0;
+
+    for (int i = 1; i < frames.Count(); ++i)
+    {
+        const CReplayFrame &cur = frames[i], &prev = frames[i - 1];
+        if (cur.Teleported())
+            run.m_iTeleports++;
+
+        // Teleports would show up as huge speeds, hold on to the last real velocity instead
+        const Vector vel = cur.Teleported() ? prevVel : (cur.PlayerOrigin() - prev.PlayerOrigin()) / interval;
+        const int buttons = cur.PlayerButtons();
+
+        if (i >= start && i <= stop)
+        {
+            const float speed3D = vel.Length(), speed2D = vel.Length2D();
+
+            if (i == start)
+            {
+                stats.m_flEnter3D = speed3D;
+                stats.m_flEnter2D = speed2D;
+            }
+            if (i == stop)
+            {
+                stats.m_flExit3D = speed3D;
+                stats.m_flExit2D = speed2D;
+            }
+
+            stats.m_flVelMax3D = max(stats.m_flVelMax3D, speed3D);
+            stats.m_flVelMax2D = max(stats.m_flVelMax2D, speed2D);
+            sum3D += speed3D;
+            sum2D += speed2D;
+
+            if ((buttons & IN_JUMP) && vel.z - prevVel.z > JUMP_IMPULSE_THRESHOLD)
+                stats.m_iJumps++;
+
+            if (((buttons & IN_MOVELEFT) && !(prevButtons & IN_MOVELEFT)) ||
+                ((buttons & IN_MOVERIGHT) && !(prevButtons & IN_MOVERIGHT)))
+                stats.m_iStrafes++;
+
+            if (fabsf(vel.z) > AIRBORNE_SPEED_EPSILON)
+            {
+                const float yawDelta = AngleNormalize(cur.EyeAngles().y - prev.EyeAngles().y);
+                const bool bAccel = vel.Length2DSqr() > prevVel.Length2DSqr();
+
+                if (yawDelta > 0.0f) // turned left
+                {
+                    strafeTicks++;
+                    if ((buttons & IN_MOVELEFT) && !(buttons & IN_MOVERIGHT))
+                        perfectSyncTicks++;
+                    if (bAccel)
+                        accelTicks++;
+                }
+                else if (yawDelta < 0.0f) // turned right
+                {
+                    strafeTicks++;
+                    if ((buttons & IN_MOVERIGHT) && !(buttons & IN_MOVELEFT))
+                        perfectSyncTicks++;
+                    if (bAccel)
+                        accelTicks++;
+                }
+            }
+
+            if (g_iCurveStep > 0 && (i - start) % g_iCurveStep == 0)
+                run.m_vecSpeedCurve.AddToTail(speed2D);
+        }
+
+        prevVel = vel;
+        prevButtons = buttons;
+    }
+
+    const int timedTicks = stop - start + 1;
+    stats.m_flVelAvg3D = static_cast<float>(sum3D / timedTicks);
+    stats.m_flVelAvg2D = static_cast<float>(sum2D / timedTicks);
+
+    if (strafeTicks)
+    {
+        stats.m_flSync = (float(perfectSyncTicks) / float(strafeTicks)) * 100.0f;
+        stats.m_flSync2 = (float(accelTicks) / float(strafeTicks)) * 100.0f;
+    }
+}
+
+static bool ReadFileToBuffer(const char *pFileName, CUtlBuffer &buf)
+{
+    FILE *pFile = fopen(pFileName, "rb");
+    if (!pFile)
+        return false;
+
+    fseek(pFile, 0, SEEK_END);
+    const long size = ftell(pFile);
+    fseek(pFile, 0, SEEK_SET);
+
+    buf.Clear();
+    if (size <= 0)
+    {
+        fclose(pFile);
+        return false;
+    }
+
+    buf.EnsureCapacity(size);
+    const size_t read = fread(buf.Base(), 1, size, pFile);
+    fclose(pFile);
+
+    buf.SeekPut(CUtlBuffer::SEEK_HEAD, static_cast<int>(read));
+    return read == static_cast<size_t>(size);
+}
+
+static void AddReplayFiles(const char *pPath, CUtlVector<RunAnalysis_t *> &runs)
+{
+    if (V_stristr(pPath, EXT_RECORDING_FILE))
+    {
+        const auto pRun = new RunAnalysis_t;
+        pRun->m_sFile = pPath;
+        runs.AddToTail(pRun);
+        return;
+    }
+
+#ifdef _WIN32
+    _finddata_t data;
+    const intptr_t hFind = _findfirst(CFmtStr("%s\\*%s", pPath, EXT_RECORDING_FILE), &data);
+    if (hFind == -1)
+        return;
+
+    do
+    {
+        const auto pRun = new RunAnalysis_t;
+        pRun->m_sFile = CFmtStr("%s\\%s", pPath, data.name).Get();
+        runs.AddToTail(pRun);
+    } while (_findnext(hFind, &data) == 0);
+
+    _findclose(hFind);
+#else
+    DIR *pDir = opendir(pPath);
+    if (!pDir)
+        return;
+
+    while (dirent *pEntry = readdir(pDir))
+    {
+        if (!V_stristr(pEntry->d_name, EXT_RECORDING_FILE))
+            continue;
+
+        const auto pRun = new RunAnalysis_t;
+        pRun->m_sFile = CFmtStr("%s/%s", pPath, pEntry->d_name).Get();
+        runs.AddToTail(pRun);
+    }
+
+    closedir(pDir);
+#endif
+}
+
+struct WorkerState_t
+{
+    CUtlVector<RunAnalysis_t *> *m_pRuns;
+    CInterlockedInt *m_pNextRun;
+
+    // Totals for the benchmark
+    int64 m_iBytes;
+    int64 m_iFrames;
+    int m_iReplays;
+};
+
+// Workers pull the next file off a shared counter, so a few huge replays don't leave the other cores idle
+static unsigned WorkerThread(void *pParam)
+{
+    WorkerState_t *pState = static_cast<WorkerState_t *>(pParam);
+    const int runCount = pState->m_pRuns->Count();
+    const int passes = max(g_iBenchPasses, 1);
+
+    CUtlBuffer buf;
+    CUtlVector<CReplayFrame> frames;
+
+    for (int work = (*pState->m_pNextRun)++; work < runCount * passes; work = (*pState->m_pNextRun)++)
+    {
+        RunAnalysis_t *pShared = pState->m_pRuns->Element(work % runCount);
+
+        // Benchmark passes of the same file can run on several threads at once, so each one parses into
+        // its own copy and only the first pass reports whether the file could be read
+        RunAnalysis_t benchRun;
+        RunAnalysis_t *pRun = pShared;
+        if (g_iBenchPasses)
+        {
+            benchRun.m_sFile = pShared->m_sFile;
+            pRun = &benchRun;
+        }
+
+        if (!ReadFileToBuffer(pRun->m_sFile, buf))
+            continue;
+
+        pRun->m_iFileSize = buf.TellPut();
+        pRun->m_bParsed = ParseReplay(buf, *pRun, frames);
+
+        pState->m_iBytes += pRun->m_iFileSize;
+        pState->m_iFrames += frames.Count();
+        pState->m_iReplays++;
+
+        if (!g_iBenchPasses)
+        {
+            if (pRun->m_bParsed)
+                AnalyzeRun(frames, *pRun);
+        }
+        else if (work < runCount)
+        {
+            pShared->m_bParsed = pRun->m_bParsed;
+        }
+    }
+
+    return 0;
+}
+
+static void WriteJsonString(CUtlBuffer &out, const char *pString)
+{
+    out.PutChar('"');
+    for (const char *p = pString; *p; ++p)
+    {
+        const unsigned char c = *p;
+        if (c == '"' || c == '\\')
+            out.Printf("\\%c", c);
+        else if (c < 0x20)
+            out.Printf("\\u%04x", c);
+        else
+            out.PutChar(c);
+    }
+    out.PutChar('"');
+}
+
+static void WriteJsonStats(CUtlBuffer &out, const char *pName, const StoredStats_t &stats)
+{
+    out.Printf("\"%s\": ", pName);
+    if (!stats.m_bValid)
+    {
+        out.PutString("null");
+        return;
+    }
+
+    out.Printf("{\"jumps\": %u, \"strafes\": %u, \"sync\": %.3f, \"sync2\": %.3f, \"ticks\": %u, "
+               "\"vel_max_3d\": %.3f, \"vel_max_2d\": %.3f, \"vel_avg_3d\": %.3f, \"vel_avg_2d\": %.3f, "
+               "\"enter_3d\": %.3f, \"enter_2d\": %.3f, \"exit_3d\": %.3f, \"exit_2d\": %.3f}",
+               stats.m_iJumps, stats.m_iStrafes, stats.m_flSync, stats.m_flSync2, stats.m_iTicks, stats.m_flVelMax3D,
+               stats.m_flVelMax2D, stats.m_flVelAvg3D, stats.m_flVelAvg2D, stats.m_flEnter3D, stats.m_flEnter2D,
+               stats.m_flExit3D, stats.m_flExit2D);
+}
+
+static void WriteJson(CUtlBuffer &out, const CUtlVector<RunAnalysis_t *> &runs)
+{
+    out.PutString("[\n");
+
+    bool bFirst = true;
+    FOR_EACH_VEC(runs, i)
+    {
+        const RunAnalysis_t *pRun = runs[i];
+        if (!pRun->m_bParsed)
+            continue;
+
+        const CReplayHeader &header = pRun->m_Header;
+
+        out.PutString(bFirst ? "  {" : ",\n  {");
+        bFirst = false;
+
+        out.PutString("\"file\": ");
+        WriteJsonString(out, pRun->m_sFile);
+        out.PutString(", \"map\": ");
+        WriteJsonString(out, header.m_szMapName);
+        out.PutString(", \"player\": ");
+        WriteJsonString(out, header.m_szPlayerName);
+        out.Printf(", \"steamid\": \"%llu\", \"version\": %i, \"tick_interval\": %f, \"track\": %i, \"zone\": %i, "
+                   "\"flags\": %u, \"date\": %lld, \"start_tick\": %u, \"stop_tick\": %u, \"time\": %.3f, "
+                   "\"frames\": %i, \"teleports\": %u, ",
+                   header.m_ulSteamID, pRun->m_iVersion, header.m_fTickInterval, header.m_iTrackNumber,
+                   header.m_iZoneNumber, header.m_iRunFlags, static_cast<long long>(header.m_iRunDate),
+                   header.m_iStartTick, header.m_iStopTick,
+                   header.m_fTickInterval * float(header.m_iStopTick - header.m_iStartTick), pRun->m_iFrames,
+                   pRun->m_iTeleports);
+
+        WriteJsonStats(out, "stored", pRun->m_Stored);
+        out.PutString(", ");
+        WriteJsonStats(out, "computed", pRun->m_Computed);
+
+        if (g_iCurveStep > 0)
+        {
+            out.Printf(", \"speed_curve_step\": %i, \"speed_curve\": [", g_iCurveStep);
+            FOR_EACH_VEC(pRun->m_vecSpeedCurve, j)
+                out.Printf(j ? ", %.1f" : "%.1f", pRun->m_vecSpeedCurve[j]);
+            out.PutChar(']');
+        }
+
+        out.PutChar('}');
+    }
+
+    out.PutString("\n]\n");
+}
+
+static void WriteCsv(CUtlBuffer &out, const CUtlVector<RunAnalysis_t *> &runs)
+{
+    out.PutString("file,map,player,steamid,version,tick_interval,track,zone,flags,time,frames,teleports,"
+                  "stored_jumps,stored_strafes,stored_sync,stored_sync2,stored_vel_avg_2d,stored_vel_max_2d,"
+                  "jumps,strafes,sync,sync2,vel_avg_2d,vel_max_2d,vel_avg_3d,vel_max_3d,enter_2d,exit_2d\n");
+
+    FOR_EACH_VEC(runs, i)
+    {
+        const RunAnalysis_t *pRun = runs[i];
+        if (!pRun->m_bParsed)
+            continue;
+
+        const CReplayHeader &header = pRun->m_Header;
+        const StoredStats_t &stored = pRun->m_Stored, &computed = pRun->m_Computed;
+
+        // Paths and names can contain anything, quote them and double any quotes
+        const CUtlString file = pRun->m_sFile.Replace("\"", "\"\"");
+        const CUtlString map = CUtlString(header.m_szMapName).Replace("\"", "\"\"");
+        const CUtlString player = CUtlString(header.m_szPlayerName).Replace("\"", "\"\"");
+
+        out.Printf("\"%s\",\"%s\",\"%s\",%llu,%i,%f,%i,%i,%u,%.3f,%i,%u,", file.Get(), map.Get(), player.Get(),
+                   header.m_ulSteamID, pRun->m_iVersion, header.m_fTickInterval, header.m_iTrackNumber,
+                   header.m_iZoneNumber, header.m_iRunFlags,
+                   header.m_fTickInterval * float(header.m_iStopTick - header.m_iStartTick), pRun->m_iFrames,
+                   pRun->m_iTeleports);
+        out.Printf("%u,%u,%.3f,%.3f,%.3f,%.3f,", stored.m_iJumps, stored.m_iStrafes, stored.m_flSync, stored.m_flSync2,
+                   stored.m_flVelAvg2D, stored.m_flVelMax2D);
+        out.Printf("%u,%u,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f\n", computed.m_iJumps, computed.m_iStrafes,
+                   computed.m_flSync, computed.m_flSync2, computed.m_flVelAvg2D, computed.m_flVelMax2D,
+                   computed.m_flVelAvg3D, computed.m_flVelMax3D, computed.m_flEnter2D, computed.m_flExit2D);
+    }
+}
+
+// Everything but the CSV/JSON goes to stderr, so the data can be piped from stdout
+static SpewRetval_t ReplayToolSpewFunc(SpewType_t type, const tchar *pMsg)
+{
+    fputs(pMsg, stderr);
+    fflush(stderr);
+
+    if (type == SPEW_ASSERT)
+        return SPEW_DEBUGGER;
+    if (type == SPEW_ERROR)
+        return SPEW_ABORT;
+    return SPEW_CONTINUE;
+}
+
+static void PrintUsage()
+{
+    Warning("replaytool [options] <replay file or directory> [...]\n"
+            "  -format <csv|json>  Output format (default csv)\n"
+            "  -o <file>           Write the output to a file instead of stdout\n"
+            "  -threads <n>        Worker threads (default: one per logical core)\n"
+            "  -curve <ticks>      Include the horizontal speed every <ticks> ticks (json only)\n"
+            "  -bench <passes>     Only measure parse and decode throughput over <passes> passes\n");
+}
+
+int main(int argc, char *argv[])
+{
+    SpewOutputFunc(ReplayToolSpewFunc);
+    MathLib_Init();
+
+    const char *pOutFile = nullptr;
+    CUtlVector<RunAnalysis_t *> runs;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const bool bHasValue = i + 1 < argc;
+        if (!V_stricmp(argv[i], "-format") && bHasValue)
+            g_OutputFormat = V_stricmp(argv[++i], "json") ? OUTPUT_CSV : OUTPUT_JSON;
+        else if (!V_stricmp(argv[i], "-o") && bHasValue)
+            pOutFile = argv[++i];
+        else if (!V_stricmp(argv[i], "-threads") && bHasValue)
+            g_iThreads = V_atoi(argv[++i]);
+        else if (!V_stricmp(argv[i], "-curve") && bHasValue)
+            g_iCurveStep = V_atoi(argv[++i]);
+        else if (!V_stricmp(argv[i], "-bench") && bHasValue)
+            g_iBenchPasses = V_atoi(argv[++i]);
+        else if (argv[i][0] == '-')
+        {
+            PrintUsage();
+            return 1;
+        }
+        else
+            AddReplayFiles(argv[i], runs);
+    }
+
+    if (runs.IsEmpty())
+    {
+        PrintUsage();
+        return 1;
+    }
+
+    if (g_iThreads <= 0)
+        g_iThreads = GetCPUInformation()->m_nLogicalProcessors;
+    g_iThreads = clamp(g_iThreads, 1, runs.Count() * max(g_iBenchPasses, 1));
+
+    CInterlockedInt nextRun;
+    nextRun = 0;
+
+    CUtlVector<WorkerState_t> workers;
+    CUtlVector<ThreadHandle_t> threads;
+    workers.SetCount(g_iThreads);
+    threads.SetCount(g_iThreads);
+
+    const double startTime = Plat_FloatTime();
+
+    FOR_EACH_VEC(workers, i)
+    {
+        V_memset(&workers[i], 0, sizeof(WorkerState_t));
+        workers[i].m_pRuns = &runs;
+        workers[i].m_pNextRun = &nextRun;
+        threads[i] = CreateSimpleThread(WorkerThread, &workers[i]);
+    }
+
+    int64 bytes = 0, frames = 0;
+    int replays = 0;
+    FOR_EACH_VEC(threads, i)
+    {
+        ThreadJoin(threads[i]);
+        ReleaseThreadHandle(threads[i]);
+
+        bytes += workers[i].m_iBytes;
+        frames += workers[i].m_iFrames;
+        replays += workers[i].m_iReplays;
+    }
+
+    const double elapsed = max(Plat_FloatTime() - startTime, 1e-6);
+
+    int failed = 0;
+    FOR_EACH_VEC(runs, i)
+    {
+        if (!runs[i]->m_bParsed)
+        {
+            Warning("Failed to read %s\n", runs[i]->m_sFile.Get());
+            failed++;
+        }
+    }
+
+    if (g_iBenchPasses)
+    {
+        Msg("%i replays x %i passes on %i threads in %.3fs\n", runs.Count(), g_iBenchPasses, g_iThreads, elapsed);
+        Msg("  %.1f replays/s, %.2f MB/s, %.0f frames/s\n", replays / elapsed, bytes / elapsed / (1024.0 * 1024.0),
+            frames / elapsed);
+    }
+    else
+    {
+        CUtlBuffer out(0, 0, CUtlBuffer::TEXT_BUFFER);
+        if (g_OutputFormat == OUTPUT_JSON)
+            WriteJson(out, runs);
+        else
+            WriteCsv(out, runs);
+
+        FILE *pFile = pOutFile ? fopen(pOutFile, "wb") : stdout;
+        if (!pFile)
+        {
+            Warning("Couldn't open %s for writing!\n", pOutFile);
+            runs.PurgeAndDeleteElements();
+            return 2;
+        }
+
+        fwrite(out.Base(), 1, out.TellPut(), pFile);
+        if (pOutFile)
+            fclose(pFile);
+
+        Msg("Analyzed %i replays (%i failed) on %i threads in %.3fs\n", runs.Count() - failed, failed, g_iThreads, elapsed);
+    }
+
+    runs.PurgeAndDeleteElements();
+    return failed ? 3 : 0;
+}
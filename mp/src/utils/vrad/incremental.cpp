@@ -718,7 +718,8 @@ void CIncremental::LinkLightsToFaces( CUtlVector<CFaceLightList> &faceLights )
 
 CIncLight::CIncLight()
 {
-	memset( m_pCachedFaces, 0, sizeof(m_pCachedFaces) );
+	m_pCachedFaces.SetCount( THREADINDEX_MAIN + 1 );
+	memset( m_pCachedFaces.Base(), 0, m_pCachedFaces.Count() * sizeof( CLightFace* ) );
 	InitializeCriticalSection( &m_CS );
 }
 
@@ -1675,25 +1675,63 @@ void ExportDirectLightsToWorldLights()
 #define NSAMPLES_SUN_AREA_LIGHT 30							// number of samples to take for an
                                                             // non-point sun light
 
+// Visibility of the groups of 4 samples that need it, both groups at once when there are 2
+static void TestLineGroups( FourVectors const *pStart, FourVectors const *pStop, fltx4 *pFractionVisible,
+						   bool const *pTrace, int nGroups, int static_prop_index_to_ignore )
+{
+	if ( nGroups == 2 && pTrace[0] && pTrace[1] )
+	{
+		TestLine8( pStart, pStop, pFractionVisible, static_prop_index_to_ignore );
+		return;
+	}
+
+	for ( int g = 0; g < nGroups; g++ )
+	{
+		if ( pTrace[g] )
+			TestLine( pStart[g], pStop[g], &pFractionVisible[g], static_prop_index_to_ignore );
+	}
+}
+
+static void TestLineGroups_DoesHitSky( FourVectors const *pStart, FourVectors const *pStop, fltx4 *pFractionVisible,
+									  bool const *pTrace, int nGroups, int static_prop_index_to_ignore )
+{
+	if ( nGroups == 2 && pTrace[0] && pTrace[1] )
+	{
+		TestLine8_DoesHitSky( pStart, pStop, pFractionVisible, true, static_prop_index_to_ignore );
+		return;
+	}
+
+	for ( int g = 0; g < nGroups; g++ )
+	{
+		if ( pTrace[g] )
+			TestLine_DoesHitSky( pStart[g], pStop[g], &pFractionVisible[g], true, static_prop_index_to_ignore );
+	}
+}
+
 // Helper function - gathers light from sun (emit_skylight)
-void GatherSampleSkyLightSSE( SSE_sampleLightOutput_t &out, directlight_t *dl, int facenum, 
-							 FourVectors const& pos, FourVectors *pNormals, int normalCount, int iThread,
+void GatherSampleSkyLightSSE( SSE_sampleLightOutput_t *pOut, directlight_t *dl, int facenum, 
+							 FourVectors const *pPos, FourVectors **ppNormals, int nGroups, int normalCount, int iThread,
 							 int nLFlags, int static_prop_index_to_ignore,
 							 float flEpsilon )
 {
 	bool bIgnoreNormals = ( nLFlags & GATHERLFLAGS_IGNORE_NORMALS ) != 0;
 	bool force_fast = ( nLFlags & GATHERLFLAGS_FORCE_FAST ) != 0;
 
-	fltx4 dot;
+	fltx4 dot[2];
+	bool bLit[2] = { false, false };
 
-	if ( bIgnoreNormals )
-		dot = ReplicateX4( CONSTANT_DOT );
-	else
-		dot = NegSIMD( pNormals[0] * dl->light.normal );
+	for ( int g = 0; g < nGroups; g++ )
+	{
+		if ( bIgnoreNormals )
+			dot[g] = ReplicateX4( CONSTANT_DOT );
+		else
+			dot[g] = NegSIMD( ppNormals[g][0] * dl->light.normal );
 
-	dot = MaxSIMD( dot, Four_Zeros );
-	int zeroMask = TestSignSIMD ( CmpEqSIMD( dot, Four_Zeros ) );
-	if (zeroMask == 0xF)
+		dot[g] = MaxSIMD( dot[g], Four_Zeros );
+		int zeroMask = TestSignSIMD ( CmpEqSIMD( dot[g], Four_Zeros ) );
+		bLit[g] = ( zeroMask != 0xF );
+	}
+	if ( !bLit[0] && !bLit[1] )
 		return;
 
 	int nsamples = 1;
@@ -1704,8 +1742,8 @@ void GatherSampleSkyLightSSE( SSE_sampleLightOutput_t &out, directlight_t *dl, i
 			nsamples /= 4;
 	}
 
-	fltx4 totalFractionVisible = Four_Zeros;
-	fltx4 fractionVisible = Four_Zeros;
+	fltx4 totalFractionVisible[2] = { Four_Zeros, Four_Zeros };
+	fltx4 fractionVisible[2] = { Four_Zeros, Four_Zeros };
 
 	DirectionalSampler_t sampler;
 
@@ -1722,34 +1760,50 @@ void GatherSampleSkyLightSSE( SSE_sampleLightOutput_t &out, directlight_t *dl, i
 			ofs *= MAX_TRACE_LENGTH * g_SunAngularExtent;
 			delta += ofs;
 		}
-		FourVectors delta4;
-		delta4.DuplicateVector ( delta );
-		delta4 += pos;
+		FourVectors delta4[2];
+		for ( int g = 0; g < nGroups; g++ )
+		{
+			delta4[g].DuplicateVector ( delta );
+			delta4[g] += pPos[g];
+		}
 
-		TestLine_DoesHitSky ( pos, delta4, &fractionVisible, true, static_prop_index_to_ignore );
+		TestLineGroups_DoesHitSky( pPos, delta4, fractionVisible, bLit, nGroups, static_prop_index_to_ignore );
 
-		totalFractionVisible = AddSIMD ( totalFractionVisible, fractionVisible );
+		for ( int g = 0; g < nGroups; g++ )
+		{
+			if ( bLit[g] )
+				totalFractionVisible[g] = AddSIMD ( totalFractionVisible[g], fractionVisible[g] );
+		}
 	}
 
-	fltx4 seeAmount = MulSIMD ( totalFractionVisible, ReplicateX4 ( 1.0f / nsamples ) );
-	out.m_flDot[0] = MulSIMD ( dot, seeAmount );
-	out.m_flFalloff = Four_Ones;
-	out.m_flSunAmount = MulSIMD ( seeAmount, ReplicateX4( 10000.0f ) );
-	for ( int i = 1; i < normalCount; i++ )
+	for ( int g = 0; g < nGroups; g++ )
 	{
-		if ( bIgnoreNormals )
-			out.m_flDot[i] = ReplicateX4 ( CONSTANT_DOT );
-		else
+		if ( !bLit[g] )
+			continue;
+
+		SSE_sampleLightOutput_t &out = pOut[g];
+		FourVectors *pNormals = ppNormals[g];
+
+		fltx4 seeAmount = MulSIMD ( totalFractionVisible[g], ReplicateX4 ( 1.0f / nsamples ) );
+		out.m_flDot[0] = MulSIMD ( dot[g], seeAmount );
+		out.m_flFalloff = Four_Ones;
+		out.m_flSunAmount = MulSIMD ( seeAmount, ReplicateX4( 10000.0f ) );
+		for ( int i = 1; i < normalCount; i++ )
 		{
-			out.m_flDot[i] = NegSIMD( pNormals[i] * dl->light.normal );
-			out.m_flDot[i] = MulSIMD( out.m_flDot[i], seeAmount );
+			if ( bIgnoreNormals )
+				out.m_flDot[i] = ReplicateX4 ( CONSTANT_DOT );
+			else
+			{
+				out.m_flDot[i] = NegSIMD( pNormals[i] * dl->light.normal );
+				out.m_flDot[i] = MulSIMD( out.m_flDot[i], seeAmount );
+			}
 		}
 	}
 }
 
 // Helper function - gathers light from ambient sky light
-void GatherSampleAmbientSkySSE( SSE_sampleLightOutput_t &out, directlight_t *dl, int facenum, 
-							   FourVectors const& pos, FourVectors *pNormals, int normalCount, int iThread,
+void GatherSampleAmbientSkySSE( SSE_sampleLightOutput_t *pOut, directlight_t *dl, int facenum, 
+							   FourVectors const *pPos, FourVectors **ppNormals, int nGroups, int normalCount, int iThread,
 							   int nLFlags, int static_prop_index_to_ignore,
 							   float flEpsilon )
 {
@@ -1757,15 +1811,19 @@ void GatherSampleAmbientSkySSE( SSE_sampleLightOutput_t &out, directlight_t *dl,
 	bool bIgnoreNormals = ( nLFlags & GATHERLFLAGS_IGNORE_NORMALS ) != 0;
 	bool force_fast = ( nLFlags & GATHERLFLAGS_FORCE_FAST ) != 0;
 
-	fltx4 sumdot = Four_Zeros;
-	fltx4 ambient_intensity[NUM_BUMP_VECTS+1];
-	fltx4 possibleHitCount[NUM_BUMP_VECTS+1];
-	fltx4 dots[NUM_BUMP_VECTS+1];
+	fltx4 sumdot[2];
+	fltx4 ambient_intensity[2][NUM_BUMP_VECTS+1];
+	fltx4 possibleHitCount[2][NUM_BUMP_VECTS+1];
+	fltx4 dots[2][NUM_BUMP_VECTS+1];
 
-	for ( int i = 0; i < normalCount; i++ )
+	for ( int g = 0; g < nGroups; g++ )
 	{
-		ambient_intensity[i] = Four_Zeros;
-		possibleHitCount[i] = Four_Zeros;
+		sumdot[g] = Four_Zeros;
+		for ( int i = 0; i < normalCount; i++ )
+		{
+			ambient_intensity[g][i] = Four_Zeros;
+			possibleHitCount[g][i] = Four_Zeros;
+		}
 	}
 
 	DirectionalSampler_t sampler;
@@ -1780,73 +1838,94 @@ void GatherSampleAmbientSkySSE( SSE_sampleLightOutput_t &out, directlight_t *dl,
 		FourVectors anorm;
 		anorm.DuplicateVector( sampler.NextValue() );
 
-		if ( bIgnoreNormals )
-			dots[0] = ReplicateX4( CONSTANT_DOT );
-		else
-			dots[0] = NegSIMD( pNormals[0] * anorm );
-
-		fltx4 validity = CmpGtSIMD( dots[0], ReplicateX4( EQUAL_EPSILON ) );
-
-		// No possibility of anybody getting lit
-		if ( !TestSignSIMD( validity ) )
-			continue;
-
-		dots[0] = AndSIMD( validity, dots[0] );
-		sumdot = AddSIMD( dots[0], sumdot );
-		possibleHitCount[0] = AddSIMD( AndSIMD( validity, Four_Ones ), possibleHitCount[0] );
+		bool bTrace[2] = { false, false };
+		FourVectors surfacePos[2], delta[2];
 
-		for ( int i = 1; i < normalCount; i++ )
+		for ( int g = 0; g < nGroups; g++ )
 		{
+			FourVectors *pNormals = ppNormals[g];
+
 			if ( bIgnoreNormals )
-				dots[i] = ReplicateX4( CONSTANT_DOT );
+				dots[g][0] = ReplicateX4( CONSTANT_DOT );
 			else
-				dots[i] = NegSIMD( pNormals[i] * anorm );
-			fltx4 validity2 = CmpGtSIMD( dots[i], ReplicateX4 ( EQUAL_EPSILON ) );
-			dots[i] = AndSIMD( validity2, dots[i] );
-			possibleHitCount[i] = AddSIMD( AndSIMD( AndSIMD( validity, validity2 ), Four_Ones ), possibleHitCount[i] );
+				dots[g][0] = NegSIMD( pNormals[0] * anorm );
+
+			fltx4 validity = CmpGtSIMD( dots[g][0], ReplicateX4( EQUAL_EPSILON ) );
+
+			// No possibility of anybody getting lit
+			if ( !TestSignSIMD( validity ) )
+				continue;
+
+			bTrace[g] = true;
+			dots[g][0] = AndSIMD( validity, dots[g][0] );
+			sumdot[g] = AddSIMD( dots[g][0], sumdot[g] );
+			possibleHitCount[g][0] = AddSIMD( AndSIMD( validity, Four_Ones ), possibleHitCount[g][0] );
+
+			for ( int i = 1; i < normalCount; i++ )
+			{
+				if ( bIgnoreNormals )
+					dots[g][i] = ReplicateX4( CONSTANT_DOT );
+				else
+					dots[g][i] = NegSIMD( pNormals[i] * anorm );
+				fltx4 validity2 = CmpGtSIMD( dots[g][i], ReplicateX4 ( EQUAL_EPSILON ) );
+				dots[g][i] = AndSIMD( validity2, dots[g][i] );
+				possibleHitCount[g][i] = AddSIMD( AndSIMD( AndSIMD( validity, validity2 ), Four_Ones ), possibleHitCount[g][i] );
+			}
+
+			// search back to see if we can hit a sky brush
+			delta[g] = anorm;
+			delta[g] *= -MAX_TRACE_LENGTH;
+			delta[g] += pPos[g];
+			surfacePos[g] = pPos[g];
+			FourVectors offset = anorm;
+			offset *= -flEpsilon;
+			surfacePos[g] -= offset;
 		}
 
-		// search back to see if we can hit a sky brush
-		FourVectors delta = anorm;
-		delta *= -MAX_TRACE_LENGTH;
-		delta += pos;
-		FourVectors surfacePos = pos;
-		FourVectors offset = anorm;
-		offset *= -flEpsilon;
-		surfacePos -= offset;
-
-		fltx4 fractionVisible = Four_Ones;
-		TestLine_DoesHitSky( surfacePos, delta, &fractionVisible, true, static_prop_index_to_ignore );
-		for ( int i = 0; i < normalCount; i++ )
+		if ( !bTrace[0] && !bTrace[1] )
+			continue;
+
+		fltx4 fractionVisible[2] = { Four_Ones, Four_Ones };
+		TestLineGroups_DoesHitSky( surfacePos, delta, fractionVisible, bTrace, nGroups, static_prop_index_to_ignore );
+
+		for ( int g = 0; g < nGroups; g++ )
 		{
-			fltx4 addedAmount = MulSIMD( fractionVisible, dots[i] );
-			ambient_intensity[i] = AddSIMD( ambient_intensity[i], addedAmount );
-		}
+			if ( !bTrace[g] )
+				continue;
 
+			for ( int i = 0; i < normalCount; i++ )
+			{
+				fltx4 addedAmount = MulSIMD( fractionVisible[g], dots[g][i] );
+				ambient_intensity[g][i] = AddSIMD( ambient_intensity[g][i], addedAmount );
+			}
+		}
 	}
 
-	out.m_flFalloff = Four_Ones;
-	for ( int i = 0; i < normalCount; i++ )
+	for ( int g = 0; g < nGroups; g++ )
 	{
-		// now scale out the missing parts of the hemisphere of this bump basis vector
-		fltx4 factor = ReciprocalSIMD( possibleHitCount[0] );
-		factor = MulSIMD( factor, possibleHitCount[i] );
-		out.m_flDot[i] = MulSIMD( factor, sumdot );
-		out.m_flDot[i] = ReciprocalSIMD( out.m_flDot[i] );
-		out.m_flDot[i] = MulSIMD( ambient_intensity[i], out.m_flDot[i] );
+		SSE_sampleLightOutput_t &out = pOut[g];
+
+		out.m_flFalloff = Four_Ones;
+		for ( int i = 0; i < normalCount; i++ )
+		{
+			// now scale out the missing parts of the hemisphere of this bump basis vector
+			fltx4 factor = ReciprocalSIMD( possibleHitCount[g][0] );
+			factor = MulSIMD( factor, possibleHitCount[g][i] );
+			out.m_flDot[i] = MulSIMD( factor, sumdot[g] );
+			out.m_flDot[i] = ReciprocalSIMD( out.m_flDot[i] );
+			out.m_flDot[i] = MulSIMD( ambient_intensity[g][i], out.m_flDot[i] );
+		}
 	}
 
 }
 
-// Helper function - gathers light from area lights, spot lights, and point lights
-void GatherSampleStandardLightSSE( SSE_sampleLightOutput_t &out, directlight_t *dl, int facenum, 
-								  FourVectors const& pos, FourVectors *pNormals, int normalCount, int iThread,
-								  int nLFlags, int static_prop_index_to_ignore,
-								  float flEpsilon )
+// Everything about a standard light up to the visibility trace, src is where the trace goes to.
+// Returns false if the light can't reach any of the samples.
+static bool SetupSampleStandardLightSSE( SSE_sampleLightOutput_t &out, directlight_t *dl, FourVectors const& pos,
+										FourVectors *pNormals, int nLFlags, FourVectors &src, FourVectors &delta, fltx4 &dot )
 {
 	bool bIgnoreNormals = ( nLFlags & GATHERLFLAGS_IGNORE_NORMALS ) != 0;
 
-	FourVectors src;
 	src.DuplicateVector( vec3_origin );
 
 	if (dl->facenum == -1)
@@ -1855,7 +1934,6 @@ void GatherSampleStandardLightSSE( SSE_sampleLightOutput_t &out, directlight_t *
 	}
 
 	// Find light vector
-	FourVectors delta;
 	delta = src;
 	delta -= pos;
 	fltx4 dist2 = delta.length2();
@@ -1864,7 +1942,7 @@ void GatherSampleStandardLightSSE( SSE_sampleLightOutput_t &out, directlight_t *
 	fltx4 dist = SqrtEstSIMD( dist2 );//delta.VectorNormalize();
 
 	// Compute dot
-	fltx4 dot = ReplicateX4( (float) CONSTANT_DOT );
+	dot = ReplicateX4( (float) CONSTANT_DOT );
 	if ( !bIgnoreNormals )
 		dot = delta * pNormals[0];
 	dot = MaxSIMD( Four_Zeros, dot );
@@ -1876,7 +1954,7 @@ void GatherSampleStandardLightSSE( SSE_sampleLightOutput_t &out, directlight_t *
 		fltx4 notPastFadeDist = CmpLeSIMD ( dist, ReplicateX4 ( dl->m_flEndFadeDistance ) );
 		dot = AndSIMD( dot, notPastFadeDist );  // dot = 0 if past fade distance
 		if ( !TestSignSIMD ( notPastFadeDist ) )
-			return;
+			return false;
 	}
 
 	dist = MaxSIMD( dist, Four_Ones );
@@ -1907,7 +1985,7 @@ void GatherSampleStandardLightSSE( SSE_sampleLightOutput_t &out, directlight_t *
 		// Light behind surface yields zero dot
 		dot2 = MaxSIMD( Four_Zeros, dot2 );
 		if ( TestSignSIMD( CmpEqSIMD( Four_Zeros, dot ) ) == 0xF )
-			return;
+			return false;
 
 		out.m_flFalloff = ReciprocalSIMD ( dist2 );
 		out.m_flFalloff = MulSIMD( out.m_flFalloff, dot2 );
@@ -1925,7 +2003,7 @@ void GatherSampleStandardLightSSE( SSE_sampleLightOutput_t &out, directlight_t *
 		// Affix dot2 to zero if outside light cone
 		inCone = CmpGtSIMD( dot2, ReplicateX4( dl->light.stopdot2 ) );
 		if ( !TestSignSIMD ( inCone ) )
-			return;
+			return false;
 		dot = AndSIMD( inCone, dot );
 
 		constant  = ReplicateX4( dl->light.constant_attn );
@@ -1982,9 +2060,14 @@ void GatherSampleStandardLightSSE( SSE_sampleLightOutput_t &out, directlight_t *
 		out.m_flFalloff = MulSIMD( mult, out.m_flFalloff );
 	}
 
-	// Raytrace for visibility function
-	fltx4 fractionVisible = Four_Ones;
-	TestLine( pos, src, &fractionVisible, static_prop_index_to_ignore);
+	return true;
+}
+
+static void FinishSampleStandardLightSSE( SSE_sampleLightOutput_t &out, FourVectors *pNormals, int normalCount,
+										 int nLFlags, FourVectors const& delta, fltx4 dot, fltx4 fractionVisible )
+{
+	bool bIgnoreNormals = ( nLFlags & GATHERLFLAGS_IGNORE_NORMALS ) != 0;
+
 	dot = MulSIMD( fractionVisible, dot );
 	out.m_flDot[0] = dot;
 
@@ -2000,39 +2083,60 @@ void GatherSampleStandardLightSSE( SSE_sampleLightOutput_t &out, directlight_t *
 	}
 }
 
-// returns dot product with normal and delta
-// dl - light
-// pos - position of sample
-// normal - surface normal of sample
-// out.m_flDot[] - returned dot products with light vector and each normal
-// out.m_flFalloff - amount of light falloff
-void GatherSampleLightSSE( SSE_sampleLightOutput_t &out, directlight_t *dl, int facenum, 
-					   FourVectors const& pos, FourVectors *pNormals, int normalCount, int iThread,
-					   int nLFlags,
-					   int static_prop_index_to_ignore,
-					   float flEpsilon )
+// Helper function - gathers light from area lights, spot lights, and point lights
+void GatherSampleStandardLightSSE( SSE_sampleLightOutput_t *pOut, directlight_t *dl, int facenum, 
+								  FourVectors const *pPos, FourVectors **ppNormals, int nGroups, int normalCount, int iThread,
+								  int nLFlags, int static_prop_index_to_ignore,
+								  float flEpsilon )
 {
-	for ( int b = 0; b < normalCount; b++ )
-		out.m_flDot[b] = Four_Zeros;
-	out.m_flFalloff = Four_Zeros;
-	out.m_flSunAmount = Four_Zeros;
+	FourVectors src[2], delta[2];
+	fltx4 dot[2];
+	bool bLit[2] = { false, false };
+
+	for ( int g = 0; g < nGroups; g++ )
+	{
+		bLit[g] = SetupSampleStandardLightSSE( pOut[g], dl, pPos[g], ppNormals[g], nLFlags, src[g], delta[g], dot[g] );
+	}
+
+	// Raytrace for visibility function
+	fltx4 fractionVisible[2] = { Four_Ones, Four_Ones };
+	TestLineGroups( pPos, src, fractionVisible, bLit, nGroups, static_prop_index_to_ignore );
+
+	for ( int g = 0; g < nGroups; g++ )
+	{
+		if ( bLit[g] )
+			FinishSampleStandardLightSSE( pOut[g], ppNormals[g], normalCount, nLFlags, delta[g], dot[g], fractionVisible[g] );
+	}
+}
+
+static void GatherSampleLightGroupsSSE( SSE_sampleLightOutput_t *pOut, directlight_t *dl, int facenum, 
+									   FourVectors const *pPos, FourVectors **ppNormals, int nGroups, int normalCount,
+									   int iThread, int nLFlags, int static_prop_index_to_ignore, float flEpsilon )
+{
+	for ( int g = 0; g < nGroups; g++ )
+	{
+		for ( int b = 0; b < normalCount; b++ )
+			pOut[g].m_flDot[b] = Four_Zeros;
+		pOut[g].m_flFalloff = Four_Zeros;
+		pOut[g].m_flSunAmount = Four_Zeros;
+	}
 	Assert( normalCount <= (NUM_BUMP_VECTS+1) );
 
 	// skylights work fundamentally differently than normal lights
 	switch( dl->light.type )
 	{
 	case emit_skylight:
-		GatherSampleSkyLightSSE( out, dl, facenum, pos, pNormals, normalCount,
+		GatherSampleSkyLightSSE( pOut, dl, facenum, pPos, ppNormals, nGroups, normalCount,
 		                         iThread, nLFlags, static_prop_index_to_ignore, flEpsilon );
 		break;
 	case emit_skyambient:
-		GatherSampleAmbientSkySSE( out, dl, facenum, pos, pNormals, normalCount,
+		GatherSampleAmbientSkySSE( pOut, dl, facenum, pPos, ppNormals, nGroups, normalCount,
 		                           iThread, nLFlags, static_prop_index_to_ignore, flEpsilon );
 		break;
 	case emit_point:
 	case emit_surface:
 	case emit_spotlight:
-		GatherSampleStandardLightSSE( out, dl, facenum, pos, pNormals, normalCount,
+		GatherSampleStandardLightSSE( pOut, dl, facenum, pPos, ppNormals, nGroups, normalCount,
 		                              iThread, nLFlags, static_prop_index_to_ignore, flEpsilon );
 		break;
 	default:
@@ -2044,14 +2148,44 @@ void GatherSampleLightSSE( SSE_sampleLightOutput_t &out, directlight_t *dl, int
 	// (tested by checking the dot product of the face normal and the light position)
 	// we don't want it to contribute to *any* of the bumped lightmaps. It glows
 	// in disturbing ways if we don't do this.
-	out.m_flDot[0] = MaxSIMD ( out.m_flDot[0], Four_Zeros );
-	fltx4 notZero = CmpGtSIMD( out.m_flDot[0], Four_Zeros );
-	for ( int n = 1; n < normalCount; n++ )
+	for ( int g = 0; g < nGroups; g++ )
 	{
-		out.m_flDot[n] = MaxSIMD( out.m_flDot[n], Four_Zeros );
-		out.m_flDot[n] = AndSIMD( out.m_flDot[n], notZero );
+		SSE_sampleLightOutput_t &out = pOut[g];
+
+		out.m_flDot[0] = MaxSIMD ( out.m_flDot[0], Four_Zeros );
+		fltx4 notZero = CmpGtSIMD( out.m_flDot[0], Four_Zeros );
+		for ( int n = 1; n < normalCount; n++ )
+		{
+			out.m_flDot[n] = MaxSIMD( out.m_flDot[n], Four_Zeros );
+			out.m_flDot[n] = AndSIMD( out.m_flDot[n], notZero );
+		}
 	}
+}
 
+// returns dot product with normal and delta
+// dl - light
+// pos - position of sample
+// normal - surface normal of sample
+// out.m_flDot[] - returned dot products with light vector and each normal
+// out.m_flFalloff - amount of light falloff
+void GatherSampleLightSSE( SSE_sampleLightOutput_t &out, directlight_t *dl, int facenum, 
+					   FourVectors const& pos, FourVectors *pNormals, int normalCount, int iThread,
+					   int nLFlags,
+					   int static_prop_index_to_ignore,
+					   float flEpsilon )
+{
+	GatherSampleLightGroupsSSE( &out, dl, facenum, &pos, &pNormals, 1, normalCount, iThread, nLFlags,
+		static_prop_index_to_ignore, flEpsilon );
+}
+
+void GatherSampleLight8SSE( SSE_sampleLightOutput_t *pOut, directlight_t *dl, int facenum, 
+					   FourVectors const *pPos, FourVectors **ppNormals, int normalCount, int iThread,
+					   int nLFlags,
+					   int static_prop_index_to_ignore,
+					   float flEpsilon )
+{
+	GatherSampleLightGroupsSSE( pOut, dl, facenum, pPos, ppNormals, 2, normalCount, iThread, nLFlags,
+		static_prop_index_to_ignore, flEpsilon );
 }
 
 /*
@@ -2491,6 +2625,84 @@ static void ComputeIlluminationPointAndNormalsSSE( lightinfo_t const& l, FourVec
 		pInfo->m_Clusters[i] = ClusterFromPoint( pos.Vec( i ) );
 }
 
+//-----------------------------------------------------------------------------
+// Marks the samples that can see the light's cluster, false if none of them can
+//-----------------------------------------------------------------------------
+static bool ComputeLightPVSMask( SSE_SampleInfo_t const& info, directlight_t *dl, int numSamples, fltx4 &dotMask )
+{
+	dotMask = Four_Zeros;
+	bool skipLight = true;
+	for( int s = 0; s < numSamples; s++ )
+	{
+		if( PVSCheck( dl->pvs, info.m_Clusters[s] ) )
+		{
+			dotMask = SetComponentSIMD( dotMask, s, 1.0f );
+			skipLight = false;
+		}
+	}
+	return !skipLight;
+}
+
+//-----------------------------------------------------------------------------
+// Applies the PVS check filter and computes falloff x dot, false if the light adds nothing
+//-----------------------------------------------------------------------------
+static bool ComputeFalloffTimesDot( SSE_SampleInfo_t const& info, SSE_sampleLightOutput_t const& out, fltx4 dotMask, fltx4 *fxdot )
+{
+	bool skipLight = true;
+	for ( int b = 0; b < info.m_NormalCount; b++ )
+	{
+		fxdot[b] = MulSIMD( out.m_flDot[b], dotMask );
+		fxdot[b] = MulSIMD( fxdot[b], out.m_flFalloff );
+		if ( !IsAllZeros( fxdot[b] ) )
+		{
+			skipLight = false;
+		}
+	}
+	return !skipLight;
+}
+
+//-----------------------------------------------------------------------------
+// Adds a light's falloff x dot at up to 4 sample points to the face's lightmaps
+//-----------------------------------------------------------------------------
+static void AddLightToSamples( SSE_SampleInfo_t& info, directlight_t *dl, int sampleIdx, int numSamples, fltx4 const *fxdot, fltx4 sunAmount )
+{
+	// Figure out the lightstyle for this particular sample
+	int lightStyleIndex = FindOrAllocateLightstyleSamples( info.m_pFace, info.m_pFaceLight, 
+		dl->light.style, info.m_NormalCount );
+	if (lightStyleIndex < 0)
+	{
+		if (info.m_WarnFace != info.m_FaceNum)
+		{
+			Warning ("\nWARNING: Too many light styles on a face at (%f, %f, %f)\n",
+				info.m_Points.x.m128_f32[0], info.m_Points.y.m128_f32[0], info.m_Points.z.m128_f32[0] );
+			info.m_WarnFace = info.m_FaceNum;
+		}
+		return;
+	}
+
+	// pLightmaps is an array of the lightmaps for each normal direction,
+	// here's where the result of the sample gathering goes
+	LightingValue_t** pLightmaps = info.m_pFaceLight->light[lightStyleIndex];
+
+	// Incremental lighting only cares about lightstyle zero
+	if( g_pIncremental && (dl->light.style == 0) )
+	{
+		for ( int i = 0; i < numSamples; i++ )
+		{
+			g_pIncremental->AddLightToFace( dl->m_IncrementalID, info.m_FaceNum, sampleIdx + i, 
+				info.m_LightmapSize, SubFloat( fxdot[0], i ), info.m_iThread );
+		}
+	}
+
+	for( int n = 0; n < info.m_NormalCount; ++n )
+	{
+		for ( int i = 0; i < numSamples; i++ )
+		{
+			pLightmaps[n][sampleIdx + i].AddLight( SubFloat( fxdot[n], i ), dl->light.intensity, SubFloat( sunAmount, i ) );
+		}
+	}
+}
+
 //-----------------------------------------------------------------------------
 // Iterates over all lights and computes lighting at up to 4 sample points
 //-----------------------------------------------------------------------------
@@ -2502,76 +2714,182 @@ static void GatherSampleLightAt4Points( SSE_SampleInfo_t& info, int sampleIdx, i
 	for (directlight_t *dl = activelights; dl != NULL; dl = dl->next)
 	{	    
 		// is this lights cluster visible?
-		fltx4 dotMask = Four_Zeros;
-		bool skipLight = true;
-		for( int s = 0; s < numSamples; s++ )
-		{
-			if( PVSCheck( dl->pvs, info.m_Clusters[s] ) )
-			{
-				dotMask = SetComponentSIMD( dotMask, s, 1.0f );
-				skipLight = false;
-			}
-		}
-		if ( skipLight )
+		fltx4 dotMask;
+		if ( !ComputeLightPVSMask( info, dl, numSamples, dotMask ) )
 			continue;
 
 		GatherSampleLightSSE( out, dl, info.m_FaceNum, info.m_Points, info.m_PointNormals, info.m_NormalCount, info.m_iThread );
 		
-		// Apply the PVS check filter and compute falloff x dot
 		fltx4 fxdot[NUM_BUMP_VECTS + 1];
-		skipLight = true;
-		for ( int b = 0; b < info.m_NormalCount; b++ )
+		if ( !ComputeFalloffTimesDot( info, out, dotMask, fxdot ) )
+			continue;
+
+		AddLightToSamples( info, dl, sampleIdx, numSamples, fxdot, out.m_flSunAmount );
+	}
+}
+
+
+//-----------------------------------------------------------------------------
+// -avx2check: the light at each pair of groups is gathered again with 4 wide
+// traces, and the falloff x dot values that don't match are counted
+//-----------------------------------------------------------------------------
+struct EightWideTraceCheck_t
+{
+	int m_nChecked;
+	int m_nDiffering;
+	float m_flMaxDifference;
+};
+
+static CToolThreadArray<EightWideTraceCheck_t> s_EightWideTraceCheck;
+
+static void CheckEightWideSampleLight( SSE_SampleInfo_t **ppInfo, int const *pNumSamples, directlight_t *dl,
+									   FourVectors const *pPoints, SSE_sampleLightOutput_t const *pOut )
+{
+	SSE_SampleInfo_t const& info = *ppInfo[0];
+	EightWideTraceCheck_t &check = s_EightWideTraceCheck[info.m_iThread];
+
+	for ( int g = 0; g < 2; g++ )
+	{
+		SSE_sampleLightOutput_t ref;
+		GatherSampleLightSSE( ref, dl, info.m_FaceNum, pPoints[g], ppInfo[g]->m_PointNormals, info.m_NormalCount, info.m_iThread );
+
+		for ( int n = 0; n < info.m_NormalCount; n++ )
 		{
-			fxdot[b] = MulSIMD( out.m_flDot[b], dotMask );
-			fxdot[b] = MulSIMD( fxdot[b], out.m_flFalloff );
-			if ( !IsAllZeros( fxdot[b] ) )
+			fltx4 test = MulSIMD( pOut[g].m_flDot[n], pOut[g].m_flFalloff );
+			fltx4 expected = MulSIMD( ref.m_flDot[n], ref.m_flFalloff );
+			for ( int i = 0; i < pNumSamples[g]; i++ )
 			{
-				skipLight = false;
+				float a = SubFloat( test, i );
+				float b = SubFloat( expected, i );
+				float flScale = max( fabs( a ), fabs( b ) );
+				float flDifference = ( flScale > 0.0f ) ? fabs( a - b ) / flScale : 0.0f;
+
+				++check.m_nChecked;
+				if ( flDifference > 1e-4f )
+					++check.m_nDiffering;
+				check.m_flMaxDifference = max( check.m_flMaxDifference, flDifference );
 			}
 		}
-		if ( skipLight )
-			continue;
+	}
+}
 
-		// Figure out the lightstyle for this particular sample
-		int lightStyleIndex = FindOrAllocateLightstyleSamples( info.m_pFace, info.m_pFaceLight, 
-			dl->light.style, info.m_NormalCount );
-		if (lightStyleIndex < 0)
+void ReportEightWideTraceCheck( void )
+{
+	int nChecked = 0, nDiffering = 0;
+	float flMaxDifference = 0.0f;
+	for ( int i = 0; i < s_EightWideTraceCheck.Count(); i++ )
+	{
+		nChecked += s_EightWideTraceCheck[i].m_nChecked;
+		nDiffering += s_EightWideTraceCheck[i].m_nDiffering;
+		flMaxDifference = max( flMaxDifference, s_EightWideTraceCheck[i].m_flMaxDifference );
+	}
+
+	if ( nChecked == 0 )
+	{
+		Msg( "8 wide trace check: no samples were traced 8 at a time\n" );
+		return;
+	}
+
+	Msg( "8 wide trace check: %d of %d light samples differ, largest difference %.3f%%\n",
+		nDiffering, nChecked, flMaxDifference * 100.0f );
+	Msg( "8 wide trace check: %d rays hit differently\n", GetEightWideTraceHitMismatches() );
+}
+
+
+//-----------------------------------------------------------------------------
+// A light at the second of a pair of groups. It's added once the first group has all
+// of its lights, so lightstyles are allocated in the same order as one group at a time.
+//-----------------------------------------------------------------------------
+struct DeferredSampleLight_t
+{
+	directlight_t *m_pLight;
+	float m_flFxDot[NUM_BUMP_VECTS + 1][4];
+	float m_flSunAmount[4];
+};
+
+//-----------------------------------------------------------------------------
+// Iterates over all lights and computes lighting at two groups of up to 4 sample
+// points, tracing the visibility rays for both groups at once
+//-----------------------------------------------------------------------------
+static void GatherSampleLightAt8Points( SSE_SampleInfo_t **ppInfo, int sampleIdx, int const *pNumSamples,
+										CUtlVector<DeferredSampleLight_t> &deferred )
+{
+	SSE_SampleInfo_t& info = *ppInfo[0];
+	SSE_sampleLightOutput_t out[2];
+	FourVectors points[2];
+	FourVectors *pNormals[2];
+	for ( int g = 0; g < 2; g++ )
+	{
+		points[g] = ppInfo[g]->m_Points;
+		pNormals[g] = ppInfo[g]->m_PointNormals;
+	}
+
+	deferred.RemoveAll();
+
+	// Iterate over all direct lights and add them to the particular sample
+	for (directlight_t *dl = activelights; dl != NULL; dl = dl->next)
+	{
+		// is this lights cluster visible?
+		fltx4 dotMask[2];
+		bool bVisible[2];
+		for ( int g = 0; g < 2; g++ )
+		{
+			bVisible[g] = ComputeLightPVSMask( *ppInfo[g], dl, pNumSamples[g], dotMask[g] );
+		}
+
+		if ( bVisible[0] && bVisible[1] )
 		{
-			if (info.m_WarnFace != info.m_FaceNum)
+			GatherSampleLight8SSE( out, dl, info.m_FaceNum, points, pNormals, info.m_NormalCount, info.m_iThread );
+			if ( g_bCheckEightWideTrace )
 			{
-				Warning ("\nWARNING: Too many light styles on a face at (%f, %f, %f)\n",
-					info.m_Points.x.m128_f32[0], info.m_Points.y.m128_f32[0], info.m_Points.z.m128_f32[0] );
-				info.m_WarnFace = info.m_FaceNum;
+				CheckEightWideSampleLight( ppInfo, pNumSamples, dl, points, out );
 			}
+		}
+		else if ( bVisible[0] || bVisible[1] )
+		{
+			int g = bVisible[0] ? 0 : 1;
+			GatherSampleLightSSE( out[g], dl, info.m_FaceNum, points[g], pNormals[g], info.m_NormalCount, info.m_iThread );
+		}
+		else
+		{
 			continue;
 		}
 
-		// pLightmaps is an array of the lightmaps for each normal direction,
-		// here's where the result of the sample gathering goes
-		LightingValue_t** pLightmaps = info.m_pFaceLight->light[lightStyleIndex];
+		fltx4 fxdot[NUM_BUMP_VECTS + 1];
+		if ( bVisible[0] && ComputeFalloffTimesDot( *ppInfo[0], out[0], dotMask[0], fxdot ) )
+		{
+			AddLightToSamples( *ppInfo[0], dl, sampleIdx, pNumSamples[0], fxdot, out[0].m_flSunAmount );
+		}
 
-		// Incremental lighting only cares about lightstyle zero
-		if( g_pIncremental && (dl->light.style == 0) )
+		if ( bVisible[1] && ComputeFalloffTimesDot( *ppInfo[1], out[1], dotMask[1], fxdot ) )
 		{
-			for ( int i = 0; i < numSamples; i++ )
+			DeferredSampleLight_t &light = deferred[ deferred.AddToTail() ];
+			light.m_pLight = dl;
+			for ( int n = 0; n < info.m_NormalCount; n++ )
 			{
-				g_pIncremental->AddLightToFace( dl->m_IncrementalID, info.m_FaceNum, sampleIdx + i, 
-					info.m_LightmapSize, SubFloat( fxdot[0], i ), info.m_iThread );
+				StoreUnalignedSIMD( light.m_flFxDot[n], fxdot[n] );
 			}
+			StoreUnalignedSIMD( light.m_flSunAmount, out[1].m_flSunAmount );
 		}
+	}
+
+	for ( int i = 0; i < deferred.Count(); i++ )
+	{
+		DeferredSampleLight_t const &light = deferred[i];
 
-		for( int n = 0; n < info.m_NormalCount; ++n )
+		fltx4 fxdot[NUM_BUMP_VECTS + 1];
+		for ( int n = 0; n < info.m_NormalCount; n++ )
 		{
-			for ( int i = 0; i < numSamples; i++ )
-			{
-				pLightmaps[n][sampleIdx + i].AddLight( SubFloat( fxdot[n], i ), dl->light.intensity, SubFloat( out.m_flSunAmount, i ) );
-			}
+			fxdot[n] = LoadUnalignedSIMD( light.m_flFxDot[n] );
 		}
+
+		AddLightToSamples( *ppInfo[1], light.m_pLight, sampleIdx + 4, pNumSamples[1], fxdot, LoadUnalignedSIMD( light.m_flSunAmount ) );
 	}
 }
 
 
 
+
 //-----------------------------------------------------------------------------
 // Iterates over all lights and computes lighting at a sample point
 //-----------------------------------------------------------------------------
@@ -3062,6 +3380,40 @@ static void InitSampleInfo( lightinfo_t const& l, int iThread, SSE_SampleInfo_t&
 	}
 }
 
+//-----------------------------------------------------------------------------
+// Loads a group of up to 4 samples and computes their illumination points + normals
+//-----------------------------------------------------------------------------
+static int ComputeSampleGroupSSE( lightinfo_t const& l, SSE_SampleInfo_t& info, int grp )
+{
+	int nSample = 4 * grp;
+
+	sample_t *sample = info.m_pFaceLight->sample + nSample;
+	int numSamples = min ( 4, info.m_pFaceLight->numsamples - nSample );
+
+	FourVectors positions;
+	FourVectors normals;
+	Vector v[4], n[4];
+
+	for ( int i = 0; i < 4; i++ )
+	{
+		v[i] = ( i < numSamples ) ? sample[i].pos : sample[numSamples - 1].pos;
+		n[i] = ( i < numSamples ) ? sample[i].normal : sample[numSamples - 1].normal;
+	}
+	positions.LoadAndSwizzle( v[0], v[1], v[2], v[3] );
+	normals.LoadAndSwizzle( n[0], n[1], n[2], n[3] );
+
+	ComputeIlluminationPointAndNormalsSSE( l, positions, normals, &info, numSamples );
+
+	// Fixup sample normals in case of smooth faces
+	if ( !l.isflat )
+	{
+		for ( int i = 0; i < numSamples; i++ )
+			sample[i].normal = info.m_PointNormals[0].Vec( i );
+	}
+
+	return numSamples;
+}
+
 void BuildFacelights (int iThread, int facenum)
 {
 	lightinfo_t	l;
@@ -3070,7 +3422,6 @@ void BuildFacelights (int iThread, int facenum)
 	SSE_SampleInfo_t sampleInfo;
 	directlight_t *dl;
 	Vector spot;
-	Vector v[4], n[4];
 
 	if( g_bInterrupt )
 		return;
@@ -3117,36 +3468,39 @@ void BuildFacelights (int iThread, int facenum)
 	f->styles[0] = 0;
 	AllocateLightstyleSamples( fl, 0, sampleInfo.m_NormalCount );
 
-	// sample the lights at each sample location
-	for ( int grp = 0; grp < numGroups; ++grp )
+	// sample the lights at each sample location, two groups at a time when their
+	// visibility rays can be traced together
+	if ( g_RtEnv.CanTrace8RaysTogether() )
 	{
-		int nSample = 4 * grp;
-
-		sample_t *sample = sampleInfo.m_pFaceLight->sample + nSample;
-		int numSamples = min ( 4, sampleInfo.m_pFaceLight->numsamples - nSample );
-
-		FourVectors positions;
-		FourVectors normals;
+		SSE_SampleInfo_t pairedInfo = sampleInfo;
+		SSE_SampleInfo_t *pGroupInfo[2] = { &sampleInfo, &pairedInfo };
+		CUtlVector<DeferredSampleLight_t> deferred;
 
-		for ( int i = 0; i < 4; i++ )
+		int grp = 0;
+		for ( ; grp + 1 < numGroups; grp += 2 )
 		{
-			v[i] = ( i < numSamples ) ? sample[i].pos : sample[numSamples - 1].pos;
-			n[i] = ( i < numSamples ) ? sample[i].normal : sample[numSamples - 1].normal;
-		}
-		positions.LoadAndSwizzle( v[0], v[1], v[2], v[3] );
-		normals.LoadAndSwizzle( n[0], n[1], n[2], n[3] );
+			int numSamples[2];
+			numSamples[0] = ComputeSampleGroupSSE( l, sampleInfo, grp );
+			numSamples[1] = ComputeSampleGroupSSE( l, pairedInfo, grp + 1 );
 
-		ComputeIlluminationPointAndNormalsSSE( l, positions, normals, &sampleInfo, numSamples );
+			GatherSampleLightAt8Points( pGroupInfo, 4 * grp, numSamples, deferred );
+		}
 
-		// Fixup sample normals in case of smooth faces
-		if ( !l.isflat )
+		if ( grp < numGroups )
 		{
-			for ( int i = 0; i < numSamples; i++ )
-				sample[i].normal = sampleInfo.m_PointNormals[0].Vec( i );
+			int numSamples = ComputeSampleGroupSSE( l, sampleInfo, grp );
+			GatherSampleLightAt4Points( sampleInfo, 4 * grp, numSamples );
 		}
+	}
+	else
+	{
+		for ( int grp = 0; grp < numGroups; ++grp )
+		{
+			int numSamples = ComputeSampleGroupSSE( l, sampleInfo, grp );
 
-		// Iterate over all the lights and add their contribution to this group of spots
-		GatherSampleLightAt4Points( sampleInfo, nSample, numSamples );
+			// Iterate over all the lights and add their contribution to this group of spots
+			GatherSampleLightAt4Points( sampleInfo, 4 * grp, numSamples );
+		}
 	}
 	
 	// Tell the incremental light manager that we're done with this face.
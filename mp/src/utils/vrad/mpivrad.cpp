@@ -315,7 +315,7 @@ public:
 	transfer_t *m_pBuildVisLeafsTransfers;
 };
 
-CVMPIVisLeafsData g_VMPIVisLeafsData[MAX_TOOL_THREADS+1];
+CToolThreadArray<CVMPIVisLeafsData> g_VMPIVisLeafsData;
 
 
 
@@ -378,7 +378,7 @@ void RunMPIBuildVisLeafs()
 		StartPacifier("");
 	}
 
-	memset( g_VMPIVisLeafsData, 0, sizeof( g_VMPIVisLeafsData ) );
+	memset( g_VMPIVisLeafsData.Base(), 0, g_VMPIVisLeafsData.Count() * sizeof( CVMPIVisLeafsData ) );
 	if ( !g_bMPIMaster || VMPI_GetActiveWorkUnitDistributor() == k_eWorkUnitDistributor_SDK )
 	{
 		// Allocate space for the transfers for each thread.
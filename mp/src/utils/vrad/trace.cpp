@@ -13,6 +13,8 @@
 #include "trace.h"
 #include "Cmodel.h"
 #include "mathlib/vmatrix.h"
+#include "vstdlib/random.h"
+#include "tier0/threadtools.h"
 
 
 //=============================================================================
@@ -81,7 +83,7 @@ float TraceLeafBrushes( int leafIndex, const Vector &start, const Vector &end, C
 	return 1.0f;
 }
 
-DispTested_t s_DispTested[MAX_TOOL_THREADS+1];
+CToolThreadArray<DispTested_t> s_DispTested;
 
 // this just uses the average coverage for the triangle
 class CCoverageCount : public ITransparentTriangleCallback
@@ -148,21 +150,19 @@ public:
 	}
 };
 
-void TestLine( const FourVectors& start, const FourVectors& stop,
-               fltx4 *pFractionVisible, int static_prop_index_to_ignore )
+// Rays from start to stop, returns their lengths
+static fltx4 SetupTestLineRays( FourVectors const& start, FourVectors const& stop, FourRays &rays )
 {
-	FourRays myrays;
-	myrays.origin = start;
-	myrays.direction = stop;
-	myrays.direction -= myrays.origin;
-	fltx4 len = myrays.direction.length();
-	myrays.direction *= ReciprocalSIMD( len );
-
-	RayTracingResult rt_result;
-	CCoverageCountTexture coverageCallback;
-
-	g_RtEnv.Trace4Rays(myrays, Four_Zeros, len, &rt_result, TRACE_ID_STATICPROP | static_prop_index_to_ignore, g_bTextureShadows ? &coverageCallback : 0 );
+	rays.origin = start;
+	rays.direction = stop;
+	rays.direction -= rays.origin;
+	fltx4 len = rays.direction.length();
+	rays.direction *= ReciprocalSIMD( len );
+	return len;
+}
 
+static fltx4 FractionVisibleFromTrace( RayTracingResult const& rt_result, fltx4 len, CCoverageCountTexture &coverageCallback )
+{
 	// Assume we can see the targets unless we get hits
 	float visibility[4];
 	for ( int i = 0; i < 4; i++ )
@@ -174,9 +174,83 @@ void TestLine( const FourVectors& start, const FourVectors& stop,
 			visibility[i] = 0.0f;
 		}
 	}
-	*pFractionVisible = LoadUnalignedSIMD( visibility );
+	fltx4 fractionVisible = LoadUnalignedSIMD( visibility );
 	if ( g_bTextureShadows )
-		*pFractionVisible = MinSIMD( *pFractionVisible, coverageCallback.GetFractionVisible() );
+		fractionVisible = MinSIMD( fractionVisible, coverageCallback.GetFractionVisible() );
+	return fractionVisible;
+}
+
+void TestLine( const FourVectors& start, const FourVectors& stop,
+               fltx4 *pFractionVisible, int static_prop_index_to_ignore )
+{
+	FourRays myrays;
+	fltx4 len = SetupTestLineRays( start, stop, myrays );
+
+	RayTracingResult rt_result;
+	CCoverageCountTexture coverageCallback;
+
+	g_RtEnv.Trace4Rays(myrays, Four_Zeros, len, &rt_result, TRACE_ID_STATICPROP | static_prop_index_to_ignore, g_bTextureShadows ? &coverageCallback : 0 );
+
+	*pFractionVisible = FractionVisibleFromTrace( rt_result, len, coverageCallback );
+}
+
+//-----------------------------------------------------------------------------
+// -avx2check: traces each half of an 8 wide trace again 4 at a time and counts
+// the rays whose hit mask within the ray length doesn't match
+//-----------------------------------------------------------------------------
+static long volatile s_nEightWideHitMismatches = 0;
+
+static void CheckEightWideHitMask( EightRays const& rays, fltx4 const *pLen, RayTracingResult const *pResult, int skip_id )
+{
+	for ( int i = 0; i < 2; i++ )
+	{
+		RayTracingResult ref;
+		CCoverageCountTexture coverageCallback;
+		g_RtEnv.Trace4Rays( rays.half[i], Four_Zeros, pLen[i], &ref, skip_id, g_bTextureShadows ? &coverageCallback : 0 );
+
+		for ( int r = 0; r < 4; r++ )
+		{
+			bool bHit = ( pResult[i].HitIds[r] != -1 ) && ( pResult[i].HitDistance.m128_f32[r] < pLen[i].m128_f32[r] );
+			bool bRefHit = ( ref.HitIds[r] != -1 ) && ( ref.HitDistance.m128_f32[r] < pLen[i].m128_f32[r] );
+			if ( bHit != bRefHit )
+			{
+				ThreadInterlockedIncrement( &s_nEightWideHitMismatches );
+			}
+		}
+	}
+}
+
+int GetEightWideTraceHitMismatches( void )
+{
+	return s_nEightWideHitMismatches;
+}
+
+void TestLine8( FourVectors const *pStart, FourVectors const *pStop,
+                fltx4 *pFractionVisible, int static_prop_index_to_ignore )
+{
+	EightRays myrays;
+	fltx4 tmin[2] = { Four_Zeros, Four_Zeros };
+	fltx4 len[2];
+	for ( int i = 0; i < 2; i++ )
+	{
+		len[i] = SetupTestLineRays( pStart[i], pStop[i], myrays.half[i] );
+	}
+
+	RayTracingResult rt_result[2];
+	CCoverageCountTexture coverageCallback[2];
+	ITransparentTriangleCallback *pCallbacks[2] = { &coverageCallback[0], &coverageCallback[1] };
+
+	g_RtEnv.Trace8Rays( myrays, tmin, len, rt_result, TRACE_ID_STATICPROP | static_prop_index_to_ignore, g_bTextureShadows ? pCallbacks : NULL );
+
+	if ( g_bCheckEightWideTrace )
+	{
+		CheckEightWideHitMask( myrays, len, rt_result, TRACE_ID_STATICPROP | static_prop_index_to_ignore );
+	}
+
+	for ( int i = 0; i < 2; i++ )
+	{
+		pFractionVisible[i] = FractionVisibleFromTrace( rt_result[i], len[i], coverageCallback[i] );
+	}
 }
 
 
@@ -349,25 +423,10 @@ void DM_ClipBoxToBrush( CToolTrace *trace, const Vector& mins, const Vector& max
 	}
 }
 
-void TestLine_DoesHitSky( FourVectors const& start, FourVectors const& stop,
-	fltx4 *pFractionVisible, bool canRecurse, int static_prop_to_skip, bool bDoDebug )
+// How much of the sky the rays see, going on into the 3D skyboxes if they reach it
+static void FinishSkyTrace( FourVectors const& start, FourVectors const& stop, RayTracingResult const& rt_result, fltx4 len,
+	CCoverageCountTexture &coverageCallback, fltx4 *pFractionVisible, bool canRecurse, int static_prop_to_skip, bool bDoDebug )
 {
-	FourRays myrays;
-	myrays.origin = start;
-	myrays.direction = stop;
-	myrays.direction -= myrays.origin;
-	fltx4 len = myrays.direction.length();
-	myrays.direction *= ReciprocalSIMD( len );
-	RayTracingResult rt_result;
-	CCoverageCountTexture coverageCallback;
-
-	g_RtEnv.Trace4Rays(myrays, Four_Zeros, len, &rt_result, TRACE_ID_STATICPROP | static_prop_to_skip, g_bTextureShadows? &coverageCallback : 0);
-
-	if ( bDoDebug )
-	{
-		WriteTrace( "trace.txt", myrays, rt_result );
-	}
-
 	float aOcclusion[4];
 	for ( int i = 0; i < 4; i++ )
 	{
@@ -430,6 +489,54 @@ void TestLine_DoesHitSky( FourVectors const& start, FourVectors const& stop,
 
 
 
+void TestLine_DoesHitSky( FourVectors const& start, FourVectors const& stop,
+	fltx4 *pFractionVisible, bool canRecurse, int static_prop_to_skip, bool bDoDebug )
+{
+	FourRays myrays;
+	fltx4 len = SetupTestLineRays( start, stop, myrays );
+	RayTracingResult rt_result;
+	CCoverageCountTexture coverageCallback;
+
+	g_RtEnv.Trace4Rays(myrays, Four_Zeros, len, &rt_result, TRACE_ID_STATICPROP | static_prop_to_skip, g_bTextureShadows? &coverageCallback : 0);
+
+	if ( bDoDebug )
+	{
+		WriteTrace( "trace.txt", myrays, rt_result );
+	}
+
+	FinishSkyTrace( start, stop, rt_result, len, coverageCallback, pFractionVisible, canRecurse, static_prop_to_skip, bDoDebug );
+}
+
+void TestLine8_DoesHitSky( FourVectors const *pStart, FourVectors const *pStop,
+	fltx4 *pFractionVisible, bool canRecurse, int static_prop_to_skip )
+{
+	EightRays myrays;
+	fltx4 tmin[2] = { Four_Zeros, Four_Zeros };
+	fltx4 len[2];
+	for ( int i = 0; i < 2; i++ )
+	{
+		len[i] = SetupTestLineRays( pStart[i], pStop[i], myrays.half[i] );
+	}
+
+	RayTracingResult rt_result[2];
+	CCoverageCountTexture coverageCallback[2];
+	ITransparentTriangleCallback *pCallbacks[2] = { &coverageCallback[0], &coverageCallback[1] };
+
+	g_RtEnv.Trace8Rays( myrays, tmin, len, rt_result, TRACE_ID_STATICPROP | static_prop_to_skip, g_bTextureShadows ? pCallbacks : NULL );
+
+	if ( g_bCheckEightWideTrace )
+	{
+		CheckEightWideHitMask( myrays, len, rt_result, TRACE_ID_STATICPROP | static_prop_to_skip );
+	}
+
+	for ( int i = 0; i < 2; i++ )
+	{
+		FinishSkyTrace( pStart[i], pStop[i], rt_result[i], len[i], coverageCallback[i], &pFractionVisible[i], canRecurse, static_prop_to_skip, false );
+	}
+}
+
+
+
 //-----------------------------------------------------------------------------
 //-----------------------------------------------------------------------------
 int PointLeafnum_r( const Vector &point, int ndxNode )
@@ -651,3 +758,153 @@ void AddBrushesForRayTrace( void )
 		}
 	}
 }
+
+
+//-----------------------------------------------------------------------------
+// Runs the independent subtrees of the kd tree build on the tool threads
+//-----------------------------------------------------------------------------
+struct RayTraceParallelJob_t
+{
+	RayTraceParallelItemFn	m_pfnItem;
+	void					*m_pUserData;
+};
+
+static void RayTraceParallelRange( int iThread, int iStart, int iEnd, void *pUserData )
+{
+	RayTraceParallelJob_t *pJob = ( RayTraceParallelJob_t * )pUserData;
+	for ( int i = iStart; i < iEnd; i++ )
+	{
+		pJob->m_pfnItem( i, pJob->m_pUserData );
+	}
+}
+
+void RayTraceParallelFor( int nItems, RayTraceParallelItemFn pfnItem, void *pUserData )
+{
+	RayTraceParallelJob_t job;
+	job.m_pfnItem = pfnItem;
+	job.m_pUserData = pUserData;
+
+	// The subtrees are very uneven, one at a time lets the idle threads steal the big ones
+	RunThreadsOnRange( nItems, 1, false, RayTraceParallelRange, &job );
+}
+
+
+//-----------------------------------------------------------------------------
+// -kdtreebench: builds the kd tree both ways and traces the same rays through
+// each, to check the binned build against the reference one
+//-----------------------------------------------------------------------------
+#define KDTREE_BENCH_RAYS	( 1 << 22 )
+
+// Traces the rays 4 at a time, storing the hit id and distance of each
+static double KDTreeBenchTrace( const CUtlVector<Vector> &origins, const CUtlVector<Vector> &directions, float flMaxDist,
+							   CUtlVector<int32> &hitIds, CUtlVector<float> &hitDists )
+{
+	fltx4 TMax = ReplicateX4( flMaxDist );
+
+	double flStart = Plat_FloatTime();
+	for ( int i = 0; i < origins.Count(); i += 4 )
+	{
+		FourRays rays;
+		rays.origin.LoadAndSwizzle( origins[i], origins[i + 1], origins[i + 2], origins[i + 3] );
+		rays.direction.LoadAndSwizzle( directions[i], directions[i + 1], directions[i + 2], directions[i + 3] );
+
+		RayTracingResult result;
+		g_RtEnv.Trace4Rays( rays, Four_Zeros, TMax, &result );
+
+		for ( int j = 0; j < 4; j++ )
+		{
+			hitIds[i + j] = result.HitIds[j];
+			hitDists[i + j] = SubFloat( result.HitDistance, j );
+		}
+	}
+	return Plat_FloatTime() - flStart;
+}
+
+void BenchmarkRayTraceKDTree( void )
+{
+	Msg( "\nkd tree benchmark, %d triangles:\n", g_RtEnv.OptimizedTriangleList.Count() );
+
+	uint32 nOldFlags = g_RtEnv.Flags;
+	g_RtEnv.Flags |= RTE_FLAGS_REFERENCE_TREE_GENERATION;
+	double flStart = Plat_FloatTime();
+	g_RtEnv.BuildKDTree();
+	double flReferenceBuild = Plat_FloatTime() - flStart;
+	g_RtEnv.Flags = nOldFlags;
+
+	CUtlVector<CacheOptimizedKDNode> referenceTree;
+	CUtlVector<int32> referenceIndices;
+	referenceTree.Swap( g_RtEnv.OptimizedKDTree );
+	referenceIndices.Swap( g_RtEnv.TriangleIndexList );
+
+	flStart = Plat_FloatTime();
+	g_RtEnv.BuildKDTree();
+	double flBinnedBuild = Plat_FloatTime() - flStart;
+
+	g_RtEnv.ConvertTrianglesToIntersectionFormat();
+
+	Msg( "  reference build: %.3f seconds, %d nodes, %d triangle references\n", flReferenceBuild,
+		referenceTree.Count(), referenceIndices.Count() );
+	Msg( "  binned build:    %.3f seconds, %d nodes, %d triangle references (%.1fx)\n", flBinnedBuild,
+		g_RtEnv.OptimizedKDTree.Count(), g_RtEnv.TriangleIndexList.Count(),
+		flBinnedBuild > 0.0 ? flReferenceBuild / flBinnedBuild : 0.0 );
+
+	// Fixed seed so every run traces the same rays
+	CUniformRandomStream random;
+	random.SetSeed( 12345 );
+
+	CUtlVector<Vector> origins, directions;
+	origins.SetCount( KDTREE_BENCH_RAYS );
+	directions.SetCount( KDTREE_BENCH_RAYS );
+	for ( int i = 0; i < KDTREE_BENCH_RAYS; i++ )
+	{
+		origins[i].Init( random.RandomFloat( g_RtEnv.m_MinBound.x, g_RtEnv.m_MaxBound.x ),
+			random.RandomFloat( g_RtEnv.m_MinBound.y, g_RtEnv.m_MaxBound.y ),
+			random.RandomFloat( g_RtEnv.m_MinBound.z, g_RtEnv.m_MaxBound.z ) );
+
+		directions[i].Init( random.RandomFloat( -1, 1 ), random.RandomFloat( -1, 1 ), random.RandomFloat( -1, 1 ) );
+		if ( VectorNormalize( directions[i] ) == 0.0f )
+		{
+			directions[i].Init( 0, 0, -1 );
+		}
+	}
+
+	float flMaxDist = ( g_RtEnv.m_MaxBound - g_RtEnv.m_MinBound ).Length();
+
+	CUtlVector<int32> binnedIds, referenceIds;
+	CUtlVector<float> binnedDists, referenceDists;
+	binnedIds.SetCount( KDTREE_BENCH_RAYS );
+	referenceIds.SetCount( KDTREE_BENCH_RAYS );
+	binnedDists.SetCount( KDTREE_BENCH_RAYS );
+	referenceDists.SetCount( KDTREE_BENCH_RAYS );
+
+	double flBinnedTrace = KDTreeBenchTrace( origins, directions, flMaxDist, binnedIds, binnedDists );
+
+	referenceTree.Swap( g_RtEnv.OptimizedKDTree );
+	referenceIndices.Swap( g_RtEnv.TriangleIndexList );
+	double flReferenceTrace = KDTreeBenchTrace( origins, directions, flMaxDist, referenceIds, referenceDists );
+	referenceTree.Swap( g_RtEnv.OptimizedKDTree );
+	referenceIndices.Swap( g_RtEnv.TriangleIndexList );
+
+	// Trace4Rays doesn't clip hits to TMax, which ones past it get reported depends on the leaves.
+	// Only the hits in range have to match.
+	int nHits = 0, nMismatches = 0;
+	for ( int i = 0; i < KDTREE_BENCH_RAYS; i++ )
+	{
+		bool bBinnedHit = binnedIds[i] != -1 && binnedDists[i] <= flMaxDist;
+		bool bReferenceHit = referenceIds[i] != -1 && referenceDists[i] <= flMaxDist;
+
+		if ( bReferenceHit )
+		{
+			nHits++;
+		}
+
+		if ( bBinnedHit != bReferenceHit || ( bBinnedHit && fabs( binnedDists[i] - referenceDists[i] ) > 1e-3f ) )
+		{
+			nMismatches++;
+		}
+	}
+
+	Msg( "  reference trace: %.0f rays/sec\n", flReferenceTrace > 0.0 ? KDTREE_BENCH_RAYS / flReferenceTrace : 0.0 );
+	Msg( "  binned trace:    %.0f rays/sec\n", flBinnedTrace > 0.0 ? KDTREE_BENCH_RAYS / flBinnedTrace : 0.0 );
+	Msg( "  %d of %d rays hit, %d hits differ\n\n", nHits, KDTREE_BENCH_RAYS, nMismatches );
+}
@@ -56,6 +56,8 @@ float		g_MaxDispPatchRadius = 1500.0f;			// Maximum radius allowed for displacem
 qboolean	g_bDumpPatches;
 bool	    bDumpNormals = false;
 bool		g_bDumpRtEnv = false;
+bool		g_bBenchKDTree = false;
+bool		g_bCheckEightWideTrace = false;
 bool		bRed2Black = true;
 bool		g_bFastAmbient = false;
 bool        g_bNoSkyRecurse = false;
@@ -2028,6 +2030,15 @@ bool RadWorld_Go()
 		RunThreadsOnIndividual (numfaces, true, BuildFacelights);
 	}
 
+	if ( g_bCheckEightWideTrace )
+	{
+		ReportEightWideTraceCheck();
+		if ( GetEightWideTraceHitMismatches() > 0 )
+		{
+			Error( "-avx2check: %d rays hit differently when traced 8 at a time\n", GetEightWideTraceHitMismatches() );
+		}
+	}
+
 	// Was the process interrupted?
 	if( g_pIncremental && (g_iCurFace != numfaces) )
 		return false;
@@ -2269,7 +2280,11 @@ void VRAD_LoadBSP( char const *pFilename )
 	// Build acceleration structure
 	printf ( "Setting up ray-trace acceleration structure... ");
 	float start = Plat_FloatTime();
-	g_RtEnv.SetupAccelerationStructure();
+	g_RtEnv.m_pfnParallelFor = RayTraceParallelFor;
+	if ( g_bBenchKDTree )
+		BenchmarkRayTraceKDTree();	// also sets it up, leaving the binned tree
+	else
+		g_RtEnv.SetupAccelerationStructure();
 	float end = Plat_FloatTime();
 	printf ( "Done (%.2f seconds)\n", end-start );
 
@@ -2414,6 +2429,18 @@ int ParseCommandLine( int argc, char **argv, bool *onlydetail )
 		{
 			g_bDumpRtEnv = true;
 		}
+		else if ( !Q_stricmp( argv[i], "-kdtreebench" ) )
+		{
+			g_bBenchKDTree = true;
+		}
+		else if ( !Q_stricmp( argv[i], "-noavx2" ) )
+		{
+			g_RtEnv.Flags |= RTE_FLAGS_NO_AVX2;
+		}
+		else if ( !Q_stricmp( argv[i], "-avx2check" ) )
+		{
+			g_bCheckEightWideTrace = true;
+		}
 		else if ( !Q_stricmp( argv[i], "-LargeDispSampleRadius" ) )
 		{
 			g_bLargeDispSampleRadius = true;
@@ -2814,6 +2841,12 @@ void PrintUsage( int argc, char **argv )
 		"  -dump           : Write debugging .txt files.\n"
 		"  -dumpnormals    : Write normals to debug files.\n"
 		"  -dumptrace      : Write ray-tracing environment to debug files.\n"
+		"  -kdtreebench    : Time the ray-tracing k-d tree build and compare it to the\n"
+		"                    reference build.\n"
+		"  -noavx2         : Don't trace visibility rays 8 at a time on AVX2 CPUs.\n"
+		"  -avx2check      : Also trace the 8 at a time rays 4 at a time, report\n"
+		"                    how many light samples differ and fail if any ray\n"
+		"                    hits differently.\n"
 		"  -threads        : Control the number of threads vbsp uses (defaults to the #\n"
 		"                    or processors on your machine).\n"
 		"  -lights <file>  : Load a lights file in addition to lights.rad and the\n"
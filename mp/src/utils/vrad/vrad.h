@@ -290,6 +290,7 @@ extern bool g_bStaticPropPolys;
 extern bool g_bTextureShadows;
 extern bool g_bShowStaticPropNormals;
 extern bool g_bDisablePropSelfShadowing;
+extern bool g_bCheckEightWideTrace;
 
 extern CUtlVector<char const *> g_NonShadowCastingMaterialStrings;
 extern void ForceTextureShadowsOnModel( const char *pModelName );
@@ -361,6 +362,7 @@ qboolean IsIncremental(char *filename);
 int SaveIncremental(char *filename);
 int PartialHead (void);
 void BuildFacelights (int facenum, int threadnum);
+void ReportEightWideTraceCheck( void );
 void PrecompLightmapOffsets();
 void FinalLightFace (int threadnum, int facenum);
 void PvsForOrigin (Vector& org, byte *pvs);
@@ -390,10 +392,23 @@ void TestLine( FourVectors const& start, FourVectors const& stop, fltx4 *pFracti
 void TestLine_DoesHitSky( FourVectors const& start, FourVectors const& stop,
                           fltx4 *pFractionVisible, bool canRecurse = true, int static_prop_to_skip=-1, bool bDoDebug = false );
 
+// the same for 2 groups of 4 rays, traced together when g_RtEnv.CanTrace8RaysTogether()
+void TestLine8( FourVectors const *pStart, FourVectors const *pStop, fltx4 *pFractionVisible, int static_prop_index_to_ignore=-1 );
+void TestLine8_DoesHitSky( FourVectors const *pStart, FourVectors const *pStop,
+                           fltx4 *pFractionVisible, bool canRecurse = true, int static_prop_to_skip=-1 );
+// -avx2check: rays whose 8 wide hit mask didn't match the 4 wide trace
+int GetEightWideTraceHitMismatches( void );
+
 // converts any marked brush entities to triangles for shadow casting
 void ExtractBrushEntityShadowCasters ( void );
 void AddBrushesForRayTrace ( void );
 
+// lets g_RtEnv build its kd tree on the tool threads
+void RayTraceParallelFor( int nItems, RayTraceParallelItemFn pfnItem, void *pUserData );
+// -kdtreebench: sets up g_RtEnv, building its kd tree with both the reference and the binned
+// builder and comparing them
+void BenchmarkRayTraceKDTree( void );
+
 void BaseLightForFace( dface_t *f, Vector& light, float *parea, Vector& reflectivity );
 void CreateDirectLights (void);
 void GetPhongNormal( int facenum, Vector const& spot, Vector& phongnormal );
@@ -459,6 +474,12 @@ void GatherSampleLightSSE( SSE_sampleLightOutput_t &out, directlight_t *dl, int
 					   int nLFlags = 0,					// GATHERLFLAGS_xxx
 					   int static_prop_to_skip=-1,
 					   float flEpsilon = 0.0 );
+// GatherSampleLightSSE for 2 groups of 4 samples, the light's visibility is traced for all 8 at once
+void GatherSampleLight8SSE( SSE_sampleLightOutput_t *pOut, directlight_t *dl, int facenum, 
+					   FourVectors const *pPos, FourVectors **ppNormals, int normalCount, int iThread,
+					   int nLFlags = 0,					// GATHERLFLAGS_xxx
+					   int static_prop_to_skip=-1,
+					   float flEpsilon = 0.0 );
 //void GatherSampleSkyLightSSE( SSE_sampleLightOutput_t &out, directlight_t *dl, int facenum, 
 //							 FourVectors const& pos, FourVectors *pNormals, int normalCount, int iThread,
 //							 int nLFlags = 0,
@@ -604,8 +625,8 @@ public:
 	virtual void AddPolysForRayTrace() = 0;
 };
 
-//extern PropTested_t s_PropTested[MAX_TOOL_THREADS+1];
-extern DispTested_t s_DispTested[MAX_TOOL_THREADS+1];
+//extern CToolThreadArray<PropTested_t> s_PropTested;
+extern CToolThreadArray<DispTested_t> s_DispTested;
 
 IVradStaticPropMgr* StaticPropMgr();
 
@@ -777,10 +777,10 @@ static void ComputeAmbientLighting( int iThread, DetailObjectLump_t& prop, Vecto
 
 
 //-----------------------------------------------------------------------------
-// Computes lighting for a single detail prop
+// Computes lighting for a single detail prop, its lightstyles are added to lightStyles
 //-----------------------------------------------------------------------------
 
-static void ComputeLighting( DetailObjectLump_t& prop, int iThread )
+static void ComputeLighting( DetailObjectLump_t& prop, int iThread, CUtlVector<DetailPropLightstylesLump_t> &lightStyles )
 {
 	// We're going to take the maximum of the ambient lighting and 
 	// the strongest directional light. This works because we're assuming
@@ -814,13 +814,13 @@ static void ComputeLighting( DetailObjectLump_t& prop, int iThread )
 		{
 			if (!hasLightstyles)
 			{
-				prop.m_LightStyles = s_pDetailPropLightStyleLump->Size();
+				prop.m_LightStyles = lightStyles.Size();
 				hasLightstyles = true;
 			}
 
-			int j = s_pDetailPropLightStyleLump->AddToTail();
-			VectorToColorRGBExp32( totalColor, (*s_pDetailPropLightStyleLump)[j].m_Lighting );
-			(*s_pDetailPropLightStyleLump)[j].m_Style = i;
+			int j = lightStyles.AddToTail();
+			VectorToColorRGBExp32( totalColor, lightStyles[j].m_Lighting );
+			lightStyles[j].m_Style = i;
 			++prop.m_LightStyleCount;
 		}
 	}
@@ -965,7 +965,7 @@ void VMPI_ProcessDetailPropWU( int iThread, int iWorkUnit, MessageBuffer *pBuf )
 	CUtlVector<DetailPropLightstylesLump_t> *pDetailPropLump = s_pDetailPropLightStyleLump;
 
 	DetailObjectLump_t& prop = g_pMPIDetailProps[iWorkUnit];
-	ComputeLighting( prop, iThread );
+	ComputeLighting( prop, iThread, *pDetailPropLump );
 
 	// Send the results back...	
 	pBuf->write( &prop.m_Lighting, sizeof( prop.m_Lighting ) );
@@ -1001,6 +1001,29 @@ void VMPI_ReceiveDetailPropWU( int iWorkUnit, MessageBuffer *pBuf, int iWorker )
 	}
 }
 	
+//-----------------------------------------------------------------------------
+// The props are lit in parallel, each thread adding lightstyles to its own list.
+// They're copied into the lump in prop order afterwards, so the lump is the same
+// however the props were split between the threads.
+//-----------------------------------------------------------------------------
+struct DetailPropLightingJob_t
+{
+	DetailObjectLump_t *m_pProps;
+	CUtlVector<int> m_PropThread;	// Which thread's list holds each prop's lightstyles
+	CUtlVector< CUtlVector<DetailPropLightstylesLump_t> > m_ThreadLightStyles;
+};
+
+static void ComputeDetailPropLightingRange( int iThread, int iStart, int iEnd, void *pUserData )
+{
+	DetailPropLightingJob_t *pJob = (DetailPropLightingJob_t*)pUserData;
+
+	for ( int i = iStart; i < iEnd; ++i )
+	{
+		ComputeLighting( pJob->m_pProps[i], iThread, pJob->m_ThreadLightStyles[iThread] );
+		pJob->m_PropThread[i] = iThread;
+	}
+}
+
 //-----------------------------------------------------------------------------
 // Computes lighting for the detail props
 //-----------------------------------------------------------------------------
@@ -1022,15 +1045,27 @@ void ComputeDetailPropLighting( int iThread )
 		UnserializeDetailPropLighting( GAMELUMP_DETAIL_PROP_LIGHTING_HDR, GAMELUMP_DETAIL_PROP_LIGHTING_HDR_VERSION, s_DetailPropLightStyleLumpHDR );
 	}
 
-	StartPacifier("Computing detail prop lighting : ");
+	// Find the sky light before the threads start, they all share the cached pointer
+	FindAmbientSkyLight();
+
+	DetailPropLightingJob_t job;
+	job.m_pProps = pProps;
+	job.m_PropThread.SetCount( count );
+	job.m_ThreadLightStyles.SetCount( numthreads + 1 );
 
-	for (int i = 0; i < count; ++i)
+	RunThreadsOnRange( count, 16, true, ComputeDetailPropLightingRange, &job );
+
+	for ( int i = 0; i < count; ++i )
 	{
-		UpdatePacifier( (float)i / (float)count );
-		ComputeLighting( pProps[i], iThread );
+		DetailObjectLump_t &prop = pProps[i];
+		if ( !prop.m_LightStyleCount )
+			continue;
+
+		CUtlVector<DetailPropLightstylesLump_t> &threadStyles = job.m_ThreadLightStyles[ job.m_PropThread[i] ];
+		int nFirst = s_pDetailPropLightStyleLump->AddMultipleToTail( prop.m_LightStyleCount, &threadStyles[prop.m_LightStyles] );
+		prop.m_LightStyles = nFirst;
 	}
 
 	// Write detail prop lightstyle lump...
 	WriteDetailLightingLumps();
-	EndPacifier( true );
 }
@@ -0,0 +1,293 @@
+//========= Copyright Valve Corporation, All rights reserved. ============//
+//
+// Purpose: Bit vector kernels for the portal flow
+//
+// The AVX2 kernels are only run on CPUs that have it, so the file is still
+// compiled for SSE2 and only the functions marked AVX2_FUNC use AVX.
+//
+// $NoKeywords: $
+//=============================================================================//
+
+#include "visbits.h"
+#include <emmintrin.h>
+#include <immintrin.h>
+#ifdef _WIN32
+#include <intrin.h>
+#endif
+
+#ifdef __GNUC__
+#define AVX2_FUNC __attribute__((target("avx2")))
+#else
+#define AVX2_FUNC
+#endif
+
+
+static bool CPUHasAVX2( void )
+{
+#ifdef _WIN32
+	int info[4];
+	__cpuid( info, 0 );
+	if ( info[0] < 7 )
+		return false;
+
+	// needs AVX, and the OS saving the ymm registers
+	__cpuid( info, 1 );
+	if ( ( info[2] & 0x18000000 ) != 0x18000000 || ( _xgetbv( 0 ) & 6 ) != 6 )
+		return false;
+
+	__cpuidex( info, 7, 0 );
+	return ( info[1] & 0x20 ) != 0;
+#else
+	__builtin_cpu_init();
+	return __builtin_cpu_supports( "avx2" ) != 0;
+#endif
+}
+
+
+//-----------------------------------------------------------------------------
+// Byte at a time, for the ends of the vectors
+//-----------------------------------------------------------------------------
+static FORCEINLINE bool AndTestNewBytes( byte *dest, const byte *a, const byte *b, const byte *seen, int i, int nBytes )
+{
+	int more = 0;
+	for ( ; i < nBytes; i++ )
+	{
+		dest[i] = a[i] & b[i];
+		more |= dest[i] & ~seen[i];
+	}
+	return more != 0;
+}
+
+static FORCEINLINE void OrBytes( byte *dest, const byte *src, int i, int nBytes )
+{
+	for ( ; i < nBytes; i++ )
+		dest[i] |= src[i];
+}
+
+static FORCEINLINE int CountBytes( const byte *bits, int i, int nBytes )
+{
+	int c = 0;
+	for ( ; i < nBytes; i++ )
+	{
+		for ( int b = bits[i]; b; b &= b - 1 )
+			c++;
+	}
+	return c;
+}
+
+
+//-----------------------------------------------------------------------------
+// Scalar
+//-----------------------------------------------------------------------------
+static bool AndTestNew_Scalar( byte *dest, const byte *a, const byte *b, const byte *seen, int nBytes )
+{
+	int nLongs = nBytes / sizeof(long);
+	long more = 0;
+	for ( int j = 0; j < nLongs; j++ )
+	{
+		((long *)dest)[j] = ((const long *)a)[j] & ((const long *)b)[j];
+		more |= ((long *)dest)[j] & ~((const long *)seen)[j];
+	}
+
+	bool bTail = AndTestNewBytes( dest, a, b, seen, nLongs * sizeof(long), nBytes );
+	return bTail || more != 0;
+}
+
+static void Or_Scalar( byte *dest, const byte *src, int nBytes )
+{
+	int nLongs = nBytes / sizeof(long);
+	for ( int j = 0; j < nLongs; j++ )
+		((long *)dest)[j] |= ((const long *)src)[j];
+
+	OrBytes( dest, src, nLongs * sizeof(long), nBytes );
+}
+
+static int Count_Scalar( const byte *bits, int nBytes )
+{
+	int c = 0;
+	for ( int i = 0; i < nBytes * 8; i++ )
+	{
+		if ( bits[i >> 3] & ( 1 << ( i & 7 ) ) )
+			c++;
+	}
+	return c;
+}
+
+
+//-----------------------------------------------------------------------------
+// SSE2
+//-----------------------------------------------------------------------------
+static FORCEINLINE __m128i PopCountBytes_SSE2( __m128i v )
+{
+	const __m128i m1 = _mm_set1_epi8( 0x55 );
+	const __m128i m2 = _mm_set1_epi8( 0x33 );
+	const __m128i m4 = _mm_set1_epi8( 0x0f );
+	v = _mm_sub_epi8( v, _mm_and_si128( _mm_srli_epi64( v, 1 ), m1 ) );
+	v = _mm_add_epi8( _mm_and_si128( v, m2 ), _mm_and_si128( _mm_srli_epi64( v, 2 ), m2 ) );
+	return _mm_and_si128( _mm_add_epi8( v, _mm_srli_epi64( v, 4 ) ), m4 );
+}
+
+static bool AndTestNew_SSE2( byte *dest, const byte *a, const byte *b, const byte *seen, int nBytes )
+{
+	__m128i more = _mm_setzero_si128();
+	int i = 0;
+	for ( ; i + 16 <= nBytes; i += 16 )
+	{
+		__m128i m = _mm_and_si128( _mm_loadu_si128( (const __m128i *)( a + i ) ), _mm_loadu_si128( (const __m128i *)( b + i ) ) );
+		_mm_storeu_si128( (__m128i *)( dest + i ), m );
+		more = _mm_or_si128( more, _mm_andnot_si128( _mm_loadu_si128( (const __m128i *)( seen + i ) ), m ) );
+	}
+
+	bool bTail = AndTestNewBytes( dest, a, b, seen, i, nBytes );
+	return bTail || _mm_movemask_epi8( _mm_cmpeq_epi8( more, _mm_setzero_si128() ) ) != 0xFFFF;
+}
+
+static void Or_SSE2( byte *dest, const byte *src, int nBytes )
+{
+	int i = 0;
+	for ( ; i + 16 <= nBytes; i += 16 )
+	{
+		__m128i d = _mm_loadu_si128( (const __m128i *)( dest + i ) );
+		_mm_storeu_si128( (__m128i *)( dest + i ), _mm_or_si128( d, _mm_loadu_si128( (const __m128i *)( src + i ) ) ) );
+	}
+
+	OrBytes( dest, src, i, nBytes );
+}
+
+static int Count_SSE2( const byte *bits, int nBytes )
+{
+	__m128i total = _mm_setzero_si128();
+	int i = 0;
+	for ( ; i + 16 <= nBytes; i += 16 )
+	{
+		__m128i v = PopCountBytes_SSE2( _mm_loadu_si128( (const __m128i *)( bits + i ) ) );
+		total = _mm_add_epi64( total, _mm_sad_epu8( v, _mm_setzero_si128() ) );
+	}
+
+	int c = _mm_cvtsi128_si32( total ) + _mm_cvtsi128_si32( _mm_srli_si128( total, 8 ) );
+	return c + CountBytes( bits, i, nBytes );
+}
+
+
+//-----------------------------------------------------------------------------
+// AVX2
+//-----------------------------------------------------------------------------
+AVX2_FUNC static bool AndTestNew_AVX2( byte *dest, const byte *a, const byte *b, const byte *seen, int nBytes )
+{
+	__m256i more = _mm256_setzero_si256();
+	int i = 0;
+	for ( ; i + 32 <= nBytes; i += 32 )
+	{
+		__m256i m = _mm256_and_si256( _mm256_loadu_si256( (const __m256i *)( a + i ) ), _mm256_loadu_si256( (const __m256i *)( b + i ) ) );
+		_mm256_storeu_si256( (__m256i *)( dest + i ), m );
+		more = _mm256_or_si256( more, _mm256_andnot_si256( _mm256_loadu_si256( (const __m256i *)( seen + i ) ), m ) );
+	}
+	bool bMore = !_mm256_testz_si256( more, more );
+	_mm256_zeroupper();
+
+	bool bTail = AndTestNewBytes( dest, a, b, seen, i, nBytes );
+	return bTail || bMore;
+}
+
+AVX2_FUNC static void Or_AVX2( byte *dest, const byte *src, int nBytes )
+{
+	int i = 0;
+	for ( ; i + 32 <= nBytes; i += 32 )
+	{
+		__m256i d = _mm256_loadu_si256( (const __m256i *)( dest + i ) );
+		_mm256_storeu_si256( (__m256i *)( dest + i ), _mm256_or_si256( d, _mm256_loadu_si256( (const __m256i *)( src + i ) ) ) );
+	}
+	_mm256_zeroupper();
+
+	OrBytes( dest, src, i, nBytes );
+}
+
+// Looks up the bit count of each nibble with a byte shuffle
+AVX2_FUNC static int Count_AVX2( const byte *bits, int nBytes )
+{
+	const __m256i lookup = _mm256_setr_epi8( 0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+											 0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4 );
+	const __m256i lowNibbles = _mm256_set1_epi8( 0x0f );
+
+	__m256i total = _mm256_setzero_si256();
+	int i = 0;
+	for ( ; i + 32 <= nBytes; i += 32 )
+	{
+		__m256i v = _mm256_loadu_si256( (const __m256i *)( bits + i ) );
+		__m256i lo = _mm256_and_si256( v, lowNibbles );
+		__m256i hi = _mm256_and_si256( _mm256_srli_epi16( v, 4 ), lowNibbles );
+		__m256i c = _mm256_add_epi8( _mm256_shuffle_epi8( lookup, lo ), _mm256_shuffle_epi8( lookup, hi ) );
+		total = _mm256_add_epi64( total, _mm256_sad_epu8( c, _mm256_setzero_si256() ) );
+	}
+
+	__m128i sum = _mm_add_epi64( _mm256_castsi256_si128( total ), _mm256_extracti128_si256( total, 1 ) );
+	int c = _mm_cvtsi128_si32( sum ) + _mm_cvtsi128_si32( _mm_srli_si128( sum, 8 ) );
+	_mm256_zeroupper();
+
+	return c + CountBytes( bits, i, nBytes );
+}
+
+
+//-----------------------------------------------------------------------------
+// Dispatch
+//-----------------------------------------------------------------------------
+struct VisBitsKernelFns_t
+{
+	const char			*m_pName;
+	VisBitsAndTestNewFn	m_pfnAndTestNew;
+	VisBitsOrFn			m_pfnOr;
+	VisBitsCountFn		m_pfnCount;
+};
+
+static const VisBitsKernelFns_t s_Kernels[VISBITS_KERNEL_COUNT] =
+{
+	{ "scalar",	AndTestNew_Scalar,	Or_Scalar,	Count_Scalar },
+	{ "SSE2",	AndTestNew_SSE2,	Or_SSE2,	Count_SSE2 },
+	{ "AVX2",	AndTestNew_AVX2,	Or_AVX2,	Count_AVX2 },
+};
+
+static VisBitsKernel_t s_Kernel = VISBITS_SSE2;
+static bool s_bCPUHasAVX2 = CPUHasAVX2();
+
+VisBitsAndTestNewFn	VisBits_AndTestNew = AndTestNew_SSE2;
+VisBitsOrFn			VisBits_Or = Or_SSE2;
+VisBitsCountFn		VisBits_Count = Count_SSE2;
+
+
+bool VisBits_IsKernelSupported( VisBitsKernel_t kernel )
+{
+	if ( kernel == VISBITS_AVX2 )
+		return s_bCPUHasAVX2;
+
+	return kernel >= 0 && kernel < VISBITS_KERNEL_COUNT;
+}
+
+bool VisBits_SetKernel( VisBitsKernel_t kernel )
+{
+	if ( !VisBits_IsKernelSupported( kernel ) )
+		return false;
+
+	s_Kernel = kernel;
+	VisBits_AndTestNew = s_Kernels[kernel].m_pfnAndTestNew;
+	VisBits_Or = s_Kernels[kernel].m_pfnOr;
+	VisBits_Count = s_Kernels[kernel].m_pfnCount;
+	return true;
+}
+
+VisBitsKernel_t VisBits_GetKernel( void )
+{
+	return s_Kernel;
+}
+
+const char *VisBits_KernelName( VisBitsKernel_t kernel )
+{
+	return s_Kernels[kernel].m_pName;
+}
+
+void VisBits_Init( bool bAllowAVX2 )
+{
+	if ( !bAllowAVX2 || !VisBits_SetKernel( VISBITS_AVX2 ) )
+	{
+		VisBits_SetKernel( VISBITS_SSE2 );
+	}
+}
@@ -0,0 +1,49 @@
+//========= Copyright Valve Corporation, All rights reserved. ============//
+//
+// Purpose: Bit vector kernels for the portal flow
+//
+// $NoKeywords: $
+//=============================================================================//
+
+#ifndef VISBITS_H
+#define VISBITS_H
+#ifdef _WIN32
+#pragma once
+#endif
+
+#include "basetypes.h"
+
+
+enum VisBitsKernel_t
+{
+	VISBITS_SCALAR = 0,		// The original long at a time loops
+	VISBITS_SSE2,
+	VISBITS_AVX2,
+
+	VISBITS_KERNEL_COUNT
+};
+
+// The kernels default to SSE2. This picks AVX2 when the CPU has it, call it before the threads start.
+void VisBits_Init( bool bAllowAVX2 );
+
+// Returns false if the CPU can't run the kernel
+bool VisBits_SetKernel( VisBitsKernel_t kernel );
+VisBitsKernel_t VisBits_GetKernel( void );
+bool VisBits_IsKernelSupported( VisBitsKernel_t kernel );
+const char *VisBits_KernelName( VisBitsKernel_t kernel );
+
+// The bit vectors can be any length and alignment
+
+// dest = a & b, returns true if dest has any bits that aren't set in seen
+typedef bool (*VisBitsAndTestNewFn)( byte *dest, const byte *a, const byte *b, const byte *seen, int nBytes );
+// dest |= src
+typedef void (*VisBitsOrFn)( byte *dest, const byte *src, int nBytes );
+// Number of bits set
+typedef int (*VisBitsCountFn)( const byte *bits, int nBytes );
+
+extern VisBitsAndTestNewFn	VisBits_AndTestNew;
+extern VisBitsOrFn			VisBits_Or;
+extern VisBitsCountFn		VisBits_Count;
+
+
+#endif // VISBITS_H
@@ -9,6 +9,7 @@
 
 #include <windows.h>
 #include "vis.h"
+#include "visbits.h"
 #include "threads.h"
 #include "stdlib.h"
 #include "pacifier.h"
@@ -55,6 +56,8 @@ bool		g_bUseRadius = false;
 double		g_VisRadius = 4096.0f * 4096.0f;
 
 bool		g_bLowPriority = false;
+bool		g_bNoAVX2 = false;
+bool		g_bBenchVisBits = false;
 
 //=============================================================================
 
@@ -199,7 +202,7 @@ void ClusterMerge (int clusternum)
 //	byte		portalvector[MAX_PORTALS/8];
 	byte		portalvector[MAX_PORTALS/4];      // 4 because portal bytes is * 2
 	byte		uncompressedLeafs[MAX_MAP_LEAFS/8];
-	int			i, j;
+	int			i;
 	int			numvis;
 	portal_t	*p;
 	int			pnum;
@@ -213,8 +216,7 @@ void ClusterMerge (int clusternum)
 		p = leaf->portals[i];
 		if (p->status != stat_done)
 			Error ("portal not done %d %p %p\n", i, p, portals);
-		for (j=0 ; j<portallongs ; j++)
-			((long *)portalvector)[j] |= ((long *)p->portalvis)[j];
+		VisBits_Or (portalvector, p->portalvis, portalbytes);
 		pnum = p - portals;
 		SetBit( portalvector, pnum );
 	}
@@ -366,6 +368,86 @@ void CalcVis (void)
 }
 
 
+/*
+==================
+BenchmarkVisBits
+
+Times each set of bit vector kernels on the portals from the .prt file,
+using the same and / and not / count pattern as the portal flow
+==================
+*/
+void BenchmarkVisBits (void)
+{
+	int			i, j, k, r;
+	portal_t	*p, *p2;
+	leaf_t		*leaf;
+	byte		*dest, *accum;
+	double		start, time, scalarTime;
+	int64		numNew[VISBITS_KERNEL_COUNT], numBits[VISBITS_KERNEL_COUNT];
+	int			numAccum[VISBITS_KERNEL_COUNT];
+	VisBitsKernel_t	bestKernel;
+
+	RunThreadsOnIndividual (g_numportals*2, true, BasePortalVis);
+
+	// enough rounds to process about 256mb of bits
+	int numPairs = 0;
+	for (i=0 ; i<g_numportals*2 ; i++)
+		numPairs += leafs[portals[i].leaf].portals.Count();
+	int numRounds = 1 + (256 << 20) / (numPairs * portalbytes + 1);
+
+	Msg ("%i portal pairs, %i bytes per vector, %i rounds\n", numPairs, portalbytes, numRounds);
+
+	dest = (byte*)malloc (portalbytes);
+	accum = (byte*)malloc (portalbytes);
+	bestKernel = VisBits_GetKernel ();
+	scalarTime = 0;
+
+	for (k=0 ; k<VISBITS_KERNEL_COUNT ; k++)
+	{
+		if ( !VisBits_SetKernel( (VisBitsKernel_t)k ) )
+		{
+			Msg ("%-8s: not supported by this CPU\n", VisBits_KernelName( (VisBitsKernel_t)k ));
+			continue;
+		}
+
+		numNew[k] = 0;
+		numBits[k] = 0;
+		memset (accum, 0, portalbytes);
+
+		start = Plat_FloatTime();
+		for (r=0 ; r<numRounds ; r++)
+		{
+			// flow from each portal through the portals of the leaf it leads into
+			for (i=0, p=portals ; i<g_numportals*2 ; i++, p++)
+			{
+				leaf = &leafs[p->leaf];
+				for (j=0 ; j<leaf->portals.Count() ; j++)
+				{
+					p2 = leaf->portals[j];
+					if ( VisBits_AndTestNew( dest, p->portalflood, p2->portalflood, p->portalfront, portalbytes ) )
+						numNew[k]++;
+					numBits[k] += CountBits (dest, g_numportals*2);
+					VisBits_Or (accum, dest, portalbytes);
+				}
+			}
+		}
+		time = Plat_FloatTime() - start;
+		numAccum[k] = CountBits (accum, g_numportals*2);
+
+		if ( k == VISBITS_SCALAR )
+			scalarTime = time;
+
+		bool bMatch = numNew[k] == numNew[VISBITS_SCALAR] && numBits[k] == numBits[VISBITS_SCALAR] && numAccum[k] == numAccum[VISBITS_SCALAR];
+		Msg ("%-8s: %.3f seconds, %.2fx scalar%s\n", VisBits_KernelName( (VisBitsKernel_t)k ), time,
+			time > 0 ? scalarTime / time : 0.0, bMatch ? "" : "  (RESULTS DON'T MATCH SCALAR)");
+	}
+
+	VisBits_SetKernel (bestKernel);
+	free (dest);
+	free (accum);
+}
+
+
 void SetPortalSphere (portal_t *p)
 {
 	int		i;
@@ -567,9 +649,9 @@ by ORing together all the PVS visible from a leaf
 */
 void CalcPAS (void)
 {
-	int		i, j, k, l, index;
+	int		i, j, k, index;
 	int		bitbyte;
-	long	*dest, *src;
+	long	*dest;
 	byte	*scan;
 	int		count;
 	byte	uncompressed[MAX_MAP_LEAFS/8];
@@ -595,19 +677,10 @@ void CalcPAS (void)
 				index = ((j<<3)+k);
 				if (index >= portalclusters)
 					Error ("Bad bit in PVS");	// pad bits should be 0
-				src = (long *)(uncompressedvis + index*leafbytes);
-				dest = (long *)uncompressed;
-				for (l=0 ; l<leaflongs ; l++)
-					((long *)uncompressed)[l] |= src[l];
-			}
-		}
-		for (j=0 ; j<portalclusters ; j++)
-		{
-			if ( CheckBit( uncompressed, j ) )
-			{
-				count++;
+				VisBits_Or (uncompressed, uncompressedvis + index*leafbytes, leafbytes);
 			}
 		}
+		count += CountBits (uncompressed, portalclusters);
 
 	//
 	// compress the bit string
@@ -953,6 +1026,14 @@ int ParseCommandLine( int argc, char **argv )
 		{
 			g_bLowPriority = true;
 		}
+		else if ( !Q_stricmp( argv[i], "-noavx2" ) )
+		{
+			g_bNoAVX2 = true;
+		}
+		else if ( !Q_stricmp( argv[i], "-bitsbench" ) )
+		{
+			g_bBenchVisBits = true;
+		}
 		else if ( !Q_stricmp( argv[i], "-FullMinidumps" ) )
 		{
 			EnableFullMinidumps( true );
@@ -1034,6 +1115,9 @@ void PrintUsage( int argc, char **argv )
 		"  -tmpout         : Make portals come from \\tmp\\<mapname>.\n"
 		"  -trace <start cluster> <end cluster> : Writes a linefile that traces the vis from one cluster to another for debugging map vis.\n"
 		"  -FullMinidumps  : Write large minidumps on crash.\n"
+		"  -noavx2         : Don't use the AVX2 bit vector code on CPUs that have it.\n"
+		"  -bitsbench      : Time the bit vector code on the map's portals, and don't\n"
+		"                    write the bsp.\n"
 		"\n"
 #if 1 // Disabled for the initial SDK release with VMPI so we can get feedback from selected users.
 		);
@@ -1123,6 +1207,7 @@ int RunVVis( int argc, char **argv )
 	}
 
 	ThreadSetDefault ();
+	VisBits_Init( !g_bNoAVX2 );
 
 	Msg ("reading %s\n", mapFile);
 	LoadBSPFile (mapFile);
@@ -1161,7 +1246,11 @@ int RunVVis( int argc, char **argv )
 	LoadPortals (portalfile);
 
 	// don't write out results when simply doing a trace
-	if ( g_TraceClusterStart < 0 )
+	if ( g_bBenchVisBits )
+	{
+		BenchmarkVisBits ();
+	}
+	else if ( g_TraceClusterStart < 0 )
 	{
 		CalcVis ();
 		CalcPAS ();